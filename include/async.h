@@ -0,0 +1,115 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_ASYNC_H
+#define _TMS_ASYNC_H
+
+/**
+ * @file
+ * @brief Declares the asynchronous evaluation of scientific expressions, for hosts that can't block a thread on a long
+ * evaluation (ex: event loops).
+ * @details tms_evaluate_async() queues the parsing and evaluation of an expression as a task of the thread pool (see
+ * thread_pool.h) and returns immediately. The completion is reported by a callback, or through a file descriptor that
+ * can be polled with the other events of the host (tms_async_eventfd() and tms_async_completed()).\n
+ * A job can be cancelled while it is queued or running, the evaluator stops before its next extended or user function
+ * call and integrate() stops between blocks of points.
+ */
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/c_complex_to_cpp.h>
+#include <tmsolve/tms_math_strs.h>
+#else
+#include "c_complex_to_cpp.h"
+#include "tms_math_strs.h"
+#endif
+#include <stddef.h>
+
+/// @brief Asynchronous evaluation, created by tms_evaluate_async() and freed by tms_async_free().
+typedef struct tms_async_job tms_async_job;
+
+/**
+ * @brief Function called when an asynchronous evaluation completes.
+ * @param job The completed job, still owned by the caller of tms_evaluate_async() (it can be freed here).
+ * @param data The pointer passed to tms_evaluate_async().
+ */
+typedef void (*tms_async_callback)(tms_async_job *job, void *data);
+
+/// @brief States of an asynchronous evaluation.
+enum tms_async_states
+{
+    TMS_ASYNC_QUEUED,
+    TMS_ASYNC_RUNNING,
+    TMS_ASYNC_DONE,
+    TMS_ASYNC_FAILED,
+    TMS_ASYNC_CANCELLED
+};
+
+/**
+ * @brief Parses and evaluates an expression on the thread pool.
+ * @param expr Expression to solve, copied.
+ * @param options Supported: ENABLE_CMPLX, EXPAND_UOPS and SHARED_LOCK (recommended, the evaluations run concurrently
+ * with each other and with the other shared evaluations).
+ * @param labels Labels of the expression with their values (payload), copied. Can be NULL.
+ * @param callback Called by a pool thread when the job completes, or by tms_async_cancel() for a queued job. If NULL,
+ * the completed job is reported by tms_async_completed().
+ * @param data Passed to the callback, see also tms_async_data().
+ * @return The job, NULL if memory allocation failed or no pool thread could be started.
+ * @note The callback must not wait for other jobs or resize the thread pool.
+ */
+tms_async_job *tms_evaluate_async(const char *expr, int options, tms_arg_list *labels, tms_async_callback callback,
+                                  void *data);
+
+/// @brief Returns the state of a job, see enum tms_async_states.
+int tms_async_state(tms_async_job *job);
+
+/**
+ * @brief Gets the answer of a completed job.
+ * @return 0 on success, -1 if the job failed, was cancelled or isn't complete yet.
+ */
+int tms_async_result(tms_async_job *job, cdouble *result);
+
+/// @brief Returns the error message of a failed or cancelled job, NULL if none.
+const char *tms_async_error(tms_async_job *job);
+
+/// @brief Returns the data pointer passed to tms_evaluate_async().
+void *tms_async_data(tms_async_job *job);
+
+/**
+ * @brief Blocks until a job completes.
+ * @return The final state of the job.
+ */
+int tms_async_wait(tms_async_job *job);
+
+/**
+ * @brief Requests the cancellation of a job, does nothing if it is already complete.
+ * @details A queued job completes immediately as cancelled, in the calling thread. A running job completes as
+ * cancelled at its next cancellation point, unless it finishes first.
+ */
+void tms_async_cancel(tms_async_job *job);
+
+/**
+ * @brief Frees a job, it is cancelled if it isn't complete yet.
+ * @note The job is freed once the pool thread running it is done. If its callback is running in another thread, this
+ * waits for it to return (the callback can free its own job, but must not free jobs of other callbacks). The callback
+ * isn't called after this returns.
+ */
+void tms_async_free(tms_async_job *job);
+
+/**
+ * @brief Returns a file descriptor readable while completed jobs without a callback are waiting for
+ * tms_async_completed(), for use with poll(), select() or epoll.
+ * @return The descriptor (an eventfd on Linux, the read end of a pipe on other systems), owned by the library. -1 if it
+ * couldn't be created or on Windows.
+ */
+int tms_async_eventfd();
+
+/**
+ * @brief Takes the completed jobs without a callback, in completion order.
+ * @param jobs Receives up to max jobs, still owned by the caller.
+ * @return Number of jobs written to the array.
+ * @note The descriptor of tms_async_eventfd() stays readable if more jobs are waiting.
+ */
+size_t tms_async_completed(tms_async_job **jobs, size_t max);
+
+#endif
@@ -1,5 +1,5 @@
 /*
-Copyright (C) 2022-2024 Ahmad Ismail
+Copyright (C) 2022-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #ifndef _TMS_ERROR_HANDLER_H
@@ -8,6 +8,7 @@ SPDX-License-Identifier: LGPL-2.1-only
 /**
  * @file
  * @brief Declares functions and structures related to libtmsolve's error handler.
+ * @note Each thread has its own error database: errors saved by a thread are only seen (and cleared) by that thread.
  */
 
 #include <stdbool.h>
@@ -50,7 +51,7 @@ enum tms_facilities
 #define EH_ALL_ERRORS (EH_FATAL | EH_NONFATAL)
 
 /**
- * @brief Saves an error in the global error database.
+ * @brief Saves an error in the error database of the calling thread.
  * @param facilities Facilities where the error originated (ex: TMS_PARSER).
  * @param error_msg The error message.
  * @param severity Indicates the seriousness of the error (fatal or not fatal) (see EH_FATAL, EH_NONFATAL macros).
@@ -1,5 +1,5 @@
 /*
-Copyright (C) 2023-2024 Ahmad Ismail
+Copyright (C) 2023-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #ifndef _TMS_EVALUATOR_H
@@ -19,18 +19,70 @@ SPDX-License-Identifier: LGPL-2.1-only
 /**
  * @brief Evaluates a math_expr structure and calculates the result.
  * @param M Expression to evaluate.
- * @param options Supported: NO_LOCK and PRINT_ERRORS.
- * @note Thread safe, unless NO_LOCK is used.
+ * @param options Supported: NO_LOCK, SHARED_LOCK and PRINT_ERRORS.
+ * @note Thread safe, unless NO_LOCK is used. With SHARED_LOCK, evaluations run concurrently (see
+ * tms_lock_evaluator_shared()), the caller must not evaluate the same expression in two threads at once.
  * @return The answer of the math expression, or NaN in case of failure.
  */
 cdouble tms_evaluate(tms_math_expr *M, int options);
 
+/**
+ * @brief Evaluates an expression once per row of label values, with real inputs and answers.
+ * @param M Expression to evaluate, parsed with a labels list.
+ * @param columns One column per label (in the order of M->labels), row i of a column is at columns[j][i * strides[j]].
+ * Can be NULL if M has no labels.
+ * @param strides Stride of each column in elements (0 repeats the first value), NULL if all columns are contiguous.
+ * @param n Number of rows.
+ * @param results Receives the n answers, NaN for the rows that failed or have a complex answer.
+ * @param options Supported: NO_LOCK, SHARED_LOCK and PRINT_ERRORS. The errors of failed rows are cleared unless printed.
+ * @return Number of failed rows.
+ * @note The evaluator is locked once for the whole batch. Thread safe, unless NO_LOCK is used (see tms_evaluate()).\n
+ * Large batches are split between the threads of the pool (see thread_pool.h), each one evaluates a copy of M. They run
+ * in the calling thread if the JIT is enabled or M is profiled.
+ */
+size_t tms_evaluate_batch(tms_math_expr *M, const double *const *columns, const int64_t *strides, size_t n,
+                          double *results, int options);
+
+/**
+ * @brief Solves each expression of a list, stops at the first failure.
+ * @param options Passed to tms_solve_e().
+ * @return Array of the answers, NULL if an expression failed or the list is empty.
+ */
+cdouble *tms_solve_list(tms_arg_list *expr_list, int options, tms_arg_list *labels);
+
+/**
+ * @brief Integer variant of tms_solve_list(), the expressions are solved with NO_LOCK.
+ */
+int64_t *tms_int_solve_list(tms_arg_list *expr_list, tms_arg_list *labels);
+
+/**
+ * @brief Solves the expressions of a list in parallel, a failed expression doesn't discard the other answers.
+ * @details The list is split between the threads of the pool (see thread_pool.h), each thread parses and evaluates its
+ * own expressions.
+ * @param expr_list The expressions.
+ * @param options Supported: NO_LOCK, ENABLE_CMPLX, EXPAND_UOPS and PRINT_ERRORS. The errors of failed expressions are
+ * cleared unless printed.
+ * @param labels Labels of the expressions with their values as payload, NULL if not needed. Not modified.
+ * @param status Receives 0 for each solved expression and -1 for each failed one, can be NULL.
+ * @return malloc'd array of the answers in the order of the list, NaN for the failed expressions. NULL if the list is
+ * empty.
+ * @note The evaluator is locked once in shared mode for the whole list (see tms_lock_evaluator_shared()), concurrent
+ * shared evaluations can run meanwhile.
+ */
+cdouble *tms_solve_list_parallel(tms_arg_list *expr_list, int options, tms_arg_list *labels, int *status);
+
+/**
+ * @brief Integer variant of tms_solve_list_parallel(), the answers of failed expressions are 0.
+ * @param options Supported: NO_LOCK, EXPAND_UOPS and PRINT_ERRORS.
+ */
+int64_t *tms_int_solve_list_parallel(tms_arg_list *expr_list, int options, tms_arg_list *labels, int *status);
+
 /**
  * @brief Calculates the answer for an int expression.
  * @param M Expression to evaluate.
  * @param result Pointer to a variable where the result will be stored (sign extended if needed).
- * @param options Supported: NO_LOCK and PRINT_ERRORS.
- * @note Thread safe, unless NO_LOCK is used.
+ * @param options Supported: NO_LOCK, SHARED_LOCK and PRINT_ERRORS.
+ * @note Thread safe, unless NO_LOCK is used (see tms_evaluate()).
  * @return 0 on success, -1 on failure.
  */
 int tms_int_evaluate(tms_int_expr *M, int64_t *result, int options);
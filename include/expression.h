@@ -0,0 +1,101 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_EXPRESSION_H
+#define _TMS_EXPRESSION_H
+
+/**
+ * @file
+ * @brief Declares tmsolve::Expression, the C++ handle of a parsed scientific expression (C++20 only).
+ */
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/tms_math_strs.h>
+#else
+#include "tms_math_strs.h"
+#endif
+
+namespace tmsolve
+{
+/**
+ * @brief Parsed scientific expression, owns its tms_math_expr.
+ * @details The expression is parsed once with the names of its labels, then evaluated with one value per label in the
+ * same order (see label_index()).\n
+ * Evaluations from several threads run concurrently, each one uses a copy of the expression taken from a pool
+ * (see SHARED_LOCK).
+ * @note Moving an expression while another thread evaluates it is not supported.
+ */
+class Expression
+{
+  public:
+    /**
+     * @brief Parses an expression.
+     * @param expr The expression.
+     * @param labels Names of the labels, the index of a name is the position of its value in evaluate().
+     * @param complex Enables complex numbers.
+     * @throws std::runtime_error With the message of the parser error.
+     */
+    Expression(std::string expr, std::vector<std::string> labels = {}, bool complex = false);
+
+    ~Expression();
+
+    Expression(Expression &&other) noexcept;
+    Expression &operator=(Expression &&other) noexcept;
+
+    Expression(const Expression &) = delete;
+    Expression &operator=(const Expression &) = delete;
+
+    /// @brief Names of the labels, in the order of their values.
+    const std::vector<std::string> &labels() const;
+
+    /**
+     * @brief Finds the position of a label in the values passed to evaluate().
+     * @throws std::out_of_range If the expression has no label with this name.
+     */
+    size_t label_index(std::string_view name) const;
+
+    /**
+     * @brief Evaluates the expression.
+     * @param values One value per label, indexed like labels().
+     * @return The answer of the expression.
+     * @throws std::invalid_argument If the number of values doesn't match the labels.
+     * @throws std::runtime_error With the message of the evaluator error.
+     */
+    std::complex<double> evaluate(std::span<const std::complex<double>> values = {});
+
+    /**
+     * @brief Evaluates the expression once per row of label values, locking the evaluator once.
+     * @param values Rows of labels().size() values, row i starts at values[i * labels().size()].
+     * @param results Receives the answer of each row, NaN for the rows that failed.
+     * @return Number of failed rows, their errors are cleared.
+     * @throws std::invalid_argument If the size of values isn't results.size() rows.
+     */
+    size_t evaluate(std::span<const std::complex<double>> values, std::span<std::complex<double>> results);
+
+    /// @brief Real variant with strided columns, see tms_evaluate_batch(). Returns the number of failed rows.
+    size_t evaluate_batch(const double *const *columns, const int64_t *strides, size_t n, double *results);
+
+  private:
+    // Never evaluated, only copied. NULL once moved from
+    tms_math_expr *M;
+    std::vector<std::string> label_names;
+    // Copies not used by any thread
+    std::vector<tms_math_expr *> pool;
+    std::mutex pool_lock;
+
+    tms_math_expr *acquire();
+    void release(tms_math_expr *copy);
+};
+} // namespace tmsolve
+
+#endif
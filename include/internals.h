@@ -1,5 +1,5 @@
 /*
-Copyright (C) 2022-2024 Ahmad Ismail
+Copyright (C) 2022-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #ifndef _TMS_INTERNALS_H
@@ -162,11 +162,37 @@ void tms_unlock_parser(int variant);
 void tms_lock_evaluator(int variant);
 
 /**
- * @brief Unlocks one of the evaluators
- * @param variant 
+ * @brief Locks one of the evaluators in shared mode, for the evaluations that can run concurrently (see SHARED_LOCK).
+ * @details Shared evaluations exclude the parser, the exclusive evaluations and modifications of variables and user
+ * functions, but not each other.
+ * @param variant Either TMS_EVALUATOR or TMS_INT_EVALUATOR
+ */
+void tms_lock_evaluator_shared(int variant);
+
+/**
+ * @brief Unlocks one of the evaluators, locked by tms_lock_evaluator() or tms_lock_evaluator_shared()
+ * @param variant Either TMS_EVALUATOR or TMS_INT_EVALUATOR
  */
 void tms_unlock_evaluator(int variant);
 
+/**
+ * @brief Locks the variables, to read or modify them while no parser or evaluator uses them.
+ * @param variant Either TMS_V_DOUBLE or TMS_V_INT64
+ */
+void tms_lock_vars(int variant);
+
+/// @brief Unlocks the variables.
+void tms_unlock_vars(int variant);
+
+/**
+ * @brief Locks the user functions, to read or modify them while no parser or evaluator uses them.
+ * @param variant Either TMS_V_DOUBLE or TMS_V_INT64
+ */
+void tms_lock_ufuncs(int variant);
+
+/// @brief Unlocks the user functions.
+void tms_unlock_ufuncs(int variant);
+
 /**
  * @brief Sets the global mask used by integer parser and evaluator. Locks both of them while the mask is being modified.
  * @note This mask is what allows the library to emulate integers of width [1-64].
@@ -202,6 +228,7 @@ int tms_set_int_var(const char *name, int64_t value, bool is_constant);
  * @param function_args A comma separated string of labels names.
  * @param function Expression of the function in terms of its labels.
  * @return 0 on success, -1 on failure.
+ * @note Thread safe, the parser is locked while the function is modified.
  */
 int tms_set_ufunction(const char *fname, const char *function_args, const char *function);
 
@@ -214,6 +241,24 @@ int tms_set_ufunction(const char *fname, const char *function_args, const char *
  */
 int tms_set_int_ufunction(const char *fname, const char *function_args, const char *function);
 
+/**
+ * @brief Loads a catalog of user functions created by tms_save_ufunctions() (or the tms_catalog tool).
+ * @details The catalog is mapped in memory and its functions are prepared on first use, so loading is independent
+ * of the number of functions. Functions defined by tms_set_ufunction() take precedence over the catalog ones.
+ * @param path Path of the catalog file, or NULL to unload the current catalog.
+ * @return 0 on success, -1 on failure.
+ * @note Only one catalog is loaded at a time, loading a catalog replaces the previous one.
+ */
+int tms_load_ufunc_catalog(const char *path);
+
+/**
+ * @brief Loads a catalog of user int functions created by tms_save_int_ufunctions() (or the tms_catalog tool).
+ * @param path Path of the catalog file, or NULL to unload the current catalog.
+ * @return 0 on success, -1 on failure.
+ * @note Only one catalog is loaded at a time, loading a catalog replaces the previous one.
+ */
+int tms_load_int_ufunc_catalog(const char *path);
+
 bool _tms_validate_args_count(int expected, int actual, int facility_id);
 
 bool _tms_validate_args_count_range(int actual, int min, int max, int facility_id);
@@ -0,0 +1,55 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_JIT_H
+#define _TMS_JIT_H
+/**
+ * @file
+ * @brief Declares functions of the optional JIT backend, which compiles frequently evaluated expressions to native code.
+ * @details The expression is translated to C and built as a shared module by the system C compiler
+ * (the TMS_JIT_CC environment variable, or "cc"), then loaded with dlopen(). TMS_JIT_CC is a program name or path run
+ * without a shell, it can't contain arguments.
+ * The compiled code performs the same operations in the same order as the evaluator, so the answers are identical.
+ * Any error at runtime (division by zero, math error...) makes the evaluator run the expression to report the error.
+ * @note Expressions using extended or user functions are not compiled.
+ */
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/tms_math_strs.h>
+#else
+#include "tms_math_strs.h"
+#endif
+
+/// @brief Maximum number of operators in an expression compiled by the JIT.
+#define TMS_JIT_MAX_NODES 4096
+
+/**
+ * @brief Sets the number of evaluations after which an expression is compiled to native code.
+ * @param threshold Number of evaluations, 0 disables the JIT (default).
+ */
+void tms_set_jit_threshold(int threshold);
+
+/// @brief Returns the current JIT threshold, 0 if disabled.
+int tms_get_jit_threshold();
+
+/**
+ * @brief Compiles an expression to native code now, regardless of the threshold.
+ * @return 0 on success, -1 if the expression is not supported by the JIT or the compilation failed.
+ * @note The compiled code is used by tms_evaluate() only if the JIT is enabled. Not thread safe, M must not be evaluated
+ * meanwhile. M->jit stays NULL if memory allocation failed.
+ */
+int tms_jit_compile(tms_math_expr *M);
+
+/// @brief Frees the compiled code of an expression.
+void tms_jit_free(struct tms_jit_code *J);
+
+/**
+ * @brief Evaluates an expression using its compiled code, compiling it if it reached the threshold.
+ * @details Thread safe for concurrent evaluations of M, a single thread compiles it and the others use the evaluator
+ * until the code is published.
+ * @return 0 on success, -1 if the evaluator should be used instead.
+ */
+int _tms_jit_evaluate(tms_math_expr *M, cdouble *result);
+
+#endif
@@ -1,5 +1,5 @@
 /*
-Copyright (C) 2022-2023 Ahmad Ismail
+Copyright (C) 2022-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #ifndef TMSOLVE_H
@@ -14,30 +14,46 @@ extern "C"
 #endif
 
 #ifndef LOCAL_BUILD
+#include <tmsolve/async.h>
 #include <tmsolve/bitwise.h>
 #include <tmsolve/error_handler.h>
 #include <tmsolve/evaluator.h>
 #include <tmsolve/function.h>
 #include <tmsolve/int_parser.h>
 #include <tmsolve/internals.h>
+#include <tmsolve/jit.h>
 #include <tmsolve/matrix.h>
+#include <tmsolve/matrix_expr.h>
 #include <tmsolve/parser.h>
+#include <tmsolve/profile.h>
 #include <tmsolve/scientific.h>
+#include <tmsolve/serializer.h>
+#include <tmsolve/sparse.h>
+#include <tmsolve/stats.h>
 #include <tmsolve/string_tools.h>
+#include <tmsolve/thread_pool.h>
 #include <tmsolve/tms_complex.h>
 #include <tmsolve/tms_math_strs.h>
 #include <tmsolve/version.h>
 #else
+#include "async.h"
 #include "bitwise.h"
 #include "error_handler.h"
 #include "evaluator.h"
 #include "function.h"
 #include "int_parser.h"
 #include "internals.h"
+#include "jit.h"
 #include "matrix.h"
+#include "matrix_expr.h"
 #include "parser.h"
+#include "profile.h"
 #include "scientific.h"
+#include "serializer.h"
+#include "sparse.h"
+#include "stats.h"
 #include "string_tools.h"
+#include "thread_pool.h"
 #include "tms_complex.h"
 #include "tms_math_strs.h"
 #include "version.h"
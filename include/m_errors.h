@@ -15,6 +15,13 @@ SPDX-License-Identifier: LGPL-2.1-only
 #define PARENTHESIS_NOT_CLOSED "Open parenthesis has no closing parenthesis"
 #define PARENTHESIS_NOT_OPEN "Extra closing parenthesis"
 #define INVALID_MATRIX "Invalid matrix"
+#define SINGULAR_MATRIX "Matrix is singular"
+#define ILL_CONDITIONED_MATRIX "Matrix is too ill-conditioned to be inverted accurately"
+#define MATRIX_NOT_SQUARE "Matrix must be square"
+#define MATRIX_DIMENSIONS_MISMATCH "Incompatible matrix dimensions"
+#define MATRIX_DIVISION "Division by a matrix isn't defined, use inv() or solve()"
+#define EXPECTED_MATRIX "Expected a matrix"
+#define NO_CONVERGENCE "The iterative solver did not converge"
 #define SYNTAX_ERROR "Syntax error"
 #define UNEXPECTED_COMMA_W_SIMPLE_FUNC "Comma not expected here, this is not a multi-argument function."
 #define INVALID_NAME "Invalid name, allowed characters: alphanumeric + underscore, starts with '_' or alphabetic"
@@ -71,4 +78,12 @@ SPDX-License-Identifier: LGPL-2.1-only
 #define MULTINV_NO_NEGATIVE_MODULUS "Multiplicative inverse requires a modulus > 0."
 #define FACTORIAL_EXPECTS_POSITIVE_INT "The factorial function expects a positive integer."
 #define NAN_NOT_ALLOWED "NaN is not allowed."
+#define EVALUATION_CANCELLED "Evaluation cancelled"
+#define INDEX_OUT_OF_RANGE "Index out of range"
+#define CATALOG_IO_ERROR "Unable to read or write the catalog file"
+#define CATALOG_INVALID "Invalid or corrupted catalog file"
+#define CATALOG_INCOMPATIBLE "Catalog file was created by an incompatible library version or platform"
+#define CATALOG_TYPE_MISMATCH "Catalog doesn't contain expressions of the requested type"
+#define CATALOG_NO_NAMES "Catalog doesn't contain named functions"
+#define CATALOG_NO_MEMORY "Not enough memory to load the catalog"
 #endif
\ No newline at end of file
@@ -1,5 +1,5 @@
 /*
-Copyright (C) 2022-2023 Ahmad Ismail
+Copyright (C) 2022-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #ifndef _TMS_MATRIX_H
@@ -9,8 +9,19 @@ SPDX-License-Identifier: LGPL-2.1-only
  * @brief Declares all matrix related macros, structures, globals and functions.
  */
 
+#ifndef LOCAL_BUILD
+#include <tmsolve/c_complex_to_cpp.h>
+#else
+#include "c_complex_to_cpp.h"
+#endif
+#include <stdbool.h>
+
+/// @brief Alignment in bytes of the storage of matrices allocated by tms_new_matrix().
+#define TMS_MATRIX_ALIGNMENT 64
+
 /**
  * @brief Stores the metadata of a 2D matrix.
+ * @details Members are stored contiguously in row-major order, row i starts at data + i * stride.
  */
 typedef struct tms_matrix
 {
@@ -18,18 +29,50 @@ typedef struct tms_matrix
     int rows;
     /// Number of columns
     int columns;
-    /// Double array storing the members of the 2D matrix.
-    double **data;
+    /// Number of doubles between the starts of two consecutive rows (>= columns).
+    int stride;
+    /// Set if the storage was allocated by the library, and should be freed with the matrix.
+    bool owns_data;
+    /// Row-major storage of the members of the 2D matrix.
+    double *data;
 } tms_matrix;
 
+/// @brief Pointer to the first member of a row of the matrix M.
+#define TMS_MATRIX_ROW(M, row) ((M)->data + (size_t)(row) * (M)->stride)
+
+/**
+ * @brief Stores the LU factorization with partial pivoting of a square matrix: P*A = L*U.
+ * @details Once factorized, a matrix can be used to solve many systems, each solve is O(n^2).
+ */
+typedef struct tms_lu
+{
+    /// Combined factors: L (unit diagonal, not stored) below the diagonal, U on and above it.
+    tms_matrix *LU;
+    /// Row permutation, row i of LU comes from row perm[i] of the source matrix.
+    int *perm;
+    /// Sign of the permutation (+1 or -1), used for the determinant.
+    int sign;
+    /// Set if a pivot is exactly zero, the matrix is singular.
+    bool singular;
+} tms_lu;
+
 /**
  * @brief Allocates a new matrix of dimensions rows*columns.
+ * @details The storage is a single block aligned to TMS_MATRIX_ALIGNMENT, rows are contiguous (stride = columns).
  * @param rows Number of rows.
  * @param columns Number of columns
  * @return A malloc'd pointer to the new matrix.
  */
 tms_matrix *tms_new_matrix(int rows, int columns);
 
+/**
+ * @brief Creates a matrix using an existing row-major buffer as storage, without copying it.
+ * @param data The buffer, must remain valid until the matrix is deleted (which doesn't free it).
+ * @param stride Number of doubles between the starts of two consecutive rows (>= columns).
+ * @return A malloc'd pointer to the new matrix, or NULL in case of failure.
+ */
+tms_matrix *tms_wrap_matrix(double *data, int rows, int columns, int stride);
+
 /**
  * @brief Deletes a matrix generated using tms_new_matrix().
  * @param matrix The matrix to delete.
@@ -48,10 +91,21 @@ void tms_round_to_identity_matrix(tms_matrix *M);
 
 /**
  * @brief Multiplies matrixes A and B.
+ * @details Uses a cache blocked kernel, vectorized for the best instruction set of the CPU (x86-64 with GCC),
+ * large products are split between the threads of the pool (see tms_set_matrix_threads() and thread_pool.h).
  * @return A new matrix, answer of A*B.
  */
 tms_matrix *tms_matrix_multiply(tms_matrix *A, tms_matrix *B);
 
+/**
+ * @brief Sets the number of parts tms_matrix_multiply() splits large products in, run by the thread pool.
+ * @param count Number of parts, 0 for the thread count of the pool or executor (default, see tms_get_thread_count()).
+ */
+void tms_set_matrix_threads(int count);
+
+/// @brief Returns the number of parts tms_matrix_multiply() splits large products in.
+int tms_get_matrix_threads();
+
 /**
  * @brief Calculates the determinant of a matrix.
  * @return The determinant, or NaN in case of failure.
@@ -60,6 +114,7 @@ double tms_matrix_det(tms_matrix *A);
 
 /**
  * @brief Calculates the comatrix of the matrix M.
+ * @details Computed as det(M) * transpose(inverse of M) in O(n^3), the minors are only used if M is singular or nearly singular.
  * @return The comatrix, or NULL in case of failure.
  */
 tms_matrix *tms_comatrix(tms_matrix *M);
@@ -71,11 +126,61 @@ tms_matrix *tms_comatrix(tms_matrix *M);
 tms_matrix *tms_matrix_tr(tms_matrix *M);
 
 /**
- * @brief Calculates the inverse of the matrix M.
- * @return The inverse matrix, or NULL in case of failure.
+ * @brief Calculates the inverse of the matrix M, using Gauss-Jordan elimination with partial pivoting.
+ * @details Fails if the reciprocal condition number (1-norm) is below DBL_EPSILON, the inverse would be mostly
+ * rounding errors.
+ * @return The inverse matrix, or NULL in case of failure (singular or too ill-conditioned matrix).
  */
 tms_matrix *tms_matrix_inv(tms_matrix *M);
 
+/**
+ * @brief Computes the LU factorization with partial pivoting of the square matrix M, in O(n^3).
+ * @return A malloc'd factorization (even if M is singular, check tms_lu::singular), or NULL in case of failure.
+ */
+tms_lu *tms_matrix_lu(tms_matrix *M);
+
+/**
+ * @brief Deletes a factorization generated using tms_matrix_lu().
+ */
+void tms_delete_lu(tms_lu *F);
+
+/**
+ * @brief Calculates the determinant of the factorized matrix, in O(n).
+ * @return The determinant, sign * product of the pivots. Not rounded to 0 for nearly singular matrices.
+ */
+double tms_lu_det(tms_lu *F);
+
+/**
+ * @brief Solves the system A*x = b using the factorization of A, in O(n^2).
+ * @param b The right hand side, an array of n values.
+ * @param x Array of n values to store the solution, must not overlap b.
+ * @return 0 on success, -1 if the matrix is singular.
+ */
+int tms_lu_solve(tms_lu *F, const double *b, double *x);
+
+/**
+ * @brief Calculates the inverse of the factorized matrix.
+ * @return The inverse matrix, or NULL if the matrix is singular.
+ * @note Unlike tms_matrix_inv(), the conditioning of the matrix isn't checked.
+ */
+tms_matrix *tms_lu_inv(tms_lu *F);
+
+/**
+ * @brief Solves A*X = B without forming the inverse of A.
+ * @details Uses the Cholesky factorization if A is symmetric positive definite, LU with partial pivoting if A is square,
+ * or Householder QR if A has more rows than columns (least squares solution).
+ * @param B Right hand sides, one per column, must have as many rows as A.
+ * @return The solution (A->columns rows, B->columns columns), or NULL in case of failure.
+ */
+tms_matrix *tms_matrix_solve(tms_matrix *A, tms_matrix *B);
+
+/**
+ * @brief Variant of tms_matrix_solve() that works in place and doesn't allocate matrices.
+ * @details A is overwritten by its factorization, the first A->columns rows of B by the solution.
+ * @return 0 on success, -1 in case of failure (A and B may be modified).
+ */
+int tms_matrix_solve_inplace(tms_matrix *A, tms_matrix *B);
+
 /**
  * @brief Replaces the column of the matrix with the matrix_column sent as argument
  * @param matrix The matrix that will have its column replaced.
@@ -90,4 +195,91 @@ void tms_replace_matrix_col(tms_matrix *matrix, tms_matrix *column_matrix, int c
  */
 tms_matrix *tms_matrix_dup(tms_matrix *M);
 
-#endif
\ No newline at end of file
+/**
+ * @brief Stores the metadata of a 2D complex matrix.
+ * @details Same layout as tms_matrix, with cdouble members (real and imaginary parts interleaved),
+ * so C99 complex and numpy complex128 arrays can be wrapped directly.
+ * The multiplication splits real and imaginary parts in its packed blocks, so its kernel still works on full vectors.
+ */
+typedef struct tms_cmatrix
+{
+    /// Number of rows.
+    int rows;
+    /// Number of columns
+    int columns;
+    /// Number of members between the starts of two consecutive rows (>= columns).
+    int stride;
+    /// Set if the storage was allocated by the library, and should be freed with the matrix.
+    bool owns_data;
+    /// Row-major storage of the members of the 2D matrix.
+    cdouble *data;
+} tms_cmatrix;
+
+/// @brief Pointer to the first member of a row of the complex matrix M.
+#define TMS_CMATRIX_ROW(M, row) ((M)->data + (size_t)(row) * (M)->stride)
+
+/**
+ * @brief Stores the LU factorization with partial pivoting of a square complex matrix, see tms_lu.
+ */
+typedef struct tms_clu
+{
+    /// Combined factors: L (unit diagonal, not stored) below the diagonal, U on and above it.
+    tms_cmatrix *LU;
+    /// Row permutation, row i of LU comes from row perm[i] of the source matrix.
+    int *perm;
+    /// Sign of the permutation (+1 or -1), used for the determinant.
+    int sign;
+    /// Set if a pivot is exactly zero, the matrix is singular.
+    bool singular;
+} tms_clu;
+
+/// @brief Allocates a new complex matrix of dimensions rows*columns, see tms_new_matrix().
+tms_cmatrix *tms_new_cmatrix(int rows, int columns);
+
+/// @brief Creates a complex matrix using an existing row-major buffer as storage, see tms_wrap_matrix().
+tms_cmatrix *tms_wrap_cmatrix(cdouble *data, int rows, int columns, int stride);
+
+/// @brief Deletes a complex matrix.
+void tms_delete_cmatrix(tms_cmatrix *M);
+
+/// @brief Duplicates a complex matrix.
+tms_cmatrix *tms_cmatrix_dup(tms_cmatrix *M);
+
+/**
+ * @brief Multiplies complex matrixes A and B, see tms_matrix_multiply().
+ * @return A new matrix, answer of A*B, or NULL in case of failure.
+ */
+tms_cmatrix *tms_cmatrix_multiply(tms_cmatrix *A, tms_cmatrix *B);
+
+/**
+ * @brief Computes the LU factorization with partial pivoting of the square complex matrix M.
+ * @return A malloc'd factorization (even if M is singular, check tms_clu::singular), or NULL in case of failure.
+ */
+tms_clu *tms_cmatrix_lu(tms_cmatrix *M);
+
+/// @brief Deletes a factorization generated using tms_cmatrix_lu().
+void tms_delete_clu(tms_clu *F);
+
+/**
+ * @brief Calculates the determinant of the factorized complex matrix, in O(n).
+ * @return The determinant, sign * product of the pivots. Not rounded to 0 for nearly singular matrices.
+ */
+cdouble tms_clu_det(tms_clu *F);
+
+/**
+ * @brief Solves the system A*x = b using the factorization of the complex matrix A.
+ * @param x Array of n values to store the solution, must not overlap b.
+ * @return 0 on success, -1 if the matrix is singular.
+ */
+int tms_clu_solve(tms_clu *F, const cdouble *b, cdouble *x);
+
+/// @brief Calculates the inverse of the factorized complex matrix, NULL if it is singular.
+tms_cmatrix *tms_clu_inv(tms_clu *F);
+
+/// @brief Calculates the determinant of a square complex matrix, NaN in case of failure.
+cdouble tms_cmatrix_det(tms_cmatrix *M);
+
+/// @brief Calculates the inverse of a square complex matrix, NULL in case of failure (singular or too ill-conditioned).
+tms_cmatrix *tms_cmatrix_inv(tms_cmatrix *M);
+
+#endif
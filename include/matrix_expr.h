@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_MATRIX_EXPR_H
+#define _TMS_MATRIX_EXPR_H
+
+/**
+ * @file
+ * @brief Declares matrix variables and the evaluator of matrix expressions.
+ * @details Matrix expressions support `+`, `-`, `*`, `/` (by a scalar), parenthesis, numbers, matrix variables and the
+ * functions inv(), tr() (transpose), det(), trace() and solve(A, B).\n
+ * The expression is parsed to a tree before any computation, so chained operations are evaluated as a whole:
+ * `inv(A)*B` is a single linear solve, `det(A*B)` is det(A)*det(B) and `trace(A*B)` doesn't form the product.\n
+ * det() and trace() are also available in scientific expressions, for example `det(inv(A)*B)+1`. Their argument can
+ * use the labels of the calling expression as scalars with a real value, for example `det(x*A)`.
+ */
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/c_complex_to_cpp.h>
+#include <tmsolve/matrix.h>
+#include <tmsolve/tms_math_strs.h>
+#else
+#include "c_complex_to_cpp.h"
+#include "matrix.h"
+#include "tms_math_strs.h"
+#endif
+
+/// @brief Maximum nesting of a matrix expression (parenthesis, signs and chained operations), deeper expressions are
+/// rejected with STACK_DEPTH_EXCEEDED.
+#define TMS_MATRIX_EXPR_MAX_DEPTH 1000
+
+/// @brief Matrix variable metadata.
+typedef struct tms_matrix_var
+{
+    char *name;
+    tms_matrix *value;
+} tms_matrix_var;
+
+/**
+ * @brief Creates or overwrites a matrix variable.
+ * @param M The matrix is copied, the caller keeps ownership of M.
+ * @return 0 on success, -1 on failure (invalid name or matrix).
+ */
+int tms_set_matrix_var(const char *name, tms_matrix *M);
+
+/**
+ * @brief Returns a malloc'd copy of a matrix variable, or NULL if it doesn't exist.
+ */
+tms_matrix *tms_get_matrix_var(const char *name);
+
+/**
+ * @brief Removes a matrix variable.
+ * @return 0 on success, -1 if the variable doesn't exist.
+ */
+int tms_remove_matrix_var(const char *name);
+
+/**
+ * @brief Removes all matrix variables.
+ */
+void tms_clear_matrix_vars();
+
+/**
+ * @brief Evaluates a matrix expression.
+ * @return A malloc'd matrix holding the result (1x1 if the result is a scalar), or NULL in case of failure.
+ */
+tms_matrix *tms_matrix_eval(const char *expr);
+
+/**
+ * @brief Extended function det(), determinant of a matrix expression.
+ */
+int _tms_det(tms_arg_list *args, tms_arg_list *labels, cdouble *result);
+
+/**
+ * @brief Extended function trace(), trace of a matrix expression.
+ */
+int _tms_trace(tms_arg_list *args, tms_arg_list *labels, cdouble *result);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_PROFILE_H
+#define _TMS_PROFILE_H
+
+/**
+ * @file
+ * @brief Declares the evaluation profiles: calls and time of each subexpression and function of one expression.
+ * @details A profile is enabled per expression, and accumulates over its evaluations until deleted or reset.\n
+ * Each subexpression evaluated is a frame named "S<index>" followed by its function name if it has one (ex: "S2 sin").
+ * The frames of the expressions evaluated by user and extended functions are nested in the frame of the function, so
+ * the time spent in a user function is attributed to the subexpressions of its own expression.\n
+ * Profiled expressions are evaluated without their compiled code (see tms_set_jit_threshold()), the nested frames
+ * would be lost otherwise.
+ * @note Profiling adds two clock reads per subexpression, small subexpressions are inflated in proportion.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/symtab.h>
+#include <tmsolve/tms_math_strs.h>
+#else
+#include "symtab.h"
+#include "tms_math_strs.h"
+#endif
+
+/// @brief Calls and cumulative time of a frame.
+typedef struct tms_profile_entry
+{
+    /// @brief Name of the subexpression, function or folded stack.
+    char *name;
+    /// @brief Number of calls.
+    uint64_t calls;
+    /// @brief Cumulative time in nanoseconds.
+    uint64_t ns;
+} tms_profile_entry;
+
+/// @brief Evaluation profile of an expression, created by tms_enable_profile() or tms_enable_int_profile().
+typedef struct tms_expr_profile
+{
+    /// @brief Name of the root frame, the expression string by default.
+    char *name;
+    /// @brief Number of evaluations, and their cumulative time.
+    tms_profile_entry total;
+    /// @brief Number of subexpressions of the profiled expression.
+    int subexpr_count;
+    /// @brief Calls and time of each subexpression of the profiled expression, including the functions it calls.
+    tms_profile_entry *subexprs;
+    /**
+     * @brief Calls and time of each function by name (tms_profile_entry items), including nested calls.
+     * @note The time of a recursive user function is counted at each level.
+     */
+    tms_symtab *functions;
+    /// @brief Time of each stack of frames without the frames it calls (tms_profile_entry items named by the stack).
+    tms_symtab *stacks;
+} tms_expr_profile;
+
+/**
+ * @brief Enables the evaluation profile of an expression, does nothing if already enabled.
+ * @param name Name of the root frame, NULL to use the expression.
+ * @return 0 on success, -1 on failure.
+ * @note The profile is stored in M->profile, and deleted with the expression. Copies of the expression are not profiled.
+ */
+int tms_enable_profile(tms_math_expr *M, const char *name);
+
+/// @brief Integer variant of tms_enable_profile().
+int tms_enable_int_profile(tms_int_expr *M, const char *name);
+
+/// @brief Deletes the evaluation profile of an expression, if any.
+void tms_disable_profile(tms_math_expr *M);
+
+/// @brief Integer variant of tms_disable_profile().
+void tms_disable_int_profile(tms_int_expr *M);
+
+/**
+ * @brief Sets the calls and times of a profile to zero.
+ */
+void tms_reset_profile(tms_expr_profile *P);
+
+/**
+ * @brief Frees a profile, for profiles detached from their expression.
+ */
+void tms_delete_profile(tms_expr_profile *P);
+
+/**
+ * @brief Returns a malloc'd array with a copy of the function entries, sorted by decreasing time.
+ * @param count Set to the number of functions.
+ * @return The array, or NULL if no function was called.
+ * @note The names belong to the profile, they are valid until it is reset or deleted.
+ */
+tms_profile_entry *tms_get_profile_functions(tms_expr_profile *P, size_t *count);
+
+/**
+ * @brief Prints the subexpressions and functions of a profile, with their calls and time.
+ */
+void tms_print_profile(tms_expr_profile *P, FILE *out);
+
+/**
+ * @brief Writes the stacks of a profile in the folded format, one "frame;frame;... nanoseconds" line per stack.
+ * @details The output is read by flame graph tools, like flamegraph.pl or speedscope.
+ * @return 0 on success, -1 on write failure.
+ */
+int tms_write_folded_profile(tms_expr_profile *P, FILE *out);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_SERIALIZER_H
+#define _TMS_SERIALIZER_H
+
+/**
+ * @file
+ * @brief Declares functions to save parsed expressions to a catalog file and load them back without parsing.
+ * @details A catalog file stores parsed expressions in a relocatable form: every pointer is replaced by an offset
+ * in the record of its expression and function pointers are resolved by name when loading.
+ * The file is mapped read only and shared (MAP_SHARED), so the processes using the same catalog share its pages in the
+ * page cache. Since the evaluation writes to the expression nodes, each record is copied to the process memory and
+ * converted to a usable expression the first time it is requested. Loading a catalog is independent of its size.
+ * @note Catalog files are only readable by a library built for the same platform (byte order and structures size).
+ * @note Records are checked for out of bounds and misaligned offsets when loading, but catalogs should come from
+ * a trusted source since the contents of the expression (operators, counts) are not validated.
+ */
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/tms_math_strs.h>
+#else
+#include "tms_math_strs.h"
+#endif
+#include <inttypes.h>
+
+/**
+ * @brief Version of the catalog format, catalogs with a different version are rejected.
+ * @details 2: added the names table (names_offset and sorted_offset).
+ */
+#define TMS_CATALOG_VERSION 2
+
+/// @brief Types of expressions stored in a catalog.
+enum tms_catalog_types
+{
+    TMS_CATALOG_SCIENTIFIC = 1,
+    TMS_CATALOG_INT
+};
+
+/// @brief Header at the start of a catalog file.
+typedef struct tms_catalog_header
+{
+    /// @brief File signature, always "TMSC".
+    char magic[4];
+    /// @brief Format version, see TMS_CATALOG_VERSION.
+    uint16_t version;
+    /// @brief Type of the stored expressions, see tms_catalog_types.
+    uint16_t type;
+    /// @brief Set to 0x01020304 by the writer, used to detect a byte order mismatch.
+    uint32_t byte_order;
+    /// @brief Size of the structures stored in the records, used to detect an ABI mismatch.
+    uint16_t ptr_size, expr_size, subexpr_size, node_size, arg_list_size, labeled_operand_size;
+    /// @brief Number of expressions in the catalog.
+    uint32_t count;
+    /// @brief Offset (from the file start) of the index, an array of "count" record offsets (uint64_t).
+    uint64_t index_offset;
+    /// @brief Offset of the names table, an array of "count" name offsets (uint64_t) in index order, 0 if unnamed.
+    uint64_t names_offset;
+    /// @brief Offset of an array of "count" record indexes (uint32_t) sorted by name, 0 if unnamed.
+    uint64_t sorted_offset;
+} tms_catalog_header;
+
+/// @brief Header of each expression record, the expression structure follows it.
+typedef struct tms_catalog_record
+{
+    /// @brief Size of the record in bytes, including this header.
+    uint64_t size;
+    /// @brief Reserved, set to 0.
+    uint64_t reserved;
+} tms_catalog_record;
+
+/// @brief A loaded catalog, see tms_open_catalog().
+typedef struct tms_catalog tms_catalog;
+
+/**
+ * @brief Saves parsed expressions to a catalog file.
+ * @param path Path of the catalog file, overwritten if it exists.
+ * @param list Array of parsed expressions.
+ * @param count Number of expressions in the array.
+ * @return 0 on success, -1 on failure.
+ */
+int tms_save_math_exprs(const char *path, tms_math_expr **list, int count);
+
+/**
+ * @brief Saves parsed int expressions to a catalog file.
+ * @param path Path of the catalog file, overwritten if it exists.
+ * @param list Array of parsed int expressions.
+ * @param count Number of expressions in the array.
+ * @return 0 on success, -1 on failure.
+ */
+int tms_save_int_exprs(const char *path, tms_int_expr **list, int count);
+
+/**
+ * @brief Saves all user functions to a catalog file, the functions can be loaded later by tms_load_ufunc_catalog().
+ * @param path Path of the catalog file, overwritten if it exists.
+ * @return 0 on success, -1 on failure.
+ * @warning Not thread safe, lock the user functions while saving.
+ */
+int tms_save_ufunctions(const char *path);
+
+/**
+ * @brief Saves all user int functions to a catalog file, the functions can be loaded later by tms_load_int_ufunc_catalog().
+ * @param path Path of the catalog file, overwritten if it exists.
+ * @return 0 on success, -1 on failure.
+ * @warning Not thread safe, lock the user functions while saving.
+ */
+int tms_save_int_ufunctions(const char *path);
+
+/**
+ * @brief Maps a catalog file in memory.
+ * @details Only the header is checked here, each expression is prepared when it is first requested.
+ * @return The loaded catalog, or NULL on failure.
+ */
+tms_catalog *tms_open_catalog(const char *path);
+
+/**
+ * @brief Closes a catalog, all expressions obtained from it become invalid.
+ */
+void tms_close_catalog(tms_catalog *C);
+
+/// @brief Returns the number of expressions in the catalog.
+int tms_catalog_count(const tms_catalog *C);
+
+/// @brief Returns the type of expressions in the catalog (see tms_catalog_types).
+int tms_catalog_type(const tms_catalog *C);
+
+/**
+ * @brief Returns the name of the expression at the specified index, or NULL if the catalog has no names.
+ */
+const char *tms_catalog_get_name(const tms_catalog *C, int index);
+
+/**
+ * @brief Finds an expression by name (binary search).
+ * @return The index of the expression, or -1 if not found.
+ */
+int tms_catalog_find(const tms_catalog *C, const char *name);
+
+/**
+ * @brief Gets an expression from a catalog.
+ * @param C The catalog.
+ * @param index Index of the expression in the list passed when saving the catalog.
+ * @return The math expression, or NULL on failure.
+ * @note The expression is owned by the catalog, don't delete it. Use tms_dup_mexpr() to get an independent copy.
+ * @warning Thread safe, but every call returns the same expression. Evaluating it writes to it (node values, answer,
+ * evaluation profile, compiled code), so threads that evaluate it concurrently must each evaluate their own copy,
+ * made with tms_dup_mexpr() before the evaluations start.
+ */
+tms_math_expr *tms_catalog_get_math_expr(tms_catalog *C, int index);
+
+/**
+ * @brief Gets an int expression from a catalog.
+ * @param C The catalog.
+ * @param index Index of the expression in the list passed when saving the catalog.
+ * @return The int expression, or NULL on failure.
+ * @note The expression is owned by the catalog, don't delete it. Use tms_dup_int_expr() to get an independent copy.
+ * @warning Thread safe, but every call returns the same expression. Evaluating it writes to it (node values, answer,
+ * evaluation profile), so threads that evaluate it concurrently must each evaluate their own copy, made with
+ * tms_dup_int_expr() before the evaluations start.
+ */
+tms_int_expr *tms_catalog_get_int_expr(tms_catalog *C, int index);
+
+/**
+ * @brief Gets a user function from a catalog saved by tms_save_ufunctions().
+ * @return The user function, or NULL if not found.
+ * @note The function is owned by the catalog and is read-only, like the expressions it holds.
+ */
+const tms_ufunc *tms_catalog_get_ufunc(tms_catalog *C, const char *name);
+
+/**
+ * @brief Gets a user int function from a catalog saved by tms_save_int_ufunctions().
+ * @return The user int function, or NULL if not found.
+ * @note The function is owned by the catalog and is read-only, like the expressions it holds.
+ */
+const tms_int_ufunc *tms_catalog_get_int_ufunc(tms_catalog *C, const char *name);
+
+#endif
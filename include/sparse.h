@@ -0,0 +1,95 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_SPARSE_H
+#define _TMS_SPARSE_H
+
+/**
+ * @file
+ * @brief Declares the sparse matrix structure (compressed sparse rows) and its functions.
+ * @details Only the nonzero members are stored, so memory use is proportional to their count.
+ * Linear systems are solved iteratively (conjugate gradient or BiCGSTAB) with a Jacobi preconditioner.
+ */
+
+#ifndef LOCAL_BUILD
+#include <tmsolve/matrix.h>
+#else
+#include "matrix.h"
+#endif
+
+/**
+ * @brief Stores a sparse matrix in compressed sparse rows (CSR) format.
+ * @details The members of row i are at indexes row_start[i] to row_start[i + 1] - 1 of col_index and values,
+ * sorted by column, each column appears at most once per row.
+ */
+typedef struct tms_sparse_matrix
+{
+    /// Number of rows.
+    int rows;
+    /// Number of columns
+    int columns;
+    /// Number of stored members.
+    int nnz;
+    /// Start of each row in col_index and values, rows + 1 values (the last one is nnz).
+    int *row_start;
+    /// Column of each stored member.
+    int *col_index;
+    /// Value of each stored member.
+    double *values;
+} tms_sparse_matrix;
+
+/// @brief Iterative methods available to solve sparse linear systems.
+enum tms_sparse_solvers
+{
+    /// Conjugate gradient if the matrix is symmetric with a positive diagonal, BiCGSTAB otherwise.
+    TMS_SPARSE_AUTO,
+    /// Conjugate gradient, the matrix must be symmetric positive definite.
+    TMS_SPARSE_CG,
+    /// Stabilized biconjugate gradient, for any square nonsingular matrix.
+    TMS_SPARSE_BICGSTAB
+};
+
+/**
+ * @brief Creates a sparse matrix from a list of (row, column, value) triplets.
+ * @details Triplets can be in any order, values of duplicate triplets are added.
+ * @param count Number of triplets.
+ * @return A malloc'd sparse matrix, or NULL in case of failure (a row or column is out of range).
+ */
+tms_sparse_matrix *tms_sparse_from_triplets(int rows, int columns, int count, const int *row, const int *col,
+                                            const double *values);
+
+/**
+ * @brief Creates a sparse matrix from the nonzero members of a dense matrix.
+ */
+tms_sparse_matrix *tms_sparse_from_dense(tms_matrix *M);
+
+/**
+ * @brief Deletes a sparse matrix.
+ */
+void tms_delete_sparse_matrix(tms_sparse_matrix *A);
+
+/**
+ * @brief Computes y = A*x.
+ * @param x Array of A->columns values.
+ * @param y Array of A->rows values to store the result, must not overlap x.
+ */
+void tms_sparse_multiply_vector(tms_sparse_matrix *A, const double *x, double *y);
+
+/**
+ * @brief Checks if the matrix is symmetric.
+ */
+bool tms_sparse_is_symmetric(tms_sparse_matrix *A);
+
+/**
+ * @brief Solves A*x = b with an iterative method, preconditioned by the diagonal of A (Jacobi).
+ * @param x Initial guess on input (zeros are fine), solution on output.
+ * @param method Iterative method, see tms_sparse_solvers.
+ * @param tolerance The iterations stop when |b - A*x| <= tolerance * |b|.
+ * @param max_iterations Maximum number of iterations, 0 for twice the number of rows (at least 100).
+ * @return The number of iterations done, or -1 in case of failure (no convergence or breakdown).
+ */
+int tms_sparse_solve(tms_sparse_matrix *A, const double *b, double *x, int method, double tolerance,
+                     int max_iterations);
+
+#endif
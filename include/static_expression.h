@@ -0,0 +1,987 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_STATIC_EXPRESSION_H
+#define _TMS_STATIC_EXPRESSION_H
+
+/**
+ * @file
+ * @brief Declares tmsolve::StaticExpression, scientific expressions parsed at compile time (C++20 only, header only).
+ * @details The expression is a string literal template argument, parsed by the compiler with the grammar of
+ * tms_parse_expr() using EXPAND_UOPS: same operator priorities, left to right evaluation of operators of the same
+ * priority, operand signs, "!", "**" and "//" operators, number formats and built-in names. Each node of the parsed
+ * expression is a type, the evaluation is inlined to straight-line code without an interpreter.\n
+ * Supported names: the built-in constants, the labels, the built-in functions with a real and a complex variant (sin,
+ * sqrt...) and the extended functions avg, min, max, logn and int.\n
+ * User functions and variables, ans and the other extended functions only exist at runtime, using them is a
+ * compile error like any syntax error (the failing call to static_detail::parse_error() names the reason).
+ * @note Failures (division by zero, math errors...) return NaN, the error database is not used.
+ */
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <concepts>
+#include <cstddef>
+#include <numbers>
+#include <string_view>
+#include <utility>
+
+extern "C"
+{
+#ifndef LOCAL_BUILD
+#include <tmsolve/scientific.h>
+#include <tmsolve/tms_complex.h>
+#else
+#include "scientific.h"
+#include "tms_complex.h"
+#endif
+}
+
+namespace tmsolve
+{
+namespace static_detail
+{
+/// @brief String literal usable as a template argument.
+template <size_t N> struct fixed_string
+{
+    char str[N] = {};
+
+    constexpr fixed_string(const char (&s)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+            str[i] = s[i];
+    }
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(str, N - 1);
+    }
+};
+
+/**
+ * @brief Not constexpr, calling it while parsing stops the compilation.
+ * @details The compiler reports the call, with the reason as argument.
+ */
+inline void parse_error(const char *reason)
+{
+    (void)reason;
+}
+
+// Same lists as the runtime (src/builtins.h), checked by tests/tms_static_test.cpp
+inline constexpr struct
+{
+    std::string_view name;
+    double real, imag;
+} builtin_vars[] = {{"i", 0, 1}, {"pi", std::numbers::pi, 0}, {"e", std::numbers::e, 0}, {"c", 299792458, 0}};
+
+inline constexpr std::string_view rc_funcs[] = {"fact", "abs",  "exp",  "ceil",  "floor", "round", "sign",
+                                                "arg",  "sqrt", "cbrt", "cos",   "sin",   "tan",   "acos",
+                                                "asin", "atan", "cosh", "sinh",  "tanh",  "acosh", "asinh",
+                                                "atanh", "ln",  "log2", "log10"};
+
+inline constexpr std::string_view extfs[] = {"avg", "min", "max", "logn", "int"};
+
+// Extended functions that need the runtime (user functions, matrices, strings...)
+inline constexpr std::string_view runtime_extfs[] = {"integrate", "derivative", "hex",     "oct",     "bin",
+                                                     "rand",      "float32",    "float64", "det",     "trace"};
+
+template <size_t N> constexpr int find_name(const std::string_view (&list)[N], std::string_view name)
+{
+    for (size_t i = 0; i < N; ++i)
+        if (list[i] == name)
+            return i;
+    return -1;
+}
+
+constexpr int rc_id(std::string_view name)
+{
+    return find_name(rc_funcs, name);
+}
+
+constexpr int extf_id(std::string_view name)
+{
+    return find_name(extfs, name);
+}
+
+enum class node_kind : uint8_t
+{
+    number,
+    label,
+    negate,
+    binary,
+    rc_func,
+    extf
+};
+
+struct node
+{
+    node_kind kind = node_kind::number;
+    // Operator of binary nodes, 'd' for "//" and '^' for "**" too
+    char op = '\0';
+    // Operands of binary nodes, argument of negate and rc_func nodes, first argument of extf nodes (in ast::args)
+    int left = -1, right = -1;
+    // Label, function index, or argument count of extf nodes
+    int index = 0;
+    double real = 0, imag = 0;
+    // Numbers in scientific notation with an exponent not computed at compile time: value * pow(10, exponent)
+    bool scaled = false;
+    double exponent = 0;
+};
+
+template <size_t N> struct ast
+{
+    node nodes[N];
+    // Argument nodes of the extended functions, contiguous for each call
+    int args[N] = {};
+    int node_count = 0, arg_count = 0, root = -1;
+    // A complex number is used outside of the arguments of extended functions, real evaluation isn't possible
+    bool is_complex = false;
+};
+
+constexpr bool is_op(char c)
+{
+    return c == '+' || c == '-' || c == '*' || c == '/' || c == '^' || c == '%';
+}
+
+constexpr bool legal_char_in_name(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+constexpr int digit_value(char c, int base)
+{
+    int digit = -1;
+    if (c >= '0' && c <= '9')
+        digit = c - '0';
+    else if (base == 16 && c >= 'a' && c <= 'f')
+        digit = c - 'a' + 10;
+    else if (base == 16 && c >= 'A' && c <= 'F')
+        digit = c - 'A' + 10;
+    return digit < base ? digit : -1;
+}
+
+constexpr int detect_base(const char *s)
+{
+    if (s[0] == '0')
+    {
+        switch (s[1])
+        {
+        case 'x':
+            return 16;
+        case 'o':
+            return 8;
+        case 'b':
+            return 2;
+        }
+    }
+    return 10;
+}
+
+// Same as tms_find_endofnumber() for unsigned numbers, '!' also ends a number since macros aren't expanded
+constexpr int find_end_of_number(const char *s)
+{
+    int end = 0, remaining_dots = 1, base = detect_base(s);
+    bool is_scientific = false, is_complex = false;
+    if (base != 10)
+        end += 2;
+
+    while (s[end] != '\0')
+    {
+        if (digit_value(s[end], base) != -1)
+            ++end;
+        else if (s[end] == '.')
+        {
+            if (remaining_dots == 0)
+                return -1;
+            ++end;
+            --remaining_dots;
+        }
+        else if (base == 10 && (s[end] == 'e' || s[end] == 'E'))
+        {
+            if (is_scientific)
+                return 0;
+            is_scientific = true;
+            ++remaining_dots;
+            ++end;
+            if (s[end] == '+' || s[end] == '-')
+                ++end;
+        }
+        else if (s[end] == 'i')
+        {
+            if (is_complex)
+                return -1;
+            is_complex = true;
+            ++end;
+        }
+        else
+            break;
+    }
+
+    if (s[end] == '\0' || is_op(s[end]) || s[end] == ')' || s[end] == ',' || s[end] == '!')
+        return end - 1;
+    else
+        return -1;
+}
+
+// Same as _tms_read_value_simple(), reads len characters
+constexpr double read_value_simple(const char *s, int len, int base)
+{
+    double value = 0, power = 1;
+    bool is_negative = false;
+    int dot = -1, start, i;
+
+    if (len == 0)
+        return NAN;
+    if (s[0] == '-' || s[0] == '+')
+    {
+        is_negative = (s[0] == '-');
+        ++s;
+        --len;
+    }
+
+    for (i = 0; i < len; ++i)
+        if (s[i] == '.')
+        {
+            dot = i;
+            break;
+        }
+    start = (dot != -1 ? dot - 1 : len - 1);
+
+    for (i = start; i >= 0; --i)
+    {
+        int digit = digit_value(s[i], base);
+        if (digit == -1)
+            return NAN;
+        value += digit * power;
+        power *= base;
+    }
+    if (dot != -1)
+    {
+        power = base;
+        for (i = dot + 1; i < len; ++i)
+        {
+            value += digit_value(s[i], base) / power;
+            power *= base;
+        }
+    }
+    return is_negative ? -value : value;
+}
+
+template <size_t N, size_t Cap> struct parser
+{
+    // Expression without whitespaces, with combined +/- runs (like the runtime parser), and an extra terminator
+    char s[N + 1] = {};
+    int pos = 0;
+    ast<Cap> &A;
+    const std::string_view *labels;
+    size_t label_count;
+    // Nesting level of extended function arguments, which are evaluated with complex enabled
+    int extf_depth = 0;
+
+    constexpr parser(const char (&expr)[N], ast<Cap> &A, const std::string_view *labels, size_t label_count)
+        : A(A), labels(labels), label_count(label_count)
+    {
+        size_t i, j = 0;
+        for (i = 0; expr[i] != '\0'; ++i)
+        {
+            char c = expr[i];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\v' && c != '\f' && c != '\r')
+                s[j++] = c;
+        }
+
+        // Combine in place, like _tms_combine_add_sub() (after removing the whitespaces: "- -" becomes "+")
+        for (i = 0, j = 0; s[i] != '\0';)
+        {
+            if (s[i] == '+' || s[i] == '-')
+            {
+                int subcount = 0;
+                while (s[i] == '+' || s[i] == '-')
+                    subcount += (s[i++] == '-');
+                s[j++] = (subcount % 2 == 1 ? '-' : '+');
+            }
+            else
+                s[j++] = s[i++];
+        }
+        s[j] = '\0';
+    }
+
+    constexpr int add_node(node n)
+    {
+        if (A.node_count == (int)Cap)
+            parse_error("too many nodes");
+        A.nodes[A.node_count] = n;
+        return A.node_count++;
+    }
+
+    constexpr int add_number(double real, double imag)
+    {
+        node n;
+        n.real = real;
+        n.imag = imag;
+        if (imag != 0 && extf_depth == 0)
+            A.is_complex = true;
+        return add_node(n);
+    }
+
+    constexpr int add_unary(node_kind kind, int operand, int index)
+    {
+        node n;
+        n.kind = kind;
+        n.left = operand;
+        n.index = index;
+        return add_node(n);
+    }
+
+    constexpr int add_binary(char op, int left, int right)
+    {
+        node n;
+        n.kind = node_kind::binary;
+        n.op = op;
+        n.left = left;
+        n.right = right;
+        return add_node(n);
+    }
+
+    // Reads an operator of the given priority at pos, returns its code or '\0'
+    constexpr char read_op(int priority)
+    {
+        char c = s[pos], next = s[pos + 1];
+        char op = '\0';
+        int len = 1;
+        if (c == '*' && next == '*')
+        {
+            op = '^';
+            len = 2;
+        }
+        else if (c == '/' && next == '/')
+        {
+            op = 'd';
+            len = 2;
+        }
+        else if (is_op(c))
+            op = c;
+
+        int op_priority = (op == '^' ? 3 : (op == '*' || op == '/' || op == '%' || op == 'd') ? 2 : 1);
+        if (op == '\0' || op_priority != priority)
+            return '\0';
+        pos += len;
+        return op;
+    }
+
+    // Subexpression: a parenthesis content, function argument or the whole expression
+    constexpr int parse_expr()
+    {
+        int left;
+        // Treat +x and -x as 0+x and 0-x
+        if (s[pos] == '+' || s[pos] == '-')
+            left = add_number(0, 0);
+        else
+            left = parse_product();
+
+        char op;
+        while ((op = read_op(1)) != '\0')
+            left = add_binary(op, left, parse_product());
+        return left;
+    }
+
+    constexpr int parse_product()
+    {
+        int left = parse_power();
+        char op;
+        while ((op = read_op(2)) != '\0')
+            left = add_binary(op, left, parse_power());
+        return left;
+    }
+
+    constexpr int parse_power()
+    {
+        int left = parse_operand();
+        char op;
+        while ((op = read_op(3)) != '\0')
+            left = add_binary(op, left, parse_operand());
+        return left;
+    }
+
+    constexpr int parse_operand()
+    {
+        int sign = 0, operand;
+        if (s[pos] == '+' || s[pos] == '-')
+            sign = (s[pos++] == '-' ? -1 : 1);
+
+        if ((s[pos] >= '0' && s[pos] <= '9') || s[pos] == '.')
+            operand = parse_number();
+        else if (legal_char_in_name(s[pos]))
+            operand = parse_name(sign != 0);
+        else if (s[pos] == '(')
+        {
+            if (sign != 0)
+                parse_error("a sign can't precede a parenthesis");
+            ++pos;
+            operand = parse_expr();
+            expect(')');
+        }
+        else
+        {
+            parse_error("syntax error");
+            return -1;
+        }
+
+        // "!" applies to the unsigned term before it, like the macro expansion to fact()
+        while (s[pos] == '!')
+        {
+            if (sign != 0)
+                parse_error("a sign can't precede a function");
+            ++pos;
+            operand = add_unary(node_kind::rc_func, operand, rc_id("fact"));
+        }
+
+        if (s[pos] != '\0' && !is_op(s[pos]) && s[pos] != ')' && s[pos] != ',')
+            parse_error("syntax error");
+
+        if (sign == -1)
+            operand = add_unary(node_kind::negate, operand, 0);
+        return operand;
+    }
+
+    constexpr void expect(char c)
+    {
+        if (s[pos] != c && c == ')')
+            parse_error("parenthesis missing");
+        else if (s[pos] != c)
+            parse_error("syntax error");
+        ++pos;
+    }
+
+    // Same as tms_read_value() on an unsigned number
+    constexpr int parse_number()
+    {
+        const char *number = s + pos;
+        int end = find_end_of_number(number);
+        if (end == -1)
+            parse_error("invalid number");
+        pos += end + 1;
+
+        int base = detect_base(number);
+        if (base != 10)
+        {
+            number += 2;
+            end -= 2;
+        }
+        if (end < 0)
+            parse_error("invalid number");
+
+        bool is_complex = false;
+        int len = end + 1, sci_notation = -1;
+        if (number[end] == 'i')
+        {
+            is_complex = true;
+            --len;
+        }
+        if (base == 10)
+            for (int i = 0; i < len; ++i)
+                if (number[i] == 'e' || number[i] == 'E')
+                {
+                    sci_notation = i;
+                    break;
+                }
+
+        double value, exponent = 0;
+        bool scaled = false;
+        if (sci_notation == -1)
+            value = read_value_simple(number, len, base);
+        else
+        {
+            value = read_value_simple(number, sci_notation, 10);
+            exponent = read_value_simple(number + sci_notation + 1, len - sci_notation - 1, 10);
+            if (exponent != exponent)
+                value = exponent;
+            // pow(10, n) is exact for integers 0 <= n <= 22, and 1 / pow(10, n) is rounded like pow(10, -n)
+            else if (exponent == (int)exponent && exponent >= -22 && exponent <= 22)
+            {
+                double power = 1;
+                for (int i = 0; i < (exponent < 0 ? -exponent : exponent); ++i)
+                    power *= 10;
+                value *= (exponent < 0 ? 1 / power : power);
+            }
+            else
+                scaled = true;
+        }
+        if (value != value)
+            parse_error("invalid number");
+
+        int n = (is_complex ? add_number(0, value) : add_number(value, 0));
+        A.nodes[n].scaled = scaled;
+        A.nodes[n].exponent = exponent;
+        return n;
+    }
+
+    constexpr int parse_name(bool is_signed)
+    {
+        int start = pos;
+        while (legal_char_in_name(s[pos]))
+            ++pos;
+        std::string_view name(s + start, pos - start);
+
+        if (s[pos] == '(')
+        {
+            if (is_signed)
+                parse_error("a sign can't precede a function");
+            ++pos;
+            return parse_call(name);
+        }
+
+        // Built-in constants come first, like the runtime variables
+        for (const auto &var : builtin_vars)
+            if (var.name == name)
+                return add_number(var.real, var.imag);
+        for (size_t i = 0; i < label_count; ++i)
+            if (labels[i] == name)
+            {
+                node n;
+                n.kind = node_kind::label;
+                n.index = i;
+                return add_node(n);
+            }
+        if (name == "ans")
+            parse_error("ans is only known at runtime");
+        parse_error("undefined variable");
+        return -1;
+    }
+
+    constexpr int parse_call(std::string_view name)
+    {
+        int id = rc_id(name);
+        if (id != -1)
+        {
+            int arg = parse_expr();
+            if (s[pos] == ',')
+                parse_error("unexpected comma in a function with one argument");
+            expect(')');
+            return add_unary(node_kind::rc_func, arg, id);
+        }
+
+        id = extf_id(name);
+        if (id == -1)
+        {
+            if (find_name(runtime_extfs, name) != -1)
+                parse_error("extended function not supported by static expressions");
+            else
+                parse_error("undefined function");
+        }
+
+        // Arguments of nested calls are added to A.args first, the arguments of this call are kept aside
+        int args[N] = {}, count = 0;
+        ++extf_depth;
+        do
+            args[count++] = parse_expr();
+        while (s[pos++] == ',');
+        --extf_depth;
+        if (s[pos - 1] != ')')
+            parse_error("parenthesis missing");
+
+        if ((name == "logn" && count != 2) || (name == "int" && count != 1))
+            parse_error("wrong argument count");
+
+        node n;
+        n.kind = node_kind::extf;
+        n.left = A.arg_count;
+        n.index = count;
+        n.right = id;
+        for (int i = 0; i < count; ++i)
+            A.args[A.arg_count++] = args[i];
+        return add_node(n);
+    }
+};
+
+template <fixed_string Expr, fixed_string... Labels> consteval auto parse()
+{
+    // An operand adds at most one node per character and a sign node, operators add one node
+    constexpr size_t cap = 2 * sizeof(Expr.str) + 2;
+    ast<cap> A;
+    const std::string_view labels[] = {Labels.view()..., std::string_view()};
+    parser<sizeof(Expr.str), cap> P(Expr.str, A, labels, sizeof...(Labels));
+
+    if (P.s[0] == '\0')
+        parse_error("empty expression");
+    A.root = P.parse_expr();
+    if (P.s[P.pos] == ')')
+        parse_error("parenthesis missing");
+    else if (P.s[P.pos] != '\0')
+        parse_error("syntax error");
+    return A;
+}
+
+template <fixed_string Expr, fixed_string... Labels> inline constexpr auto parsed = parse<Expr, Labels...>();
+
+using complex = std::complex<double>;
+
+inline cdouble to_c(complex z)
+{
+    return cdouble{z.real(), z.imag()};
+}
+
+inline complex from_c(cdouble z)
+{
+    return complex(z.r, z.c);
+}
+
+template <typename T> constexpr T nan()
+{
+    return T(NAN);
+}
+
+// Same as tms_fact(), without saving an error
+inline double fact(double value)
+{
+    if (value - std::floor(value) != 0 || value < 0)
+        return NAN;
+    double result = 1;
+    for (int i = 2; i <= value; ++i)
+    {
+        result *= i;
+        if (std::isinf(result))
+            break;
+    }
+    return result;
+}
+
+template <int F> inline double rc_call(double x)
+{
+    if constexpr (F == rc_id("fact"))
+        return fact(x);
+    else if constexpr (F == rc_id("abs"))
+        return std::fabs(x);
+    else if constexpr (F == rc_id("exp"))
+        return std::exp(x);
+    else if constexpr (F == rc_id("ceil"))
+        return std::ceil(x);
+    else if constexpr (F == rc_id("floor"))
+        return std::floor(x);
+    else if constexpr (F == rc_id("round"))
+        return std::round(x);
+    else if constexpr (F == rc_id("sign"))
+        return tms_sign(x);
+    else if constexpr (F == rc_id("arg"))
+        return tms_carg_d(x);
+    else if constexpr (F == rc_id("sqrt"))
+        return std::sqrt(x);
+    else if constexpr (F == rc_id("cbrt"))
+        return std::cbrt(x);
+    else if constexpr (F == rc_id("cos"))
+        return tms_cos(x);
+    else if constexpr (F == rc_id("sin"))
+        return tms_sin(x);
+    else if constexpr (F == rc_id("tan"))
+        return tms_tan(x);
+    else if constexpr (F == rc_id("acos"))
+        return std::acos(x);
+    else if constexpr (F == rc_id("asin"))
+        return std::asin(x);
+    else if constexpr (F == rc_id("atan"))
+        return std::atan(x);
+    else if constexpr (F == rc_id("cosh"))
+        return std::cosh(x);
+    else if constexpr (F == rc_id("sinh"))
+        return std::sinh(x);
+    else if constexpr (F == rc_id("tanh"))
+        return std::tanh(x);
+    else if constexpr (F == rc_id("acosh"))
+        return std::acosh(x);
+    else if constexpr (F == rc_id("asinh"))
+        return std::asinh(x);
+    else if constexpr (F == rc_id("atanh"))
+        return std::atanh(x);
+    else if constexpr (F == rc_id("ln"))
+        return std::log(x);
+    else if constexpr (F == rc_id("log2"))
+        return std::log2(x);
+    else
+    {
+        static_assert(F == rc_id("log10"), "Function without a real variant");
+        return std::log10(x);
+    }
+}
+
+template <int F> inline complex rc_call(complex z)
+{
+    if constexpr (F == rc_id("fact"))
+        return z.imag() != 0 ? nan<complex>() : complex(fact(z.real()));
+    else if constexpr (F == rc_id("abs"))
+        return from_c(cabs_z(to_c(z)));
+    else if constexpr (F == rc_id("exp"))
+        return from_c(tms_cexp(to_c(z)));
+    else if constexpr (F == rc_id("ceil"))
+        return from_c(tms_cceil(to_c(z)));
+    else if constexpr (F == rc_id("floor"))
+        return from_c(tms_cfloor(to_c(z)));
+    else if constexpr (F == rc_id("round"))
+        return from_c(tms_cround(to_c(z)));
+    else if constexpr (F == rc_id("sign"))
+        return from_c(tms_csign(to_c(z)));
+    else if constexpr (F == rc_id("arg"))
+        return from_c(carg_z(to_c(z)));
+    else if constexpr (F == rc_id("sqrt"))
+        return std::sqrt(z);
+    else if constexpr (F == rc_id("cbrt"))
+        return from_c(tms_ccbrt(to_c(z)));
+    else if constexpr (F == rc_id("cos"))
+        return from_c(tms_ccos(to_c(z)));
+    else if constexpr (F == rc_id("sin"))
+        return from_c(tms_csin(to_c(z)));
+    else if constexpr (F == rc_id("tan"))
+        return from_c(tms_ctan(to_c(z)));
+    else if constexpr (F == rc_id("acos"))
+        return std::acos(z);
+    else if constexpr (F == rc_id("asin"))
+        return std::asin(z);
+    else if constexpr (F == rc_id("atan"))
+        return std::atan(z);
+    else if constexpr (F == rc_id("cosh"))
+        return std::cosh(z);
+    else if constexpr (F == rc_id("sinh"))
+        return std::sinh(z);
+    else if constexpr (F == rc_id("tanh"))
+        return std::tanh(z);
+    else if constexpr (F == rc_id("acosh"))
+        return std::acosh(z);
+    else if constexpr (F == rc_id("asinh"))
+        return std::asinh(z);
+    else if constexpr (F == rc_id("atanh"))
+        return std::atanh(z);
+    else if constexpr (F == rc_id("ln"))
+        return from_c(tms_cln(to_c(z)));
+    else if constexpr (F == rc_id("log2"))
+        return from_c(tms_clog2(to_c(z)));
+    else
+    {
+        static_assert(F == rc_id("log10"), "Function without a complex variant");
+        return from_c(tms_clog10(to_c(z)));
+    }
+}
+
+// Same as the evaluator: left / right rounded toward zero
+inline double round_to_zero(double x)
+{
+    return x > 0 ? std::floor(x) : std::ceil(x);
+}
+
+inline complex round_to_zero(complex z)
+{
+    return from_c(tms_round_to_zero(to_c(z)));
+}
+
+template <char Op, typename T> inline T binary(T l, T r)
+{
+    if constexpr (Op == '+')
+        return l + r;
+    else if constexpr (Op == '-')
+        return l - r;
+    else if constexpr (Op == '*')
+        return l * r;
+    else if constexpr (Op == '/' || Op == 'd')
+    {
+        if (r == T(0))
+            return nan<T>();
+        if constexpr (Op == 'd')
+            return round_to_zero(l / r);
+        else
+            return l / r;
+    }
+    else if constexpr (Op == '%')
+    {
+        if constexpr (std::is_same_v<T, complex>)
+        {
+            if (l.imag() != 0 || r.imag() != 0 || r == 0.0)
+                return nan<T>();
+            return std::fmod(l.real(), r.real());
+        }
+        else
+            return r == 0 ? nan<T>() : std::fmod(l, r);
+    }
+    else
+    {
+        static_assert(Op == '^');
+        if constexpr (std::is_same_v<T, complex>)
+            return from_c(tms_cpow(to_c(l), to_c(r)));
+        else
+            return std::pow(l, r);
+    }
+}
+
+// Same as _tms_avg(), _tms_min(), _tms_max(), _tms_logn() and _tms_int()
+template <int F, size_t N> inline complex extf_call(const complex (&args)[N])
+{
+    for (const complex &arg : args)
+        if (std::isnan(arg.real()))
+            return nan<complex>();
+
+    if constexpr (F == extf_id("avg"))
+    {
+        complex total = 0;
+        for (const complex &arg : args)
+            total += arg;
+        return total / (double)N;
+    }
+    else if constexpr (F == extf_id("min") || F == extf_id("max"))
+    {
+        complex result = (F == extf_id("min") ? INFINITY : -INFINITY);
+        for (const complex &arg : args)
+        {
+            if (arg.imag() != 0)
+                return nan<complex>();
+            if (F == extf_id("min") ? result.real() > arg.real() : result.real() < arg.real())
+                result = arg;
+        }
+        return result;
+    }
+    else if constexpr (F == extf_id("logn"))
+    {
+        if (args[1].imag() != 0)
+            return nan<complex>();
+        return from_c(tms_cln(to_c(args[0]))) / std::log(args[1].real());
+    }
+    else
+    {
+        static_assert(F == extf_id("int"));
+        return round_to_zero(args[0]);
+    }
+}
+
+/**
+ * @brief Node I of the parsed expression A, evaluated with real (double) or complex operands.
+ * @details Extended functions are evaluated with complex operands like at runtime, a complex answer fails the real
+ * evaluation.
+ */
+template <const auto &A, int I> struct term
+{
+    static constexpr node n = A.nodes[I];
+
+    template <typename T> static T eval(const complex *labels)
+    {
+        if constexpr (n.kind == node_kind::number)
+        {
+            double scale = (n.scaled ? std::pow(10.0, n.exponent) : 1);
+            if constexpr (std::is_same_v<T, complex>)
+                return n.scaled ? complex(n.real * scale, n.imag * scale) : complex(n.real, n.imag);
+            else
+                return n.scaled ? n.real * scale : n.real;
+        }
+        else if constexpr (n.kind == node_kind::label)
+        {
+            if constexpr (std::is_same_v<T, complex>)
+                return labels[n.index];
+            else
+                return labels[n.index].real();
+        }
+        else if constexpr (n.kind == node_kind::negate)
+            return -term<A, n.left>::template eval<T>(labels);
+        else if constexpr (n.kind == node_kind::binary)
+            return binary<n.op>(term<A, n.left>::template eval<T>(labels),
+                                term<A, n.right>::template eval<T>(labels));
+        else if constexpr (n.kind == node_kind::rc_func)
+            return rc_call<n.index>(term<A, n.left>::template eval<T>(labels));
+        else
+        {
+            complex result = [labels]<size_t... K>(std::index_sequence<K...>) {
+                const complex args[] = {term<A, A.args[n.left + K]>::template eval<complex>(labels)...};
+                return extf_call<n.right>(args);
+            }(std::make_index_sequence<n.index>());
+
+            if constexpr (std::is_same_v<T, complex>)
+                return result;
+            else
+                return result.imag() != 0 ? nan<T>() : result.real();
+        }
+    }
+};
+} // namespace static_detail
+
+/**
+ * @brief Scientific expression parsed at compile time, evaluated by straight-line code.
+ * @details Example: StaticExpression<"x^2+sin(y)", "x", "y">::evaluate(2, 0.5).\n
+ * The labels are the names following the expression, their values are passed to evaluate() in the same order.
+ * @note The built-in constants have priority over labels of the same name, like at runtime.
+ */
+template <static_detail::fixed_string Expr, static_detail::fixed_string... Labels> class StaticExpression
+{
+    static constexpr const auto &ast = static_detail::parsed<Expr, Labels...>;
+    using root = static_detail::term<static_detail::parsed<Expr, Labels...>, ast.root>;
+
+  public:
+    /// @brief Number of labels, and of values passed to evaluate().
+    static constexpr size_t label_count = sizeof...(Labels);
+
+    /// @brief Names of the labels, in the order of their values.
+    static constexpr std::array<std::string_view, label_count> labels = {Labels.view()...};
+
+    /**
+     * @brief Evaluates the expression with real operands, then with complex operands if it fails, like tms_solve().
+     * @details The real evaluation is skipped if the expression or a label value is complex.
+     * @return The answer of the expression, or NaN in case of failure.
+     */
+    template <std::convertible_to<std::complex<double>>... V>
+        requires(sizeof...(V) == label_count)
+    static std::complex<double> evaluate(V... values)
+    {
+        const std::complex<double> L[label_count + 1] = {std::complex<double>(values)...};
+        bool real_labels = true;
+        for (size_t i = 0; i < label_count; ++i)
+            real_labels = real_labels && L[i].imag() == 0;
+
+        if (!ast.is_complex && real_labels)
+        {
+            double result = root::template eval<double>(L);
+            if (!std::isnan(result))
+                return result;
+        }
+        return check(root::template eval<std::complex<double>>(L));
+    }
+
+    /**
+     * @brief Evaluates the expression with real operands only.
+     * @return The answer of the expression, or NaN in case of failure (including complex answers).
+     */
+    template <std::convertible_to<double>... V>
+        requires(sizeof...(V) == label_count)
+    static double evaluate_real(V... values)
+    {
+        if (ast.is_complex)
+            return NAN;
+        const std::complex<double> L[label_count + 1] = {std::complex<double>((double)values)...};
+        return root::template eval<double>(L);
+    }
+
+    /**
+     * @brief Evaluates the expression with complex operands only, like ENABLE_CMPLX.
+     * @return The answer of the expression, or NaN in case of failure.
+     */
+    template <std::convertible_to<std::complex<double>>... V>
+        requires(sizeof...(V) == label_count)
+    static std::complex<double> evaluate_complex(V... values)
+    {
+        const std::complex<double> L[label_count + 1] = {std::complex<double>(values)...};
+        return check(root::template eval<std::complex<double>>(L));
+    }
+
+    /// @brief Same as evaluate().
+    template <std::convertible_to<std::complex<double>>... V>
+        requires(sizeof...(V) == label_count)
+    std::complex<double> operator()(V... values) const
+    {
+        return evaluate(values...);
+    }
+
+  private:
+    // Failures return NaN, like the runtime evaluator
+    static std::complex<double> check(std::complex<double> result)
+    {
+        if (std::isnan(result.real()) || std::isnan(result.imag()))
+            return NAN;
+        return result;
+    }
+};
+} // namespace tmsolve
+
+#endif
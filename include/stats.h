@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_STATS_H
+#define _TMS_STATS_H
+
+/**
+ * @file
+ * @brief Declares the profiling counters: number of calls and cumulative time of each phase of the library.
+ * @details The counters are disabled by default, enable them with tms_set_stats(). When disabled, the cost is a branch
+ * per instrumented call.\n
+ * The time of a phase includes the phases it calls (the evaluation time includes the extended functions time).
+ * Recursive calls of a phase are counted, but only the outermost call is timed.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// @brief Phases measured by the profiling counters.
+enum tms_stat_phases
+{
+    /// tms_parse_expr()
+    TMS_STAT_PARSE,
+    /// tms_parse_int_expr()
+    TMS_STAT_INT_PARSE,
+    /// Expansion of unary operators into functions (EXPAND_UOPS option) in both parsers.
+    TMS_STAT_EXPAND_MACROS,
+    /// Scientific evaluator, without the lock wait.
+    TMS_STAT_EVALUATE,
+    /// Integer evaluator, without the lock wait.
+    TMS_STAT_INT_EVALUATE,
+    /// Calls of extended functions by the evaluators.
+    TMS_STAT_EXTF,
+    /// Lookups of user functions by the evaluators.
+    TMS_STAT_UFUNC_LOOKUP,
+    /// tms_save_error()
+    TMS_STAT_SAVE_ERROR,
+    /// Waits for a lock held by another thread in tms_lock_parser(), the count is the number of waits.
+    TMS_STAT_PARSER_LOCK_WAIT,
+    /// Waits for a lock held by another thread in tms_lock_evaluator(), the count is the number of waits.
+    TMS_STAT_EVALUATOR_LOCK_WAIT,
+    /// Number of phases.
+    TMS_STAT_COUNT
+};
+
+/// @brief Snapshot of the profiling counters.
+typedef struct tms_stats
+{
+    /// @brief Number of calls of each phase.
+    uint64_t count[TMS_STAT_COUNT];
+    /// @brief Cumulative time of each phase in nanoseconds.
+    uint64_t ns[TMS_STAT_COUNT];
+} tms_stats;
+
+/**
+ * @brief Enables or disables the profiling counters, the current values are kept.
+ */
+void tms_set_stats(bool enable);
+
+/// @brief Returns true if the profiling counters are enabled.
+bool tms_stats_enabled();
+
+/**
+ * @brief Returns a snapshot of the profiling counters.
+ * @note Counters are updated independently, a snapshot taken while other threads are running may be slightly
+ * inconsistent (a count updated before its time).
+ */
+tms_stats tms_get_stats();
+
+/**
+ * @brief Sets all profiling counters to zero.
+ */
+void tms_reset_stats();
+
+/**
+ * @brief Returns the name of a phase (ex: "parse" for TMS_STAT_PARSE), or NULL if the phase is invalid.
+ */
+const char *tms_stat_name(int phase);
+
+#endif
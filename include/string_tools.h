@@ -69,6 +69,8 @@ bool tms_is_valid_number_end(char c);
 
 int8_t tms_bin_to_int(char c);
 
+int8_t tms_isdigit(char c);
+
 int8_t tms_dec_to_int(char c);
 
 int8_t tms_oct_to_int(char c);
@@ -0,0 +1,138 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_SYMTAB_H
+#define _TMS_SYMTAB_H
+
+/**
+ * @file
+ * @brief Declares the symbol table used to store variables and functions by name.
+ * @details Open addressing hash table with linear probing, specialized for short string keys.\n
+ * Each slot stores a 32-bit hash and the first 16 bytes of the name (zero padded), so a lookup of a name shorter than 16
+ * bytes is two integer comparisons without following the name pointer, longer names compare the rest with strcmp().\n
+ * Items are copied in the table, the first member of an item must be its name (`char *name`).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct tms_symtab tms_symtab;
+
+/// @brief Bytes of the name stored inline in a slot of the table.
+#define TMS_SYMTAB_KEY_SIZE 16
+
+static inline uint64_t _tms_symtab_read64(const char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return value;
+}
+
+static inline uint64_t _tms_symtab_read32(const char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+/**
+ * @brief Copies the first bytes of the name to key as little endian integers, zero padded.
+ * @details The value of the key is the same on all platforms, the built-in names tables generated at build time rely on it.
+ * @return The length of the name.
+ */
+static inline size_t _tms_symtab_key(const char *name, uint64_t key[TMS_SYMTAB_KEY_SIZE / 8])
+{
+    size_t n = strlen(name), i;
+    key[0] = key[1] = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Overlapping loads that end at the last byte, shifted to drop the bytes read twice
+    if (n >= 16)
+    {
+        key[0] = _tms_symtab_read64(name);
+        key[1] = _tms_symtab_read64(name + 8);
+    }
+    else if (n >= 8)
+    {
+        key[0] = _tms_symtab_read64(name);
+        if (n > 8)
+            key[1] = _tms_symtab_read64(name + n - 8) >> (8 * (16 - n));
+    }
+    else if (n >= 4)
+        key[0] = _tms_symtab_read32(name) | (_tms_symtab_read32(name + n - 4) >> (8 * (8 - n))) << 32;
+    else
+        for (i = 0; i < n; ++i)
+            key[0] |= (uint64_t)(unsigned char)name[i] << (8 * i);
+#else
+    for (i = 0; i < n && i < TMS_SYMTAB_KEY_SIZE; ++i)
+        key[i / 8] |= (uint64_t)(unsigned char)name[i] << (8 * (i % 8));
+#endif
+    return n;
+}
+
+/**
+ * @brief Creates a new symbol table.
+ * @param elsize Size of an item in bytes.
+ * @param cap Initial capacity (number of items), 0 for the default.
+ * @param seed Seed of the hash function.
+ * @param elfree Function called to free the members of an item when it is deleted by tms_symtab_delete_and_free() or
+ * tms_symtab_clear(), can be NULL.
+ */
+tms_symtab *tms_symtab_new(size_t elsize, size_t cap, uint64_t seed, void (*elfree)(void *item));
+
+/**
+ * @brief Frees the table, without calling elfree on the items.
+ */
+void tms_symtab_free(tms_symtab *T);
+
+/**
+ * @brief Removes all items, calling elfree on each of them.
+ */
+void tms_symtab_clear(tms_symtab *T);
+
+/// @brief Returns the number of items in the table.
+size_t tms_symtab_count(tms_symtab *T);
+
+/**
+ * @brief Finds an item by name.
+ * @return Pointer to the item in the table, or NULL if it doesn't exist.
+ * @warning The pointer is invalidated by any modification of the table.
+ */
+const void *tms_symtab_get(tms_symtab *T, const char *name);
+
+/**
+ * @brief Inserts an item, or replaces the item with the same name.
+ * @return Pointer to a copy of the replaced item (valid until the next modification), or NULL if there wasn't one.
+ */
+const void *tms_symtab_set(tms_symtab *T, const void *item);
+
+/**
+ * @brief Removes an item by name.
+ * @return Pointer to a copy of the removed item (valid until the next modification), or NULL if it doesn't exist.
+ */
+const void *tms_symtab_delete(tms_symtab *T, const char *name);
+
+/**
+ * @brief Removes an item by name and calls elfree on it.
+ * @return 0 on success, -1 if the item doesn't exist.
+ */
+int tms_symtab_delete_and_free(tms_symtab *T, const char *name);
+
+/**
+ * @brief Iterates over the items.
+ * @param i Iterator, set to 0 before the first call.
+ * @param item Set to the current item.
+ * @return true if an item was found, false at the end of the table.
+ */
+bool tms_symtab_iter(tms_symtab *T, size_t *i, void **item);
+
+/**
+ * @brief Returns a malloc'd array with a copy of all items, or NULL if the table is empty.
+ * @param len Set to the number of items.
+ * @param sort Sorts the items by name.
+ */
+void *tms_symtab_to_array(tms_symtab *T, size_t *len, bool sort);
+
+#endif
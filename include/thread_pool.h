@@ -0,0 +1,92 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_THREAD_POOL_H
+#define _TMS_THREAD_POOL_H
+
+/**
+ * @file
+ * @brief Declares the thread pool shared by the parallel parts of the library, and the interface of host executors.
+ * @details Parallel jobs are ranges of items split in chunks. Each thread of the pool owns a part of the chunks and
+ * steals half of the remaining chunks of another thread when it runs out, the calling thread takes part in its own job.
+ * The pool threads are started by the first parallel job.\n
+ * Used by integrate(), tms_evaluate_batch() and tms_matrix_multiply(). A host with its own threads can run the jobs of
+ * the library instead with tms_set_executor().\n
+ * The pool threads also run the tasks queued by tms_evaluate_async(), one at a time each.
+ * @note Parallel jobs started by a job (ex: integrate() evaluated by a parallel batch) run in the thread that starts them.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Function running the items [begin, end) of a parallel job.
+ * @param arg The argument passed to tms_parallel_for().
+ */
+typedef void (*tms_range_func)(void *arg, size_t begin, size_t end);
+
+/// @brief Executor provided by the host to run the parallel jobs of the library.
+typedef struct tms_executor
+{
+    /// @brief Passed to the callbacks.
+    void *context;
+    /// @brief Returns the number of threads that can run a job at once, including the calling thread.
+    int (*thread_count)(void *context);
+    /**
+     * @brief Calls func on disjoint ranges covering the items [0, n), then returns.
+     * @details Ranges should be at least grain items long, except the last one.
+     */
+    void (*parallel_for)(void *context, size_t n, size_t grain, tms_range_func func, void *arg);
+} tms_executor;
+
+/**
+ * @brief Sets the number of threads of the pool, including the thread that starts a job.
+ * @param count Number of threads, 0 to use all the CPUs (default), 1 runs the jobs in the calling thread.
+ * @note Waits for the running jobs and tasks to finish, then stops the pool threads.
+ */
+void tms_set_thread_pool_size(int count);
+
+/// @brief Returns the number of threads of the pool, including the thread that starts a job.
+int tms_get_thread_pool_size();
+
+/**
+ * @brief Stops the threads of the pool, they are started again by the next parallel job.
+ * @details Waits for the running jobs and the queued tasks (ex: tms_evaluate_async()) to finish first.
+ */
+void tms_stop_thread_pool();
+
+/**
+ * @brief Runs the parallel jobs of the library with a host executor instead of the thread pool.
+ * @param E The executor, copied. NULL uses the thread pool again.
+ * @note Should be called while no parallel job runs.
+ */
+void tms_set_executor(const tms_executor *E);
+
+/// @brief Returns the number of threads that run a parallel job, from the executor or the thread pool.
+int tms_get_thread_count();
+
+/**
+ * @brief Calls func on ranges covering the items [0, n) in parallel, and returns when all the items are done.
+ * @param n Number of items.
+ * @param grain Minimum number of items of a range, chunks of this size are distributed between the threads.
+ * @param func Function running a range of items, called concurrently from several threads.
+ * @param arg Argument passed to func.
+ * @note The whole range runs in the calling thread if it fits in one chunk, if the thread count is 1, if this thread is
+ * already running a job, or while evaluations are profiled or dumped (see _tms_debug).
+ */
+void tms_parallel_for(size_t n, size_t grain, tms_range_func func, void *arg);
+
+/**
+ * @brief Returns false if a parallel job started now would run in the calling thread.
+ */
+bool _tms_parallel_enabled();
+
+/**
+ * @brief Queues a task run once by a thread of the pool, at least one pool thread is started.
+ * @details Tasks run on the pool threads even with a host executor.
+ * @return 0 on success, -1 if no pool thread could be started.
+ */
+int _tms_pool_submit(void (*func)(void *), void *arg);
+
+#endif
@@ -1,5 +1,5 @@
 /*
-Copyright (C) 2023-2024 Ahmad Ismail
+Copyright (C) 2023-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #ifndef _TMS_STRUCTS_H
@@ -178,6 +178,8 @@ enum tms_variable_types
 #define PRINT_ERRORS 4
 /// Enables unary operators expansion
 #define EXPAND_UOPS 8
+/// Locks the evaluator in shared mode, evaluations of different expressions run concurrently.
+#define SHARED_LOCK 16
 
 /// @brief Holds the metadata of a subexpression.
 typedef struct tms_math_subexpr
@@ -247,6 +249,16 @@ typedef struct tms_math_expr
 
     ///@brief Toggles complex support.
     bool enable_complex;
+
+    ///@brief Number of evaluations (updated atomically), used to decide when to compile the expression.
+    ///@details Negative once a thread claimed the compilation, see tms_set_jit_threshold().
+    int eval_count;
+
+    ///@brief Native code of the expression, NULL if not compiled yet.
+    struct tms_jit_code *jit;
+
+    ///@brief Evaluation profile, NULL unless enabled by tms_enable_profile().
+    struct tms_expr_profile *profile;
 } tms_math_expr;
 
 /// @brief Operator node, stores the required metadata for an operator and its operands.
@@ -340,6 +352,9 @@ typedef struct tms_int_expr
 
     /// @brief Answer of the expression.
     int64_t answer;
+
+    /// @brief Evaluation profile, NULL unless enabled by tms_enable_int_profile().
+    struct tms_expr_profile *profile;
 } tms_int_expr;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,352 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "async.h"
+#include "async_common.h"
+#include "error_handler.h"
+#include "evaluator.h"
+#include "internals.h"
+#include "m_errors.h"
+#include "parser.h"
+#include "string_tools.h"
+#include "thread_pool.h"
+#include "tms_complex.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+_Thread_local int *_tms_async_cancel = NULL;
+// Job whose callback is running in this thread
+static _Thread_local tms_async_job *_tms_async_calling = NULL;
+
+struct tms_async_job
+{
+    char *expr;
+    int options;
+    // Owned by the job until it is parsed
+    tms_arg_list *labels;
+    tms_async_callback callback;
+    void *data;
+    // enum tms_async_states, read and written atomically
+    int state;
+    // Set by tms_async_cancel(), see _tms_cancelled()
+    int cancel;
+    // Members below are protected by the async lock, except result and error (written before the final state)
+    // References of the caller, of the pool task and of a running callback
+    int refs;
+    // Set by tms_async_free(), the completion isn't reported anymore
+    bool released;
+    // In the completed list
+    bool listed;
+    // The callback is running, tms_async_free() waits for it
+    bool in_callback;
+    struct tms_async_job *next;
+    double complex result;
+    char *error;
+};
+
+static pthread_mutex_t _tms_async_lock = PTHREAD_MUTEX_INITIALIZER;
+// Signaled when a job completes or its callback returns
+static pthread_cond_t _tms_async_done = PTHREAD_COND_INITIALIZER;
+// Completed jobs without a callback, oldest first, and their last link
+static tms_async_job *_tms_async_list = NULL, **_tms_async_tail = &_tms_async_list;
+// Read and write ends of the completion descriptor, both are the same eventfd on Linux
+static int _tms_async_fds[2] = {-1, -1};
+
+// Makes the completion descriptor readable, called with the async lock held
+static void _tms_async_signal()
+{
+#ifndef _WIN32
+    if (_tms_async_fds[1] == -1)
+        return;
+#ifdef __linux__
+    uint64_t one = 1;
+    while (write(_tms_async_fds[1], &one, sizeof(one)) == -1 && errno == EINTR)
+        ;
+#else
+    // A full pipe is still readable, the write can fail
+    char byte = 0;
+    while (write(_tms_async_fds[1], &byte, 1) == -1 && errno == EINTR)
+        ;
+#endif
+#endif
+}
+
+// Empties the completion descriptor, called with the async lock held
+static void _tms_async_drain()
+{
+#ifndef _WIN32
+    if (_tms_async_fds[0] == -1)
+        return;
+    char buffer[64];
+    ssize_t size;
+    // Non blocking, stops when empty
+    do
+        size = read(_tms_async_fds[0], buffer, sizeof(buffer));
+    while (size > 0 || (size == -1 && errno == EINTR));
+#endif
+}
+
+// Drops a reference to J, the last one frees it
+static void _tms_async_release(tms_async_job *J)
+{
+    pthread_mutex_lock(&_tms_async_lock);
+    bool last = (--J->refs == 0);
+    pthread_mutex_unlock(&_tms_async_lock);
+    if (!last)
+        return;
+
+    free(J->expr);
+    tms_free_arg_list(J->labels);
+    free(J->error);
+    free(J);
+}
+
+// Reports the completion of J, its state and answer are already set
+static void _tms_async_finish(tms_async_job *J)
+{
+    pthread_mutex_lock(&_tms_async_lock);
+    bool report = !J->released;
+    if (report && J->callback == NULL)
+    {
+        J->listed = true;
+        J->next = NULL;
+        *_tms_async_tail = J;
+        _tms_async_tail = &J->next;
+        _tms_async_signal();
+    }
+    bool call = report && J->callback != NULL;
+    if (call)
+    {
+        // Keeps J alive if the callback frees it
+        ++J->refs;
+        J->in_callback = true;
+    }
+    pthread_cond_broadcast(&_tms_async_done);
+    pthread_mutex_unlock(&_tms_async_lock);
+
+    if (!call)
+        return;
+
+    tms_async_job *previous = _tms_async_calling;
+    _tms_async_calling = J;
+    J->callback(J, J->data);
+    _tms_async_calling = previous;
+
+    pthread_mutex_lock(&_tms_async_lock);
+    J->in_callback = false;
+    pthread_cond_broadcast(&_tms_async_done);
+    pthread_mutex_unlock(&_tms_async_lock);
+    _tms_async_release(J);
+}
+
+// Pool task parsing and evaluating a job
+static void _tms_async_run(void *arg)
+{
+    tms_async_job *J = arg;
+    int state = TMS_ASYNC_QUEUED;
+
+    // Cancelled while queued, tms_async_cancel() completed it
+    if (!__atomic_compare_exchange_n(&J->state, &state, TMS_ASYNC_RUNNING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        _tms_async_release(J);
+        return;
+    }
+
+    _tms_async_cancel = &J->cancel;
+    if ((J->options & SHARED_LOCK) != 0)
+        tms_lock_evaluator_shared(TMS_EVALUATOR);
+    else
+        tms_lock_evaluator(TMS_EVALUATOR);
+
+    // The expression owns the labels, the parser frees them if it fails
+    tms_math_expr *M = tms_parse_expr(J->expr, (J->options & (ENABLE_CMPLX | EXPAND_UOPS)) | NO_LOCK, J->labels);
+    J->labels = NULL;
+    J->result = tms_evaluate(M, NO_LOCK);
+    tms_delete_math_expr(M);
+
+    tms_unlock_evaluator(TMS_EVALUATOR);
+    _tms_async_cancel = NULL;
+
+    state = TMS_ASYNC_DONE;
+    if (tms_iscnan(J->result))
+    {
+        tms_error_data *E = tms_get_last_error(TMS_EVALUATOR | TMS_PARSER);
+        if (_tms_cancelled(&J->cancel))
+            state = TMS_ASYNC_CANCELLED;
+        else
+        {
+            state = TMS_ASYNC_FAILED;
+            J->error = strdup(E != NULL ? E->message : UNKNOWN_FUNC_ERROR);
+        }
+        // The next job of this thread starts with an empty error database
+        tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
+    }
+    __atomic_store_n(&J->state, state, __ATOMIC_RELEASE);
+
+    _tms_async_finish(J);
+    _tms_async_release(J);
+}
+
+tms_async_job *tms_evaluate_async(const char *expr, int options, tms_arg_list *labels, tms_async_callback callback,
+                                  void *data)
+{
+    tms_async_job *J = malloc(sizeof(tms_async_job));
+    if (J == NULL)
+        return NULL;
+    *J = (tms_async_job){.expr = strdup(expr),
+                         .options = options,
+                         .labels = tms_dup_arg_list(labels),
+                         .callback = callback,
+                         .data = data,
+                         .state = TMS_ASYNC_QUEUED,
+                         .refs = 2};
+
+    if (J->expr == NULL || _tms_pool_submit(_tms_async_run, J) != 0)
+    {
+        free(J->expr);
+        tms_free_arg_list(J->labels);
+        free(J);
+        return NULL;
+    }
+    return J;
+}
+
+int tms_async_state(tms_async_job *J)
+{
+    return __atomic_load_n(&J->state, __ATOMIC_ACQUIRE);
+}
+
+int tms_async_result(tms_async_job *J, cdouble *result)
+{
+    if (tms_async_state(J) != TMS_ASYNC_DONE)
+        return -1;
+    *result = J->result;
+    return 0;
+}
+
+const char *tms_async_error(tms_async_job *J)
+{
+    switch (tms_async_state(J))
+    {
+    case TMS_ASYNC_FAILED:
+        return J->error;
+    case TMS_ASYNC_CANCELLED:
+        return EVALUATION_CANCELLED;
+    default:
+        return NULL;
+    }
+}
+
+void *tms_async_data(tms_async_job *J)
+{
+    return J->data;
+}
+
+int tms_async_wait(tms_async_job *J)
+{
+    int state;
+    pthread_mutex_lock(&_tms_async_lock);
+    while ((state = tms_async_state(J)) < TMS_ASYNC_DONE)
+        pthread_cond_wait(&_tms_async_done, &_tms_async_lock);
+    pthread_mutex_unlock(&_tms_async_lock);
+    return state;
+}
+
+void tms_async_cancel(tms_async_job *J)
+{
+    __atomic_store_n(&J->cancel, 1, __ATOMIC_RELAXED);
+
+    // A queued job completes now, its pool task will only drop its reference
+    int state = TMS_ASYNC_QUEUED;
+    if (__atomic_compare_exchange_n(&J->state, &state, TMS_ASYNC_CANCELLED, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        _tms_async_finish(J);
+}
+
+void tms_async_free(tms_async_job *J)
+{
+    if (J == NULL)
+        return;
+
+    pthread_mutex_lock(&_tms_async_lock);
+    J->released = true;
+    if (J->listed)
+    {
+        tms_async_job **link = &_tms_async_list;
+        while (*link != J)
+            link = &(*link)->next;
+        *link = J->next;
+        if (_tms_async_tail == &J->next)
+            _tms_async_tail = link;
+    }
+    // A callback running in another thread returns before J is freed, it can free J itself
+    while (J->in_callback && _tms_async_calling != J)
+        pthread_cond_wait(&_tms_async_done, &_tms_async_lock);
+    pthread_mutex_unlock(&_tms_async_lock);
+
+    tms_async_cancel(J);
+    _tms_async_release(J);
+}
+
+int tms_async_eventfd()
+{
+#ifdef _WIN32
+    return -1;
+#else
+    pthread_mutex_lock(&_tms_async_lock);
+    if (_tms_async_fds[0] == -1)
+    {
+#ifdef __linux__
+        _tms_async_fds[0] = _tms_async_fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+        if (pipe(_tms_async_fds) == 0)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                fcntl(_tms_async_fds[i], F_SETFL, fcntl(_tms_async_fds[i], F_GETFL) | O_NONBLOCK);
+                fcntl(_tms_async_fds[i], F_SETFD, FD_CLOEXEC);
+            }
+        }
+        else
+            _tms_async_fds[0] = _tms_async_fds[1] = -1;
+#endif
+        // Jobs completed before the descriptor existed
+        if (_tms_async_list != NULL)
+            _tms_async_signal();
+    }
+    int fd = _tms_async_fds[0];
+    pthread_mutex_unlock(&_tms_async_lock);
+    return fd;
+#endif
+}
+
+size_t tms_async_completed(tms_async_job **jobs, size_t max)
+{
+    size_t count = 0;
+    pthread_mutex_lock(&_tms_async_lock);
+    _tms_async_drain();
+    while (count < max && _tms_async_list != NULL)
+    {
+        tms_async_job *J = _tms_async_list;
+        _tms_async_list = J->next;
+        J->listed = false;
+        jobs[count++] = J;
+    }
+    if (_tms_async_list == NULL)
+        _tms_async_tail = &_tms_async_list;
+    else
+        _tms_async_signal();
+    pthread_mutex_unlock(&_tms_async_lock);
+    return count;
+}
@@ -0,0 +1,21 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_ASYNC_COMMON_H
+#define _TMS_ASYNC_COMMON_H
+
+// Cancellation of asynchronous evaluations, checked by the evaluator and long running extended functions
+
+#include <stdbool.h>
+
+// Cancel flag of the asynchronous evaluation running in the current thread, NULL if none
+extern _Thread_local int *_tms_async_cancel;
+
+// Returns true if the evaluation owning flag (can be NULL) was cancelled
+static inline bool _tms_cancelled(const int *flag)
+{
+    return flag != NULL && __atomic_load_n(flag, __ATOMIC_RELAXED) != 0;
+}
+
+#endif
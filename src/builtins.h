@@ -0,0 +1,149 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_BUILTINS_H
+#define _TMS_BUILTINS_H
+
+/*
+Lists of the built-in functions and constants, and the minimal perfect hash used to find them by name.
+Each list is an X macro: X(name, members...), expanded to the arrays in internals.c and to the names only by
+tools/tms_gen_builtins.c, which generates the hash tables in builtins_phf.h.
+The CMake build regenerates the tables in its build directory. After editing a list, update the copy kept in the
+sources (used by the other builds) with the output of tms_gen_builtins, the CI checks that it matches.
+*/
+
+#include "symtab.h"
+#include <stdint.h>
+
+#define TMS_BUILTIN_VARS(X)                                                                                            \
+    X("i", I)                                                                                                          \
+    X("pi", M_PI)                                                                                                      \
+    X("e", M_E)                                                                                                        \
+    X("c", 299792458)
+
+#define TMS_BUILTIN_RC_FUNCS(X)                                                                                        \
+    X("fact", tms_fact, tms_cfact)                                                                                     \
+    X("abs", fabs, cabs_z)                                                                                             \
+    X("exp", exp, tms_cexp)                                                                                            \
+    X("ceil", ceil, tms_cceil)                                                                                         \
+    X("floor", floor, tms_cfloor)                                                                                      \
+    X("round", round, tms_cround)                                                                                      \
+    X("sign", tms_sign, tms_csign)                                                                                     \
+    X("arg", tms_carg_d, carg_z)                                                                                       \
+    X("sqrt", sqrt, csqrt)                                                                                             \
+    X("cbrt", cbrt, tms_ccbrt)                                                                                         \
+    X("cos", tms_cos, tms_ccos)                                                                                        \
+    X("sin", tms_sin, tms_csin)                                                                                        \
+    X("tan", tms_tan, tms_ctan)                                                                                        \
+    X("acos", acos, cacos)                                                                                             \
+    X("asin", asin, casin)                                                                                             \
+    X("atan", atan, catan)                                                                                             \
+    X("cosh", cosh, ccosh)                                                                                             \
+    X("sinh", sinh, csinh)                                                                                             \
+    X("tanh", tanh, ctanh)                                                                                             \
+    X("acosh", acosh, cacosh)                                                                                          \
+    X("asinh", asinh, casinh)                                                                                          \
+    X("atanh", atanh, catanh)                                                                                          \
+    X("ln", log, tms_cln)                                                                                              \
+    X("log2", log2, tms_clog2)                                                                                         \
+    X("log10", log10, tms_clog10)
+
+// Extended functions, may take more than one argument (stored in a comma separated string)
+#define TMS_BUILTIN_EXTFS(X)                                                                                           \
+    X("avg", _tms_avg)                                                                                                 \
+    X("min", _tms_min)                                                                                                 \
+    X("max", _tms_max)                                                                                                 \
+    X("integrate", _tms_integrate)                                                                                     \
+    X("derivative", _tms_derivative)                                                                                   \
+    X("logn", _tms_logn)                                                                                               \
+    X("hex", _tms_hex)                                                                                                 \
+    X("oct", _tms_oct)                                                                                                 \
+    X("bin", _tms_bin)                                                                                                 \
+    X("rand", _tms_rand)                                                                                               \
+    X("int", _tms_int)                                                                                                 \
+    X("float32", _tms_bin_to_float32)                                                                                  \
+    X("float64", _tms_bin_to_float64)                                                                                  \
+    X("det", _tms_det)                                                                                                 \
+    X("trace", _tms_trace)
+
+#define TMS_BUILTIN_INT_FUNCS(X)                                                                                       \
+    X("not", tms_not)                                                                                                  \
+    X("fact", tms_int_fact)                                                                                            \
+    X("mask", tms_mask)                                                                                                \
+    X("mask_bit", tms_mask_bit)                                                                                        \
+    X("inv_mask", tms_inv_mask)                                                                                        \
+    X("ipv4_prefix", tms_ipv4_prefix)                                                                                  \
+    X("zeros", tms_zeros)                                                                                              \
+    X("ones", tms_ones)                                                                                                \
+    X("abs", tms_int_abs)                                                                                              \
+    X("parity", tms_parity)
+
+#define TMS_BUILTIN_INT_EXTFS(X)                                                                                       \
+    X("rand", _tms_int_rand)                                                                                           \
+    X("rr", _tms_rr)                                                                                                   \
+    X("rl", _tms_rl)                                                                                                   \
+    X("sr", _tms_sr)                                                                                                   \
+    X("sra", _tms_sra)                                                                                                 \
+    X("sl", _tms_sl)                                                                                                   \
+    X("nand", _tms_nand)                                                                                               \
+    X("and", _tms_and)                                                                                                 \
+    X("xor", _tms_xor)                                                                                                 \
+    X("nor", _tms_nor)                                                                                                 \
+    X("or", _tms_or)                                                                                                   \
+    X("ipv4", _tms_ipv4)                                                                                               \
+    X("dotted", _tms_dotted)                                                                                           \
+    X("mask_range", _tms_mask_range)                                                                                   \
+    X("min", _tms_int_min)                                                                                             \
+    X("max", _tms_int_max)                                                                                             \
+    X("float", _tms_from_float)                                                                                        \
+    X("hamming_dist", _tms_hamming_distance)                                                                           \
+    X("multinv", _tms_multinv)                                                                                         \
+    X("gcd", _tms_gcd)                                                                                                 \
+    X("lcm", _tms_lcm)
+
+/*
+Hash and displace: the hash of a name selects a bucket, and the slot of the name is computed from the hash and the
+displacement of its bucket, chosen by the generator so that each name of the list gets a distinct slot.
+The hash and the check of the slot use the inline key of the symbol tables (the first 16 bytes of the name as
+integers), names shorter than 16 bytes are found or rejected without reading the name stored in the item.
+*/
+typedef struct _tms_phf
+{
+    uint32_t count;
+    uint32_t buckets;
+    const uint32_t *displacement;
+    // Key of the name in each slot
+    const uint64_t (*keys)[TMS_SYMTAB_KEY_SIZE / 8];
+    // Maps the slot to the index in the list
+    const uint8_t *index;
+} _tms_phf;
+
+static inline uint64_t _tms_phf_hash(const char *name, const uint64_t key[TMS_SYMTAB_KEY_SIZE / 8], size_t len)
+{
+    uint64_t h = (key[0] ^ len) * 0x9E3779B97F4A7C15;
+    h = (h ^ (h >> 32) ^ key[1]) * 0x9E3779B97F4A7C15;
+    // The rest of long names, byte by byte to get the same hash on all platforms
+    for (size_t i = TMS_SYMTAB_KEY_SIZE; i < len; ++i)
+        h = (h ^ (unsigned char)name[i]) * 0x100000001B3;
+    return h ^ (h >> 32);
+}
+
+// Maps a 32-bit value to [0, n) without a division
+static inline uint32_t _tms_phf_reduce(uint32_t x, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+static inline uint32_t _tms_phf_bucket(uint64_t h, uint32_t buckets)
+{
+    return _tms_phf_reduce((uint32_t)h, buckets);
+}
+
+static inline uint32_t _tms_phf_slot(uint64_t h, uint32_t displacement, uint32_t count)
+{
+    h = (h ^ displacement) * 0xD6E8FEB86659FD93;
+    return _tms_phf_reduce((uint32_t)(h >> 32), count);
+}
+
+#endif
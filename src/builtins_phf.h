@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+// Generated by tools/tms_gen_builtins.c from builtins.h, do not edit
+#ifndef _TMS_BUILTINS_PHF_H
+#define _TMS_BUILTINS_PHF_H
+
+#include "builtins.h"
+
+static const uint32_t _tms_builtin_vars_displacement[] = {1, 2, 2};
+static const uint64_t _tms_builtin_vars_keys[][2] = {
+    {0x6970, 0x0}, // pi
+    {0x63, 0x0}, // c
+    {0x65, 0x0}, // e
+    {0x69, 0x0}, // i
+};
+static const uint8_t _tms_builtin_vars_index[] = {1, 3, 2, 0};
+static const _tms_phf _tms_builtin_vars_phf = {
+    4, 3, _tms_builtin_vars_displacement, _tms_builtin_vars_keys, _tms_builtin_vars_index};
+
+static const uint32_t _tms_rc_func_displacement[] = {0, 11, 0, 4, 0, 2, 12, 1, 0, 0, 9, 7, 31};
+static const uint64_t _tms_rc_func_keys[][2] = {
+    {0x686E617461, 0x0}, // atanh
+    {0x736261, 0x0}, // abs
+    {0x74726263, 0x0}, // cbrt
+    {0x68736F63, 0x0}, // cosh
+    {0x677261, 0x0}, // arg
+    {0x68736F6361, 0x0}, // acosh
+    {0x726F6F6C66, 0x0}, // floor
+    {0x74727173, 0x0}, // sqrt
+    {0x74636166, 0x0}, // fact
+    {0x736F63, 0x0}, // cos
+    {0x6E6C, 0x0}, // ln
+    {0x6E676973, 0x0}, // sign
+    {0x6E6973, 0x0}, // sin
+    {0x736F6361, 0x0}, // acos
+    {0x6C696563, 0x0}, // ceil
+    {0x686E6174, 0x0}, // tanh
+    {0x6E697361, 0x0}, // asin
+    {0x32676F6C, 0x0}, // log2
+    {0x707865, 0x0}, // exp
+    {0x6E6174, 0x0}, // tan
+    {0x686E697361, 0x0}, // asinh
+    {0x3031676F6C, 0x0}, // log10
+    {0x6E617461, 0x0}, // atan
+    {0x686E6973, 0x0}, // sinh
+    {0x646E756F72, 0x0}, // round
+};
+static const uint8_t _tms_rc_func_index[] = {21, 1, 9, 16, 7, 19, 4, 8, 0, 10, 22, 6, 11, 13, 3, 18, 14, 23, 2, 12, 20, 24, 15, 17, 5};
+static const _tms_phf _tms_rc_func_phf = {
+    25, 13, _tms_rc_func_displacement, _tms_rc_func_keys, _tms_rc_func_index};
+
+static const uint32_t _tms_extf_displacement[] = {0, 16, 7, 17, 8, 0, 0, 0};
+static const uint64_t _tms_extf_keys[][2] = {
+    {0x646E6172, 0x0}, // rand
+    {0x786568, 0x0}, // hex
+    {0x746564, 0x0}, // det
+    {0x6563617274, 0x0}, // trace
+    {0x343674616F6C66, 0x0}, // float64
+    {0x6E676F6C, 0x0}, // logn
+    {0x6E696D, 0x0}, // min
+    {0x677661, 0x0}, // avg
+    {0x78616D, 0x0}, // max
+    {0x323374616F6C66, 0x0}, // float32
+    {0x6974617669726564, 0x6576}, // derivative
+    {0x74636F, 0x0}, // oct
+    {0x746E69, 0x0}, // int
+    {0x7461726765746E69, 0x65}, // integrate
+    {0x6E6962, 0x0}, // bin
+};
+static const uint8_t _tms_extf_index[] = {9, 6, 13, 14, 12, 5, 1, 0, 2, 11, 4, 7, 10, 3, 8};
+static const _tms_phf _tms_extf_phf = {
+    15, 8, _tms_extf_displacement, _tms_extf_keys, _tms_extf_index};
+
+static const uint32_t _tms_int_func_displacement[] = {5, 0, 5, 2, 3, 0};
+static const uint64_t _tms_int_func_keys[][2] = {
+    {0x746F6E, 0x0}, // not
+    {0x6572705F34767069, 0x786966}, // ipv4_prefix
+    {0x73656E6F, 0x0}, // ones
+    {0x6B73616D5F766E69, 0x0}, // inv_mask
+    {0x6B73616D, 0x0}, // mask
+    {0x736261, 0x0}, // abs
+    {0x7469625F6B73616D, 0x0}, // mask_bit
+    {0x736F72657A, 0x0}, // zeros
+    {0x74636166, 0x0}, // fact
+    {0x797469726170, 0x0}, // parity
+};
+static const uint8_t _tms_int_func_index[] = {0, 5, 7, 4, 2, 8, 3, 6, 1, 9};
+static const _tms_phf _tms_int_func_phf = {
+    10, 6, _tms_int_func_displacement, _tms_int_func_keys, _tms_int_func_index};
+
+static const uint32_t _tms_int_extf_displacement[] = {0, 0, 7, 4, 0, 3, 0, 17, 14, 2, 55};
+static const uint64_t _tms_int_extf_keys[][2] = {
+    {0x646E61, 0x0}, // and
+    {0x6E61725F6B73616D, 0x6567}, // mask_range
+    {0x726F, 0x0}, // or
+    {0x646574746F64, 0x0}, // dotted
+    {0x726F6E, 0x0}, // nor
+    {0x78616D, 0x0}, // max
+    {0x617273, 0x0}, // sra
+    {0x6E696D, 0x0}, // min
+    {0x6D636C, 0x0}, // lcm
+    {0x7272, 0x0}, // rr
+    {0x646E6172, 0x0}, // rand
+    {0x646E616E, 0x0}, // nand
+    {0x74616F6C66, 0x0}, // float
+    {0x766E69746C756D, 0x0}, // multinv
+    {0x34767069, 0x0}, // ipv4
+    {0x6C72, 0x0}, // rl
+    {0x6C73, 0x0}, // sl
+    {0x7273, 0x0}, // sr
+    {0x726F78, 0x0}, // xor
+    {0x5F676E696D6D6168, 0x74736964}, // hamming_dist
+    {0x646367, 0x0}, // gcd
+};
+static const uint8_t _tms_int_extf_index[] = {7, 13, 10, 12, 9, 15, 4, 14, 20, 1, 0, 6, 16, 18, 11, 2, 5, 3, 8, 17, 19};
+static const _tms_phf _tms_int_extf_phf = {
+    21, 11, _tms_int_extf_displacement, _tms_int_extf_keys, _tms_int_extf_index};
+
+#endif
@@ -8,13 +8,18 @@ SPDX-License-Identifier: LGPL-2.1-only
 #include <tmsolve/libtmsolve.h>
 #endif
 #include "c_complex_to_cpp.h"
+#include "expression.h"
 #include <complex>
 #include <format>
+#include <map>
 #include <math.h>
 #include <vector>
 #ifdef PYTHON_BINDINGS_BUILD
 #include "nanobind/nanobind.h"
 #include "nanobind/stl/complex.h"
+#include "nanobind/ndarray.h"
+#include "nanobind/stl/map.h"
+#include "nanobind/stl/pair.h"
 #include "nanobind/stl/string.h"
 #include "nanobind/stl/vector.h"
 
@@ -78,20 +83,29 @@ void set_int_var(std::string name, int64_t value, bool is_constant = false)
 
 std::complex<double> get_var(std::string name)
 {
+    // The variable is copied before another thread can modify it
+    tms_lock_vars(TMS_V_DOUBLE);
     auto var = tms_get_var_by_name(name.c_str());
-    if (var == NULL)
+    bool found = (var != NULL);
+    struct cpp_double value = found ? var->value : (struct cpp_double){0, 0};
+    tms_unlock_vars(TMS_V_DOUBLE);
+    if (!found)
         throw std::runtime_error(std::format("Variable \"{}\" not found", name));
 
-    return to_complex(var->value);
+    return to_complex(value);
 }
 
 int64_t get_int_var(std::string name)
 {
+    tms_lock_vars(TMS_V_INT64);
     auto var = tms_get_int_var_by_name(name.c_str());
-    if (var == NULL)
+    bool found = (var != NULL);
+    int64_t value = found ? var->value : 0;
+    tms_unlock_vars(TMS_V_INT64);
+    if (!found)
         throw std::runtime_error(std::format("Variable \"{}\" not found", name));
 
-    return var->value;
+    return value;
 }
 
 void set_ufunction(std::string fname, std::string function_args, std::string function)
@@ -152,29 +166,239 @@ void set_int_mask(int size_in_bits)
     }
 }
 
+// Message of the last error of the facilities, which are cleared
+static std::string take_last_error(int facilities, const char *fallback)
+{
+    tms_error_data *error = tms_get_last_error(facilities);
+    std::string message = (error != NULL ? error->message : fallback);
+    tms_clear_errors(facilities);
+    return message;
+}
+
+Expression::Expression(std::string expr, std::vector<std::string> labels, bool complex) : label_names(labels)
+{
+    tms_arg_list *L = NULL;
+    if (!labels.empty())
+    {
+        std::string joined = labels[0];
+        for (size_t i = 1; i < labels.size(); ++i)
+            joined += "," + labels[i];
+        L = tms_get_args(joined.c_str());
+    }
+    // The parsed expression owns the labels list
+    M = tms_parse_expr(expr.c_str(), complex ? ENABLE_CMPLX : 0, L);
+    if (M == NULL)
+        throw std::runtime_error(take_last_error(TMS_PARSER, "Failed to parse the expression."));
+}
+
+Expression::~Expression()
+{
+    for (tms_math_expr *copy : pool)
+        tms_delete_math_expr(copy);
+    tms_delete_math_expr(M);
+}
+
+Expression::Expression(Expression &&other) noexcept
+    : M(other.M), label_names(std::move(other.label_names)), pool(std::move(other.pool))
+{
+    other.M = NULL;
+    other.pool.clear();
+}
+
+Expression &Expression::operator=(Expression &&other) noexcept
+{
+    if (this != &other)
+    {
+        std::swap(M, other.M);
+        std::swap(label_names, other.label_names);
+        std::swap(pool, other.pool);
+    }
+    return *this;
+}
+
+const std::vector<std::string> &Expression::labels() const
+{
+    return label_names;
+}
+
+size_t Expression::label_index(std::string_view name) const
+{
+    for (size_t i = 0; i < label_names.size(); ++i)
+        if (label_names[i] == name)
+            return i;
+    throw std::out_of_range(std::format("The expression has no label \"{}\"", name));
+}
+
+std::complex<double> Expression::evaluate(std::span<const std::complex<double>> values)
+{
+    if (values.size() != label_names.size())
+        throw std::invalid_argument(
+            std::format("Expected values for {} labels, got {}", label_names.size(), values.size()));
+
+    tms_math_expr *copy = acquire();
+    // std::complex<double> has the layout of cdouble, the values are only read
+    if (!values.empty())
+        tms_set_labels_values(copy, (cdouble *)values.data());
+    cdouble answer = tms_evaluate(copy, SHARED_LOCK);
+    release(copy);
+    if (isnan(answer.r) || isnan(answer.c))
+        throw std::runtime_error(take_last_error(TMS_EVALUATOR | TMS_PARSER, "Failed to get an answer."));
+    return to_complex(answer);
+}
+
+size_t Expression::evaluate(std::span<const std::complex<double>> values, std::span<std::complex<double>> results)
+{
+    size_t count = label_names.size(), n = results.size(), failed = 0;
+    if (values.size() != n * count)
+        throw std::invalid_argument(
+            std::format("Expected {} values for {} rows, got {}", n * count, n, values.size()));
+
+    tms_math_expr *copy = acquire();
+    tms_lock_evaluator_shared(TMS_EVALUATOR);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (count != 0)
+            tms_set_labels_values(copy, (cdouble *)values.data() + i * count);
+        cdouble answer = tms_evaluate(copy, NO_LOCK);
+        if (isnan(answer.r) || isnan(answer.c))
+        {
+            results[i] = NAN;
+            ++failed;
+            tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
+        }
+        else
+            results[i] = to_complex(answer);
+    }
+    tms_unlock_evaluator(TMS_EVALUATOR);
+    release(copy);
+    return failed;
+}
+
+size_t Expression::evaluate_batch(const double *const *columns, const int64_t *strides, size_t n, double *results)
+{
+    tms_math_expr *copy = acquire();
+    size_t failed = tms_evaluate_batch(copy, columns, strides, n, results, SHARED_LOCK);
+    release(copy);
+    return failed;
+}
+
+tms_math_expr *Expression::acquire()
+{
+    if (M == NULL)
+        throw std::logic_error("The expression was moved.");
+    std::lock_guard<std::mutex> guard(pool_lock);
+    if (pool.empty())
+        return tms_dup_mexpr(M);
+    tms_math_expr *copy = pool.back();
+    pool.pop_back();
+    return copy;
+}
+
+void Expression::release(tms_math_expr *copy)
+{
+    std::lock_guard<std::mutex> guard(pool_lock);
+    pool.push_back(copy);
+}
+
+// Profiling counters by phase name: (number of calls, cumulative time in nanoseconds)
+std::map<std::string, std::pair<uint64_t, uint64_t>> get_stats()
+{
+    tms_stats S = tms_get_stats();
+    std::map<std::string, std::pair<uint64_t, uint64_t>> result;
+    for (int i = 0; i < TMS_STAT_COUNT; ++i)
+        result[tms_stat_name(i)] = {S.count[i], S.ns[i]};
+    return result;
+}
+
 } // namespace tmsolve
 
 #ifdef PYTHON_BINDINGS_BUILD
 using namespace tmsolve;
+
+using input_array = nb::ndarray<const double, nb::ndim<1>, nb::device::cpu>;
+using output_array = nb::ndarray<nb::numpy, double, nb::ndim<1>>;
+
+/*
+Evaluates the expression over arrays passed by label name, scalars are repeated for each row.
+Float64 arrays are read in place (any stride), other inputs are converted by nanobind.
+*/
+output_array evaluate_arrays(Expression &E, nb::kwargs values)
+{
+    const std::vector<std::string> &labels = E.labels();
+    size_t count = labels.size(), n = 1;
+    bool has_array = false;
+    std::vector<const double *> columns(count);
+    std::vector<int64_t> strides(count);
+    std::vector<double> scalars(count);
+    // Keeps converted arrays alive until the evaluation ends
+    std::vector<input_array> arrays;
+
+    if (values.size() != count)
+        throw nb::type_error(std::format("Expected values for {} labels, got {}", count, values.size()).c_str());
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!values.contains(labels[i].c_str()))
+            throw nb::type_error(std::format("Missing values for label \"{}\"", labels[i]).c_str());
+        nb::object value = values[labels[i].c_str()];
+        if (nb::isinstance<nb::float_>(value) || nb::isinstance<nb::int_>(value))
+        {
+            scalars[i] = nb::cast<double>(value);
+            columns[i] = &scalars[i];
+            strides[i] = 0;
+            continue;
+        }
+        input_array a = nb::cast<input_array>(value);
+        if (has_array && a.shape(0) != n)
+            throw nb::value_error("All arrays must have the same length.");
+        n = a.shape(0);
+        has_array = true;
+        columns[i] = a.data();
+        strides[i] = a.stride(0);
+        arrays.push_back(a);
+    }
+
+    double *results = new double[n];
+    nb::capsule owner(results, [](void *p) noexcept { delete[] (double *)p; });
+    {
+        // Evaluations of other threads run meanwhile, on their own copy of the expression
+        nb::gil_scoped_release release;
+        E.evaluate_batch(columns.data(), strides.data(), n, results);
+    }
+    return output_array(results, {n}, owner);
+}
+
+// The library has its own locks, the GIL is released while it runs (and raised exceptions are translated after)
+using release_gil = nb::call_guard<nb::gil_scoped_release>;
+
 NB_MODULE(tmsolve, m)
 {
     nb::class_<tms_int_factor>(m, "int_factor")
         .def_rw("factor", &tms_int_factor::factor)
         .def_rw("power", &tms_int_factor::power);
+    nb::class_<Expression>(m, "Expression")
+        .def(nb::init<std::string, std::vector<std::string>, bool>(), "expr"_a,
+             "labels"_a = std::vector<std::string>(), "complex"_a = false)
+        .def_prop_ro("labels", &Expression::labels)
+        .def("evaluate", &evaluate_arrays,
+             "Evaluates the expression for each row of the arrays passed by label name (scalars are repeated), "
+             "returns a float64 array with NaN for the rows that failed.");
     m.def("tmsolve_init", &tmsolve_init);
-    m.def("solve", &solve, "expr"_a);
-    m.def("int_solve", &int_solve, "expr"_a);
-    m.def("factor", &find_factors, "value"_a);
-    m.def("set_var", &set_var, "name"_a, "value"_a, "is_constant"_a = false);
-    m.def("get_var", &get_var, "name"_a);
-    m.def("set_int_var", &set_int_var, "name"_a, "value"_a, "is_constant"_a = false);
-    m.def("get_int_var", &get_int_var, "name"_a);
-    m.def("set_ufunction", &set_ufunction, "fname"_a, "function_args"_a, "function"_a);
-    m.def("set_int_ufunction", &set_int_ufunction, "fname"_a, "function_args"_a, "function"_a);
-    m.def("remove_var", &remove_var, "name"_a);
-    m.def("remove_int_var", &remove_int_var, "name"_a);
-    m.def("remove_ufunc", &remove_ufunc, "fname"_a);
-    m.def("remove_int_ufunc", &remove_int_ufunc, "fname"_a);
-    m.def("set_int_mask", &set_int_mask, "size_in_bits"_a);
+    m.def("solve", &solve, "expr"_a, release_gil());
+    m.def("int_solve", &int_solve, "expr"_a, release_gil());
+    m.def("factor", &find_factors, "value"_a, release_gil());
+    m.def("set_var", &set_var, "name"_a, "value"_a, "is_constant"_a = false, release_gil());
+    m.def("get_var", &get_var, "name"_a, release_gil());
+    m.def("set_int_var", &set_int_var, "name"_a, "value"_a, "is_constant"_a = false, release_gil());
+    m.def("get_int_var", &get_int_var, "name"_a, release_gil());
+    m.def("set_ufunction", &set_ufunction, "fname"_a, "function_args"_a, "function"_a, release_gil());
+    m.def("set_int_ufunction", &set_int_ufunction, "fname"_a, "function_args"_a, "function"_a, release_gil());
+    m.def("remove_var", &remove_var, "name"_a, release_gil());
+    m.def("remove_int_var", &remove_int_var, "name"_a, release_gil());
+    m.def("remove_ufunc", &remove_ufunc, "fname"_a, release_gil());
+    m.def("remove_int_ufunc", &remove_int_ufunc, "fname"_a, release_gil());
+    m.def("set_int_mask", &set_int_mask, "size_in_bits"_a, release_gil());
+    m.def("set_stats", &tms_set_stats, "enable"_a);
+    m.def("reset_stats", &tms_reset_stats);
+    m.def("get_stats", &get_stats);
 }
 #endif
@@ -3,27 +3,15 @@ Copyright (C) 2022-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #include "error_handler.h"
-#include <pthread.h>
+#include "stats_common.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-int last_error = 0, fatal = 0, non_fatal = 0;
-tms_error_data error_table[EH_MAX_ERRORS];
-
-// Defined in internals and initialized there
-extern pthread_mutex_t _error_db_lock;
-
-void _lock_error_database()
-{
-    pthread_mutex_lock(&_error_db_lock);
-}
-
-void _unlock_error_database()
-{
-    pthread_mutex_unlock(&_error_db_lock);
-}
+// Each thread has its own error database, the errors of concurrent evaluations don't mix
+_Thread_local int last_error = 0, fatal = 0, non_fatal = 0;
+_Thread_local tms_error_data error_table[EH_MAX_ERRORS];
 
 void tms_print_error(tms_error_data E)
 {
@@ -120,8 +108,7 @@ int tms_save_expr_with_error(const char *expr, int error_position, tms_error_dat
 
 int tms_save_error(int facilities, const char *error_msg, int severity, const char *expr, int error_position)
 {
-    _lock_error_database();
-
+    uint64_t stats_start = _tms_stats_begin(TMS_STAT_SAVE_ERROR);
     // Case of error table being full
     if (last_error == EH_MAX_ERRORS - 1)
     {
@@ -157,7 +144,7 @@ int tms_save_error(int facilities, const char *error_msg, int severity, const ch
 
     last_error = fatal + non_fatal;
 
-    _unlock_error_database();
+    _tms_stats_end(TMS_STAT_SAVE_ERROR, stats_start);
     return status;
 }
 
@@ -172,8 +159,6 @@ int tms_print_errors(int facilities)
 
 int tms_clear_errors(int facilities)
 {
-    _lock_error_database();
-
     int i, deleted_count = 0;
     for (i = 0; i < last_error; ++i)
     {
@@ -208,33 +193,24 @@ int tms_clear_errors(int facilities)
     }
 
     last_error = fatal + non_fatal;
-
-    _unlock_error_database();
     return deleted_count;
 }
 
 int tms_find_error(int facilities, const char *error_msg)
 {
-    _lock_error_database();
     for (int i = 0; i < last_error; ++i)
         if ((facilities & error_table[i].facilities) != 0 && (strcmp(error_msg, error_table[i].message) == 0))
-        {
-            _unlock_error_database();
             return i;
-        }
-    _unlock_error_database();
     return -1;
 }
 
 tms_error_data *tms_get_last_error(int facilities)
 {
-    _lock_error_database();
     int last_match = -1;
     for (int i = 0; i < last_error; ++i)
         if ((facilities & error_table[i].facilities) != 0)
             last_match = i;
 
-    _unlock_error_database();
     if (last_match >= 0)
         return error_table + last_match;
     else
@@ -243,7 +219,6 @@ tms_error_data *tms_get_last_error(int facilities)
 
 int tms_get_error_count(int facilities, int error_type)
 {
-    _lock_error_database();
     int select_fatal, select_non_fatal;
     if (facilities == TMS_ALL_FACILITIES)
     {
@@ -262,7 +237,6 @@ int tms_get_error_count(int facilities, int error_type)
                     ++select_non_fatal;
             }
     }
-    _unlock_error_database();
     switch (error_type)
     {
     case EH_NONFATAL:
@@ -277,7 +251,6 @@ int tms_get_error_count(int facilities, int error_type)
 
 int tms_modify_last_error(int facilities, const char *expr, int error_position, const char *prefix)
 {
-    _lock_error_database();
     int i;
     // Find the last error
     for (i = last_error - 1; i >= 0; --i)
@@ -286,10 +259,7 @@ int tms_modify_last_error(int facilities, const char *expr, int error_position,
             break;
     }
     if (i == -1)
-    {
-        _unlock_error_database();
         return -1;
-    }
 
     if (prefix != NULL)
     {
@@ -307,6 +277,5 @@ int tms_modify_last_error(int facilities, const char *expr, int error_position,
         error_table[i].expr_len = strlen(expr);
         status = tms_save_expr_with_error(expr, error_position, error_table + i);
     }
-    _unlock_error_database();
     return status;
 }
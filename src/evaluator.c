@@ -3,14 +3,19 @@ Copyright (C) 2023-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #include "evaluator.h"
+#include "async_common.h"
 #include "bitwise.h"
 #include "error_handler.h"
 #include "int_parser.h"
 #include "internals.h"
+#include "jit.h"
 #include "m_errors.h"
 #include "parser.h"
+#include "profile_common.h"
 #include "scientific.h"
+#include "stats_common.h"
 #include "string_tools.h"
+#include "thread_pool.h"
 #include "tms_complex.h"
 #include <math.h>
 #include <stdio.h>
@@ -18,10 +23,82 @@ SPDX-License-Identifier: LGPL-2.1-only
 #include <string.h>
 
 double complex _tms_evaluate_unsafe(tms_math_expr *M);
+int _tms_int_evaluate_unsafe(tms_int_expr *M, int64_t *result);
+
+// Minimum number of rows evaluated by a thread in tms_evaluate_batch()
+#define TMS_BATCH_GRAIN 256
+// Minimum number of expressions solved by a thread in tms_solve_list_parallel()
+#define TMS_LIST_GRAIN 8
+
+// Set while an extended function runs in this thread, the expressions it evaluates are not dumped
+static _Thread_local bool _tms_debug_muted = false;
+
+// Locks an evaluator in shared mode if options has SHARED_LOCK, in exclusive mode otherwise
+static void _tms_lock_evaluator_mode(int variant, int options)
+{
+    if ((options & SHARED_LOCK) != 0)
+        tms_lock_evaluator_shared(variant);
+    else
+        tms_lock_evaluator(variant);
+}
+
+// Pushes the profile frame of a subexpression, user is the name of user functions
+static void _tms_profile_enter_subexpr(const char *expr, int i, int subexpr_start, uint8_t func_type, const char *user)
+{
+    int func_len;
+    const char *func = _tms_subexpr_func_name(expr, subexpr_start, func_type, user, &func_len);
+    _tms_profile_enter(i, func, func_len);
+}
+
+/*
+Evaluates M with its subexpressions recorded in the running profile, or in the profile of M if none is running.
+The frames left open by a failed evaluation are closed.
+*/
+static double complex _tms_evaluate_profiled(tms_math_expr *M)
+{
+    double complex result;
+    _tms_profile_ctx C;
+    if (_tms_profile != NULL)
+    {
+        int level = _tms_profile_level();
+        result = _tms_evaluate_unsafe(M);
+        _tms_profile_unwind(level);
+    }
+    else if (_tms_profile_begin(&C, M->profile) == 0)
+    {
+        result = _tms_evaluate_unsafe(M);
+        _tms_profile_end(&C);
+    }
+    else
+        result = _tms_evaluate_unsafe(M);
+    return result;
+}
+
+// Integer variant of _tms_evaluate_profiled()
+static int _tms_int_evaluate_profiled(tms_int_expr *M, int64_t *result)
+{
+    int status;
+    _tms_profile_ctx C;
+    if (_tms_profile != NULL)
+    {
+        int level = _tms_profile_level();
+        status = _tms_int_evaluate_unsafe(M, result);
+        _tms_profile_unwind(level);
+    }
+    else if (_tms_profile_begin(&C, M->profile) == 0)
+    {
+        status = _tms_int_evaluate_unsafe(M, result);
+        _tms_profile_end(&C);
+    }
+    else
+        status = _tms_int_evaluate_unsafe(M, result);
+    return status;
+}
 
 double complex tms_evaluate(tms_math_expr *M, int options)
 {
-    static int stack_depth;
+    // Per thread, concurrent evaluations nest independently
+    static _Thread_local int stack_depth;
     ++stack_depth;
     if (stack_depth > 32)
     {
@@ -31,7 +108,7 @@ double complex tms_evaluate(tms_math_expr *M, int options)
     }
 
     if ((options & NO_LOCK) != 1)
-        tms_lock_evaluator(TMS_EVALUATOR);
+        _tms_lock_evaluator_mode(TMS_EVALUATOR, options);
 
     if (tms_get_error_count(TMS_EVALUATOR | TMS_PARSER, EH_ALL_ERRORS) != 0)
     {
@@ -39,7 +116,15 @@ double complex tms_evaluate(tms_math_expr *M, int options)
         tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
     }
 
-    double complex result = _tms_evaluate_unsafe(M);
+    double complex result;
+    uint64_t stats_start = _tms_stats_begin(TMS_STAT_EVALUATE);
+    // The compiled code has no subexpressions to record, profiled evaluations (and the ones they nest) don't use it
+    if (M != NULL && _tms_profiling(M->profile))
+        result = _tms_evaluate_profiled(M);
+    // Use the compiled code if available, the evaluator runs if it isn't or if an error occurred
+    else if (_tms_jit_evaluate(M, &result) != 0)
+        result = _tms_evaluate_unsafe(M);
+    _tms_stats_end(TMS_STAT_EVALUATE, stats_start);
 
     if (tms_iscnan(result) && (options & PRINT_ERRORS) != 0)
         tms_print_errors(TMS_EVALUATOR | TMS_PARSER);
@@ -50,6 +135,82 @@ double complex tms_evaluate(tms_math_expr *M, int options)
     return result;
 }
 
+// Rows of a batch evaluated by one range, see tms_evaluate_batch()
+typedef struct _tms_batch_job
+{
+    tms_math_expr *M;
+    const double *const *columns;
+    const int64_t *strides;
+    double *results;
+    int options;
+    // Ranges are run in parallel, each one evaluates its own copy of M
+    bool copy;
+    size_t failed;
+} _tms_batch_job;
+
+// Evaluates rows [begin, end) of a batch
+static void _tms_evaluate_rows(void *arg, size_t begin, size_t end)
+{
+    _tms_batch_job *J = arg;
+    tms_math_expr *M = (J->copy ? tms_dup_mexpr(J->M) : J->M);
+    int labels_count = (M->labels != NULL ? M->labels->count : 0), j;
+    size_t failed = 0, i;
+    double complex answer, *values = malloc((labels_count > 0 ? labels_count : 1) * sizeof(double complex));
+
+    for (i = begin; i < end; ++i)
+    {
+        if (labels_count > 0)
+        {
+            for (j = 0; j < labels_count; ++j)
+                values[j] = J->columns[j][(int64_t)i * (J->strides != NULL ? J->strides[j] : 1)];
+            tms_set_labels_values(M, values);
+        }
+        answer = tms_evaluate(M, NO_LOCK);
+        if (tms_iscnan(answer) || cimag(answer) != 0)
+        {
+            J->results[i] = NAN;
+            ++failed;
+            // Don't let the errors of this row be reported by the next one
+            if ((J->options & PRINT_ERRORS) != 0)
+                tms_print_errors(TMS_EVALUATOR | TMS_PARSER);
+            else
+                tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
+        }
+        else
+            J->results[i] = creal(answer);
+    }
+
+    __atomic_fetch_add(&J->failed, failed, __ATOMIC_RELAXED);
+    free(values);
+    if (J->copy)
+        tms_delete_math_expr(M);
+}
+
+size_t tms_evaluate_batch(tms_math_expr *M, const double *const *columns, const int64_t *strides, size_t n,
+                          double *results, int options)
+{
+    // Copies of M are neither compiled by the JIT nor profiled, the batch runs in this thread with them
+    _tms_batch_job J = {.M = M,
+                        .columns = columns,
+                        .strides = strides,
+                        .results = results,
+                        .options = options,
+                        .copy = tms_get_jit_threshold() == 0 && !_tms_profiling(M->profile) && _tms_parallel_enabled()};
+
+    if ((options & NO_LOCK) != 1)
+        _tms_lock_evaluator_mode(TMS_EVALUATOR, options);
+
+    // The pool threads evaluate under the lock held by this thread
+    if (J.copy)
+        tms_parallel_for(n, TMS_BATCH_GRAIN, _tms_evaluate_rows, &J);
+    else
+        _tms_evaluate_rows(&J, 0, n);
+
+    if ((options & NO_LOCK) != 1)
+        tms_unlock_evaluator(TMS_EVALUATOR);
+    return J.failed;
+}
+
 double complex *tms_solve_list(tms_arg_list *expr_list, int options, tms_arg_list *labels)
 {
     if (expr_list->count < 1)
@@ -90,30 +251,131 @@ int64_t *tms_int_solve_list(tms_arg_list *expr_list, tms_arg_list *labels)
     return answer_list;
 }
 
+// Expressions of a list solved by one range, see tms_solve_list_parallel()
+typedef struct _tms_list_job
+{
+    tms_arg_list *expr_list, *labels;
+    int options;
+    // double complex or int64_t answers
+    void *answers;
+    int *status;
+} _tms_list_job;
+
+// Solves the expressions [begin, end) of a list
+static void _tms_solve_list_range(void *arg, size_t begin, size_t end)
+{
+    _tms_list_job *J = arg;
+    double complex *answers = J->answers;
+    tms_math_expr *M;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        // The expression owns its labels, the parser frees them if it fails
+        M = tms_parse_expr(J->expr_list->arguments[i], J->options | NO_LOCK, tms_dup_arg_list(J->labels));
+        answers[i] = tms_evaluate(M, NO_LOCK | (J->options & PRINT_ERRORS));
+        tms_delete_math_expr(M);
+        if (J->status != NULL)
+            J->status[i] = (tms_iscnan(answers[i]) ? -1 : 0);
+        // Don't let the errors of this expression be reported by the next one
+        if (tms_iscnan(answers[i]))
+            tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
+    }
+}
+
+// Integer variant of _tms_solve_list_range()
+static void _tms_int_solve_list_range(void *arg, size_t begin, size_t end)
+{
+    _tms_list_job *J = arg;
+    int64_t *answers = J->answers;
+    tms_int_expr *M;
+    int status;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        M = tms_parse_int_expr(J->expr_list->arguments[i], J->options | NO_LOCK, tms_dup_arg_list(J->labels));
+        status = (M != NULL ? tms_int_evaluate(M, answers + i, NO_LOCK | (J->options & PRINT_ERRORS)) : -1);
+        tms_delete_int_expr(M);
+        if (J->status != NULL)
+            J->status[i] = status;
+        if (status != 0)
+        {
+            answers[i] = 0;
+            tms_clear_errors(TMS_INT_EVALUATOR | TMS_INT_PARSER);
+        }
+    }
+}
+
+// Solves a list with the range function of the variant, each thread parses and evaluates its own expressions
+static void *_tms_solve_list_parallel(int variant, tms_arg_list *expr_list, int options, tms_arg_list *labels,
+                                      int *status)
+{
+    if (expr_list->count < 1)
+        return NULL;
+    size_t size = (variant == TMS_EVALUATOR ? sizeof(double complex) : sizeof(int64_t));
+    _tms_list_job J = {expr_list, labels, options, malloc(expr_list->count * size), status};
+    if (J.answers == NULL)
+        return NULL;
+
+    // The shared lock keeps the variables and user functions unchanged while the threads parse
+    if ((options & NO_LOCK) != 1)
+        tms_lock_evaluator_shared(variant);
+    tms_parallel_for(expr_list->count, TMS_LIST_GRAIN,
+                     variant == TMS_EVALUATOR ? _tms_solve_list_range : _tms_int_solve_list_range, &J);
+    if ((options & NO_LOCK) != 1)
+        tms_unlock_evaluator(variant);
+    return J.answers;
+}
+
+double complex *tms_solve_list_parallel(tms_arg_list *expr_list, int options, tms_arg_list *labels, int *status)
+{
+    return _tms_solve_list_parallel(TMS_EVALUATOR, expr_list, options, labels, status);
+}
+
+int64_t *tms_int_solve_list_parallel(tms_arg_list *expr_list, int options, tms_arg_list *labels, int *status)
+{
+    return _tms_solve_list_parallel(TMS_INT_EVALUATOR, expr_list, options, labels, status);
+}
+
 double complex _tms_evaluate_unsafe(tms_math_expr *M)
 {
     if (M == NULL)
         return NAN;
     tms_op_node *i_node;
     int i;
+    bool profiled = _tms_profiling(NULL);
 
     tms_math_subexpr *S = M->S;
     for (i = 0; i < M->subexpr_count; ++i)
     {
+        if (profiled)
+            _tms_profile_enter_subexpr(M->expr, i, S[i].subexpr_start, S[i].func_type, S[i].func.user);
+
         // Extended and User functions have no nodes
         if (S[i].nodes == NULL)
         {
+            // Cancellation point of asynchronous evaluations, before the calls that can run for long
+            if ((S[i].func_type == TMS_F_EXTENDED && S[i].exec_extf) || S[i].func_type == TMS_F_USER)
+            {
+                if (_tms_cancelled(_tms_async_cancel))
+                {
+                    tms_save_error(TMS_EVALUATOR, EVALUATION_CANCELLED, EH_FATAL, M->expr, S[i].subexpr_start);
+                    return NAN;
+                }
+            }
+
             if (S[i].func_type == TMS_F_EXTENDED && S[i].exec_extf)
             {
-                bool _debug_state = _tms_debug;
+                bool _debug_state = _tms_debug_muted;
 
                 // Disable debug output for extended functions
-                _tms_debug = false;
+                _tms_debug_muted = true;
 
                 // Call the extended function using its pointer
+                uint64_t stats_start = _tms_stats_begin(TMS_STAT_EXTF);
                 int status = (*(S[i].func.extended))(S[i].f_args, M->labels, *(S[i].result));
+                _tms_stats_end(TMS_STAT_EXTF, stats_start);
 
-                _tms_debug = _debug_state;
+                _tms_debug_muted = _debug_state;
 
                 if (status != 0)
                 {
@@ -134,7 +396,9 @@ double complex _tms_evaluate_unsafe(tms_math_expr *M)
             }
             else if (S[i].func_type == TMS_F_USER)
             {
+                uint64_t stats_start = _tms_stats_begin(TMS_STAT_UFUNC_LOOKUP);
                 const tms_ufunc *userf = tms_get_ufunc_by_name(S[i].func.user);
+                _tms_stats_end(TMS_STAT_UFUNC_LOOKUP, stats_start);
                 if (userf == NULL)
                 {
                     tms_save_error(TMS_EVALUATOR, USER_FUNCTION_NOT_FOUND, EH_FATAL, M->expr, M->S[i].subexpr_start);
@@ -267,9 +531,12 @@ double complex _tms_evaluate_unsafe(tms_math_expr *M)
                 return NAN;
             }
         }
+
+        if (profiled)
+            _tms_profile_leave();
     }
 
-    if (_tms_debug)
+    if (_tms_debug && !_tms_debug_muted)
         tms_dump_expr(M, true);
 
     return M->answer;
@@ -285,25 +552,30 @@ int _tms_int_evaluate_unsafe(tms_int_expr *M, int64_t *result)
 
     tms_int_op_node *i_node;
     int state;
-    bool modify_error;
+    bool modify_error, profiled = _tms_profiling(NULL);
     // Subexpression pointer to access the subexpression array.
     tms_int_subexpr *S = M->S;
     for (int i = 0; i < M->subexpr_count; ++i)
     {
+        if (profiled)
+            _tms_profile_enter_subexpr(M->expr, i, S[i].subexpr_start, S[i].func_type, S[i].func.user);
+
         // Extended functions have no nodes
         if (S[i].nodes == NULL)
         {
             if (S[i].func_type == TMS_F_INT_EXTENDED && S[i].exec_extf)
             {
-                bool _debug_state = _tms_debug;
+                bool _debug_state = _tms_debug_muted;
 
                 // Disable debug output for extended functions
-                _tms_debug = false;
+                _tms_debug_muted = true;
 
                 // Call the extended function using its pointer
+                uint64_t stats_start = _tms_stats_begin(TMS_STAT_EXTF);
                 int status = (*(S[i].func.extended))(S[i].f_args, M->labels, *(S[i].result));
+                _tms_stats_end(TMS_STAT_EXTF, stats_start);
 
-                _tms_debug = _debug_state;
+                _tms_debug_muted = _debug_state;
 
                 if (status != 0)
                 {
@@ -320,7 +592,9 @@ int _tms_int_evaluate_unsafe(tms_int_expr *M, int64_t *result)
             }
             else if (S[i].func_type == TMS_F_INT_USER)
             {
+                uint64_t stats_start = _tms_stats_begin(TMS_STAT_UFUNC_LOOKUP);
                 const tms_int_ufunc *userf = tms_get_int_ufunc_by_name(S[i].func.user);
+                _tms_stats_end(TMS_STAT_UFUNC_LOOKUP, stats_start);
                 if (userf == NULL)
                 {
                     tms_save_error(TMS_INT_EVALUATOR, USER_FUNCTION_NOT_FOUND, EH_FATAL, M->expr,
@@ -478,9 +752,12 @@ int _tms_int_evaluate_unsafe(tms_int_expr *M, int64_t *result)
                 break;
             }
         }
+
+        if (profiled)
+            _tms_profile_leave();
     }
 
-    if (_tms_debug)
+    if (_tms_debug && !_tms_debug_muted)
         tms_dump_int_expr(M, true);
 
     *result = M->answer;
@@ -489,7 +766,8 @@ int _tms_int_evaluate_unsafe(tms_int_expr *M, int64_t *result)
 
 int tms_int_evaluate(tms_int_expr *M, int64_t *result, int options)
 {
-    static int stack_depth;
+    // Per thread, concurrent evaluations nest independently
+    static _Thread_local int stack_depth;
     ++stack_depth;
     if (stack_depth > 32)
     {
@@ -499,7 +777,7 @@ int tms_int_evaluate(tms_int_expr *M, int64_t *result, int options)
     }
 
     if ((options & NO_LOCK) != 1)
-        tms_lock_evaluator(TMS_INT_EVALUATOR);
+        _tms_lock_evaluator_mode(TMS_INT_EVALUATOR, options);
 
     if (tms_get_error_count(TMS_INT_EVALUATOR | TMS_INT_PARSER, EH_ALL_ERRORS) != 0)
     {
@@ -507,7 +785,13 @@ int tms_int_evaluate(tms_int_expr *M, int64_t *result, int options)
         tms_clear_errors(TMS_INT_EVALUATOR | TMS_INT_PARSER);
     }
 
-    int exit_status = _tms_int_evaluate_unsafe(M, result);
+    uint64_t stats_start = _tms_stats_begin(TMS_STAT_INT_EVALUATE);
+    int exit_status;
+    if (M != NULL && _tms_profiling(M->profile))
+        exit_status = _tms_int_evaluate_profiled(M, result);
+    else
+        exit_status = _tms_int_evaluate_unsafe(M, result);
+    _tms_stats_end(TMS_STAT_INT_EVALUATE, stats_start);
     if (exit_status != 0 && (options & PRINT_ERRORS) != 0)
         tms_print_errors(TMS_INT_EVALUATOR | TMS_INT_PARSER);
 
@@ -518,6 +802,20 @@ int tms_int_evaluate(tms_int_expr *M, int64_t *result, int options)
     return exit_status;
 }
 
+// Copies the label values to the payload of the labels list, the function arguments are parsed with them
+static void _tms_set_labels_payload(tms_arg_list *L, void *values_list, size_t size)
+{
+    if (L->payload == values_list)
+        return;
+    if (L->payload_size != size)
+    {
+        free(L->payload);
+        L->payload = malloc(size);
+        L->payload_size = size;
+    }
+    memcpy(L->payload, values_list, size);
+}
+
 void tms_set_labels_values(tms_math_expr *M, double complex *values_list)
 {
     int i;
@@ -528,6 +826,8 @@ void tms_set_labels_values(tms_math_expr *M, double complex *values_list)
         else
             *(double complex *)(M->all_labeled_ops[i].ptr) = values_list[M->all_labeled_ops[i].id];
     }
+    if (M->labels != NULL)
+        _tms_set_labels_payload(M->labels, values_list, M->labels->count * sizeof(double complex));
 }
 
 void tms_set_int_labels_values(tms_int_expr *M, int64_t *values_list)
@@ -540,6 +840,8 @@ void tms_set_int_labels_values(tms_int_expr *M, int64_t *values_list)
         else
             *(int64_t *)(M->all_labeled_ops[i].ptr) = values_list[M->all_labeled_ops[i].id];
     }
+    if (M->labels != NULL)
+        _tms_set_labels_payload(M->labels, values_list, M->labels->count * sizeof(int64_t));
 }
 
 bool _print_operand_source(tms_math_subexpr *S, double complex *operand, int s_i, bool was_evaluated)
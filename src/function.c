@@ -1,15 +1,18 @@
 /*
-Copyright (C) 2021-2024 Ahmad Ismail
+Copyright (C) 2021-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #include "function.h"
+#include "async_common.h"
 #include "error_handler.h"
 #include "evaluator.h"
 #include "internals.h"
+#include "jit.h"
 #include "m_errors.h"
 #include "parser.h"
 #include "scientific.h"
 #include "string_tools.h"
+#include "thread_pool.h"
 #include "tms_complex.h"
 #include "tms_math_strs.h"
 #include <float.h>
@@ -234,6 +237,13 @@ int _tms_derivative(tms_arg_list *L, tms_arg_list *labels, double complex *resul
     x -= epsilon;
     tms_set_labels_values(M, &x);
     fx1 = tms_evaluate(M, NO_LOCK);
+    if (_tms_cancelled(_tms_async_cancel))
+    {
+        tms_clear_errors(TMS_EVALUATOR);
+        tms_save_error(TMS_EVALUATOR, EVALUATION_CANCELLED, EH_FATAL, NULL, 0);
+        tms_delete_math_expr(M);
+        return -1;
+    }
     // Solve for x + epsilon
     x += 2 * epsilon;
     tms_set_labels_values(M, &x);
@@ -250,6 +260,67 @@ int _tms_derivative(tms_arg_list *L, tms_arg_list *labels, double complex *resul
     return 0;
 }
 
+// Number of points summed by a block of the integration
+#define TMS_INTEGRATE_BLOCK 8192
+
+// Simpson 3/8 sums of the points of the integration, by block
+typedef struct _tms_integrate_job
+{
+    tms_math_expr *M;
+    double complex lower_bound;
+    double delta, rounds;
+    // Blocks are run in parallel, each range of blocks evaluates its own copy of M
+    bool copy;
+    int failed;
+    // Cancel flag of the asynchronous evaluation running the integration, checked between blocks
+    int *cancel;
+    // Sums of the points with an index not divisible by 3, and divisible by 3
+    double (*sums)[2];
+} _tms_integrate_job;
+
+// Sums the points 1 to rounds - 1 of blocks [begin, end)
+static void _tms_integrate_blocks(void *arg, size_t begin, size_t end)
+{
+    _tms_integrate_job *J = arg;
+    tms_math_expr *M = (J->copy ? tms_dup_mexpr(J->M) : J->M);
+    double complex an;
+    double fn;
+    size_t b, n, last;
+    // Pool threads stop the nested integrations at the same time
+    int *cancel = _tms_async_cancel;
+    _tms_async_cancel = J->cancel;
+
+    for (b = begin; b < end && !__atomic_load_n(&J->failed, __ATOMIC_RELAXED); ++b)
+    {
+        if (_tms_cancelled(J->cancel))
+        {
+            __atomic_store_n(&J->failed, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        J->sums[b][0] = J->sums[b][1] = 0;
+        last = (b + 1) * TMS_INTEGRATE_BLOCK;
+        if (last > J->rounds)
+            last = J->rounds;
+        for (n = (b == 0 ? 1 : b * TMS_INTEGRATE_BLOCK); n < last; ++n)
+        {
+            an = J->lower_bound + J->delta * n / J->rounds;
+            tms_set_labels_values(M, &an);
+            fn = tms_evaluate(M, NO_LOCK);
+            if (isnan(fn))
+            {
+                // The error is reported by the thread that started the integration
+                tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
+                __atomic_store_n(&J->failed, 1, __ATOMIC_RELAXED);
+                break;
+            }
+            J->sums[b][n % 3 == 0] += fn;
+        }
+    }
+    if (J->copy)
+        tms_delete_math_expr(M);
+    _tms_async_cancel = cancel;
+}
+
 int _tms_integrate(tms_arg_list *L, tms_arg_list *labels, double complex *result)
 {
     tms_math_expr *M;
@@ -262,10 +333,9 @@ int _tms_integrate(tms_arg_list *L, tms_arg_list *labels, double complex *result
         return -1;
     }
 
-    int n;
     bool flip_result = false;
-    double complex lower_bound, upper_bound, an;
-    double integration_ans, rounds, delta, fn;
+    double complex lower_bound, upper_bound;
+    double integration_ans, rounds, delta;
 
     lower_bound = tms_solve_e(L->arguments[0], NO_LOCK | ENABLE_CMPLX, labels);
     upper_bound = tms_solve_e(L->arguments[1], NO_LOCK | ENABLE_CMPLX, labels);
@@ -329,41 +399,36 @@ int _tms_integrate(tms_arg_list *L, tms_arg_list *labels, double complex *result
         return -1;
     }
 
-    double part1 = 0, part2 = 0;
-    // Use i to determine when n is divisible by 3 without doing a mod 3
-    int i = 1;
+    // The points are summed by blocks, in the same order whatever the number of threads.
+    // With the JIT, M is compiled once and evaluated in this thread instead of compiling a copy per range of blocks
+    _tms_integrate_job J = {.M = M,
+                            .lower_bound = lower_bound,
+                            .delta = delta,
+                            .rounds = rounds,
+                            .copy = tms_get_jit_threshold() == 0 && _tms_parallel_enabled(),
+                            .cancel = _tms_async_cancel};
+    size_t b, blocks = ((size_t)rounds + TMS_INTEGRATE_BLOCK - 1) / TMS_INTEGRATE_BLOCK;
+    J.sums = malloc(blocks * sizeof(*J.sums));
+    if (J.copy)
+        tms_parallel_for(blocks, 1, _tms_integrate_blocks, &J);
+    else
+        _tms_integrate_blocks(&J, 0, blocks);
+    if (J.failed)
+    {
+        tms_save_error(TMS_EVALUATOR, _tms_cancelled(J.cancel) ? EVALUATION_CANCELLED : INTEGRAl_UNDEFINED, EH_FATAL, NULL,
+                       0);
+        tms_delete_math_expr(M);
+        free(J.sums);
+        return -1;
+    }
 
-    for (n = 1; n < rounds; ++n)
+    double part1 = 0, part2 = 0;
+    for (b = 0; b < blocks; ++b)
     {
-        if (i == 3)
-        {
-            an = lower_bound + delta * n / rounds;
-            tms_set_labels_values(M, &an);
-            fn = tms_evaluate(M, NO_LOCK);
-            if (isnan(fn) == true)
-            {
-                tms_save_error(TMS_EVALUATOR, INTEGRAl_UNDEFINED, EH_FATAL, NULL, 0);
-                tms_delete_math_expr(M);
-                return -1;
-            }
-            part2 += fn;
-            i = 1;
-        }
-        else
-        {
-            an = lower_bound + delta * n / rounds;
-            tms_set_labels_values(M, &an);
-            fn = tms_evaluate(M, NO_LOCK);
-            if (isnan(fn) == true)
-            {
-                tms_save_error(TMS_EVALUATOR, INTEGRAl_UNDEFINED, EH_FATAL, NULL, 0);
-                tms_delete_math_expr(M);
-                return -1;
-            }
-            part1 += fn;
-            ++i;
-        }
+        part1 += J.sums[b][0];
+        part2 += J.sums[b][1];
     }
+    free(J.sums);
     integration_ans += 3 * part1 + 2 * part2;
 
     integration_ans *= 0.375 * (delta / rounds);
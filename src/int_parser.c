@@ -6,6 +6,8 @@ SPDX-License-Identifier: LGPL-2.1-only
 #include "error_handler.h"
 #include "evaluator.h"
 #include "internals.h"
+#include "profile.h"
+#include "stats_common.h"
 #include "string_tools.h"
 #include "tms_math_strs.h"
 
@@ -110,16 +112,6 @@ int _tms_read_int_operand(tms_int_expr *M, int start, int64_t *result)
     return 0;
 }
 
-int _tms_compare_int_subexpr_depth(const void *a, const void *b)
-{
-    if (((tms_int_subexpr *)a)->depth < ((tms_int_subexpr *)b)->depth)
-        return 1;
-    else if ((*((tms_int_subexpr *)a)).depth > (*((tms_int_subexpr *)b)).depth)
-        return -1;
-    else
-        return 0;
-}
-
 int _tms_set_int_function_ptr(const char *expr, tms_int_expr *M, int s_i)
 {
     tms_int_subexpr *S = &(M->S[s_i]);
@@ -254,7 +246,9 @@ tms_int_expr *tms_parse_int_expr(const char *expr, int options, tms_arg_list *la
         tms_clear_errors(TMS_INT_PARSER);
     }
 
+    uint64_t stats_start = _tms_stats_begin(TMS_STAT_INT_PARSE);
     tms_int_expr *M = _tms_parse_int_expr_unsafe(expr, options, labels);
+    _tms_stats_end(TMS_STAT_INT_PARSE, stats_start);
     if (M == NULL && (options & PRINT_ERRORS) != 0)
         tms_print_errors(TMS_INT_PARSER);
 
@@ -294,11 +288,22 @@ tms_int_expr *_tms_parse_int_expr_unsafe(const char *expr_const, int options, tm
 
     // Expand unary operators into functions
     if ((options & EXPAND_UOPS) != 0)
+    {
+        uint64_t stats_start = _tms_stats_begin(TMS_STAT_EXPAND_MACROS);
         _tms_expand_int_macros(&expr);
+        _tms_stats_end(TMS_STAT_EXPAND_MACROS, stats_start);
+    }
+
+    // Split the expression into tokens once, the following steps work on the tokens instead of rescanning the string
+    tms_token_list T;
+    _tms_tokenize(expr, &T);
 
-    tms_int_expr *M = _tms_init_int_expr(expr);
+    tms_int_expr *M = _tms_init_int_expr(expr, &T);
     if (M == NULL)
+    {
+        free(T.tokens);
         return NULL;
+    }
 
     // Add the labels to the math expression if necessary
     M->labels = (enable_labels ? labels : NULL);
@@ -335,15 +340,17 @@ tms_int_expr *_tms_parse_int_expr_unsafe(const char *expr_const, int options, tm
         status = _tms_set_int_function_ptr(expr, M, s_i);
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_int_expr(M);
             return NULL;
         }
 
         // Get an array of the index of all operators and set their count
-        int *operator_index = _tms_get_operator_indexes(expr, S, s_i);
+        int *operator_index = _tms_get_operator_indexes(expr, S, s_i, &T);
 
         if (operator_index == NULL)
         {
+            free(T.tokens);
             tms_delete_int_expr(M);
             return NULL;
         }
@@ -354,13 +361,15 @@ tms_int_expr *_tms_parse_int_expr_unsafe(const char *expr_const, int options, tm
         // Exiting due to error
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_int_expr(M);
             return NULL;
         }
 
-        status = _tms_set_all_operands(M, s_i, enable_labels);
+        status = _tms_set_all_operands(M, s_i, enable_labels, &T);
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_int_expr(M);
             return NULL;
         }
@@ -368,11 +377,13 @@ tms_int_expr *_tms_parse_int_expr_unsafe(const char *expr_const, int options, tm
         status = _tms_set_evaluation_order(S + s_i);
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_int_expr(M);
             return NULL;
         }
         _tms_set_result_pointers(M, s_i);
     }
+    free(T.tokens);
 
     if (enable_labels)
     {
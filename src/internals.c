@@ -4,15 +4,25 @@ SPDX-License-Identifier: LGPL-2.1-only
 */
 #include "internals.h"
 #include "bitwise.h"
+#include "builtins.h"
+// The CMake build generates the hash tables in its build directory, other builds use the copy kept in the sources
+#ifdef TMS_GENERATED_BUILTINS
+#include <builtins_phf.h>
+#else
+#include "builtins_phf.h"
+#endif
 #include "error_handler.h"
 #include "function.h"
-#include "hashmap.h"
 #include "hashset.h"
 #include "int_parser.h"
 #include "m_errors.h"
+#include "matrix_expr.h"
 #include "parser.h"
 #include "scientific.h"
+#include "serializer.h"
+#include "stats_common.h"
 #include "string_tools.h"
+#include "symtab.h"
 #include "tms_complex.h"
 #include "tms_math_strs.h"
 #include <math.h>
@@ -25,190 +35,43 @@ SPDX-License-Identifier: LGPL-2.1-only
 double complex tms_g_ans = 0;
 int64_t tms_g_int_ans = 0;
 
-const tms_rc_func tms_g_rc_func[] = {
-    {"fact", tms_fact, tms_cfact}, {"abs", fabs, cabs_z},        {"exp", exp, tms_cexp},
-    {"ceil", ceil, tms_cceil},     {"floor", floor, tms_cfloor}, {"round", round, tms_cround},
-    {"sign", tms_sign, tms_csign}, {"arg", tms_carg_d, carg_z},  {"sqrt", sqrt, csqrt},
-    {"cbrt", cbrt, tms_ccbrt},     {"cos", tms_cos, tms_ccos},   {"sin", tms_sin, tms_csin},
-    {"tan", tms_tan, tms_ctan},    {"acos", acos, cacos},        {"asin", asin, casin},
-    {"atan", atan, catan},         {"cosh", cosh, ccosh},        {"sinh", sinh, csinh},
-    {"tanh", tanh, ctanh},         {"acosh", acosh, cacosh},     {"asinh", asinh, casinh},
-    {"atanh", atanh, catanh},      {"ln", log, tms_cln},         {"log2", log2, tms_clog2},
-    {"log10", log10, tms_clog10}};
-
-// Extended functions, may take more than one argument (stored in a comma separated string)
-const tms_extf tms_g_extf[] = {{"avg", _tms_avg},
-                               {"min", _tms_min},
-                               {"max", _tms_max},
-                               {"integrate", _tms_integrate},
-                               {"derivative", _tms_derivative},
-                               {"logn", _tms_logn},
-                               {"hex", _tms_hex},
-                               {"oct", _tms_oct},
-                               {"bin", _tms_bin},
-                               {"rand", _tms_rand},
-                               {"int", _tms_int},
-                               {"float32", _tms_bin_to_float32},
-                               {"float64", _tms_bin_to_float64}};
-
-const tms_int_func tms_g_int_func[] = {{"not", tms_not},           {"fact", tms_int_fact},
-                                       {"mask", tms_mask},         {"mask_bit", tms_mask_bit},
-                                       {"inv_mask", tms_inv_mask}, {"ipv4_prefix", tms_ipv4_prefix},
-                                       {"zeros", tms_zeros},       {"ones", tms_ones},
-                                       {"abs", tms_int_abs},       {"parity", tms_parity}};
-
-const tms_int_extf tms_g_int_extf[] = {{"rand", _tms_int_rand},
-                                       {"rr", _tms_rr},
-                                       {"rl", _tms_rl},
-                                       {"sr", _tms_sr},
-                                       {"sra", _tms_sra},
-                                       {"sl", _tms_sl},
-                                       {"nand", _tms_nand},
-                                       {"and", _tms_and},
-                                       {"xor", _tms_xor},
-                                       {"nor", _tms_nor},
-                                       {"or", _tms_or},
-                                       {"ipv4", _tms_ipv4},
-                                       {"dotted", _tms_dotted},
-                                       {"mask_range", _tms_mask_range},
-                                       {"min", _tms_int_min},
-                                       {"max", _tms_int_max},
-                                       {"float", _tms_from_float},
-                                       {"hamming_dist", _tms_hamming_distance},
-                                       {"multinv", _tms_multinv},
-                                       {"gcd", _tms_gcd},
-                                       {"lcm", _tms_lcm}};
+#define TMS_RC_FUNC_ITEM(name, real, cmplx) {name, real, cmplx},
+#define TMS_FUNC_ITEM(name, function) {name, function},
+#define TMS_VAR_ITEM(name, value) {name, value, true},
+
+const tms_rc_func tms_g_rc_func[] = {TMS_BUILTIN_RC_FUNCS(TMS_RC_FUNC_ITEM)};
+
+const tms_extf tms_g_extf[] = {TMS_BUILTIN_EXTFS(TMS_FUNC_ITEM)};
+
+const tms_int_func tms_g_int_func[] = {TMS_BUILTIN_INT_FUNCS(TMS_FUNC_ITEM)};
+
+const tms_int_extf tms_g_int_extf[] = {TMS_BUILTIN_INT_EXTFS(TMS_FUNC_ITEM)};
+
+const tms_var tms_g_builtin_vars[] = {TMS_BUILTIN_VARS(TMS_VAR_ITEM)};
 
 bool _tms_do_init = true;
 bool _tms_debug = false;
 
 pthread_mutex_t _parser_lock, _int_parser_lock;
-pthread_mutex_t _ufunc_lock, _int_ufunc_lock;
-pthread_mutex_t _variables_lock, _int_variables_lock;
-pthread_mutex_t _evaluator_lock, _int_evaluator_lock;
-pthread_mutex_t _error_db_lock;
+// Read locked by shared evaluations (SHARED_LOCK option), write locked otherwise
+pthread_rwlock_t _ufunc_lock, _int_ufunc_lock;
+pthread_rwlock_t _variables_lock, _int_variables_lock;
+pthread_rwlock_t _evaluator_lock, _int_evaluator_lock;
 
 char *tms_g_illegal_names[] = {"ans"};
 const int tms_g_illegal_names_count = array_length(tms_g_illegal_names);
 
-tms_var tms_g_builtin_vars[] = {{"i", I, true}, {"pi", M_PI, true}, {"e", M_E, true}, {"c", 299792458, true}};
-hashmap *var_hmap, *int_var_hmap, *ufunc_hmap, *int_ufunc_hmap;
-hashmap *rc_func_hmap, *extf_hmap, *int_func_hmap, *int_extf_hmap;
+// Built-in functions and constants are found with the perfect hash of builtins_phf.h, these tables hold user names
+tms_symtab *var_hmap, *int_var_hmap, *ufunc_hmap, *int_ufunc_hmap;
+
+// User functions catalogs, searched when a user function is not found in the symbol table
+tms_catalog *ufunc_catalog = NULL, *int_ufunc_catalog = NULL;
 
 uint64_t tms_int_mask = 0xFFFFFFFF;
 
 int8_t tms_int_mask_size = 32;
 
-// Too many boilerplates, incoming!
-// What they do is hash, compare and retrieve for all hashmaps
-int _tms_var_compare(const void *a, const void *b, void *udata)
-{
-    const tms_var *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_var_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_var *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_int_var_compare(const void *a, const void *b, void *udata)
-{
-    const tms_int_var *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_int_var_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_int_var *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_ufunc_compare(const void *a, const void *b, void *udata)
-{
-    const tms_ufunc *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_ufunc_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_ufunc *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_int_ufunc_compare(const void *a, const void *b, void *udata)
-{
-    const tms_int_ufunc *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_int_ufunc_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_int_ufunc *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_rc_func_compare(const void *a, const void *b, void *udata)
-{
-    const tms_rc_func *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_rc_func_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_rc_func *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_extf_compare(const void *a, const void *b, void *udata)
-{
-    const tms_extf *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_extf_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_extf *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_int_func_compare(const void *a, const void *b, void *udata)
-{
-    const tms_int_func *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_int_func_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_int_func *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-int _tms_int_extf_compare(const void *a, const void *b, void *udata)
-{
-    const tms_int_extf *va = a, *vb = b;
-    return strcmp(va->name, vb->name);
-}
-
-uint64_t _tms_int_extf_hash(const void *item, uint64_t seed0, uint64_t seed1)
-{
-    const tms_int_extf *v = item;
-    return hashmap_xxhash3(v->name, strlen(v->name), seed0, seed1);
-}
-
-void _tms_free_rcfunc(void *item)
-{
-    tms_rc_func *a = item;
-    free(a->name);
-}
-
-void _tms_free_extf(void *item)
-{
-    tms_extf *a = item;
-    free(a->name);
-}
-
+// Free the members of the items of the symbol tables
 void _tms_free_ufunc(void *item)
 {
     tms_ufunc *a = item;
@@ -222,117 +85,149 @@ void _tms_free_var(void *item)
     free(a->name);
 }
 
-void _tms_free_int_func(void *item)
+void _tms_free_int_ufunc(void *item)
 {
-    tms_int_func *a = item;
+    tms_int_ufunc *a = item;
     free(a->name);
+    tms_delete_int_expr(a->F);
 }
 
-void _tms_free_int_extf(void *item)
+void _tms_free_int_var(void *item)
 {
-    tms_int_extf *a = item;
+    tms_int_var *a = item;
     free(a->name);
 }
 
-void _tms_free_int_ufunc(void *item)
+// Finds a built-in item by name, items is the list of the hash P and the first member of an item is its name
+static inline const void *_tms_get_builtin(const _tms_phf *P, const void *items, size_t elsize, const char *name)
 {
-    tms_int_ufunc *a = item;
-    free(a->name);
-    tms_delete_int_expr(a->F);
+    uint64_t key[TMS_SYMTAB_KEY_SIZE / 8];
+    size_t len = _tms_symtab_key(name, key);
+    uint64_t h = _tms_phf_hash(name, key, len);
+    uint32_t slot = _tms_phf_slot(h, P->displacement[_tms_phf_bucket(h, P->buckets)], P->count);
+    const char *item = (const char *)items + P->index[slot] * elsize;
+
+    if (P->keys[slot][0] != key[0] || P->keys[slot][1] != key[1])
+        return NULL;
+    // Names shorter than the key are fully compared already
+    if (len < TMS_SYMTAB_KEY_SIZE || strcmp(*(char *const *)item, name) == 0)
+        return item;
+    else
+        return NULL;
 }
 
-void _tms_free_int_var(void *item)
+// Compares items by name, the first member of an item
+static int _tms_compare_names(const void *a, const void *b)
 {
-    tms_int_var *a = item;
-    free(a->name);
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Returns a malloc'd copy of a list of built-in items, optionally sorted by name
+static void *_tms_copy_builtins(const void *items, size_t count, size_t elsize, size_t *out_count, bool sort)
+{
+    void *copy = malloc(count * elsize);
+    memcpy(copy, items, count * elsize);
+    if (sort)
+        qsort(copy, count, elsize, _tms_compare_names);
+    *out_count = count;
+    return copy;
 }
 
 const tms_var *tms_get_var_by_name(const char *name)
 {
-    tms_var tmp = {.name = name};
-    return hashmap_get(var_hmap, &tmp);
+    const tms_var *v = _tms_get_builtin(&_tms_builtin_vars_phf, tms_g_builtin_vars, sizeof(tms_var), name);
+    return v != NULL ? v : tms_symtab_get(var_hmap, name);
 }
 
 const tms_int_var *tms_get_int_var_by_name(const char *name)
 {
-    tms_int_var tmp = {.name = name};
-    return hashmap_get(int_var_hmap, &tmp);
+    return tms_symtab_get(int_var_hmap, name);
 }
 
 const tms_rc_func *tms_get_rc_func_by_name(const char *name)
 {
-    tms_rc_func tmp = {.name = name};
-    return hashmap_get(rc_func_hmap, &tmp);
+    return _tms_get_builtin(&_tms_rc_func_phf, tms_g_rc_func, sizeof(tms_rc_func), name);
 }
 
 const tms_extf *tms_get_extf_by_name(const char *name)
 {
-    tms_extf tmp = {.name = name};
-    return hashmap_get(extf_hmap, &tmp);
+    return _tms_get_builtin(&_tms_extf_phf, tms_g_extf, sizeof(tms_extf), name);
 }
 
 const tms_int_func *tms_get_int_func_by_name(const char *name)
 {
-    tms_int_func tmp = {.name = name};
-    return hashmap_get(int_func_hmap, &tmp);
+    return _tms_get_builtin(&_tms_int_func_phf, tms_g_int_func, sizeof(tms_int_func), name);
 }
 
 const tms_int_extf *tms_get_int_extf_by_name(const char *name)
 {
-    tms_int_extf tmp = {.name = name};
-    return hashmap_get(int_extf_hmap, &tmp);
+    return _tms_get_builtin(&_tms_int_extf_phf, tms_g_int_extf, sizeof(tms_int_extf), name);
 }
 
 const tms_ufunc *tms_get_ufunc_by_name(const char *name)
 {
-    tms_ufunc tmp = {.name = name};
-    return hashmap_get(ufunc_hmap, &tmp);
+    const tms_ufunc *F = tms_symtab_get(ufunc_hmap, name);
+    if (F == NULL && ufunc_catalog != NULL)
+        F = tms_catalog_get_ufunc(ufunc_catalog, name);
+    return F;
 }
 
 const tms_int_ufunc *tms_get_int_ufunc_by_name(const char *name)
 {
-    tms_int_ufunc tmp = {.name = name};
-    return hashmap_get(int_ufunc_hmap, &tmp);
+    const tms_int_ufunc *F = tms_symtab_get(int_ufunc_hmap, name);
+    if (F == NULL && int_ufunc_catalog != NULL)
+        F = tms_catalog_get_int_ufunc(int_ufunc_catalog, name);
+    return F;
 }
 
 tms_var *tms_get_all_vars(size_t *count, bool sort)
 {
-    return hashmap_to_array(var_hmap, count, sort);
+    size_t user_count, builtin_count = array_length(tms_g_builtin_vars);
+    tms_var *user_vars = tms_symtab_to_array(var_hmap, &user_count, false), *all;
+    if (user_vars == NULL)
+        return _tms_copy_builtins(tms_g_builtin_vars, builtin_count, sizeof(tms_var), count, sort);
+
+    all = realloc(user_vars, (user_count + builtin_count) * sizeof(tms_var));
+    memcpy(all + user_count, tms_g_builtin_vars, sizeof(tms_g_builtin_vars));
+    *count = user_count + builtin_count;
+    if (sort)
+        qsort(all, *count, sizeof(tms_var), _tms_compare_names);
+    return all;
 }
 
 tms_int_var *tms_get_all_int_vars(size_t *count, bool sort)
 {
-    return hashmap_to_array(int_var_hmap, count, sort);
+    return tms_symtab_to_array(int_var_hmap, count, sort);
 }
 
 tms_rc_func *tms_get_all_rc_func(size_t *count, bool sort)
 {
-    return hashmap_to_array(rc_func_hmap, count, sort);
+    return _tms_copy_builtins(tms_g_rc_func, array_length(tms_g_rc_func), sizeof(tms_rc_func), count, sort);
 }
 
 tms_extf *tms_get_all_extf(size_t *count, bool sort)
 {
-    return hashmap_to_array(extf_hmap, count, sort);
+    return _tms_copy_builtins(tms_g_extf, array_length(tms_g_extf), sizeof(tms_extf), count, sort);
 }
 
 tms_ufunc *tms_get_all_ufunc(size_t *count, bool sort)
 {
-    return hashmap_to_array(ufunc_hmap, count, sort);
+    return tms_symtab_to_array(ufunc_hmap, count, sort);
 }
 
 tms_int_func *tms_get_all_int_func(size_t *count, bool sort)
 {
-    return hashmap_to_array(int_func_hmap, count, sort);
+    return _tms_copy_builtins(tms_g_int_func, array_length(tms_g_int_func), sizeof(tms_int_func), count, sort);
 }
 
 tms_int_extf *tms_get_all_int_extf(size_t *count, bool sort)
 {
-    return hashmap_to_array(int_extf_hmap, count, sort);
+    return _tms_copy_builtins(tms_g_int_extf, array_length(tms_g_int_extf), sizeof(tms_int_extf), count, sort);
 }
 
 tms_int_ufunc *tms_get_all_int_ufunc(size_t *count, bool sort)
 {
-    return hashmap_to_array(int_ufunc_hmap, count, sort);
+    return tms_symtab_to_array(int_ufunc_hmap, count, sort);
 }
 
 bool tms_function_exists(const char *name)
@@ -371,40 +266,56 @@ bool tms_builtin_int_function_exists(const char *name)
 
 int tms_remove_var(const char *name)
 {
-    const tms_var t = {.name = name}, *check;
-    check = hashmap_get(var_hmap, &t);
+    int status;
+    tms_lock_vars(TMS_V_DOUBLE);
+    const tms_var *check = tms_get_var_by_name(name);
     if (check == NULL)
-        return -1;
+        status = -1;
     // Can't remove a built in variable, so return 1 to tell it
-    if (check->is_constant)
-        return 1;
+    else if (check->is_constant)
+        status = 1;
     else
-        return hashmap_delete_and_free(var_hmap, &t);
+        status = tms_symtab_delete_and_free(var_hmap, name);
+    tms_unlock_vars(TMS_V_DOUBLE);
+    return status;
 }
 
 int tms_remove_int_var(const char *name)
 {
-    const tms_int_var t = {.name = name}, *check;
-    check = hashmap_get(int_var_hmap, &t);
+    int status;
+    tms_lock_vars(TMS_V_INT64);
+    const tms_int_var *check = tms_symtab_get(int_var_hmap, name);
     if (check == NULL)
-        return -1;
+        status = -1;
     // Can't remove a built in variable, so return 1 to tell it
-    if (check->is_constant)
-        return 1;
+    else if (check->is_constant)
+        status = 1;
     else
-        return hashmap_delete_and_free(int_var_hmap, &t);
+        status = tms_symtab_delete_and_free(int_var_hmap, name);
+    tms_unlock_vars(TMS_V_INT64);
+    return status;
 }
 
 int tms_remove_ufunc(const char *name)
 {
-    tms_ufunc t = {.name = name};
-    return hashmap_delete_and_free(ufunc_hmap, &t);
+    tms_lock_ufuncs(TMS_V_DOUBLE);
+    int status = tms_symtab_delete_and_free(ufunc_hmap, name);
+    tms_unlock_ufuncs(TMS_V_DOUBLE);
+    return status;
 }
 
 int tms_remove_int_ufunc(const char *name)
 {
-    tms_int_ufunc t = {.name = name};
-    return hashmap_delete_and_free(int_ufunc_hmap, &t);
+    tms_lock_ufuncs(TMS_V_INT64);
+    int status = tms_symtab_delete_and_free(int_ufunc_hmap, name);
+    tms_unlock_ufuncs(TMS_V_INT64);
+    return status;
+}
+
+// Random seed for the hash function of a symbol table
+static uint64_t _tms_symtab_seed()
+{
+    return (uint64_t)rand() << 32 ^ rand();
 }
 
 void tmsolve_init()
@@ -414,56 +325,21 @@ void tmsolve_init()
         // Initialize mutexes
         pthread_mutex_init(&_parser_lock, NULL);
         pthread_mutex_init(&_int_parser_lock, NULL);
-        pthread_mutex_init(&_evaluator_lock, NULL);
-        pthread_mutex_init(&_int_evaluator_lock, NULL);
-        pthread_mutex_init(&_ufunc_lock, NULL);
-        pthread_mutex_init(&_int_ufunc_lock, NULL);
-        pthread_mutex_init(&_variables_lock, NULL);
-        pthread_mutex_init(&_int_variables_lock, NULL);
-        pthread_mutex_init(&_error_db_lock, NULL);
+        pthread_rwlock_init(&_evaluator_lock, NULL);
+        pthread_rwlock_init(&_int_evaluator_lock, NULL);
+        pthread_rwlock_init(&_ufunc_lock, NULL);
+        pthread_rwlock_init(&_int_ufunc_lock, NULL);
+        pthread_rwlock_init(&_variables_lock, NULL);
+        pthread_rwlock_init(&_int_variables_lock, NULL);
 
         // Seed the random number generator
         srand(time(NULL));
 
-        // Prepare hashmaps
-        var_hmap =
-            hashmap_new(sizeof(tms_var), 0, rand(), rand(), _tms_var_hash, _tms_var_compare, _tms_free_var, NULL);
-
-        int_var_hmap = hashmap_new(sizeof(tms_int_var), 0, rand(), rand(), _tms_int_var_hash, _tms_int_var_compare,
-                                   _tms_free_int_var, NULL);
-
-        ufunc_hmap = hashmap_new(sizeof(tms_ufunc), 0, rand(), rand(), _tms_ufunc_hash, _tms_ufunc_compare,
-                                 _tms_free_ufunc, NULL);
-
-        int_ufunc_hmap = hashmap_new(sizeof(tms_int_ufunc), 0, rand(), rand(), _tms_int_ufunc_hash,
-                                     _tms_int_ufunc_compare, _tms_free_int_ufunc, NULL);
-
-        rc_func_hmap = hashmap_new(sizeof(tms_rc_func), 0, rand(), rand(), _tms_rc_func_hash, _tms_rc_func_compare,
-                                   _tms_free_rcfunc, NULL);
-
-        extf_hmap =
-            hashmap_new(sizeof(tms_extf), 0, rand(), rand(), _tms_extf_hash, _tms_extf_compare, _tms_free_extf, NULL);
-
-        int_func_hmap = hashmap_new(sizeof(tms_int_func), 0, rand(), rand(), _tms_int_func_hash, _tms_int_func_compare,
-                                    _tms_free_int_func, NULL);
-
-        int_extf_hmap = hashmap_new(sizeof(tms_int_extf), 0, rand(), rand(), _tms_int_extf_hash, _tms_int_extf_compare,
-                                    _tms_free_int_extf, NULL);
-        int i;
-        for (i = 0; i < array_length(tms_g_builtin_vars); ++i)
-            hashmap_set(var_hmap, tms_g_builtin_vars + i);
-
-        for (i = 0; i < array_length(tms_g_rc_func); ++i)
-            hashmap_set(rc_func_hmap, tms_g_rc_func + i);
-
-        for (i = 0; i < array_length(tms_g_extf); ++i)
-            hashmap_set(extf_hmap, tms_g_extf + i);
-
-        for (i = 0; i < array_length(tms_g_int_func); ++i)
-            hashmap_set(int_func_hmap, tms_g_int_func + i);
-
-        for (i = 0; i < array_length(tms_g_int_extf); ++i)
-            hashmap_set(int_extf_hmap, tms_g_int_extf + i);
+        // Prepare symbol tables
+        var_hmap = tms_symtab_new(sizeof(tms_var), 0, _tms_symtab_seed(), _tms_free_var);
+        int_var_hmap = tms_symtab_new(sizeof(tms_int_var), 0, _tms_symtab_seed(), _tms_free_int_var);
+        ufunc_hmap = tms_symtab_new(sizeof(tms_ufunc), 0, _tms_symtab_seed(), _tms_free_ufunc);
+        int_ufunc_hmap = tms_symtab_new(sizeof(tms_int_ufunc), 0, _tms_symtab_seed(), _tms_free_int_ufunc);
 
         _tms_do_init = false;
     }
@@ -474,15 +350,15 @@ void tms_lock_parser(int variant)
     switch (variant)
     {
     case TMS_PARSER:
-        pthread_mutex_lock(&_parser_lock);
-        pthread_mutex_lock(&_variables_lock);
-        pthread_mutex_lock(&_ufunc_lock);
+        _tms_stats_lock(&_parser_lock, TMS_STAT_PARSER_LOCK_WAIT);
+        _tms_stats_wrlock(&_variables_lock, TMS_STAT_PARSER_LOCK_WAIT);
+        _tms_stats_wrlock(&_ufunc_lock, TMS_STAT_PARSER_LOCK_WAIT);
         return;
 
     case TMS_INT_PARSER:
-        pthread_mutex_lock(&_int_parser_lock);
-        pthread_mutex_lock(&_int_variables_lock);
-        pthread_mutex_lock(&_int_ufunc_lock);
+        _tms_stats_lock(&_int_parser_lock, TMS_STAT_PARSER_LOCK_WAIT);
+        _tms_stats_wrlock(&_int_variables_lock, TMS_STAT_PARSER_LOCK_WAIT);
+        _tms_stats_wrlock(&_int_ufunc_lock, TMS_STAT_PARSER_LOCK_WAIT);
         return;
 
     default:
@@ -497,14 +373,14 @@ void tms_unlock_parser(int variant)
     {
     case TMS_PARSER:
         pthread_mutex_unlock(&_parser_lock);
-        pthread_mutex_unlock(&_variables_lock);
-        pthread_mutex_unlock(&_ufunc_lock);
+        pthread_rwlock_unlock(&_variables_lock);
+        pthread_rwlock_unlock(&_ufunc_lock);
         return;
 
     case TMS_INT_PARSER:
         pthread_mutex_unlock(&_int_parser_lock);
-        pthread_mutex_unlock(&_int_variables_lock);
-        pthread_mutex_unlock(&_int_ufunc_lock);
+        pthread_rwlock_unlock(&_int_variables_lock);
+        pthread_rwlock_unlock(&_int_ufunc_lock);
         return;
 
     default:
@@ -518,13 +394,38 @@ void tms_lock_evaluator(int variant)
     switch (variant)
     {
     case TMS_EVALUATOR:
-        pthread_mutex_lock(&_evaluator_lock);
-        pthread_mutex_lock(&_ufunc_lock);
+        _tms_stats_wrlock(&_evaluator_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_wrlock(&_variables_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_wrlock(&_ufunc_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        return;
+
+    case TMS_INT_EVALUATOR:
+        _tms_stats_wrlock(&_int_evaluator_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_wrlock(&_int_variables_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_wrlock(&_int_ufunc_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        return;
+
+    default:
+        fputs("libtmsolve: Error while locking evaluator: invalid ID...", stderr);
+        abort();
+    }
+}
+
+void tms_lock_evaluator_shared(int variant)
+{
+    // Same order as the exclusive lock
+    switch (variant)
+    {
+    case TMS_EVALUATOR:
+        _tms_stats_rdlock(&_evaluator_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_rdlock(&_variables_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_rdlock(&_ufunc_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
         return;
 
     case TMS_INT_EVALUATOR:
-        pthread_mutex_lock(&_int_evaluator_lock);
-        pthread_mutex_lock(&_int_ufunc_lock);
+        _tms_stats_rdlock(&_int_evaluator_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_rdlock(&_int_variables_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
+        _tms_stats_rdlock(&_int_ufunc_lock, TMS_STAT_EVALUATOR_LOCK_WAIT);
         return;
 
     default:
@@ -538,13 +439,15 @@ void tms_unlock_evaluator(int variant)
     switch (variant)
     {
     case TMS_EVALUATOR:
-        pthread_mutex_unlock(&_evaluator_lock);
-        pthread_mutex_unlock(&_ufunc_lock);
+        pthread_rwlock_unlock(&_evaluator_lock);
+        pthread_rwlock_unlock(&_variables_lock);
+        pthread_rwlock_unlock(&_ufunc_lock);
         return;
 
     case TMS_INT_EVALUATOR:
-        pthread_mutex_unlock(&_int_evaluator_lock);
-        pthread_mutex_unlock(&_int_ufunc_lock);
+        pthread_rwlock_unlock(&_int_evaluator_lock);
+        pthread_rwlock_unlock(&_int_variables_lock);
+        pthread_rwlock_unlock(&_int_ufunc_lock);
         return;
 
     default:
@@ -558,10 +461,10 @@ void tms_lock_vars(int variant)
     switch (variant)
     {
     case TMS_V_DOUBLE:
-        pthread_mutex_lock(&_variables_lock);
+        pthread_rwlock_wrlock(&_variables_lock);
         return;
     case TMS_V_INT64:
-        pthread_mutex_lock(&_int_variables_lock);
+        pthread_rwlock_wrlock(&_int_variables_lock);
         return;
 
     default:
@@ -575,10 +478,10 @@ void tms_unlock_vars(int variant)
     switch (variant)
     {
     case TMS_V_DOUBLE:
-        pthread_mutex_unlock(&_variables_lock);
+        pthread_rwlock_unlock(&_variables_lock);
         return;
     case TMS_V_INT64:
-        pthread_mutex_unlock(&_int_variables_lock);
+        pthread_rwlock_unlock(&_int_variables_lock);
         return;
 
     default:
@@ -592,10 +495,10 @@ void tms_lock_ufuncs(int variant)
     switch (variant)
     {
     case TMS_V_DOUBLE:
-        pthread_mutex_lock(&_ufunc_lock);
+        pthread_rwlock_wrlock(&_ufunc_lock);
         return;
     case TMS_V_INT64:
-        pthread_mutex_lock(&_int_ufunc_lock);
+        pthread_rwlock_wrlock(&_int_ufunc_lock);
         return;
 
     default:
@@ -609,10 +512,10 @@ void tms_unlock_ufuncs(int variant)
     switch (variant)
     {
     case TMS_V_DOUBLE:
-        pthread_mutex_unlock(&_ufunc_lock);
+        pthread_rwlock_unlock(&_ufunc_lock);
         return;
     case TMS_V_INT64:
-        pthread_mutex_unlock(&_int_ufunc_lock);
+        pthread_rwlock_unlock(&_int_ufunc_lock);
         return;
 
     default:
@@ -630,7 +533,7 @@ void tmsolve_reset()
     if (all_vars != NULL)
         for (size_t i = 0; i < len; ++i)
             if (!all_vars[i].is_constant)
-                hashmap_delete(var_hmap, all_vars + i);
+                tms_symtab_delete_and_free(var_hmap, all_vars[i].name);
     tms_g_ans = 0;
     free(all_vars);
     tms_unlock_vars(TMS_V_DOUBLE);
@@ -642,18 +545,24 @@ void tmsolve_reset()
     if (all_int_vars != NULL)
         for (size_t i = 0; i < len; ++i)
             if (!all_int_vars[i].is_constant)
-                hashmap_delete(int_var_hmap, all_int_vars + i);
+                tms_symtab_delete_and_free(int_var_hmap, all_int_vars[i].name);
     tms_g_int_ans = 0;
     free(all_int_vars);
     tms_unlock_vars(TMS_V_INT64);
 
     tms_lock_ufuncs(TMS_V_DOUBLE);
-    hashmap_clear(ufunc_hmap, true);
+    tms_symtab_clear(ufunc_hmap);
+    tms_close_catalog(ufunc_catalog);
+    ufunc_catalog = NULL;
     tms_unlock_ufuncs(TMS_V_DOUBLE);
 
     tms_lock_ufuncs(TMS_V_INT64);
-    hashmap_clear(int_ufunc_hmap, true);
+    tms_symtab_clear(int_ufunc_hmap);
+    tms_close_catalog(int_ufunc_catalog);
+    int_ufunc_catalog = NULL;
     tms_unlock_ufuncs(TMS_V_INT64);
+
+    tms_clear_matrix_vars();
 }
 
 int _tms_set_int_mask_nolock(int size_in_bits)
@@ -754,15 +663,15 @@ int _tms_set_var_unsafe(const char *name, double complex value, bool is_constant
         tmp_name = strdup(name);
 
     tms_var v = {.name = tmp_name, .value = value, .is_constant = is_constant};
-    hashmap_set(var_hmap, &v);
+    tms_symtab_set(var_hmap, &v);
     return 0;
 }
 
 int tms_set_var(const char *name, double complex value, bool is_constant)
 {
-    pthread_mutex_lock(&_variables_lock);
+    pthread_rwlock_wrlock(&_variables_lock);
     int status = _tms_set_var_unsafe(name, value, is_constant);
-    pthread_mutex_unlock(&_variables_lock);
+    pthread_rwlock_unlock(&_variables_lock);
     return status;
 }
 
@@ -805,15 +714,15 @@ int _tms_set_int_var_unsafe(const char *name, int64_t value, bool is_constant)
         tmp_name = strdup(name);
 
     tms_int_var v = {.name = tmp_name, .value = value, .is_constant = is_constant};
-    hashmap_set(int_var_hmap, &v);
+    tms_symtab_set(int_var_hmap, &v);
     return 0;
 }
 
 int tms_set_int_var(const char *name, int64_t value, bool is_constant)
 {
-    pthread_mutex_lock(&_int_variables_lock);
+    pthread_rwlock_wrlock(&_int_variables_lock);
     int status = _tms_set_int_var_unsafe(name, value, is_constant);
-    pthread_mutex_unlock(&_int_variables_lock);
+    pthread_rwlock_unlock(&_int_variables_lock);
     return status;
 }
 
@@ -972,9 +881,50 @@ bool _tms_ufunc_has_bad_refs(const char *fname)
     return false;
 }
 
-int tms_set_ufunction(const char *fname, const char *function_args, const char *function)
+// Opens a catalog of user functions and replaces the currently loaded one
+static int _tms_load_ufunc_catalog(const char *path, int type, int variant, tms_catalog **loaded)
+{
+    tms_catalog *C = NULL;
+    if (path != NULL)
+    {
+        C = tms_open_catalog(path);
+        if (C == NULL)
+            return -1;
+        if (tms_catalog_type(C) != type)
+        {
+            tms_save_error(TMS_GENERAL, CATALOG_TYPE_MISMATCH, EH_FATAL, NULL, 0);
+            tms_close_catalog(C);
+            return -1;
+        }
+        if (tms_catalog_count(C) > 0 && tms_catalog_get_name(C, 0) == NULL)
+        {
+            tms_save_error(TMS_GENERAL, CATALOG_NO_NAMES, EH_FATAL, NULL, 0);
+            tms_close_catalog(C);
+            return -1;
+        }
+    }
+
+    tms_lock_ufuncs(variant);
+    tms_close_catalog(*loaded);
+    *loaded = C;
+    tms_unlock_ufuncs(variant);
+    return 0;
+}
+
+int tms_load_ufunc_catalog(const char *path)
+{
+    return _tms_load_ufunc_catalog(path, TMS_CATALOG_SCIENTIFIC, TMS_V_DOUBLE, &ufunc_catalog);
+}
+
+int tms_load_int_ufunc_catalog(const char *path)
 {
-    const tms_ufunc *old = tms_get_ufunc_by_name(fname);
+    return _tms_load_ufunc_catalog(path, TMS_CATALOG_INT, TMS_V_INT64, &int_ufunc_catalog);
+}
+
+int _tms_set_ufunction_unsafe(const char *fname, const char *function_args, const char *function)
+{
+    // Functions from the catalog are read-only, a function with the same name shadows them
+    const tms_ufunc *old = tms_symtab_get(ufunc_hmap, fname);
 
     // Skip name related verification if it already exists
     if (old == NULL)
@@ -1038,7 +988,7 @@ int tms_set_ufunction(const char *fname, const char *function_args, const char *
             return -1;
         }
     }
-    tms_math_expr *new = tms_parse_expr(function, ENABLE_CMPLX, arg_list);
+    tms_math_expr *new = tms_parse_expr(function, ENABLE_CMPLX | NO_LOCK, arg_list);
 
     if (new == NULL)
         return -1;
@@ -1052,13 +1002,13 @@ int tms_set_ufunction(const char *fname, const char *function_args, const char *
 
         tms_ufunc tmp = {.F = new, .name = old->name};
 
-        // We need to update the hashmap because the function checks will lookup the name in the hashmap
+        // We need to update the symbol table because the function checks will lookup the name in it
         // otherwise we will get the old function checked instead
-        hashmap_set(ufunc_hmap, &tmp);
+        tms_symtab_set(ufunc_hmap, &tmp);
         if (_tms_ufunc_has_bad_refs(fname))
         {
             // Restore the original function since the new one is problematic
-            hashmap_set(ufunc_hmap, &old_F);
+            tms_symtab_set(ufunc_hmap, &old_F);
             tms_delete_math_expr(tmp.F);
             return -1;
         }
@@ -1071,12 +1021,21 @@ int tms_set_ufunction(const char *fname, const char *function_args, const char *
     else
     {
         tms_ufunc tmp = {.F = new, .name = strdup(fname)};
-        hashmap_set(ufunc_hmap, &tmp);
+        tms_symtab_set(ufunc_hmap, &tmp);
         return 0;
     }
     return -1;
 }
 
+int tms_set_ufunction(const char *fname, const char *function_args, const char *function)
+{
+    // The parser lock excludes the evaluations, which may be calling the replaced function
+    tms_lock_parser(TMS_PARSER);
+    int status = _tms_set_ufunction_unsafe(fname, function_args, function);
+    tms_unlock_parser(TMS_PARSER);
+    return status;
+}
+
 // Get all user defined functions
 hashset *get_all_int_ufunc_references(const char *fname)
 {
@@ -1232,9 +1191,10 @@ bool _tms_int_ufunc_has_bad_refs(const char *fname)
     return false;
 }
 
-int tms_set_int_ufunction(const char *fname, const char *function_args, const char *function)
+int _tms_set_int_ufunction_unsafe(const char *fname, const char *function_args, const char *function)
 {
-    const tms_int_ufunc *old = tms_get_int_ufunc_by_name(fname);
+    // Functions from the catalog are read-only, a function with the same name shadows them
+    const tms_int_ufunc *old = tms_symtab_get(int_ufunc_hmap, fname);
 
     // Skip name related verification if it already exists
     if (old == NULL)
@@ -1297,7 +1257,7 @@ int tms_set_int_ufunction(const char *fname, const char *function_args, const ch
             return -1;
         }
     }
-    tms_int_expr *new = tms_parse_int_expr(function, 0, arg_list);
+    tms_int_expr *new = tms_parse_int_expr(function, NO_LOCK, arg_list);
 
     if (new == NULL)
         return -1;
@@ -1311,13 +1271,13 @@ int tms_set_int_ufunction(const char *fname, const char *function_args, const ch
 
         tms_int_ufunc tmp = {.F = new, .name = old->name};
 
-        // We need to update the hashmap because the function checks will lookup the name in the hashmap
+        // We need to update the symbol table because the function checks will lookup the name in it
         // otherwise we will get the old function checked instead
-        hashmap_set(int_ufunc_hmap, &tmp);
+        tms_symtab_set(int_ufunc_hmap, &tmp);
         if (_tms_int_ufunc_has_bad_refs(fname))
         {
             // Restore the original function since the new one is problematic
-            hashmap_set(int_ufunc_hmap, &old_F);
+            tms_symtab_set(int_ufunc_hmap, &old_F);
             tms_delete_int_expr(tmp.F);
             return -1;
         }
@@ -1330,15 +1290,24 @@ int tms_set_int_ufunction(const char *fname, const char *function_args, const ch
     else
     {
         tms_int_ufunc tmp = {.F = new, .name = strdup(fname)};
-        hashmap_set(int_ufunc_hmap, &tmp);
+        tms_symtab_set(int_ufunc_hmap, &tmp);
         return 0;
     }
     return -1;
 }
+
+int tms_set_int_ufunction(const char *fname, const char *function_args, const char *function)
+{
+    tms_lock_parser(TMS_INT_PARSER);
+    int status = _tms_set_int_ufunction_unsafe(fname, function_args, function);
+    tms_unlock_parser(TMS_INT_PARSER);
+    return status;
+}
+
 char **tms_smode_autocompletion_helper(const char *name)
 {
     size_t max_count =
-        array_length(tms_g_rc_func) + array_length(tms_g_extf) + hashmap_count(ufunc_hmap) + hashmap_count(var_hmap);
+        array_length(tms_g_rc_func) + array_length(tms_g_extf) + tms_symtab_count(ufunc_hmap) + tms_symtab_count(var_hmap);
     size_t i, next = 0;
     // +1 for the extra NULL
     char **matches = malloc((max_count + 1) * sizeof(char *));
@@ -1355,14 +1324,14 @@ char **tms_smode_autocompletion_helper(const char *name)
 
     // User functions
     size_t count;
-    tms_ufunc *ufuncs = hashmap_to_array(ufunc_hmap, &count, true);
+    tms_ufunc *ufuncs = tms_symtab_to_array(ufunc_hmap, &count, true);
     if (ufuncs != NULL)
         for (i = 0; i < count; ++i)
             if (_tms_string_is_prefix(ufuncs[i].name, name))
                 matches[next++] = tms_strcat_dup(ufuncs[i].name, "(");
 
     // Variables
-    tms_var *vars = hashmap_to_array(var_hmap, &count, true);
+    tms_var *vars = tms_symtab_to_array(var_hmap, &count, true);
     if (vars != NULL)
         for (i = 0; i < count; ++i)
             if (_tms_string_is_prefix(vars[i].name, name))
@@ -1378,8 +1347,8 @@ char **tms_smode_autocompletion_helper(const char *name)
 
 char **tms_imode_autocompletion_helper(const char *name)
 {
-    size_t max_count = array_length(tms_g_int_func) + array_length(tms_g_int_extf) + hashmap_count(int_ufunc_hmap) +
-                       hashmap_count(int_var_hmap);
+    size_t max_count = array_length(tms_g_int_func) + array_length(tms_g_int_extf) + tms_symtab_count(int_ufunc_hmap) +
+                       tms_symtab_count(int_var_hmap);
     size_t i, next = 0;
     // +1 for the extra NULL
     char **matches = malloc((max_count + 1) * sizeof(char *));
@@ -1396,14 +1365,14 @@ char **tms_imode_autocompletion_helper(const char *name)
 
     // User functions
     size_t count;
-    tms_int_ufunc *int_ufuncs = hashmap_to_array(int_ufunc_hmap, &count, true);
+    tms_int_ufunc *int_ufuncs = tms_symtab_to_array(int_ufunc_hmap, &count, true);
     if (int_ufuncs != NULL)
         for (i = 0; i < count; ++i)
             if (_tms_string_is_prefix(int_ufuncs[i].name, name))
                 matches[next++] = tms_strcat_dup(int_ufuncs[i].name, "(");
 
     // Variables
-    tms_int_var *int_vars = hashmap_to_array(int_var_hmap, &count, true);
+    tms_int_var *int_vars = tms_symtab_to_array(int_var_hmap, &count, true);
     if (int_vars != NULL)
         for (i = 0; i < count; ++i)
             if (_tms_string_is_prefix(int_vars[i].name, name))
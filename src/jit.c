@@ -0,0 +1,522 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "jit.h"
+#include "error_handler.h"
+#include "internals.h"
+#include "tms_complex.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+// Signature of the compiled function: operands read from memory, function pointers, and answer
+typedef int (*tms_jit_entry)(cdouble *const *in, void *const *fn, cdouble *out);
+
+struct tms_jit_code
+{
+    void *handle;
+    // NULL if the compilation failed, the evaluator is used
+    tms_jit_entry run;
+    cdouble **in;
+    void **fn;
+};
+
+int tms_jit_threshold = 0;
+
+void tms_set_jit_threshold(int threshold)
+{
+    tms_jit_threshold = (threshold > 0 ? threshold : 0);
+}
+
+int tms_get_jit_threshold()
+{
+    return tms_jit_threshold;
+}
+
+void tms_jit_free(struct tms_jit_code *J)
+{
+    if (J == NULL)
+        return;
+#ifndef _WIN32
+    if (J->handle != NULL)
+        dlclose(J->handle);
+#endif
+    free(J->in);
+    free(J->fn);
+    free(J);
+}
+
+#ifndef _WIN32
+
+// Address range of the nodes of a subexpression
+typedef struct _tms_jit_range
+{
+    uintptr_t start, end;
+    int s;
+} _tms_jit_range;
+
+// State of the code generator
+typedef struct _tms_jit_gen
+{
+    FILE *out;
+    tms_math_expr *M;
+    // Sorted ranges of the nodes arrays, used to find the node owning an operand
+    _tms_jit_range *ranges;
+    int r_count;
+    // Local variable holding the current value of each operand (-1 if the value is in memory)
+    int **left_var, **right_var;
+    int answer_var;
+    int var_count;
+    cdouble **in;
+    int in_count;
+    void **fn;
+    int fn_count;
+} _tms_jit_gen;
+
+static int _tms_jit_compare_ranges(const void *a, const void *b)
+{
+    uintptr_t start_a = ((_tms_jit_range *)a)->start, start_b = ((_tms_jit_range *)b)->start;
+    if (start_a < start_b)
+        return -1;
+    else if (start_a > start_b)
+        return 1;
+    else
+        return 0;
+}
+
+// Returns a pointer to the variable tracking the operand at "slot", NULL if it isn't a node operand or the answer
+static int *_tms_jit_slot_var(_tms_jit_gen *G, cdouble *slot)
+{
+    if (slot == &(G->M->answer))
+        return &(G->answer_var);
+
+    uintptr_t p = (uintptr_t)slot;
+    int low = 0, high = G->r_count - 1;
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        if (p < G->ranges[mid].start)
+            high = mid - 1;
+        else if (p >= G->ranges[mid].end)
+            low = mid + 1;
+        else
+        {
+            int s = G->ranges[mid].s, n = (p - G->ranges[mid].start) / sizeof(tms_op_node);
+            tms_op_node *N = G->M->S[s].nodes + n;
+            if (slot == &(N->left_operand))
+                return &(G->left_var[s][n]);
+            else if (slot == &(N->right_operand))
+                return &(G->right_var[s][n]);
+            else
+                return NULL;
+        }
+    }
+    return NULL;
+}
+
+// Writes the C expression of the operand value at "slot"
+static void _tms_jit_read(_tms_jit_gen *G, cdouble *slot)
+{
+    int *var = _tms_jit_slot_var(G, slot);
+    if (var != NULL && *var != -1)
+        fprintf(G->out, "v%d", *var);
+    else
+    {
+        // Not computed by the expression (a number or a label), read from memory at each run
+        G->in[G->in_count] = slot;
+        fprintf(G->out, "(*in[%d])", G->in_count++);
+    }
+}
+
+// Declares a new variable receiving the value of the operand at "slot"
+static int _tms_jit_write(_tms_jit_gen *G, cdouble *slot)
+{
+    int *var = _tms_jit_slot_var(G, slot);
+    if (var == NULL)
+        return -1;
+    *var = G->var_count++;
+    fprintf(G->out, "    cd v%d = ", *var);
+    return *var;
+}
+
+static int _tms_jit_add_fn(_tms_jit_gen *G, void *ptr)
+{
+    G->fn[G->fn_count] = ptr;
+    return G->fn_count++;
+}
+
+// Generates the code of a node, same operations and checks as the evaluator
+static int _tms_jit_gen_node(_tms_jit_gen *G, tms_op_node *N)
+{
+    FILE *out = G->out;
+    int v;
+
+    if (N->result == NULL)
+        return -1;
+
+    switch (N->op)
+    {
+    case '+':
+    case '-':
+    case '*':
+        v = _tms_jit_write(G, N->result);
+        if (v == -1)
+            return -1;
+        _tms_jit_read(G, &(N->left_operand));
+        fprintf(out, " %c ", N->op);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs(";\n", out);
+        break;
+
+    case '/':
+    case 'd':
+        fputs("    if (", out);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs(" == 0)\n        return 1;\n", out);
+        v = _tms_jit_write(G, N->result);
+        if (v == -1)
+            return -1;
+        if (N->op == 'd')
+            fprintf(out, "((cd(*)(cd))fn[%d])(", _tms_jit_add_fn(G, tms_round_to_zero));
+        _tms_jit_read(G, &(N->left_operand));
+        fputs(" / ", out);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs(N->op == 'd' ? ");\n" : ";\n", out);
+        break;
+
+    case '%':
+        fputs("    if (", out);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs(" == 0 || cimag(", out);
+        _tms_jit_read(G, &(N->left_operand));
+        fputs(") != 0 || cimag(", out);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs(") != 0)\n        return 1;\n", out);
+        v = _tms_jit_write(G, N->result);
+        if (v == -1)
+            return -1;
+        fputs("fmod(creal(", out);
+        _tms_jit_read(G, &(N->left_operand));
+        fputs("), creal(", out);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs("));\n", out);
+        break;
+
+    case '^':
+    case 'p':
+        v = _tms_jit_write(G, N->result);
+        if (v == -1)
+            return -1;
+        if (G->M->enable_complex == false)
+            fputs("pow(creal(", out);
+        else
+            fprintf(out, "((cd(*)(cd, cd))fn[%d])((", _tms_jit_add_fn(G, tms_cpow));
+        _tms_jit_read(G, &(N->left_operand));
+        fputs(G->M->enable_complex == false ? "), creal(" : "), (", out);
+        _tms_jit_read(G, &(N->right_operand));
+        fputs("));\n", out);
+        break;
+
+    default:
+        return -1;
+    }
+    fprintf(out, "    if (isnan(creal(v%d)) || isnan(cimag(v%d)))\n        return 1;\n", v, v);
+    return 0;
+}
+
+/*
+Writes the C source of the expression, returns 0 on success, -1 if the expression isn't supported or -2 if memory
+allocation failed.
+*/
+static int _tms_jit_generate(_tms_jit_gen *G)
+{
+    tms_math_expr *M = G->M;
+    tms_math_subexpr *S = M->S;
+    FILE *out = G->out;
+    int s, n, node_count, total_nodes = 0;
+
+    for (s = 0; s < M->subexpr_count; ++s)
+    {
+        if (S[s].nodes == NULL || (S[s].func_type != TMS_NOFUNC && S[s].func_type != TMS_F_REAL &&
+                                   S[s].func_type != TMS_F_CMPLX))
+            return -1;
+        node_count = (S[s].op_count > 0 ? S[s].op_count : 1);
+        total_nodes += node_count;
+        G->left_var[s] = malloc(node_count * sizeof(int));
+        G->right_var[s] = malloc(node_count * sizeof(int));
+        if (G->left_var[s] == NULL || G->right_var[s] == NULL)
+            return -2;
+        for (n = 0; n < node_count; ++n)
+            G->left_var[s][n] = G->right_var[s][n] = -1;
+        G->ranges[G->r_count++] =
+            (_tms_jit_range){(uintptr_t)S[s].nodes, (uintptr_t)(S[s].nodes + node_count), s};
+        if (total_nodes > TMS_JIT_MAX_NODES)
+            return -1;
+    }
+    qsort(G->ranges, G->r_count, sizeof(_tms_jit_range), _tms_jit_compare_ranges);
+
+    // A node reads at most 5 operands (modulo checks), single operand subexpressions and the answer read one
+    G->in = malloc((5 * total_nodes + M->subexpr_count + 1) * sizeof(cdouble *));
+    G->fn = malloc((total_nodes + M->subexpr_count) * sizeof(void *));
+    if (G->in == NULL || G->fn == NULL)
+        return -2;
+
+    fputs("#include <complex.h>\n#include <math.h>\ntypedef double complex cd;\n"
+          "int tms_jit_entry(cd *const *in, void *const *fn, cd *out)\n{\n",
+          out);
+
+    for (s = 0; s < M->subexpr_count; ++s)
+    {
+        tms_op_node *N = S[s].nodes + S[s].start_node;
+        cdouble *slot = *(S[s].result);
+        int v;
+
+        if (S[s].op_count == 0)
+        {
+            if (N->result == NULL)
+                return -1;
+            v = _tms_jit_write(G, N->result);
+            if (v == -1)
+                return -1;
+            _tms_jit_read(G, &(N->left_operand));
+            fputs(";\n", out);
+        }
+        else
+        {
+            for (; N != NULL; N = N->next)
+                if (_tms_jit_gen_node(G, N) != 0)
+                    return -1;
+        }
+
+        // Function call on the subexpression answer
+        if (S[s].func_type != TMS_NOFUNC)
+        {
+            int f = _tms_jit_add_fn(G, (S[s].func_type == TMS_F_REAL ? (void *)S[s].func.real : (void *)S[s].func.cmplx));
+            int *var = _tms_jit_slot_var(G, slot);
+            if (var == NULL || *var == -1)
+                return -1;
+            int previous = *var;
+            _tms_jit_write(G, slot);
+            if (S[s].func_type == TMS_F_REAL)
+                fprintf(out, "((double(*)(double))fn[%d])(creal(v%d));\n", f, previous);
+            else
+                fprintf(out, "((cd(*)(cd))fn[%d])(v%d);\n", f, previous);
+        }
+
+        int *var = _tms_jit_slot_var(G, slot);
+        if (var == NULL || *var == -1)
+            return -1;
+        // The last node already checked its result if there is no function call
+        if (S[s].func_type != TMS_NOFUNC || S[s].op_count == 0)
+            fprintf(out, "    if (isnan(creal(v%d)) || isnan(cimag(v%d)))\n        return 1;\n", *var, *var);
+    }
+
+    fputs("    *out = ", out);
+    _tms_jit_read(G, &(M->answer));
+    fputs(";\n    return 0;\n}\n", out);
+    return 0;
+}
+
+/*
+Runs the compiler without a shell, the paths are passed as they are and the signal handlers of the host are unchanged.
+Returns 0 if it exited successfully.
+*/
+static int _tms_jit_run_cc(const char *cc, const char *so_path, const char *c_path)
+{
+    // No contraction to FMA, the evaluator rounds after each operation
+    char *const argv[] = {
+        (char *)cc, "-O2", "-fPIC", "-shared", "-ffp-contract=off", "-o", (char *)so_path, (char *)c_path, "-lm", NULL};
+    posix_spawn_file_actions_t actions;
+    pid_t pid;
+    int status, error;
+
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        return -1;
+    // The compiler output is not shown to the host
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    error = posix_spawnp(&pid, cc, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0)
+        return -1;
+
+    while (waitpid(pid, &status, 0) == -1)
+        if (errno != EINTR)
+            return -1;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1);
+}
+
+// Builds the generated source as a shared module and loads it
+static int _tms_jit_build(struct tms_jit_code *J, const char *source, size_t size)
+{
+    const char *tmp_dir = getenv("TMPDIR"), *cc = getenv("TMS_JIT_CC");
+    if (tmp_dir == NULL)
+        tmp_dir = "/tmp";
+    if (cc == NULL)
+        cc = "cc";
+
+    size_t dir_len = strlen(tmp_dir) + 32;
+    char dir[dir_len], c_path[dir_len + 8], so_path[dir_len + 8];
+    snprintf(dir, dir_len, "%s/tms_jit_XXXXXX", tmp_dir);
+    if (mkdtemp(dir) == NULL)
+        return -1;
+    snprintf(c_path, sizeof(c_path), "%s/expr.c", dir);
+    snprintf(so_path, sizeof(so_path), "%s/expr.so", dir);
+
+    FILE *c_file = fopen(c_path, "w");
+    bool failed = (c_file == NULL);
+    if (!failed)
+        failed = (fwrite(source, 1, size, c_file) != size) | (fclose(c_file) != 0);
+
+    if (!failed)
+        failed = (_tms_jit_run_cc(cc, so_path, c_path) != 0);
+
+    if (!failed)
+    {
+        J->handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+        if (J->handle != NULL)
+            *(void **)(&J->run) = dlsym(J->handle, "tms_jit_entry");
+        failed = (J->run == NULL);
+    }
+
+    // The module remains mapped after removing the files
+    remove(c_path);
+    remove(so_path);
+    rmdir(dir);
+    return (failed ? -1 : 0);
+}
+
+int tms_jit_compile(tms_math_expr *M)
+{
+    if (M == NULL)
+        return -1;
+
+    tms_jit_free(M->jit);
+    M->jit = NULL;
+
+    _tms_jit_gen G = {.M = M, .answer_var = -1};
+    G.ranges = malloc(M->subexpr_count * sizeof(_tms_jit_range));
+    G.left_var = calloc(M->subexpr_count, sizeof(int *));
+    G.right_var = calloc(M->subexpr_count, sizeof(int *));
+    struct tms_jit_code *J = calloc(1, sizeof(struct tms_jit_code));
+
+    char *source = NULL;
+    size_t size = 0;
+    int status = -2;
+    if (G.ranges != NULL && G.left_var != NULL && G.right_var != NULL && J != NULL)
+        G.out = open_memstream(&source, &size);
+    if (G.out != NULL)
+    {
+        status = _tms_jit_generate(&G);
+        // The buffer is only complete once the stream is closed
+        if (fclose(G.out) != 0 && status == 0)
+            status = -2;
+    }
+
+    if (status == 0)
+        status = _tms_jit_build(J, source, size);
+
+    if (status == 0)
+    {
+        J->in = G.in;
+        J->fn = G.fn;
+    }
+    else
+    {
+        free(G.in);
+        free(G.fn);
+        if (J != NULL && J->handle != NULL)
+            dlclose(J->handle);
+        // Out of memory: no code, another attempt can succeed
+        if (status == -2)
+        {
+            free(J);
+            J = NULL;
+        }
+        // Keep the empty structure to avoid retrying
+        else
+        {
+            J->handle = NULL;
+            J->run = NULL;
+        }
+        status = -1;
+    }
+
+    if (G.left_var != NULL && G.right_var != NULL)
+    {
+        for (int s = 0; s < M->subexpr_count; ++s)
+        {
+            free(G.left_var[s]);
+            free(G.right_var[s]);
+        }
+    }
+    free(G.left_var);
+    free(G.right_var);
+    free(G.ranges);
+    free(source);
+    // Published once complete, concurrent evaluations use the evaluator until then
+    __atomic_store_n(&M->jit, J, __ATOMIC_RELEASE);
+    return status;
+}
+
+#else
+
+int tms_jit_compile(tms_math_expr *M)
+{
+    if (M == NULL)
+        return -1;
+
+    // No JIT support on this platform, the empty structure disables further attempts
+    tms_jit_free(M->jit);
+    __atomic_store_n(&M->jit, calloc(1, sizeof(struct tms_jit_code)), __ATOMIC_RELEASE);
+    return -1;
+}
+
+#endif
+
+int _tms_jit_evaluate(tms_math_expr *M, cdouble *result)
+{
+    // The debug dump shows the nodes values, which are only set by the evaluator
+    if (M == NULL || tms_jit_threshold == 0 || _tms_debug)
+        return -1;
+
+    struct tms_jit_code *J = __atomic_load_n(&M->jit, __ATOMIC_ACQUIRE);
+    if (J == NULL)
+    {
+        // Only the thread that claims the count compiles, the count stays negative and the others use the evaluator
+        int count = __atomic_add_fetch(&M->eval_count, 1, __ATOMIC_RELAXED);
+        if (count < tms_jit_threshold ||
+            !__atomic_compare_exchange_n(&M->eval_count, &count, INT_MIN, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return -1;
+        tms_jit_compile(M);
+        J = __atomic_load_n(&M->jit, __ATOMIC_ACQUIRE);
+    }
+
+    if (J == NULL || J->run == NULL)
+        return -1;
+
+    cdouble answer;
+    if (J->run(J->in, J->fn, &answer) != 0)
+    {
+        // Errors are reported by the evaluator, drop any error saved by functions called from the compiled code
+        tms_clear_errors(TMS_EVALUATOR | TMS_PARSER);
+        return -1;
+    }
+    M->answer = answer;
+    *result = answer;
+    return 0;
+}
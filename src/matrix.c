@@ -1,32 +1,77 @@
 /*
-Copyright (C) 2021-2024 Ahmad Ismail
+Copyright (C) 2021-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 #include "matrix.h"
 #include "error_handler.h"
 #include "m_errors.h"
+#include "thread_pool.h"
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Allocates the storage of a matrix, aligned to TMS_MATRIX_ALIGNMENT
+static double *_tms_matrix_alloc(size_t count)
+{
+    size_t size = count * sizeof(double);
+    // aligned_alloc() requires a size multiple of the alignment
+    size = (size / TMS_MATRIX_ALIGNMENT + 1) * TMS_MATRIX_ALIGNMENT;
+#ifdef _WIN32
+    return _aligned_malloc(size, TMS_MATRIX_ALIGNMENT);
+#else
+    return aligned_alloc(TMS_MATRIX_ALIGNMENT, size);
+#endif
+}
+
+static void _tms_matrix_free(double *data)
+{
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
 tms_matrix *tms_new_matrix(int rows, int columns)
 {
     tms_matrix *matrix;
     matrix = malloc(sizeof(tms_matrix));
     matrix->columns = columns;
     matrix->rows = rows;
-    matrix->data = malloc(rows * sizeof(double *));
-    for (int i = 0; i < rows; ++i)
-        matrix->data[i] = malloc(columns * sizeof(double));
+    matrix->stride = columns;
+    matrix->owns_data = true;
+    matrix->data = _tms_matrix_alloc((size_t)rows * columns);
     return matrix;
 }
+
+tms_matrix *tms_wrap_matrix(double *data, int rows, int columns, int stride)
+{
+    tms_matrix *matrix;
+    if (data == NULL || rows < 0 || columns < 0 || stride < columns)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    matrix = malloc(sizeof(tms_matrix));
+    matrix->columns = columns;
+    matrix->rows = rows;
+    matrix->stride = stride;
+    matrix->owns_data = false;
+    matrix->data = data;
+    return matrix;
+}
+
 // Delete a matrix structure
 void tms_delete_matrix(tms_matrix *matrix)
 {
-    for (int i = 0; i < matrix->rows; ++i)
-        free(matrix->data[i]);
-    free(matrix->data);
+    if (matrix->owns_data)
+        _tms_matrix_free(matrix->data);
     free(matrix);
 }
 
@@ -44,7 +89,7 @@ tms_matrix *tms_remove_matrix_row_col(tms_matrix *M, int row, int col)
             if (parent_col == col)
                 continue;
             else
-                new_M->data[derived_row][derived_col++] = M->data[parent_row][parent_col];
+                TMS_MATRIX_ROW(new_M, derived_row)[derived_col++] = TMS_MATRIX_ROW(M, parent_row)[parent_col];
         }
         ++derived_row;
     }
@@ -54,48 +99,218 @@ tms_matrix *tms_remove_matrix_row_col(tms_matrix *M, int row, int col)
 void tms_round_to_identity_matrix(tms_matrix *M)
 {
     int row, column;
-    // Detect the all ones diagonal
+    if (M->rows != M->columns)
+        return;
+
+    // Check all the members first, the matrix is left unchanged if it isn't close to the identity matrix
     for (row = 0; row < M->rows; ++row)
-    {
-        column = row;
-        if (fabs(1 - round(M->data[row][column])) < 1e-14)
-            M->data[row][column] = 1;
-        else
-            return;
-    }
+        for (column = 0; column < M->columns; ++column)
+            if (fabs(TMS_MATRIX_ROW(M, row)[column] - (row == column)) >= 1e-14)
+                return;
 
     for (row = 0; row < M->rows; ++row)
         for (column = 0; column < M->columns; ++column)
+            TMS_MATRIX_ROW(M, row)[column] = (row == column);
+}
+
+/*
+ * Matrix multiplication kernel, follows the usual blocked GEMM structure:
+ * B is packed by panels of TMS_GEMM_KC rows and TMS_GEMM_NC columns, A by blocks of TMS_GEMM_MC rows,
+ * then a micro-kernel computes TMS_GEMM_MR*TMS_GEMM_NR tiles of the result while keeping them in registers.
+ */
+
+// Rows and columns of a result tile computed by the micro-kernel
+#define TMS_GEMM_MR 6
+#define TMS_GEMM_NR 8
+// Cache blocking: A blocks of MC*KC stay in L2, B panels of KC*NC in L3
+#define TMS_GEMM_MC 96
+#define TMS_GEMM_KC 256
+#define TMS_GEMM_NC 4096
+// Below this number of multiply-adds, splitting the product isn't worth it
+#define TMS_GEMM_MT_THRESHOLD (1 << 21)
+
+// Number of parts of the products run by the thread pool, 0 for its number of threads
+int tms_matrix_threads = 0;
+
+void tms_set_matrix_threads(int count)
+{
+    tms_matrix_threads = (count < 0 ? 0 : count);
+}
+
+int tms_get_matrix_threads()
+{
+    if (tms_matrix_threads != 0)
+        return tms_matrix_threads;
+    return tms_get_thread_count();
+}
+
+#if defined(__GNUC__)
+// One row of a tile, GCC/Clang lower it to AVX-512, AVX or SSE2 instructions depending on the target
+typedef double _tms_gemm_row __attribute__((vector_size(TMS_GEMM_NR * sizeof(double))));
+
+// The micro-kernel is compiled for each instruction set, the best one is selected at load time.
+// Not with ThreadSanitizer, the IFUNC resolver runs before it is initialized and crashes the program.
+#if defined(__x86_64__) && defined(__ELF__) && !defined(__clang__) && !defined(__SANITIZE_THREAD__)
+#define _TMS_GEMM_CLONES __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+#define _TMS_GEMM_CLONES
+#endif
+
+// Computes C += A*B for a tile, A and B are packed, only the first m rows and n columns of the tile are stored
+_TMS_GEMM_CLONES static void _tms_gemm_kernel(int kc, const double *A, const double *B, double *C, int ldc, int m, int n)
+{
+    _tms_gemm_row acc[TMS_GEMM_MR] = {0}, b;
+    int i, j, p;
+
+    for (p = 0; p < kc; ++p)
+    {
+        b = *(const _tms_gemm_row *)(B + p * TMS_GEMM_NR);
+        // Unrolled so the accumulators stay in registers
+#pragma GCC unroll 16
+        for (i = 0; i < TMS_GEMM_MR; ++i)
+            acc[i] += A[p * TMS_GEMM_MR + i] * b;
+    }
+
+    for (i = 0; i < m; ++i)
+        for (j = 0; j < n; ++j)
+            C[i * ldc + j] += acc[i][j];
+}
+#else
+static void _tms_gemm_kernel(int kc, const double *A, const double *B, double *C, int ldc, int m, int n)
+{
+    double acc[TMS_GEMM_MR][TMS_GEMM_NR] = {{0}};
+    int i, j, p;
+
+    for (p = 0; p < kc; ++p)
+        for (i = 0; i < TMS_GEMM_MR; ++i)
+            for (j = 0; j < TMS_GEMM_NR; ++j)
+                acc[i][j] += A[p * TMS_GEMM_MR + i] * B[p * TMS_GEMM_NR + j];
+
+    for (i = 0; i < m; ++i)
+        for (j = 0; j < n; ++j)
+            C[i * ldc + j] += acc[i][j];
+}
+#endif
+
+// Packs rows [row, row + mc) and columns [col, col + kc) of A by strips of MR rows, stored column by column
+static void _tms_gemm_pack_A(tms_matrix *A, int row, int col, int mc, int kc, double *packed)
+{
+    int i, ir, p;
+    for (ir = 0; ir < mc; ir += TMS_GEMM_MR)
+        for (p = 0; p < kc; ++p)
+            for (i = 0; i < TMS_GEMM_MR; ++i)
+                *(packed++) = (ir + i < mc ? TMS_MATRIX_ROW(A, row + ir + i)[col + p] : 0);
+}
+
+// Packs rows [row, row + kc) and columns [col, col + nc) of B by strips of NR columns, stored row by row
+static void _tms_gemm_pack_B(tms_matrix *B, int row, int col, int kc, int nc, double *packed)
+{
+    int j, jr, p;
+    for (jr = 0; jr < nc; jr += TMS_GEMM_NR)
+        for (p = 0; p < kc; ++p)
         {
-            if (row == column)
-                continue;
-            else if (fabs(M->data[row][column]) < 1e-14)
-                M->data[row][column] = 0;
-            else
-                return;
+            const double *src = TMS_MATRIX_ROW(B, row + p) + col + jr;
+            for (j = 0; j < TMS_GEMM_NR; ++j)
+                *(packed++) = (jr + j < nc ? src[j] : 0);
+        }
+}
+
+// Rows of the result computed by one range of parts, the matrices are tms_matrix or tms_cmatrix depending on the worker
+typedef struct _tms_gemm_job
+{
+    void *A, *B, *C;
+    int first_row, last_row;
+} _tms_gemm_job;
+
+// Product split in parts of whole tiles, run by the thread pool
+typedef struct _tms_gemm_parts
+{
+    void (*worker)(_tms_gemm_job *);
+    void *A, *B, *C;
+    int rows, tile_rows, tiles, count;
+} _tms_gemm_parts;
+
+// Computes rows [first_row, last_row) of C = A*B, C should be zeroed
+static void _tms_gemm(_tms_gemm_job *job)
+{
+    tms_matrix *A = job->A, *B = job->B, *C = job->C;
+    int M = job->last_row, N = B->columns, K = A->columns;
+    int ic, jc, pc, ir, jr, mc, nc, kc;
+    double *packed_A = _tms_matrix_alloc(TMS_GEMM_MC * TMS_GEMM_KC);
+    double *packed_B = _tms_matrix_alloc(TMS_GEMM_KC * TMS_GEMM_NC);
+
+    for (jc = 0; jc < N; jc += TMS_GEMM_NC)
+    {
+        nc = (N - jc < TMS_GEMM_NC ? N - jc : TMS_GEMM_NC);
+        for (pc = 0; pc < K; pc += TMS_GEMM_KC)
+        {
+            kc = (K - pc < TMS_GEMM_KC ? K - pc : TMS_GEMM_KC);
+            _tms_gemm_pack_B(B, pc, jc, kc, nc, packed_B);
+            for (ic = job->first_row; ic < M; ic += TMS_GEMM_MC)
+            {
+                mc = (M - ic < TMS_GEMM_MC ? M - ic : TMS_GEMM_MC);
+                _tms_gemm_pack_A(A, ic, pc, mc, kc, packed_A);
+                for (jr = 0; jr < nc; jr += TMS_GEMM_NR)
+                    for (ir = 0; ir < mc; ir += TMS_GEMM_MR)
+                        _tms_gemm_kernel(kc, packed_A + ir * kc, packed_B + jr * kc,
+                                         TMS_MATRIX_ROW(C, ic + ir) + jc + jr, C->stride,
+                                         (mc - ir < TMS_GEMM_MR ? mc - ir : TMS_GEMM_MR),
+                                         (nc - jr < TMS_GEMM_NR ? nc - jr : TMS_GEMM_NR));
+            }
         }
+    }
+    _tms_matrix_free(packed_A);
+    _tms_matrix_free(packed_B);
+}
+
+// Computes the rows of parts [begin, end)
+static void _tms_gemm_range(void *arg, size_t begin, size_t end)
+{
+    _tms_gemm_parts *P = arg;
+    _tms_gemm_job job = {P->A, P->B, P->C, (long long)P->tiles * begin / P->count * P->tile_rows,
+                         (long long)P->tiles * end / P->count * P->tile_rows};
+    if (job.last_row > P->rows)
+        job.last_row = P->rows;
+    P->worker(&job);
+}
+
+// Runs the worker on the rows of C, split in parts of whole tiles of "tile_rows" if the product is large enough
+static void _tms_gemm_run(void (*worker)(_tms_gemm_job *), void *A, void *B, void *C, int rows, int tile_rows,
+                          double madds)
+{
+    int threads = tms_get_matrix_threads(), tiles = (rows + tile_rows - 1) / tile_rows;
+    if (madds < TMS_GEMM_MT_THRESHOLD)
+        threads = 1;
+    if (threads > tiles)
+        threads = tiles;
+
+    if (threads <= 1)
+    {
+        _tms_gemm_job job = {A, B, C, 0, rows};
+        worker(&job);
+        return;
+    }
+
+    // Each part packs its own panels of B, the parts are as large as possible
+    _tms_gemm_parts P = {worker, A, B, C, rows, tile_rows, tiles, threads};
+    tms_parallel_for(threads, 1, _tms_gemm_range, &P);
 }
 
 // Multiply matrixes A and B and return a pointer to the resulting matrix, returns NULL in case of error
 tms_matrix *tms_matrix_multiply(tms_matrix *A, tms_matrix *B)
 {
-    int i, j, k;
+    int i;
     tms_matrix *result;
     if (A->columns != B->rows)
     {
-        puts("Cannot multiply, incompatible dimensions.");
+        tms_save_error(TMS_MATRIX, MATRIX_DIMENSIONS_MISMATCH, EH_FATAL, NULL, 0);
         return NULL;
     }
     result = tms_new_matrix(A->rows, B->columns);
-    // i defines the row at which we are working.
-    for (i = 0; i < A->rows; ++i)
-        for (j = 0; j < B->columns; ++j)
-        {
-            result->data[i][j] = 0;
-            // In the next loop: k sweeps the row 'i' of the left operand and column 'j' of the right operand
-            for (k = 0; k < B->rows; ++k)
-                result->data[i][j] += A->data[i][k] * B->data[k][j];
-        }
+    for (i = 0; i < result->rows; ++i)
+        memset(TMS_MATRIX_ROW(result, i), 0, result->columns * sizeof(double));
+
+    _tms_gemm_run(_tms_gemm, A, B, result, A->rows, TMS_GEMM_MR, (double)A->rows * A->columns * B->columns);
 
     // Remove minor precision loss when multiplying the matrix and its inverse
     tms_round_to_identity_matrix(result);
@@ -105,7 +320,7 @@ tms_matrix *tms_matrix_multiply(tms_matrix *A, tms_matrix *B)
 void tms_replace_matrix_col(tms_matrix *M, tms_matrix *column_matrix, int column)
 {
     for (int i = 0; i < column_matrix->rows; ++i)
-        M->data[i][column] = column_matrix->data[i][0];
+        TMS_MATRIX_ROW(M, i)[column] = TMS_MATRIX_ROW(column_matrix, i)[0];
 }
 
 tms_matrix *tms_matrix_dup(tms_matrix *matrix)
@@ -114,45 +329,434 @@ tms_matrix *tms_matrix_dup(tms_matrix *matrix)
     if (matrix == NULL)
         return NULL;
 
-    copy = tms_new_matrix(matrix->columns, matrix->rows);
-    for (int i = 0; i < matrix->rows; ++i)
-        memcpy(copy->data[i], matrix->data[i], matrix->columns * sizeof(double));
+    copy = tms_new_matrix(matrix->rows, matrix->columns);
+    if (matrix->stride == matrix->columns)
+        memcpy(copy->data, matrix->data, (size_t)matrix->rows * matrix->columns * sizeof(double));
+    else
+        for (int i = 0; i < matrix->rows; ++i)
+            memcpy(TMS_MATRIX_ROW(copy, i), TMS_MATRIX_ROW(matrix, i), matrix->columns * sizeof(double));
     return copy;
 }
 
+// Sum of absolute values of the largest column
+static double _tms_matrix_norm1(tms_matrix *M)
+{
+    double norm = 0, *sums = calloc(M->columns, sizeof(double));
+    int i, j;
+    for (i = 0; i < M->rows; ++i)
+        for (j = 0; j < M->columns; ++j)
+            sums[j] += fabs(TMS_MATRIX_ROW(M, i)[j]);
+    for (j = 0; j < M->columns; ++j)
+        if (sums[j] > norm)
+            norm = sums[j];
+    free(sums);
+    return norm;
+}
+
+tms_lu *tms_matrix_lu(tms_matrix *M)
+{
+    int i, j, k, n, pivot;
+    double factor, tmp;
+    tms_lu *F;
+
+    if (M == NULL)
+        return NULL;
+    if (M->rows < 1 || M->rows != M->columns)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+
+    n = M->rows;
+    F = malloc(sizeof(tms_lu));
+    F->LU = tms_matrix_dup(M);
+    F->perm = malloc(n * sizeof(int));
+    F->sign = 1;
+    F->singular = false;
+
+    for (i = 0; i < n; ++i)
+        F->perm[i] = i;
+
+    tms_matrix *LU = F->LU;
+    double *row_k, *row_i;
+    for (k = 0; k < n; ++k)
+    {
+        // Partial pivoting: use the largest entry of column k
+        pivot = k;
+        for (i = k + 1; i < n; ++i)
+            if (fabs(TMS_MATRIX_ROW(LU, i)[k]) > fabs(TMS_MATRIX_ROW(LU, pivot)[k]))
+                pivot = i;
+
+        row_k = TMS_MATRIX_ROW(LU, k);
+        if (pivot != k)
+        {
+            row_i = TMS_MATRIX_ROW(LU, pivot);
+            for (j = 0; j < n; ++j)
+            {
+                tmp = row_k[j];
+                row_k[j] = row_i[j];
+                row_i[j] = tmp;
+            }
+            j = F->perm[k];
+            F->perm[k] = F->perm[pivot];
+            F->perm[pivot] = j;
+            F->sign = -F->sign;
+        }
+
+        // Only an exactly zero pivot makes the factorization unusable, badly scaled matrices are still factorized
+        if (row_k[k] == 0)
+        {
+            F->singular = true;
+            // Nothing to eliminate in this column
+            continue;
+        }
+
+        for (i = k + 1; i < n; ++i)
+        {
+            row_i = TMS_MATRIX_ROW(LU, i);
+            factor = row_i[k] /= row_k[k];
+            if (factor == 0)
+                continue;
+            for (j = k + 1; j < n; ++j)
+                row_i[j] -= factor * row_k[j];
+        }
+    }
+    return F;
+}
+
+void tms_delete_lu(tms_lu *F)
+{
+    if (F == NULL)
+        return;
+    tms_delete_matrix(F->LU);
+    free(F->perm);
+    free(F);
+}
+
+double tms_lu_det(tms_lu *F)
+{
+    double det = F->sign;
+    for (int i = 0; i < F->LU->rows; ++i)
+        det *= TMS_MATRIX_ROW(F->LU, i)[i];
+    return det;
+}
+
+int tms_lu_solve(tms_lu *F, const double *b, double *x)
+{
+    int i, j, n = F->LU->rows;
+    double *row, sum;
+
+    if (F->singular)
+    {
+        tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    // Forward substitution: L*y = P*b
+    for (i = 0; i < n; ++i)
+    {
+        row = TMS_MATRIX_ROW(F->LU, i);
+        sum = b[F->perm[i]];
+        for (j = 0; j < i; ++j)
+            sum -= row[j] * x[j];
+        x[i] = sum;
+    }
+    // Back substitution: U*x = y
+    for (i = n - 1; i >= 0; --i)
+    {
+        row = TMS_MATRIX_ROW(F->LU, i);
+        sum = x[i];
+        for (j = i + 1; j < n; ++j)
+            sum -= row[j] * x[j];
+        x[i] = sum / row[i];
+    }
+    return 0;
+}
+
+tms_matrix *tms_lu_inv(tms_lu *F)
+{
+    int i, j, n = F->LU->rows;
+    tms_matrix *inverse;
+    double *e, *x;
+
+    if (F->singular)
+    {
+        tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+
+    inverse = tms_new_matrix(n, n);
+    e = calloc(n, sizeof(double));
+    x = malloc(n * sizeof(double));
+    // Column j of the inverse is the solution of A*x = e_j
+    for (j = 0; j < n; ++j)
+    {
+        e[j] = 1;
+        tms_lu_solve(F, e, x);
+        e[j] = 0;
+        for (i = 0; i < n; ++i)
+            TMS_MATRIX_ROW(inverse, i)[j] = x[i];
+    }
+    free(e);
+    free(x);
+    return inverse;
+}
+
+// row_dst -= factor * row_src, for "count" members
+static void _tms_row_axpy(double *row_dst, const double *row_src, double factor, int count)
+{
+    for (int j = 0; j < count; ++j)
+        row_dst[j] -= factor * row_src[j];
+}
+
+static void _tms_swap_rows(double *row_a, double *row_b, int count)
+{
+    double tmp;
+    for (int j = 0; j < count; ++j)
+    {
+        tmp = row_a[j];
+        row_a[j] = row_b[j];
+        row_b[j] = tmp;
+    }
+}
+
+// Solves U*X = B where U is the upper triangle of A, X overwrites the first A->columns rows of B
+static void _tms_back_substitute(tms_matrix *A, tms_matrix *B)
+{
+    int i, j, n = A->columns, k = B->columns;
+    double *row_i;
+    for (i = n - 1; i >= 0; --i)
+    {
+        row_i = TMS_MATRIX_ROW(B, i);
+        for (j = i + 1; j < n; ++j)
+            _tms_row_axpy(row_i, TMS_MATRIX_ROW(B, j), TMS_MATRIX_ROW(A, i)[j], k);
+        for (j = 0; j < k; ++j)
+            row_i[j] /= TMS_MATRIX_ROW(A, i)[i];
+    }
+}
+
+// Checks if M is exactly symmetric with a positive diagonal, a necessary condition for Cholesky factorization
+static bool _tms_is_cholesky_candidate(tms_matrix *M)
+{
+    for (int i = 0; i < M->rows; ++i)
+    {
+        if (TMS_MATRIX_ROW(M, i)[i] <= 0)
+            return false;
+        for (int j = 0; j < i; ++j)
+            if (TMS_MATRIX_ROW(M, i)[j] != TMS_MATRIX_ROW(M, j)[i])
+                return false;
+    }
+    return true;
+}
+
+// Cholesky factorization A = L*L^T then solve, returns -1 without touching B if A isn't positive definite
+static int _tms_solve_cholesky(tms_matrix *A, tms_matrix *B)
+{
+    int i, j, p, n = A->rows, k = B->columns;
+    double sum, *row_i, *row_j, *diagonal = malloc(n * sizeof(double));
+
+    // L overwrites the lower triangle, the upper triangle keeps a copy of the matrix in case of failure
+    for (j = 0; j < n; ++j)
+    {
+        row_j = TMS_MATRIX_ROW(A, j);
+        diagonal[j] = row_j[j];
+        sum = row_j[j];
+        for (p = 0; p < j; ++p)
+            sum -= row_j[p] * row_j[p];
+        if (sum <= 0)
+        {
+            // Not positive definite, restore the lower triangle and the diagonal
+            for (i = 0; i < n; ++i)
+                for (p = 0; p < i; ++p)
+                    TMS_MATRIX_ROW(A, i)[p] = TMS_MATRIX_ROW(A, p)[i];
+            for (i = 0; i < j; ++i)
+                TMS_MATRIX_ROW(A, i)[i] = diagonal[i];
+            free(diagonal);
+            return -1;
+        }
+        row_j[j] = sqrt(sum);
+
+        for (i = j + 1; i < n; ++i)
+        {
+            row_i = TMS_MATRIX_ROW(A, i);
+            sum = row_i[j];
+            for (p = 0; p < j; ++p)
+                sum -= row_i[p] * row_j[p];
+            row_i[j] = sum / row_j[j];
+        }
+    }
+    free(diagonal);
+
+    // Forward substitution L*Y = B, then back substitution L^T*X = Y
+    for (i = 0; i < n; ++i)
+    {
+        row_i = TMS_MATRIX_ROW(B, i);
+        for (p = 0; p < i; ++p)
+            _tms_row_axpy(row_i, TMS_MATRIX_ROW(B, p), TMS_MATRIX_ROW(A, i)[p], k);
+        for (p = 0; p < k; ++p)
+            row_i[p] /= TMS_MATRIX_ROW(A, i)[i];
+    }
+    for (i = n - 1; i >= 0; --i)
+    {
+        row_i = TMS_MATRIX_ROW(B, i);
+        for (p = i + 1; p < n; ++p)
+            _tms_row_axpy(row_i, TMS_MATRIX_ROW(B, p), TMS_MATRIX_ROW(A, p)[i], k);
+        for (p = 0; p < k; ++p)
+            row_i[p] /= TMS_MATRIX_ROW(A, i)[i];
+    }
+    return 0;
+}
+
+// Gaussian elimination with partial pivoting, the row operations are applied to B as they are done on A
+// Like tms_matrix_lu(), only an exactly zero pivot is singular, badly scaled systems are still solved
+static int _tms_solve_lu(tms_matrix *A, tms_matrix *B)
+{
+    int i, j, pivot, n = A->rows, k = B->columns;
+    double factor, *row_i, *row_j;
+
+    for (j = 0; j < n; ++j)
+    {
+        pivot = j;
+        for (i = j + 1; i < n; ++i)
+            if (fabs(TMS_MATRIX_ROW(A, i)[j]) > fabs(TMS_MATRIX_ROW(A, pivot)[j]))
+                pivot = i;
+
+        row_j = TMS_MATRIX_ROW(A, j);
+        if (pivot != j)
+        {
+            _tms_swap_rows(row_j, TMS_MATRIX_ROW(A, pivot), n);
+            _tms_swap_rows(TMS_MATRIX_ROW(B, j), TMS_MATRIX_ROW(B, pivot), k);
+        }
+        if (row_j[j] == 0)
+        {
+            tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
+            return -1;
+        }
+
+        for (i = j + 1; i < n; ++i)
+        {
+            row_i = TMS_MATRIX_ROW(A, i);
+            factor = row_i[j] /= row_j[j];
+            if (factor == 0)
+                continue;
+            _tms_row_axpy(row_i + j + 1, row_j + j + 1, factor, n - j - 1);
+            _tms_row_axpy(TMS_MATRIX_ROW(B, i), TMS_MATRIX_ROW(B, j), factor, k);
+        }
+    }
+    _tms_back_substitute(A, B);
+    return 0;
+}
+
+// Least squares solution using Householder reflections: Q*R = A, then R*X = Q^T*B
+// Only an exactly zero column is rank deficient, as for the pivots of _tms_solve_lu()
+static int _tms_solve_qr(tms_matrix *A, tms_matrix *B)
+{
+    int i, j, p, m = A->rows, n = A->columns, k = B->columns;
+    double norm, alpha, beta, dot;
+
+    for (j = 0; j < n; ++j)
+    {
+        // The reflection vector v overwrites column j from the diagonal down
+        norm = 0;
+        for (i = j; i < m; ++i)
+            norm += TMS_MATRIX_ROW(A, i)[j] * TMS_MATRIX_ROW(A, i)[j];
+        norm = sqrt(norm);
+        if (norm == 0)
+        {
+            tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
+            return -1;
+        }
+        // Sign chosen to avoid cancellation in v[0]
+        alpha = (TMS_MATRIX_ROW(A, j)[j] > 0 ? -norm : norm);
+        TMS_MATRIX_ROW(A, j)[j] -= alpha;
+        // beta = 2 / (v . v), which simplifies to this since v[0] = x[0] - alpha and alpha^2 = |x|^2
+        beta = 1 / (-alpha * TMS_MATRIX_ROW(A, j)[j]);
+
+        // Apply H = I - beta*v*v^T to the remaining columns of A, then to B
+        for (p = j + 1; p < n; ++p)
+        {
+            dot = 0;
+            for (i = j; i < m; ++i)
+                dot += TMS_MATRIX_ROW(A, i)[j] * TMS_MATRIX_ROW(A, i)[p];
+            dot *= beta;
+            for (i = j; i < m; ++i)
+                TMS_MATRIX_ROW(A, i)[p] -= dot * TMS_MATRIX_ROW(A, i)[j];
+        }
+        for (p = 0; p < k; ++p)
+        {
+            dot = 0;
+            for (i = j; i < m; ++i)
+                dot += TMS_MATRIX_ROW(A, i)[j] * TMS_MATRIX_ROW(B, i)[p];
+            dot *= beta;
+            for (i = j; i < m; ++i)
+                TMS_MATRIX_ROW(B, i)[p] -= dot * TMS_MATRIX_ROW(A, i)[j];
+        }
+        TMS_MATRIX_ROW(A, j)[j] = alpha;
+    }
+    _tms_back_substitute(A, B);
+    return 0;
+}
+
+int tms_matrix_solve_inplace(tms_matrix *A, tms_matrix *B)
+{
+    if (A == NULL || B == NULL)
+        return -1;
+    if (A->rows != B->rows || A->rows < A->columns || A->columns < 1)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    if (A->rows > A->columns)
+        return _tms_solve_qr(A, B);
+    else if (_tms_is_cholesky_candidate(A) && _tms_solve_cholesky(A, B) == 0)
+        return 0;
+    else
+        return _tms_solve_lu(A, B);
+}
+
+tms_matrix *tms_matrix_solve(tms_matrix *A, tms_matrix *B)
+{
+    tms_matrix *A_copy, *X;
+    if (A == NULL || B == NULL)
+        return NULL;
+
+    A_copy = tms_matrix_dup(A);
+    X = tms_matrix_dup(B);
+    if (tms_matrix_solve_inplace(A_copy, X) != 0)
+    {
+        tms_delete_matrix(A_copy);
+        tms_delete_matrix(X);
+        return NULL;
+    }
+    tms_delete_matrix(A_copy);
+    // Least squares: the solution is in the first rows, the storage is a single block so the extra rows are just ignored
+    X->rows = A->columns;
+    return X;
+}
+
 double tms_matrix_det(tms_matrix *A)
 {
-    int i;
-    tms_matrix *B;
-    double det = 0, tmp;
+    tms_lu *F;
+    double det;
     if (A->rows != A->columns)
     {
-        puts("Error, matrix must be square.");
+        tms_save_error(TMS_MATRIX, MATRIX_NOT_SQUARE, EH_FATAL, NULL, 0);
         return NAN;
     }
 
+    // Exact for small integer matrices, no rounding from the elimination
     if (A->rows == 2)
     {
-        det = A->data[0][0] * A->data[1][1] - A->data[1][0] * A->data[0][1];
+        det = TMS_MATRIX_ROW(A, 0)[0] * TMS_MATRIX_ROW(A, 1)[1] - TMS_MATRIX_ROW(A, 1)[0] * TMS_MATRIX_ROW(A, 0)[1];
         return det;
     }
-    else
-    {
-        // i points at the column we are working at
-        for (i = 0; i < A->columns; ++i)
-        {
-            // hold the value pointed to by (0,j) to multiply later
-            if (i % 2 == 0)
-                tmp = A->data[0][i];
-            else
-                tmp = -A->data[0][i];
 
-            // Get matrix B from matrix A by excluding rows
-            B = tms_remove_matrix_row_col(A, 0, i);
-            det += tmp * tms_matrix_det(B);
-            tms_delete_matrix(B);
-        }
-    }
+    F = tms_matrix_lu(A);
+    if (F == NULL)
+        return NAN;
+    det = tms_lu_det(F);
+    tms_delete_lu(F);
     return det;
 }
 
@@ -162,14 +766,15 @@ tms_matrix *tms_matrix_tr(tms_matrix *M)
     tms_matrix *transpose = tms_new_matrix(M->columns, M->rows);
     for (i = 0; i < M->rows; ++i)
         for (j = 0; j < M->columns; ++j)
-            transpose->data[j][i] = M->data[i][j];
+            TMS_MATRIX_ROW(transpose, j)[i] = TMS_MATRIX_ROW(M, i)[j];
     return transpose;
 }
 
 tms_matrix *tms_comatrix(tms_matrix *M)
 {
     int i, j;
-    tms_matrix *comatrix, *minor;
+    tms_matrix *comatrix, *minor, *inverse;
+    tms_lu *F;
     double det;
     // Check for empty matrix
     if (M == NULL)
@@ -182,49 +787,526 @@ tms_matrix *tms_comatrix(tms_matrix *M)
     comatrix = tms_new_matrix(M->rows, M->columns);
     if (comatrix->rows == 2)
     {
-        comatrix->data[0][0] = M->data[1][1];
-        comatrix->data[1][1] = M->data[0][0];
-        comatrix->data[0][1] = -M->data[1][0];
-        comatrix->data[1][0] = -M->data[0][1];
+        TMS_MATRIX_ROW(comatrix, 0)[0] = TMS_MATRIX_ROW(M, 1)[1];
+        TMS_MATRIX_ROW(comatrix, 1)[1] = TMS_MATRIX_ROW(M, 0)[0];
+        TMS_MATRIX_ROW(comatrix, 0)[1] = -TMS_MATRIX_ROW(M, 1)[0];
+        TMS_MATRIX_ROW(comatrix, 1)[0] = -TMS_MATRIX_ROW(M, 0)[1];
+        return comatrix;
+    }
+
+    // comatrix = det(M) * transpose(inverse of M), a single factorization instead of n^2 determinants
+    F = tms_matrix_lu(M);
+    inverse = (F->singular ? NULL : tms_lu_inv(F));
+    // The inverse of a nearly singular matrix is dominated by rounding errors, use the minors as for singular matrices
+    if (inverse != NULL && !(1 / (_tms_matrix_norm1(M) * _tms_matrix_norm1(inverse)) >= DBL_EPSILON))
+    {
+        tms_delete_matrix(inverse);
+        inverse = NULL;
+    }
+    if (inverse != NULL)
+    {
+        det = tms_lu_det(F);
+        tms_delete_lu(F);
+        for (i = 0; i < M->rows; ++i)
+            for (j = 0; j < M->columns; ++j)
+                TMS_MATRIX_ROW(comatrix, i)[j] = det * TMS_MATRIX_ROW(inverse, j)[i];
+        tms_delete_matrix(inverse);
         return comatrix;
     }
+    tms_delete_lu(F);
+
+    // Singular matrix, the comatrix can still be nonzero (rank n-1), use the minors
     for (i = 0; i < M->rows; ++i)
         for (j = 0; j < M->columns; ++j)
         {
             minor = tms_remove_matrix_row_col(M, i, j);
             det = tms_matrix_det(minor);
             tms_delete_matrix(minor);
-            comatrix->data[i][j] = pow(-1, i + j) * det;
+            TMS_MATRIX_ROW(comatrix, i)[j] = (i + j) % 2 == 0 ? det : -det;
         }
     return comatrix;
 }
 
 tms_matrix *tms_matrix_inv(tms_matrix *M)
 {
-    int i, j;
-    double det;
-    tms_matrix *inverse, *tmp;
+    int i, j, k, n, pivot, *pivots;
+    double factor, rcond, *row_k, *row_i;
+    tms_matrix *inverse;
     // Check for empty matrix
     if (M == NULL)
         return NULL;
-    if (M->rows != M->columns || M->rows < 2)
+    if (M->rows != M->columns || M->rows < 1)
+    {
+        tms_save_error(TMS_MATRIX, MATRIX_NOT_SQUARE, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+
+    // Gauss-Jordan elimination with partial pivoting, the copy of M is replaced by its inverse column by column
+    n = M->rows;
+    inverse = tms_matrix_dup(M);
+    pivots = malloc(n * sizeof(int));
+    for (k = 0; k < n; ++k)
+    {
+        pivot = k;
+        for (i = k + 1; i < n; ++i)
+            if (fabs(TMS_MATRIX_ROW(inverse, i)[k]) > fabs(TMS_MATRIX_ROW(inverse, pivot)[k]))
+                pivot = i;
+        pivots[k] = pivot;
+        row_k = TMS_MATRIX_ROW(inverse, k);
+        if (pivot != k)
+            _tms_swap_rows(row_k, TMS_MATRIX_ROW(inverse, pivot), n);
+
+        if (row_k[k] == 0)
+        {
+            tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
+            tms_delete_matrix(inverse);
+            free(pivots);
+            return NULL;
+        }
+
+        // Column k of the identity takes the place of column k of M
+        factor = 1 / row_k[k];
+        row_k[k] = 1;
+        for (j = 0; j < n; ++j)
+            row_k[j] *= factor;
+        for (i = 0; i < n; ++i)
+        {
+            if (i == k)
+                continue;
+            row_i = TMS_MATRIX_ROW(inverse, i);
+            factor = row_i[k];
+            if (factor == 0)
+                continue;
+            row_i[k] = 0;
+            _tms_row_axpy(row_i, row_k, factor, n);
+        }
+    }
+
+    // The row swaps of M become column swaps of the inverse, in reverse order
+    for (k = n - 1; k >= 0; --k)
+        if (pivots[k] != k)
+            for (i = 0; i < n; ++i)
+            {
+                row_i = TMS_MATRIX_ROW(inverse, i);
+                factor = row_i[k];
+                row_i[k] = row_i[pivots[k]];
+                row_i[pivots[k]] = factor;
+            }
+    free(pivots);
+
+    // Reciprocal condition number, the inverse is meaningless if it is at the rounding level
+    rcond = 1 / (_tms_matrix_norm1(M) * _tms_matrix_norm1(inverse));
+    if (!(rcond >= DBL_EPSILON))
+    {
+        tms_save_error(TMS_MATRIX, ILL_CONDITIONED_MATRIX, EH_FATAL, NULL, 0);
+        tms_delete_matrix(inverse);
+        return NULL;
+    }
+    return inverse;
+}
+
+tms_cmatrix *tms_new_cmatrix(int rows, int columns)
+{
+    tms_cmatrix *matrix;
+    matrix = malloc(sizeof(tms_cmatrix));
+    matrix->columns = columns;
+    matrix->rows = rows;
+    matrix->stride = columns;
+    matrix->owns_data = true;
+    matrix->data = (cdouble *)_tms_matrix_alloc((size_t)rows * columns * 2);
+    return matrix;
+}
+
+tms_cmatrix *tms_wrap_cmatrix(cdouble *data, int rows, int columns, int stride)
+{
+    tms_cmatrix *matrix;
+    if (data == NULL || rows < 0 || columns < 0 || stride < columns)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    matrix = malloc(sizeof(tms_cmatrix));
+    matrix->columns = columns;
+    matrix->rows = rows;
+    matrix->stride = stride;
+    matrix->owns_data = false;
+    matrix->data = data;
+    return matrix;
+}
+
+void tms_delete_cmatrix(tms_cmatrix *matrix)
+{
+    if (matrix->owns_data)
+        _tms_matrix_free((double *)matrix->data);
+    free(matrix);
+}
+
+tms_cmatrix *tms_cmatrix_dup(tms_cmatrix *matrix)
+{
+    tms_cmatrix *copy;
+    if (matrix == NULL)
+        return NULL;
+
+    copy = tms_new_cmatrix(matrix->rows, matrix->columns);
+    for (int i = 0; i < matrix->rows; ++i)
+        memcpy(TMS_CMATRIX_ROW(copy, i), TMS_CMATRIX_ROW(matrix, i), matrix->columns * sizeof(cdouble));
+    return copy;
+}
+
+// The complex kernel keeps real and imaginary accumulators, so it uses fewer rows per tile to fit the registers
+#define TMS_CGEMM_MR 3
+#define TMS_CGEMM_KC 128
+#define TMS_CGEMM_NC 2048
+
+/*
+ * Members are interleaved in storage, packing splits them into real and imaginary panels
+ * so the kernel works on vectors of real parts and vectors of imaginary parts.
+ */
+
+#if defined(__GNUC__)
+_TMS_GEMM_CLONES static void _tms_cgemm_kernel(int kc, const double *A, const double *B, cdouble *C, int ldc, int m,
+                                               int n)
+{
+    _tms_gemm_row acc_re[TMS_CGEMM_MR] = {0}, acc_im[TMS_CGEMM_MR] = {0}, b_re, b_im;
+    double a_re, a_im, *c;
+    int i, j, p;
+
+    for (p = 0; p < kc; ++p)
+    {
+        b_re = *(const _tms_gemm_row *)(B + 2 * p * TMS_GEMM_NR);
+        b_im = *(const _tms_gemm_row *)(B + (2 * p + 1) * TMS_GEMM_NR);
+#pragma GCC unroll 16
+        for (i = 0; i < TMS_CGEMM_MR; ++i)
+        {
+            a_re = A[2 * p * TMS_CGEMM_MR + i];
+            a_im = A[(2 * p + 1) * TMS_CGEMM_MR + i];
+            acc_re[i] += a_re * b_re - a_im * b_im;
+            acc_im[i] += a_re * b_im + a_im * b_re;
+        }
+    }
+
+    for (i = 0; i < m; ++i)
+    {
+        c = (double *)(C + i * ldc);
+        for (j = 0; j < n; ++j)
+        {
+            c[2 * j] += acc_re[i][j];
+            c[2 * j + 1] += acc_im[i][j];
+        }
+    }
+}
+#else
+static void _tms_cgemm_kernel(int kc, const double *A, const double *B, cdouble *C, int ldc, int m, int n)
+{
+    double acc_re[TMS_CGEMM_MR][TMS_GEMM_NR] = {{0}}, acc_im[TMS_CGEMM_MR][TMS_GEMM_NR] = {{0}};
+    double a_re, a_im, b_re, b_im, *c;
+    int i, j, p;
+
+    for (p = 0; p < kc; ++p)
+        for (i = 0; i < TMS_CGEMM_MR; ++i)
+        {
+            a_re = A[2 * p * TMS_CGEMM_MR + i];
+            a_im = A[(2 * p + 1) * TMS_CGEMM_MR + i];
+            for (j = 0; j < TMS_GEMM_NR; ++j)
+            {
+                b_re = B[2 * p * TMS_GEMM_NR + j];
+                b_im = B[(2 * p + 1) * TMS_GEMM_NR + j];
+                acc_re[i][j] += a_re * b_re - a_im * b_im;
+                acc_im[i][j] += a_re * b_im + a_im * b_re;
+            }
+        }
+
+    for (i = 0; i < m; ++i)
+    {
+        c = (double *)(C + i * ldc);
+        for (j = 0; j < n; ++j)
+        {
+            c[2 * j] += acc_re[i][j];
+            c[2 * j + 1] += acc_im[i][j];
+        }
+    }
+}
+#endif
+
+// Same as _tms_gemm_pack_A(), each column of a strip is stored as MR real parts then MR imaginary parts
+static void _tms_cgemm_pack_A(tms_cmatrix *A, int row, int col, int mc, int kc, double *packed)
+{
+    int i, ir, p;
+    const double *src;
+    for (ir = 0; ir < mc; ir += TMS_CGEMM_MR)
+        for (p = 0; p < kc; ++p)
+        {
+            for (i = 0; i < TMS_CGEMM_MR; ++i)
+            {
+                src = (const double *)(TMS_CMATRIX_ROW(A, row + ir + i) + col + p);
+                packed[i] = (ir + i < mc ? src[0] : 0);
+                packed[TMS_CGEMM_MR + i] = (ir + i < mc ? src[1] : 0);
+            }
+            packed += 2 * TMS_CGEMM_MR;
+        }
+}
+
+// Same as _tms_gemm_pack_B(), each row of a strip is stored as NR real parts then NR imaginary parts
+static void _tms_cgemm_pack_B(tms_cmatrix *B, int row, int col, int kc, int nc, double *packed)
+{
+    int j, jr, p;
+    for (jr = 0; jr < nc; jr += TMS_GEMM_NR)
+        for (p = 0; p < kc; ++p)
+        {
+            const double *src = (const double *)(TMS_CMATRIX_ROW(B, row + p) + col + jr);
+            for (j = 0; j < TMS_GEMM_NR; ++j)
+            {
+                packed[j] = (jr + j < nc ? src[2 * j] : 0);
+                packed[TMS_GEMM_NR + j] = (jr + j < nc ? src[2 * j + 1] : 0);
+            }
+            packed += 2 * TMS_GEMM_NR;
+        }
+}
+
+// Computes rows [first_row, last_row) of C = A*B for complex matrices, C should be zeroed
+static void _tms_cgemm(_tms_gemm_job *job)
+{
+    tms_cmatrix *A = job->A, *B = job->B, *C = job->C;
+    int M = job->last_row, N = B->columns, K = A->columns;
+    int ic, jc, pc, ir, jr, mc, nc, kc;
+    double *packed_A = _tms_matrix_alloc(2 * TMS_GEMM_MC * TMS_CGEMM_KC);
+    double *packed_B = _tms_matrix_alloc(2 * TMS_CGEMM_KC * TMS_CGEMM_NC);
+
+    for (jc = 0; jc < N; jc += TMS_CGEMM_NC)
+    {
+        nc = (N - jc < TMS_CGEMM_NC ? N - jc : TMS_CGEMM_NC);
+        for (pc = 0; pc < K; pc += TMS_CGEMM_KC)
+        {
+            kc = (K - pc < TMS_CGEMM_KC ? K - pc : TMS_CGEMM_KC);
+            _tms_cgemm_pack_B(B, pc, jc, kc, nc, packed_B);
+            for (ic = job->first_row; ic < M; ic += TMS_GEMM_MC)
+            {
+                mc = (M - ic < TMS_GEMM_MC ? M - ic : TMS_GEMM_MC);
+                _tms_cgemm_pack_A(A, ic, pc, mc, kc, packed_A);
+                for (jr = 0; jr < nc; jr += TMS_GEMM_NR)
+                    for (ir = 0; ir < mc; ir += TMS_CGEMM_MR)
+                        _tms_cgemm_kernel(kc, packed_A + 2 * ir * kc, packed_B + 2 * jr * kc,
+                                          TMS_CMATRIX_ROW(C, ic + ir) + jc + jr, C->stride,
+                                          (mc - ir < TMS_CGEMM_MR ? mc - ir : TMS_CGEMM_MR),
+                                          (nc - jr < TMS_GEMM_NR ? nc - jr : TMS_GEMM_NR));
+            }
+        }
+    }
+    _tms_matrix_free(packed_A);
+    _tms_matrix_free(packed_B);
+}
+
+tms_cmatrix *tms_cmatrix_multiply(tms_cmatrix *A, tms_cmatrix *B)
+{
+    tms_cmatrix *result;
+    if (A->columns != B->rows)
+    {
+        tms_save_error(TMS_MATRIX, MATRIX_DIMENSIONS_MISMATCH, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    result = tms_new_cmatrix(A->rows, B->columns);
+    for (int i = 0; i < result->rows; ++i)
+        memset(TMS_CMATRIX_ROW(result, i), 0, result->columns * sizeof(cdouble));
+
+    // A complex multiply-add is 4 real ones
+    _tms_gemm_run(_tms_cgemm, A, B, result, A->rows, TMS_CGEMM_MR, 4.0 * A->rows * A->columns * B->columns);
+    return result;
+}
+
+// row_dst -= factor * row_src for complex rows, written on the real and imaginary parts to avoid __muldc3() calls
+static void _tms_crow_axpy(cdouble *row_dst, const cdouble *row_src, cdouble factor, int count)
+{
+    double *dst = (double *)row_dst, f_re = creal(factor), f_im = cimag(factor);
+    const double *src = (const double *)row_src;
+    for (int j = 0; j < count; ++j)
+    {
+        dst[2 * j] -= f_re * src[2 * j] - f_im * src[2 * j + 1];
+        dst[2 * j + 1] -= f_re * src[2 * j + 1] + f_im * src[2 * j];
+    }
+}
+
+tms_clu *tms_cmatrix_lu(tms_cmatrix *M)
+{
+    int i, j, k, n, pivot;
+    cdouble factor, tmp, *row_k, *row_i;
+    tms_clu *F;
+
+    if (M == NULL)
+        return NULL;
+    if (M->rows < 1 || M->rows != M->columns)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+
+    n = M->rows;
+    F = malloc(sizeof(tms_clu));
+    F->LU = tms_cmatrix_dup(M);
+    F->perm = malloc(n * sizeof(int));
+    F->sign = 1;
+    F->singular = false;
+
+    for (i = 0; i < n; ++i)
+        F->perm[i] = i;
+
+    tms_cmatrix *LU = F->LU;
+    for (k = 0; k < n; ++k)
+    {
+        pivot = k;
+        for (i = k + 1; i < n; ++i)
+            if (cabs(TMS_CMATRIX_ROW(LU, i)[k]) > cabs(TMS_CMATRIX_ROW(LU, pivot)[k]))
+                pivot = i;
+
+        row_k = TMS_CMATRIX_ROW(LU, k);
+        if (pivot != k)
+        {
+            row_i = TMS_CMATRIX_ROW(LU, pivot);
+            for (j = 0; j < n; ++j)
+            {
+                tmp = row_k[j];
+                row_k[j] = row_i[j];
+                row_i[j] = tmp;
+            }
+            j = F->perm[k];
+            F->perm[k] = F->perm[pivot];
+            F->perm[pivot] = j;
+            F->sign = -F->sign;
+        }
+
+        if (row_k[k] == 0)
+        {
+            F->singular = true;
+            continue;
+        }
+
+        for (i = k + 1; i < n; ++i)
+        {
+            row_i = TMS_CMATRIX_ROW(LU, i);
+            factor = row_i[k] /= row_k[k];
+            if (factor == 0)
+                continue;
+            _tms_crow_axpy(row_i + k + 1, row_k + k + 1, factor, n - k - 1);
+        }
+    }
+    return F;
+}
+
+void tms_delete_clu(tms_clu *F)
+{
+    if (F == NULL)
+        return;
+    tms_delete_cmatrix(F->LU);
+    free(F->perm);
+    free(F);
+}
+
+cdouble tms_clu_det(tms_clu *F)
+{
+    cdouble det = F->sign;
+    for (int i = 0; i < F->LU->rows; ++i)
+        det *= TMS_CMATRIX_ROW(F->LU, i)[i];
+    return det;
+}
+
+int tms_clu_solve(tms_clu *F, const cdouble *b, cdouble *x)
+{
+    int i, j, n = F->LU->rows;
+    cdouble *row, sum;
+
+    if (F->singular)
+    {
+        tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        row = TMS_CMATRIX_ROW(F->LU, i);
+        sum = b[F->perm[i]];
+        for (j = 0; j < i; ++j)
+            sum -= row[j] * x[j];
+        x[i] = sum;
+    }
+    for (i = n - 1; i >= 0; --i)
     {
-        puts("Can't invert non square matrix.");
+        row = TMS_CMATRIX_ROW(F->LU, i);
+        sum = x[i];
+        for (j = i + 1; j < n; ++j)
+            sum -= row[j] * x[j];
+        x[i] = sum / row[i];
+    }
+    return 0;
+}
+
+tms_cmatrix *tms_clu_inv(tms_clu *F)
+{
+    int i, j, n = F->LU->rows;
+    tms_cmatrix *inverse;
+    cdouble *e, *x;
+
+    if (F->singular)
+    {
+        tms_save_error(TMS_MATRIX, SINGULAR_MATRIX, EH_FATAL, NULL, 0);
         return NULL;
     }
-    inverse = tms_comatrix(M);
-    // tmp stores the comatrix pointer, otherwise it would be lost and memory leaked
-    tmp = inverse;
-    inverse = tms_matrix_tr(inverse);
-    tms_delete_matrix(tmp);
-    det = tms_matrix_det(M);
-    if (det == 0)
+
+    inverse = tms_new_cmatrix(n, n);
+    e = calloc(n, sizeof(cdouble));
+    x = malloc(n * sizeof(cdouble));
+    for (j = 0; j < n; ++j)
+    {
+        e[j] = 1;
+        tms_clu_solve(F, e, x);
+        e[j] = 0;
+        for (i = 0; i < n; ++i)
+            TMS_CMATRIX_ROW(inverse, i)[j] = x[i];
+    }
+    free(e);
+    free(x);
+    return inverse;
+}
+
+cdouble tms_cmatrix_det(tms_cmatrix *M)
+{
+    tms_clu *F = tms_cmatrix_lu(M);
+    cdouble det;
+    if (F == NULL)
+        return NAN;
+    det = tms_clu_det(F);
+    tms_delete_clu(F);
+    return det;
+}
+
+// Sum of moduli of the largest column, see _tms_matrix_norm1()
+static double _tms_cmatrix_norm1(tms_cmatrix *M)
+{
+    double norm = 0, *sums = calloc(M->columns, sizeof(double));
+    int i, j;
+    for (i = 0; i < M->rows; ++i)
+        for (j = 0; j < M->columns; ++j)
+            sums[j] += cabs(TMS_CMATRIX_ROW(M, i)[j]);
+    for (j = 0; j < M->columns; ++j)
+        if (sums[j] > norm)
+            norm = sums[j];
+    free(sums);
+    return norm;
+}
+
+tms_cmatrix *tms_cmatrix_inv(tms_cmatrix *M)
+{
+    tms_cmatrix *inverse;
+    tms_clu *F = tms_cmatrix_lu(M);
+    if (F == NULL)
+        return NULL;
+    inverse = tms_clu_inv(F);
+    tms_delete_clu(F);
+
+    // Same reciprocal condition number check as tms_matrix_inv()
+    if (inverse != NULL && !(1 / (_tms_cmatrix_norm1(M) * _tms_cmatrix_norm1(inverse)) >= DBL_EPSILON))
     {
-        puts("Matrix cannot be inverted, determinant = 0.");
+        tms_save_error(TMS_MATRIX, ILL_CONDITIONED_MATRIX, EH_FATAL, NULL, 0);
+        tms_delete_cmatrix(inverse);
         return NULL;
     }
-    for (i = 0; i < inverse->rows; ++i)
-        for (j = 0; j < inverse->columns; ++j)
-            inverse->data[i][j] /= det;
     return inverse;
 }
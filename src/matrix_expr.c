@@ -0,0 +1,939 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "matrix_expr.h"
+#include "error_handler.h"
+#include "internals.h"
+#include "m_errors.h"
+#include "string_tools.h"
+#include "symtab.h"
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Created on first use, the lock is held while an expression is parsed and evaluated (variables are borrowed)
+static tms_symtab *matrix_var_table = NULL;
+static pthread_mutex_t _matrix_variables_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _tms_free_matrix_var(void *item)
+{
+    tms_matrix_var *v = item;
+    free(v->name);
+    tms_delete_matrix(v->value);
+}
+
+static tms_symtab *_tms_matrix_vars()
+{
+    if (matrix_var_table == NULL)
+        matrix_var_table = tms_symtab_new(sizeof(tms_matrix_var), 0, rand(), _tms_free_matrix_var);
+    return matrix_var_table;
+}
+
+static const tms_matrix_var *_tms_get_matrix_var_unsafe(const char *name)
+{
+    return tms_symtab_get(_tms_matrix_vars(), name);
+}
+
+int tms_set_matrix_var(const char *name, tms_matrix *M)
+{
+    if (M == NULL || M->rows < 1 || M->columns < 1)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return -1;
+    }
+    if (tms_valid_name(name) == false)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_NAME, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    pthread_mutex_lock(&_matrix_variables_lock);
+    const tms_matrix_var *existing_var = _tms_get_matrix_var_unsafe(name);
+    tms_matrix_var v = {.value = tms_matrix_dup(M)};
+    // Reuse the already allocated name, the old value is freed
+    if (existing_var != NULL)
+    {
+        v.name = existing_var->name;
+        tms_delete_matrix(existing_var->value);
+    }
+    else
+        v.name = strdup(name);
+    tms_symtab_set(_tms_matrix_vars(), &v);
+    pthread_mutex_unlock(&_matrix_variables_lock);
+    return 0;
+}
+
+tms_matrix *tms_get_matrix_var(const char *name)
+{
+    tms_matrix *copy = NULL;
+    pthread_mutex_lock(&_matrix_variables_lock);
+    const tms_matrix_var *v = _tms_get_matrix_var_unsafe(name);
+    if (v != NULL)
+        copy = tms_matrix_dup(v->value);
+    pthread_mutex_unlock(&_matrix_variables_lock);
+    return copy;
+}
+
+int tms_remove_matrix_var(const char *name)
+{
+    pthread_mutex_lock(&_matrix_variables_lock);
+    int status = tms_symtab_delete_and_free(_tms_matrix_vars(), name);
+    pthread_mutex_unlock(&_matrix_variables_lock);
+    return status;
+}
+
+void tms_clear_matrix_vars()
+{
+    pthread_mutex_lock(&_matrix_variables_lock);
+    tms_symtab_clear(_tms_matrix_vars());
+    pthread_mutex_unlock(&_matrix_variables_lock);
+}
+
+enum _tms_mnode_types
+{
+    _TMS_MN_NUMBER,
+    _TMS_MN_VAR,
+    _TMS_MN_ADD,
+    _TMS_MN_SUB,
+    _TMS_MN_MUL,
+    _TMS_MN_DIV,
+    _TMS_MN_NEG,
+    _TMS_MN_INV,
+    _TMS_MN_TR,
+    _TMS_MN_DET,
+    _TMS_MN_TRACE,
+    _TMS_MN_SOLVE
+};
+
+// Node of the parsed expression, nothing is computed until the whole tree is available
+typedef struct _tms_mnode
+{
+    int type;
+    // Index in the expression, used in error messages
+    int index;
+    double number;
+    // Borrowed from the symbol table of the variables
+    tms_matrix *var;
+    struct _tms_mnode *left, *right;
+    // Levels of the tree below this node (1 for a leaf), the evaluator recurses once per level
+    int height;
+} _tms_mnode;
+
+static const struct
+{
+    char *name;
+    int type;
+    int argc;
+} _tms_mfuncs[] = {{"inv", _TMS_MN_INV, 1},
+                   {"tr", _TMS_MN_TR, 1},
+                   {"det", _TMS_MN_DET, 1},
+                   {"trace", _TMS_MN_TRACE, 1},
+                   {"solve", _TMS_MN_SOLVE, 2}};
+
+// Parser and evaluator state
+typedef struct _tms_mctx
+{
+    const char *expr;
+    int i;
+    int facility;
+    // Labels of the scientific expression calling det() or trace(), NULL for tms_matrix_eval()
+    tms_arg_list *labels;
+    // Nesting of signs and parenthesis being parsed
+    int depth;
+} _tms_mctx;
+
+// Value of an evaluated node, a scalar if M is NULL
+typedef struct _tms_mval
+{
+    tms_matrix *M;
+    double scalar;
+    // Unset if M is a variable (must be copied before any modification)
+    bool owned;
+} _tms_mval;
+
+static void _tms_delete_mnode(_tms_mnode *node)
+{
+    if (node == NULL)
+        return;
+    _tms_delete_mnode(node->left);
+    _tms_delete_mnode(node->right);
+    free(node);
+}
+
+static _tms_mnode *_tms_new_mnode(int type, int index, _tms_mnode *left, _tms_mnode *right)
+{
+    _tms_mnode *node = calloc(1, sizeof(_tms_mnode));
+    node->type = type;
+    node->index = index;
+    node->left = left;
+    node->right = right;
+    node->height = 1;
+    if (left != NULL && left->height >= node->height)
+        node->height = left->height + 1;
+    if (right != NULL && right->height >= node->height)
+        node->height = right->height + 1;
+    return node;
+}
+
+// Creates an operator or function node, fails if the tree becomes too deep (the children are freed)
+static _tms_mnode *_tms_mparse_node(_tms_mctx *ctx, int type, int index, _tms_mnode *left, _tms_mnode *right)
+{
+    _tms_mnode *node = _tms_new_mnode(type, index, left, right);
+    if (node->height > TMS_MATRIX_EXPR_MAX_DEPTH)
+    {
+        tms_save_error(ctx->facility, STACK_DEPTH_EXCEEDED, EH_FATAL, ctx->expr, index);
+        _tms_delete_mnode(node);
+        return NULL;
+    }
+    return node;
+}
+
+static void _tms_mval_free(_tms_mval *v)
+{
+    if (v->owned)
+        tms_delete_matrix(v->M);
+    v->M = NULL;
+    v->owned = false;
+}
+
+// Makes sure the matrix of v can be modified
+static void _tms_mval_own(_tms_mval *v)
+{
+    if (v->M != NULL && !v->owned)
+    {
+        v->M = tms_matrix_dup(v->M);
+        v->owned = true;
+    }
+}
+
+static void _tms_mskip_spaces(_tms_mctx *ctx)
+{
+    while (isspace(ctx->expr[ctx->i]))
+        ++ctx->i;
+}
+
+static _tms_mnode *_tms_mparse_sum(_tms_mctx *ctx);
+
+static _tms_mnode *_tms_mparse_primary(_tms_mctx *ctx)
+{
+    const char *expr = ctx->expr;
+    int start;
+    size_t i, len;
+    _tms_mnode *node;
+
+    _tms_mskip_spaces(ctx);
+    start = ctx->i;
+
+    if (expr[start] == '(')
+    {
+        ++ctx->i;
+        node = _tms_mparse_sum(ctx);
+        if (node == NULL)
+            return NULL;
+        _tms_mskip_spaces(ctx);
+        if (expr[ctx->i] != ')')
+        {
+            tms_save_error(ctx->facility, PARENTHESIS_NOT_CLOSED, EH_FATAL, expr, start);
+            _tms_delete_mnode(node);
+            return NULL;
+        }
+        ++ctx->i;
+        return node;
+    }
+
+    if (isdigit(expr[start]) || expr[start] == '.')
+    {
+        char *end;
+        node = _tms_new_mnode(_TMS_MN_NUMBER, start, NULL, NULL);
+        node->number = strtod(expr + start, &end);
+        ctx->i = end - expr;
+        return node;
+    }
+
+    if (!isalpha(expr[start]) && expr[start] != '_')
+    {
+        tms_save_error(ctx->facility, expr[start] == '\0' ? RIGHT_OP_MISSING : SYNTAX_ERROR, EH_FATAL, expr, start);
+        return NULL;
+    }
+
+    while (isalnum(expr[ctx->i]) || expr[ctx->i] == '_')
+        ++ctx->i;
+    len = ctx->i - start;
+    _tms_mskip_spaces(ctx);
+
+    // Variable, the labels of the calling expression (scalars) take precedence over the matrix variables
+    if (expr[ctx->i] != '(')
+    {
+        char *name = tms_strndup(expr + start, len);
+        int label = -1;
+        if (ctx->labels != NULL)
+            label = tms_find_str_in_array(name, ctx->labels->arguments, ctx->labels->count, TMS_NOFUNC);
+        const tms_matrix_var *v = (label == -1 ? _tms_get_matrix_var_unsafe(name) : NULL);
+        free(name);
+
+        if (label != -1)
+        {
+            // The payload holds the current values of the labels
+            if (ctx->labels->payload == NULL || ctx->labels->payload_size < (label + 1) * sizeof(cdouble))
+            {
+                tms_save_error(ctx->facility, UNDEFINED_VARIABLE, EH_FATAL, expr, start);
+                return NULL;
+            }
+            cdouble value = ((cdouble *)ctx->labels->payload)[label];
+            if (cimag(value) != 0)
+            {
+                tms_save_error(ctx->facility, ILLEGAL_COMPLEX_OP, EH_FATAL, expr, start);
+                return NULL;
+            }
+            node = _tms_new_mnode(_TMS_MN_NUMBER, start, NULL, NULL);
+            node->number = creal(value);
+            return node;
+        }
+        if (v == NULL)
+        {
+            tms_save_error(ctx->facility, UNDEFINED_VARIABLE, EH_FATAL, expr, start);
+            return NULL;
+        }
+        node = _tms_new_mnode(_TMS_MN_VAR, start, NULL, NULL);
+        node->var = v->value;
+        return node;
+    }
+
+    // Function call
+    for (i = 0; i < array_length(_tms_mfuncs); ++i)
+        if (strlen(_tms_mfuncs[i].name) == len && strncmp(_tms_mfuncs[i].name, expr + start, len) == 0)
+            break;
+    if (i == array_length(_tms_mfuncs))
+    {
+        tms_save_error(ctx->facility, UNDEFINED_FUNCTION, EH_FATAL, expr, start);
+        return NULL;
+    }
+
+    int open = ctx->i++;
+    _tms_mnode *left = _tms_mparse_sum(ctx), *right = NULL;
+    if (left == NULL)
+        return NULL;
+    _tms_mskip_spaces(ctx);
+    if (_tms_mfuncs[i].argc == 2)
+    {
+        if (expr[ctx->i] != ',')
+        {
+            tms_save_error(ctx->facility, TOO_FEW_ARGS, EH_FATAL, expr, ctx->i);
+            _tms_delete_mnode(left);
+            return NULL;
+        }
+        ++ctx->i;
+        right = _tms_mparse_sum(ctx);
+        if (right == NULL)
+        {
+            _tms_delete_mnode(left);
+            return NULL;
+        }
+        _tms_mskip_spaces(ctx);
+    }
+    if (expr[ctx->i] != ')')
+    {
+        tms_save_error(ctx->facility, expr[ctx->i] == ',' ? TOO_MANY_ARGS : PARENTHESIS_NOT_CLOSED, EH_FATAL, expr,
+                       expr[ctx->i] == ',' ? ctx->i : open);
+        _tms_delete_mnode(left);
+        _tms_delete_mnode(right);
+        return NULL;
+    }
+    ++ctx->i;
+    return _tms_mparse_node(ctx, _tms_mfuncs[i].type, start, left, right);
+}
+
+static _tms_mnode *_tms_mparse_unary(_tms_mctx *ctx)
+{
+    _tms_mnode *node;
+    _tms_mskip_spaces(ctx);
+    int start = ctx->i;
+
+    // Signs and parenthesis recurse through here, "+" doesn't add a node so the depth is counted separately
+    if (ctx->depth == TMS_MATRIX_EXPR_MAX_DEPTH)
+    {
+        tms_save_error(ctx->facility, STACK_DEPTH_EXCEEDED, EH_FATAL, ctx->expr, start);
+        return NULL;
+    }
+    ++ctx->depth;
+    if (ctx->expr[start] == '-' || ctx->expr[start] == '+')
+    {
+        ++ctx->i;
+        node = _tms_mparse_unary(ctx);
+        if (node != NULL && ctx->expr[start] == '-')
+            node = _tms_mparse_node(ctx, _TMS_MN_NEG, start, node, NULL);
+    }
+    else
+        node = _tms_mparse_primary(ctx);
+    --ctx->depth;
+    return node;
+}
+
+static _tms_mnode *_tms_mparse_product(_tms_mctx *ctx)
+{
+    _tms_mnode *left = _tms_mparse_unary(ctx), *right;
+    while (left != NULL)
+    {
+        _tms_mskip_spaces(ctx);
+        char op = ctx->expr[ctx->i];
+        if (op != '*' && op != '/')
+            break;
+        int index = ctx->i++;
+        right = _tms_mparse_unary(ctx);
+        if (right == NULL)
+        {
+            _tms_delete_mnode(left);
+            return NULL;
+        }
+        left = _tms_mparse_node(ctx, op == '*' ? _TMS_MN_MUL : _TMS_MN_DIV, index, left, right);
+    }
+    return left;
+}
+
+static _tms_mnode *_tms_mparse_sum(_tms_mctx *ctx)
+{
+    _tms_mnode *left = _tms_mparse_product(ctx), *right;
+    while (left != NULL)
+    {
+        _tms_mskip_spaces(ctx);
+        char op = ctx->expr[ctx->i];
+        if (op != '+' && op != '-')
+            break;
+        int index = ctx->i++;
+        right = _tms_mparse_product(ctx);
+        if (right == NULL)
+        {
+            _tms_delete_mnode(left);
+            return NULL;
+        }
+        left = _tms_mparse_node(ctx, op == '+' ? _TMS_MN_ADD : _TMS_MN_SUB, index, left, right);
+    }
+    return left;
+}
+
+static _tms_mnode *_tms_mparse(_tms_mctx *ctx)
+{
+    _tms_mskip_spaces(ctx);
+    if (ctx->expr[ctx->i] == '\0')
+    {
+        tms_save_error(ctx->facility, NO_INPUT, EH_FATAL, ctx->expr, 0);
+        return NULL;
+    }
+    _tms_mnode *root = _tms_mparse_sum(ctx);
+    if (root == NULL)
+        return NULL;
+    _tms_mskip_spaces(ctx);
+    if (ctx->expr[ctx->i] != '\0')
+    {
+        tms_save_error(ctx->facility, ctx->expr[ctx->i] == ')' ? PARENTHESIS_NOT_OPEN : SYNTAX_ERROR, EH_FATAL,
+                       ctx->expr, ctx->i);
+        _tms_delete_mnode(root);
+        return NULL;
+    }
+    return root;
+}
+
+static int _tms_meval(_tms_mnode *node, _tms_mctx *ctx, _tms_mval *out);
+
+// Saves an error at the position of node, always returns -1
+static int _tms_merror(_tms_mctx *ctx, _tms_mnode *node, const char *msg)
+{
+    tms_save_error(ctx->facility, msg, EH_FATAL, ctx->expr, node->index);
+    return -1;
+}
+
+// Matrix functions report their errors to TMS_MATRIX, move them to the facility of the expression
+static int _tms_mlib_error(_tms_mctx *ctx, _tms_mnode *node)
+{
+    tms_error_data *e = tms_get_last_error(TMS_MATRIX);
+    if (ctx->facility != TMS_MATRIX && e != NULL)
+    {
+        char *msg = strdup(e->message);
+        tms_clear_errors(TMS_MATRIX);
+        _tms_merror(ctx, node, msg);
+        free(msg);
+    }
+    else if (e == NULL)
+        _tms_merror(ctx, node, INTERNAL_ERROR);
+    else
+        tms_modify_last_error(TMS_MATRIX, ctx->expr, node->index, NULL);
+    return -1;
+}
+
+// Evaluates a node that must be a matrix (scalars are accepted as 1x1 matrices if allow_scalar is set)
+static int _tms_meval_matrix(_tms_mnode *node, _tms_mctx *ctx, _tms_mval *out, bool allow_scalar)
+{
+    if (_tms_meval(node, ctx, out) != 0)
+        return -1;
+    if (out->M == NULL)
+    {
+        if (!allow_scalar)
+            return _tms_merror(ctx, node, EXPECTED_MATRIX);
+        out->M = tms_new_matrix(1, 1);
+        out->M->data[0] = out->scalar;
+        out->owned = true;
+    }
+    return 0;
+}
+
+// Replaces B by the solution of A*X = B
+static int _tms_msolve(_tms_mctx *ctx, _tms_mnode *node, tms_matrix *A, _tms_mval *B)
+{
+    if (A->rows != B->M->rows)
+        return _tms_merror(ctx, node, MATRIX_DIMENSIONS_MISMATCH);
+    tms_matrix *X = tms_matrix_solve(A, B->M);
+    if (X == NULL)
+        return _tms_mlib_error(ctx, node);
+    _tms_mval_free(B);
+    B->M = X;
+    B->owned = true;
+    return 0;
+}
+
+static int _tms_minv(_tms_mctx *ctx, _tms_mnode *node, _tms_mval *v)
+{
+    tms_matrix *inverse;
+    if (v->M == NULL)
+    {
+        if (v->scalar == 0)
+            return _tms_merror(ctx, node, DIVISION_BY_ZERO);
+        v->scalar = 1 / v->scalar;
+        return 0;
+    }
+    if (v->M->rows != v->M->columns)
+        return _tms_merror(ctx, node, MATRIX_NOT_SQUARE);
+
+    inverse = tms_matrix_inv(v->M);
+    if (inverse == NULL)
+        return _tms_mlib_error(ctx, node);
+    _tms_mval_free(v);
+    v->M = inverse;
+    v->owned = true;
+    return 0;
+}
+
+static int _tms_mdet(_tms_mctx *ctx, _tms_mnode *node, _tms_mval *v)
+{
+    double det;
+    if (v->M == NULL)
+        return 0;
+    if (v->M->rows != v->M->columns)
+        return _tms_merror(ctx, node, MATRIX_NOT_SQUARE);
+    det = tms_matrix_det(v->M);
+    if (isnan(det))
+        return _tms_mlib_error(ctx, node);
+    _tms_mval_free(v);
+    v->scalar = det;
+    return 0;
+}
+
+static void _tms_mscale(_tms_mval *v, double factor)
+{
+    _tms_mval_own(v);
+    for (int i = 0; i < v->M->rows; ++i)
+        for (int j = 0; j < v->M->columns; ++j)
+            TMS_MATRIX_ROW(v->M, i)[j] *= factor;
+}
+
+static int _tms_meval_mul(_tms_mnode *node, _tms_mctx *ctx, _tms_mval *out)
+{
+    _tms_mval a = {0}, b = {0};
+    tms_matrix *product;
+
+    // inv(X)*Y: solve X*R = Y instead of forming the inverse
+    if (node->left->type == _TMS_MN_INV)
+    {
+        if (_tms_meval(node->left->left, ctx, &a) != 0)
+            return -1;
+        if (_tms_meval(node->right, ctx, &b) != 0)
+        {
+            _tms_mval_free(&a);
+            return -1;
+        }
+        if (a.M != NULL && b.M != NULL)
+        {
+            int status = a.M->rows != a.M->columns ? _tms_merror(ctx, node->left, MATRIX_NOT_SQUARE)
+                                                   : _tms_msolve(ctx, node, a.M, &b);
+            _tms_mval_free(&a);
+            if (status != 0)
+                _tms_mval_free(&b);
+            *out = b;
+            return status;
+        }
+        if (_tms_minv(ctx, node->left, &a) != 0)
+        {
+            _tms_mval_free(&b);
+            return -1;
+        }
+    }
+    // X*inv(Y) = transpose(solve(tr(Y), tr(X)))
+    else if (node->right->type == _TMS_MN_INV)
+    {
+        if (_tms_meval(node->left, ctx, &a) != 0)
+            return -1;
+        if (_tms_meval(node->right->left, ctx, &b) != 0)
+        {
+            _tms_mval_free(&a);
+            return -1;
+        }
+        if (a.M != NULL && b.M != NULL)
+        {
+            int status;
+            if (b.M->rows != b.M->columns)
+                status = _tms_merror(ctx, node->right, MATRIX_NOT_SQUARE);
+            else
+            {
+                tms_matrix *Yt = tms_matrix_tr(b.M);
+                _tms_mval Xt = {.M = tms_matrix_tr(a.M), .owned = true};
+                status = _tms_msolve(ctx, node, Yt, &Xt);
+                tms_delete_matrix(Yt);
+                if (status == 0)
+                {
+                    out->M = tms_matrix_tr(Xt.M);
+                    out->owned = true;
+                }
+                _tms_mval_free(&Xt);
+            }
+            _tms_mval_free(&a);
+            _tms_mval_free(&b);
+            return status;
+        }
+        if (_tms_minv(ctx, node->right, &b) != 0)
+        {
+            _tms_mval_free(&a);
+            return -1;
+        }
+    }
+    else
+    {
+        if (_tms_meval(node->left, ctx, &a) != 0)
+            return -1;
+        if (_tms_meval(node->right, ctx, &b) != 0)
+        {
+            _tms_mval_free(&a);
+            return -1;
+        }
+    }
+
+    if (a.M == NULL && b.M == NULL)
+    {
+        out->scalar = a.scalar * b.scalar;
+        return 0;
+    }
+    else if (a.M == NULL || b.M == NULL)
+    {
+        *out = a.M == NULL ? b : a;
+        _tms_mscale(out, a.M == NULL ? a.scalar : b.scalar);
+        return 0;
+    }
+
+    if (a.M->columns != b.M->rows)
+    {
+        _tms_mval_free(&a);
+        _tms_mval_free(&b);
+        return _tms_merror(ctx, node, MATRIX_DIMENSIONS_MISMATCH);
+    }
+    product = tms_matrix_multiply(a.M, b.M);
+    _tms_mval_free(&a);
+    _tms_mval_free(&b);
+    out->M = product;
+    out->owned = true;
+    return 0;
+}
+
+static int _tms_meval_add(_tms_mnode *node, _tms_mctx *ctx, _tms_mval *out)
+{
+    _tms_mval a = {0}, b = {0};
+    double sign = node->type == _TMS_MN_ADD ? 1 : -1;
+    if (_tms_meval(node->left, ctx, &a) != 0)
+        return -1;
+    if (_tms_meval(node->right, ctx, &b) != 0)
+    {
+        _tms_mval_free(&a);
+        return -1;
+    }
+
+    if (a.M == NULL && b.M == NULL)
+    {
+        out->scalar = a.scalar + sign * b.scalar;
+        return 0;
+    }
+    if (a.M == NULL || b.M == NULL || a.M->rows != b.M->rows || a.M->columns != b.M->columns)
+    {
+        _tms_mval_free(&a);
+        _tms_mval_free(&b);
+        return _tms_merror(ctx, node, MATRIX_DIMENSIONS_MISMATCH);
+    }
+
+    _tms_mval_own(&a);
+    for (int i = 0; i < a.M->rows; ++i)
+    {
+        double *row_a = TMS_MATRIX_ROW(a.M, i), *row_b = TMS_MATRIX_ROW(b.M, i);
+        for (int j = 0; j < a.M->columns; ++j)
+            row_a[j] += sign * row_b[j];
+    }
+    _tms_mval_free(&b);
+    *out = a;
+    return 0;
+}
+
+static int _tms_meval(_tms_mnode *node, _tms_mctx *ctx, _tms_mval *out)
+{
+    _tms_mval a = {0}, b = {0};
+    *out = (_tms_mval){0};
+
+    switch (node->type)
+    {
+    case _TMS_MN_NUMBER:
+        out->scalar = node->number;
+        return 0;
+
+    case _TMS_MN_VAR:
+        out->M = node->var;
+        return 0;
+
+    case _TMS_MN_ADD:
+    case _TMS_MN_SUB:
+        return _tms_meval_add(node, ctx, out);
+
+    case _TMS_MN_MUL:
+        return _tms_meval_mul(node, ctx, out);
+
+    case _TMS_MN_DIV:
+        if (_tms_meval(node->left, ctx, out) != 0)
+            return -1;
+        if (_tms_meval(node->right, ctx, &b) != 0)
+        {
+            _tms_mval_free(out);
+            return -1;
+        }
+        if (b.M != NULL)
+        {
+            _tms_mval_free(out);
+            _tms_mval_free(&b);
+            return _tms_merror(ctx, node, MATRIX_DIVISION);
+        }
+        if (b.scalar == 0)
+        {
+            _tms_mval_free(out);
+            return _tms_merror(ctx, node, DIVISION_BY_ZERO);
+        }
+        if (out->M == NULL)
+            out->scalar /= b.scalar;
+        else
+            _tms_mscale(out, 1 / b.scalar);
+        return 0;
+
+    case _TMS_MN_NEG:
+        if (_tms_meval(node->left, ctx, out) != 0)
+            return -1;
+        if (out->M == NULL)
+            out->scalar = -out->scalar;
+        else
+            _tms_mscale(out, -1);
+        return 0;
+
+    case _TMS_MN_INV:
+        // inv(inv(X)) = X
+        if (node->left->type == _TMS_MN_INV)
+            return _tms_meval(node->left->left, ctx, out);
+        if (_tms_meval(node->left, ctx, out) != 0)
+            return -1;
+        if (_tms_minv(ctx, node, out) != 0)
+        {
+            _tms_mval_free(out);
+            return -1;
+        }
+        return 0;
+
+    case _TMS_MN_TR:
+        // tr(tr(X)) = X
+        if (node->left->type == _TMS_MN_TR)
+            return _tms_meval(node->left->left, ctx, out);
+        if (_tms_meval(node->left, ctx, out) != 0)
+            return -1;
+        if (out->M != NULL)
+        {
+            tms_matrix *transpose = tms_matrix_tr(out->M);
+            _tms_mval_free(out);
+            out->M = transpose;
+            out->owned = true;
+        }
+        return 0;
+
+    case _TMS_MN_DET:
+        // det(inv(X)) = 1/det(X)
+        if (node->left->type == _TMS_MN_INV)
+        {
+            if (_tms_meval(node->left->left, ctx, out) != 0 || _tms_mdet(ctx, node, out) != 0)
+            {
+                _tms_mval_free(out);
+                return -1;
+            }
+            if (out->scalar == 0)
+                return _tms_merror(ctx, node->left, SINGULAR_MATRIX);
+            out->scalar = 1 / out->scalar;
+            return 0;
+        }
+        // det(tr(X)) = det(X)
+        if (node->left->type == _TMS_MN_TR)
+            node = node->left;
+        // det(X*Y) = det(X)*det(Y) if both are square, avoids the product
+        else if (node->left->type == _TMS_MN_MUL && node->left->left->type != _TMS_MN_INV &&
+                 node->left->right->type != _TMS_MN_INV)
+        {
+            if (_tms_meval(node->left->left, ctx, &a) != 0)
+                return -1;
+            if (_tms_meval(node->left->right, ctx, &b) != 0)
+            {
+                _tms_mval_free(&a);
+                return -1;
+            }
+            if (a.M != NULL && b.M != NULL && a.M->rows == a.M->columns && b.M->rows == b.M->columns &&
+                a.M->rows == b.M->rows)
+            {
+                int status = _tms_mdet(ctx, node, &a) != 0 || _tms_mdet(ctx, node, &b) != 0 ? -1 : 0;
+                if (status == 0)
+                    out->scalar = a.scalar * b.scalar;
+                _tms_mval_free(&a);
+                _tms_mval_free(&b);
+                return status;
+            }
+            _tms_mval_free(&a);
+            _tms_mval_free(&b);
+        }
+        if (_tms_meval(node->left, ctx, out) != 0 || _tms_mdet(ctx, node, out) != 0)
+        {
+            _tms_mval_free(out);
+            return -1;
+        }
+        return 0;
+
+    case _TMS_MN_TRACE:
+        // trace(X*Y) = sum of X[i][k]*Y[k][i], O(n^2) instead of the O(n^3) product
+        if (node->left->type == _TMS_MN_MUL && node->left->left->type != _TMS_MN_INV &&
+            node->left->right->type != _TMS_MN_INV)
+        {
+            if (_tms_meval(node->left->left, ctx, &a) != 0)
+                return -1;
+            if (_tms_meval(node->left->right, ctx, &b) != 0)
+            {
+                _tms_mval_free(&a);
+                return -1;
+            }
+            if (a.M != NULL && b.M != NULL && a.M->rows == b.M->columns && a.M->columns == b.M->rows)
+            {
+                double trace = 0;
+                for (int i = 0; i < a.M->rows; ++i)
+                {
+                    double *row_a = TMS_MATRIX_ROW(a.M, i);
+                    for (int k = 0; k < a.M->columns; ++k)
+                        trace += row_a[k] * TMS_MATRIX_ROW(b.M, k)[i];
+                }
+                _tms_mval_free(&a);
+                _tms_mval_free(&b);
+                out->scalar = trace;
+                return 0;
+            }
+            _tms_mval_free(&a);
+            _tms_mval_free(&b);
+        }
+        if (_tms_meval(node->left, ctx, out) != 0)
+            return -1;
+        if (out->M != NULL)
+        {
+            double trace = 0;
+            if (out->M->rows != out->M->columns)
+            {
+                _tms_mval_free(out);
+                return _tms_merror(ctx, node, MATRIX_NOT_SQUARE);
+            }
+            for (int i = 0; i < out->M->rows; ++i)
+                trace += TMS_MATRIX_ROW(out->M, i)[i];
+            _tms_mval_free(out);
+            out->scalar = trace;
+        }
+        return 0;
+
+    case _TMS_MN_SOLVE:
+        if (_tms_meval_matrix(node->left, ctx, &a, true) != 0)
+            return -1;
+        if (_tms_meval_matrix(node->right, ctx, out, false) != 0)
+        {
+            _tms_mval_free(&a);
+            return -1;
+        }
+        if (_tms_msolve(ctx, node, a.M, out) != 0)
+        {
+            _tms_mval_free(&a);
+            _tms_mval_free(out);
+            return -1;
+        }
+        _tms_mval_free(&a);
+        return 0;
+
+    default:
+        return _tms_merror(ctx, node, INTERNAL_ERROR);
+    }
+}
+
+// Parses and evaluates expr, errors are reported to facility
+static int _tms_matrix_eval(_tms_mctx *ctx, int root_type, _tms_mval *result)
+{
+    int status = -1;
+    pthread_mutex_lock(&_matrix_variables_lock);
+    _tms_mnode *root = _tms_mparse(ctx);
+    if (root != NULL)
+    {
+        // Wrap the expression in a function (det/trace called from scientific expressions)
+        if (root_type != -1)
+            root = _tms_new_mnode(root_type, 0, root, NULL);
+        status = _tms_meval(root, ctx, result);
+        // Variables can't be used once the lock is released
+        if (status == 0)
+            _tms_mval_own(result);
+    }
+    _tms_delete_mnode(root);
+    pthread_mutex_unlock(&_matrix_variables_lock);
+    return status;
+}
+
+tms_matrix *tms_matrix_eval(const char *expr)
+{
+    _tms_mctx ctx = {.expr = expr, .i = 0, .facility = TMS_MATRIX};
+    _tms_mval result;
+    if (_tms_matrix_eval(&ctx, -1, &result) != 0)
+        return NULL;
+    if (result.M == NULL)
+    {
+        result.M = tms_new_matrix(1, 1);
+        result.M->data[0] = result.scalar;
+    }
+    return result.M;
+}
+
+static int _tms_matrix_extf(tms_arg_list *args, tms_arg_list *labels, int root_type, cdouble *result)
+{
+    if (_tms_validate_args_count(1, args->count, TMS_EVALUATOR) == false)
+        return -1;
+
+    _tms_mctx ctx = {.expr = args->arguments[0], .i = 0, .facility = TMS_EVALUATOR, .labels = labels};
+    _tms_mval value;
+    if (_tms_matrix_eval(&ctx, root_type, &value) != 0)
+        return -1;
+    *result = value.scalar;
+    return 0;
+}
+
+int _tms_det(tms_arg_list *args, tms_arg_list *labels, cdouble *result)
+{
+    return _tms_matrix_extf(args, labels, _TMS_MN_DET, result);
+}
+
+int _tms_trace(tms_arg_list *args, tms_arg_list *labels, cdouble *result)
+{
+    return _tms_matrix_extf(args, labels, _TMS_MN_TRACE, result);
+}
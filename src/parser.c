@@ -12,12 +12,17 @@ SPDX-License-Identifier: LGPL-2.1-only
 #include "evaluator.h"
 #include "function.h"
 #include "internals.h"
+#include "jit.h"
 #include "parser.h"
+#include "profile.h"
+#include "stats_common.h"
 #include "string_tools.h"
 #include "tms_complex.h"
 #include "tms_math_strs.h"
 
 #define dup_mexpr tms_dup_mexpr
+// The scientific expression has JIT state to reset on creation and duplication
+#define HAS_JIT_STATE
 
 #include "parser_common.h"
 
@@ -180,10 +185,12 @@ tms_math_expr *tms_parse_expr(const char *expr, int options, tms_arg_list *label
         fputs(ERROR_DB_NOT_EMPTY, stderr);
         tms_clear_errors(TMS_PARSER);
     }
+    uint64_t stats_start = _tms_stats_begin(TMS_STAT_PARSE);
     // expr is constant, but we need to do some modifications (remove whitespaces, combine some symbols...)
     // We need a writable copy
     char *dup_expr = strdup(expr);
     tms_math_expr *M = _tms_parse_expr_unsafe(dup_expr, options, labels);
+    _tms_stats_end(TMS_STAT_PARSE, stats_start);
     if (M == NULL && (options & PRINT_ERRORS) != 0)
         tms_print_errors(TMS_PARSER);
 
@@ -221,11 +228,22 @@ tms_math_expr *_tms_parse_expr_unsafe(char *expr, int options, tms_arg_list *lab
     _tms_combine_add_sub(expr);
     // Expand unary operators into functions
     if ((options & EXPAND_UOPS) != 0)
+    {
+        uint64_t stats_start = _tms_stats_begin(TMS_STAT_EXPAND_MACROS);
         _tms_expand_macros(&expr);
+        _tms_stats_end(TMS_STAT_EXPAND_MACROS, stats_start);
+    }
+
+    // Split the expression into tokens once, the following steps work on the tokens instead of rescanning the string
+    tms_token_list T;
+    _tms_tokenize(expr, &T);
 
-    tms_math_expr *M = _tms_init_math_expr(expr);
+    tms_math_expr *M = _tms_init_math_expr(expr, &T);
     if (M == NULL)
+    {
+        free(T.tokens);
         return NULL;
+    }
     else
         M->enable_complex = enable_complex;
 
@@ -268,15 +286,17 @@ tms_math_expr *_tms_parse_expr_unsafe(char *expr, int options, tms_arg_list *lab
         status = _tms_set_rcfunction_ptr(expr, M, s_i);
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_math_expr(M);
             return NULL;
         }
 
         // Get an array of the index of all operators and set their count
-        int *operator_index = _tms_get_operator_indexes(expr, S, s_i);
+        int *operator_index = _tms_get_operator_indexes(expr, S, s_i, &T);
 
         if (operator_index == NULL)
         {
+            free(T.tokens);
             tms_delete_math_expr(M);
             return NULL;
         }
@@ -287,13 +307,15 @@ tms_math_expr *_tms_parse_expr_unsafe(char *expr, int options, tms_arg_list *lab
         // Exiting due to error
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_math_expr(M);
             return NULL;
         }
 
-        status = _tms_set_all_operands(M, s_i, enable_labels);
+        status = _tms_set_all_operands(M, s_i, enable_labels, &T);
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_math_expr(M);
             return NULL;
         }
@@ -301,11 +323,13 @@ tms_math_expr *_tms_parse_expr_unsafe(char *expr, int options, tms_arg_list *lab
         status = _tms_set_evaluation_order(S + s_i);
         if (status == -1)
         {
+            free(T.tokens);
             tms_delete_math_expr(M);
             return NULL;
         }
         _tms_set_result_pointers(M, s_i);
     }
+    free(T.tokens);
 
     // Set labels metadata
     if (enable_labels)
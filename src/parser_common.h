@@ -27,27 +27,168 @@ SPDX-License-Identifier: LGPL-2.1-only
 #define MAX_PRIORITY 3
 #endif
 
-static int _tms_set_operand(math_expr *M, op_node *N, int op_start, int s_i, char operand, bool enable_labels);
+// Token types generated by the lexer
+enum tms_token_type
+{
+    TMS_TOK_OPERAND,
+    TMS_TOK_OP,
+    TMS_TOK_SIGN,
+    TMS_TOK_LPAREN,
+    TMS_TOK_RPAREN,
+    TMS_TOK_COMMA,
+    TMS_TOK_OTHER
+};
+
+typedef struct tms_token
+{
+    // Index of the first char of the token in the expression
+    int start;
+    int len;
+    // For parenthesis: index of the token of the matching parenthesis, -1 if none
+    int match;
+    // For open parenthesis: index of the subexpression it opens, -1 if none
+    int subexpr;
+    uint8_t type;
+} tms_token;
+
+typedef struct tms_token_list
+{
+    tms_token *tokens;
+    int count;
+} tms_token_list;
 
-static int _tms_find_subexpr_starting_at(math_subexpr *S, int start, int s_i, int8_t mode);
+static int _tms_set_operand(math_expr *M, op_node *N, int op_start, char operand, bool enable_labels, tms_token_list *T);
+
+static int _tms_find_subexpr_starting_at(math_subexpr *S, int start, tms_token_list *T);
 
 static int _tms_set_evaluation_order(math_subexpr *S);
 
 static void _tms_generate_labels_refs(math_expr *M);
 
-static int compare_subexpr_depth(const void *a, const void *b)
+static void _tms_tokenize(const char *expr, tms_token_list *T)
 {
-    if (((math_subexpr *)a)->depth < ((math_subexpr *)b)->depth)
-        return 1;
-    else if ((*((math_subexpr *)a)).depth > (*((math_subexpr *)b)).depth)
-        return -1;
-    else
-        return 0;
+    int i = 0, t = 0, t_max = 64, long_op_len;
+    // Start of the current run of name characters, used to detect the scientific notation
+    int run_start = -1;
+    // Stack of open parenthesis tokens, used to pair each parenthesis in the same pass
+    int p_top = 0, p_max = 16;
+    int *p_stack = malloc(p_max * sizeof(int));
+    tms_token *tokens = malloc(t_max * sizeof(tms_token));
+    char c;
+
+    while ((c = expr[i]) != '\0')
+    {
+        DYNAMIC_RESIZE(tokens, t, t_max, tms_token)
+        tokens[t].start = i;
+        tokens[t].len = 1;
+        tokens[t].match = -1;
+        tokens[t].subexpr = -1;
+
+        if (c == '(')
+        {
+            tokens[t].type = TMS_TOK_LPAREN;
+            DYNAMIC_RESIZE(p_stack, p_top, p_max, int)
+            p_stack[p_top++] = t;
+            run_start = -1;
+        }
+        else if (c == ')')
+        {
+            tokens[t].type = TMS_TOK_RPAREN;
+            if (p_top > 0)
+            {
+                tokens[t].match = p_stack[--p_top];
+                tokens[tokens[t].match].match = t;
+            }
+            run_start = -1;
+        }
+        else if (tms_legal_char_in_name(c) || c == '.')
+        {
+            // Variables and numbers (including the dot and sign of a scientific notation) form a single token
+            if (t > 0 && tokens[t - 1].type == TMS_TOK_OPERAND && tokens[t - 1].start + tokens[t - 1].len == i)
+            {
+                ++tokens[t - 1].len;
+                --t;
+            }
+            else
+                tokens[t].type = TMS_TOK_OPERAND;
+
+            if (c == '.')
+                run_start = -1;
+            else if (run_start == -1)
+                run_start = i;
+        }
+        else if ((long_op_len = is_long_op(expr + i)))
+        {
+            tokens[t].type = TMS_TOK_OP;
+            tokens[t].len = long_op_len;
+            i += long_op_len - 1;
+            run_start = -1;
+        }
+        else if (is_op(c))
+        {
+            // A + or - used in scientific notation (like 1e+5) is part of the number
+            // Not every "e" followed by + is a scientific notation, the run of name characters should be a decimal number
+            if ((c == '+' || c == '-') && i > 0 && (expr[i - 1] == 'e' || expr[i - 1] == 'E') && run_start != -1 &&
+                tms_isdigit(expr[run_start]) != -1 && tms_detect_base(expr + run_start) == 10)
+            {
+                ++tokens[t - 1].len;
+                run_start = -1;
+                ++i;
+                continue;
+            }
+            tokens[t].type = TMS_TOK_OP;
+            run_start = -1;
+        }
+        else if (c == ',')
+        {
+            tokens[t].type = TMS_TOK_COMMA;
+            run_start = -1;
+        }
+        else
+        {
+            tokens[t].type = TMS_TOK_OTHER;
+            run_start = -1;
+        }
+
+        // A + or - located just after an operator is the sign of the next operand
+        if (tokens[t].type == TMS_TOK_OP && (expr[i + 1] == '-' || expr[i + 1] == '+'))
+        {
+            ++t;
+            ++i;
+            DYNAMIC_RESIZE(tokens, t, t_max, tms_token)
+            tokens[t].start = i;
+            tokens[t].len = 1;
+            tokens[t].match = -1;
+            tokens[t].subexpr = -1;
+            tokens[t].type = TMS_TOK_SIGN;
+        }
+        ++t;
+        ++i;
+    }
+    free(p_stack);
+    T->tokens = tokens;
+    T->count = t;
 }
 
-math_expr *init_math_expr(char *expr)
+// Returns the index of the first token starting at or after "start"
+static int _tms_find_token(tms_token_list *T, int start)
 {
-    int s_max = 8, i, s_i, length = strlen(expr), s_count;
+    int low = 0, high = T->count;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (T->tokens[mid].start < start)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+math_expr *init_math_expr(char *expr, tms_token_list *T)
+{
+    int s_max = 8, i, t, s_i, length = strlen(expr), s_count, max_depth = 0;
+    tms_token *tokens = T->tokens;
 
     // Pointer to subexpressions heap array
     math_subexpr *S;
@@ -61,6 +202,11 @@ math_expr *init_math_expr(char *expr)
     M->S = NULL;
     M->subexpr_count = 0;
     M->expr = expr;
+    M->profile = NULL;
+#ifdef HAS_JIT_STATE
+    M->eval_count = 0;
+    M->jit = NULL;
+#endif
 
     S = malloc(s_max * sizeof(math_subexpr));
 
@@ -68,14 +214,19 @@ math_expr *init_math_expr(char *expr)
     s_i = 0;
     bool is_extended_or_runtime;
     // Determine the depth and start/end of each subexpression parenthesis
-    for (i = 0; i < length; ++i)
+    for (t = 0; t < T->count; ++t)
     {
-        if (expr[i] == '(')
+        i = tokens[t].start;
+        if (tokens[t].type == TMS_TOK_LPAREN)
         {
             DYNAMIC_RESIZE(S, s_i, s_max, math_subexpr)
             is_extended_or_runtime = false;
             S[s_i].nodes = NULL;
+            S[s_i].result = NULL;
             S[s_i].depth = ++depth;
+            tokens[t].subexpr = s_i;
+            if (depth > max_depth)
+                max_depth = depth;
 
             // Treat extended functions as a subexpression
             if (i > 0 && tms_legal_char_in_name(expr[i - 1]))
@@ -108,7 +259,7 @@ math_expr *init_math_expr(char *expr)
                     is_extended_or_runtime = true;
                     S[s_i].subexpr_start = i - strlen(name);
                     S[s_i].solve_start = i + 1;
-                    S[s_i].solve_end = tms_find_closing_parenthesis(expr, i) - 1;
+                    S[s_i].solve_end = (tokens[t].match == -1 ? -2 : tokens[tokens[t].match].start - 1);
                     if (S[s_i].solve_end != -2)
                     {
                         S[s_i].start_node = -1;
@@ -116,8 +267,8 @@ math_expr *init_math_expr(char *expr)
                         char *arguments = tms_strndup(expr + i + 1, S[s_i].solve_end - i);
                         S[s_i].f_args = tms_get_args(arguments);
                         free(arguments);
-                        // Set "i" at the end of the subexpression to avoid iterating within the extended/user function
-                        i = S[s_i].solve_end;
+                        // Jump to the closing parenthesis to avoid iterating within the extended/user function
+                        t = tokens[t].match - 1;
 
                         // Specific to extended functions
                         if (extf_i != NULL)
@@ -151,7 +302,7 @@ math_expr *init_math_expr(char *expr)
 
                 // The expression start is the parenthesis, may change if a function is found
                 S[s_i].subexpr_start = i;
-                S[s_i].solve_end = tms_find_closing_parenthesis(expr, i) - 1;
+                S[s_i].solve_end = (tokens[t].match == -1 ? -2 : tokens[tokens[t].match].start - 1);
 
                 // Empty parenthesis pair is only allowed for extended functions
                 if (S[s_i].solve_end == i)
@@ -173,7 +324,7 @@ math_expr *init_math_expr(char *expr)
             }
             ++s_i;
         }
-        else if (expr[i] == ')')
+        else if (tokens[t].type == TMS_TOK_RPAREN)
         {
             // An extra ')'
             if (depth == 0)
@@ -198,37 +349,65 @@ math_expr *init_math_expr(char *expr)
     }
     // + 1 for the subexpression with depth 0
     s_count = s_i + 1;
-    // Shrink the block to the required size
     S = realloc(S, s_count * sizeof(math_subexpr));
 
-    // Copy the pointer to the structure
-    M->S = S;
-
-    M->subexpr_count = s_count;
-
     // The whole expression's "subexpression"
     S[s_i].depth = 0;
     S[s_i].solve_start = S[s_i].subexpr_start = 0;
     S[s_i].solve_end = length - 1;
     S[s_i].func.extended = NULL;
     S[s_i].nodes = NULL;
+    S[s_i].result = NULL;
     S[s_i].func_type = TMS_NOFUNC;
     S[s_i].exec_extf = true;
     S[s_i].f_args = NULL;
 
-    // Sort by depth (high to low)
-    qsort(S, s_count, sizeof(math_subexpr), compare_subexpr_depth);
+    // Sort by depth (high to low) using a counting sort, subexpressions of the same depth keep their order
+    // depth_start[d] is the first index in the sorted array for subexpressions of depth d
+    int *depth_start = calloc(max_depth + 1, sizeof(int));
+    int *new_index = malloc(s_count * sizeof(int));
+    math_subexpr *sorted_S = malloc(s_count * sizeof(math_subexpr));
+
+    for (s_i = 0; s_i < s_count; ++s_i)
+        ++depth_start[S[s_i].depth];
+
+    for (i = max_depth, t = 0; i >= 0; --i)
+    {
+        int tmp = depth_start[i];
+        depth_start[i] = t;
+        t += tmp;
+    }
+
+    for (s_i = 0; s_i < s_count; ++s_i)
+    {
+        new_index[s_i] = depth_start[S[s_i].depth]++;
+        sorted_S[new_index[s_i]] = S[s_i];
+    }
+
+    // Link the parenthesis tokens to the sorted subexpressions
+    for (t = 0; t < T->count; ++t)
+    {
+        if (tokens[t].subexpr != -1)
+            tokens[t].subexpr = new_index[tokens[t].subexpr];
+    }
+
+    free(S);
+    free(depth_start);
+    free(new_index);
+
+    M->S = sorted_S;
+    M->subexpr_count = s_count;
     return M;
 }
 
-static int *_tms_get_operator_indexes(const char *expr, math_subexpr *S, int s_i)
+static int *_tms_get_operator_indexes(const char *expr, math_subexpr *S, int s_i, tms_token_list *T)
 {
     // For simplicity
     int solve_start = S[s_i].solve_start;
     int solve_end = S[s_i].solve_end;
     int buffer_size = 16;
     int op_count = 0;
-    int long_op_len;
+    tms_token *tokens = T->tokens;
 
     if (solve_start > solve_end)
     {
@@ -238,70 +417,39 @@ static int *_tms_get_operator_indexes(const char *expr, math_subexpr *S, int s_i
 
     int *operator_index = (int *)malloc(buffer_size * sizeof(int));
     // Count number of operators and store it's indexes
-    for (int i = solve_start; i <= solve_end; ++i)
+    for (int t = _tms_find_token(T, solve_start); t < T->count && tokens[t].start <= solve_end; ++t)
     {
-        // Skip an already processed expression
-        if (expr[i] == '(')
+        switch (tokens[t].type)
         {
-            int previous_subexp;
-            previous_subexp = _tms_find_subexpr_starting_at(S, i + 1, s_i, 2);
-            if (previous_subexp != -1)
-                i = S[previous_subexp].solve_end + 1;
-        }
-        else if (tms_legal_char_in_name(expr[i]) || expr[i] == '.') // Skip variables and regular numbers
-            continue;
-        // Long operators are like >>, <<, <<<, >>>, //
-        else if ((long_op_len = is_long_op(expr + i)))
-        {
-            // Varying the array size on demand
-            DYNAMIC_RESIZE(operator_index, op_count, buffer_size, int)
-
-            operator_index[op_count] = i;
-            // Reach the end of the long operator
-            i += long_op_len - 1;
+        // Skip an already processed expression
+        case TMS_TOK_LPAREN:
+            t = tokens[t].match;
+            break;
 
-            // Skip a + or - located just after an operator
-            if (expr[i + 1] == '-' || expr[i + 1] == '+')
-                ++i;
+        // Skip variables, regular numbers and the sign of operands
+        case TMS_TOK_OPERAND:
+        case TMS_TOK_SIGN:
+            break;
 
-            ++op_count;
-        }
-        else if (is_op(expr[i]))
-        {
-            // Skip a + or - used in scientific notation (like 1e+5)
-            if (i > 0 && (expr[i - 1] == 'e' || expr[i - 1] == 'E') && (expr[i] == '+' || expr[i] == '-'))
-            {
-                // Not every "e" followed by + is a scientific notation
-                // Maybe a variable name that ends with an "e" is being added to something?
-                int tmp = tms_name_bounds(expr, i - 1, false);
-
-                // Not a valid name (either a number or something messed up, which will be caught later)
-                if (tmp == -1)
-                    continue;
-            }
+        case TMS_TOK_OP:
             // Varying the array size on demand
             DYNAMIC_RESIZE(operator_index, op_count, buffer_size, int)
-
-            operator_index[op_count] = i;
-            // Skip a + or - located just after an operator
-            if (expr[i + 1] == '-' || expr[i + 1] == '+')
-                ++i;
+            operator_index[op_count] = tokens[t].start;
             ++op_count;
-        }
-        else if (expr[i] == ',')
-        {
+            break;
+
+        case TMS_TOK_COMMA:
             // There is a function before the parenthesis
             if (S->solve_start > S->subexpr_start + 1)
-                tms_save_error(PARSER, UNEXPECTED_COMMA_W_SIMPLE_FUNC, EH_FATAL, expr, i);
+                tms_save_error(PARSER, UNEXPECTED_COMMA_W_SIMPLE_FUNC, EH_FATAL, expr, tokens[t].start);
             else
-                tms_save_error(PARSER, SYNTAX_ERROR, EH_FATAL, expr, i);
+                tms_save_error(PARSER, SYNTAX_ERROR, EH_FATAL, expr, tokens[t].start);
             free(operator_index);
             return NULL;
-        }
-        else
-        {
+
+        default:
             // Not a subexpr, nor a number or an operand, so it is a syntax error
-            tms_save_error(PARSER, SYNTAX_ERROR, EH_FATAL, expr, i);
+            tms_save_error(PARSER, SYNTAX_ERROR, EH_FATAL, expr, tokens[t].start);
             free(operator_index);
             return NULL;
         }
@@ -448,7 +596,7 @@ static void _tms_set_result_pointers(math_expr *M, int s_i)
         tmp_node->result = &M->answer;
 }
 
-static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
+static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels, tms_token_list *T)
 {
     math_subexpr *S = M->S;
     char *expr = M->expr;
@@ -460,7 +608,7 @@ static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
     if (op_count == 0)
     {
         // Read to the left operand
-        if (_tms_set_operand(M, NB, solve_start, s_i, 'l', enable_labels))
+        if (_tms_set_operand(M, NB, solve_start, 'l', enable_labels, T))
             return -1;
         else
             return 0;
@@ -480,7 +628,7 @@ static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
     }
     else
     {
-        status = _tms_set_operand(M, NB, solve_start, s_i, 'l', enable_labels);
+        status = _tms_set_operand(M, NB, solve_start, 'l', enable_labels, T);
         if (status == -1)
             return -1;
     }
@@ -497,7 +645,7 @@ static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
         if (i == op_count - 1)
         {
             // Set the last operand as the right operand of the last node
-            status = _tms_set_operand(M, NB + i, operand_start, s_i, 'r', enable_labels);
+            status = _tms_set_operand(M, NB + i, operand_start, 'r', enable_labels, T);
             if (status == -1)
                 return -1;
         }
@@ -507,7 +655,7 @@ static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
             // same in case of x-y+z
             if (NB[i].priority >= NB[i + 1].priority)
             {
-                status = _tms_set_operand(M, NB + i, operand_start, s_i, 'r', enable_labels);
+                status = _tms_set_operand(M, NB + i, operand_start, 'r', enable_labels, T);
                 if (status == -1)
                     return -1;
             }
@@ -515,7 +663,7 @@ static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
             // x+y^z : y is set in the node containing z (node i+1) as the left operand
             else
             {
-                status = _tms_set_operand(M, NB + i + 1, operand_start, s_i, 'l', enable_labels);
+                status = _tms_set_operand(M, NB + i + 1, operand_start, 'l', enable_labels, T);
                 if (status == -1)
                     return -1;
             }
@@ -524,41 +672,26 @@ static int _tms_set_all_operands(math_expr *M, int s_i, bool enable_labels)
     return 0;
 }
 
-static int _tms_find_subexpr_starting_at(math_subexpr *S, int start, int s_i, int8_t mode)
+static int _tms_find_subexpr_starting_at(math_subexpr *S, int start, tms_token_list *T)
 {
-    int i;
-    // If a subexpression is an operand in another subexpression, it will have a depth higher by only 1
-    // Skip deeper subexpression to reduce search time
-    int target_depth = S[s_i].depth + 1;
-    i = s_i - 1;
+    tms_token *tokens = T->tokens;
+    int t = _tms_find_token(T, start);
 
-    switch (mode)
-    {
-    case 1:
-        while (i >= 0)
-        {
-            if (S[i].depth > target_depth)
-                break;
+    if (t == T->count || tokens[t].start != start)
+        return -1;
 
-            if (S[i].subexpr_start == start)
-                return i;
-            else
-                --i;
-        }
-        break;
-    case 2:
-        while (i >= 0)
-        {
-            if (S[i].depth > target_depth)
-                break;
+    // The subexpression could start with a function name
+    if (tokens[t].type == TMS_TOK_OPERAND && t + 1 < T->count)
+        ++t;
 
-            if (S[i].solve_start == start)
-                return i;
-            else
-                --i;
-        }
-    }
-    return -1;
+    // Use the link between the parenthesis and the subexpression instead of searching
+    if (tokens[t].type != TMS_TOK_LPAREN || tokens[t].subexpr == -1)
+        return -1;
+
+    if (S[tokens[t].subexpr].subexpr_start == start)
+        return tokens[t].subexpr;
+    else
+        return -1;
 }
 
 static int _tms_set_labels(math_expr *M, int start, op_node *x_node, char rl)
@@ -566,6 +699,18 @@ static int _tms_set_labels(math_expr *M, int start, op_node *x_node, char rl)
     char *expr = M->expr;
     bool is_negative = false;
 
+    // The sign of the operand (ex: x*-y)
+    if (expr[start] == '+')
+    {
+        is_negative = false;
+        ++start;
+    }
+    else if (expr[start] == '-')
+    {
+        is_negative = true;
+        ++start;
+    }
+
     char *name = tms_get_name(expr, start, true);
     if (name == NULL)
     {
@@ -578,17 +723,6 @@ static int _tms_set_labels(math_expr *M, int start, op_node *x_node, char rl)
     if (id == -1)
         return -1;
 
-    if (expr[start] == '+')
-    {
-        is_negative = false;
-        ++start;
-    }
-    else if (expr[start] == '-')
-    {
-        is_negative = true;
-        ++start;
-    }
-
     if (rl == 'l')
     {
         x_node->labels |= LABEL_LEFT;
@@ -612,7 +746,7 @@ static int _tms_set_labels(math_expr *M, int start, op_node *x_node, char rl)
     return 0;
 }
 
-static int _tms_set_operand(math_expr *M, op_node *N, int op_start, int s_i, char operand, bool enable_labels)
+static int _tms_set_operand(math_expr *M, op_node *N, int op_start, char operand, bool enable_labels, tms_token_list *T)
 {
     math_subexpr *S = M->S;
     operand_type *operand_ptr;
@@ -633,7 +767,7 @@ static int _tms_set_operand(math_expr *M, op_node *N, int op_start, int s_i, cha
     }
 
     // Check if the operand is the result of a subexpression
-    tmp = _tms_find_subexpr_starting_at(S, op_start, s_i, 1);
+    tmp = _tms_find_subexpr_starting_at(S, op_start, T);
 
     // The operand is a variable or a numeric value
     if (tmp == -1)
@@ -746,6 +880,13 @@ math_expr *dup_mexpr(math_expr *M)
     math_expr *NM = malloc(sizeof(math_expr));
     // Copy the math expression
     *NM = *M;
+    // The profile belongs to the original, copies evaluated by user functions are recorded in the caller's profile
+    NM->profile = NULL;
+#ifdef HAS_JIT_STATE
+    // Compiled code refers to the operands of the original expression
+    NM->eval_count = 0;
+    NM->jit = NULL;
+#endif
     NM->expr = strdup(M->expr);
     NM->labels = tms_dup_arg_list(M->labels);
     NM->S = malloc(NM->subexpr_count * sizeof(math_subexpr));
@@ -901,6 +1042,12 @@ void delete_math_expr_members(math_expr *M)
     free(M->all_labeled_ops);
     free(M->expr);
     tms_free_arg_list(M->labels);
+    tms_delete_profile(M->profile);
+    M->profile = NULL;
+#ifdef HAS_JIT_STATE
+    tms_jit_free(M->jit);
+    M->jit = NULL;
+#endif
 }
 
 void delete_math_expr(math_expr *M)
@@ -0,0 +1,301 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "profile.h"
+#include "profile_common.h"
+#include "stats_common.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Thread_local _tms_profile_ctx *_tms_profile = NULL;
+int _tms_profile_count = 0;
+
+static void _tms_free_profile_entry(void *item)
+{
+    free(((tms_profile_entry *)item)->name);
+}
+
+// Adds a call to the entry of name, creating it if needed
+static void _tms_profile_record(tms_symtab *T, const char *name, uint64_t ns)
+{
+    // Only the counters are modified, the name (key) stays the same
+    tms_profile_entry *E = (tms_profile_entry *)tms_symtab_get(T, name);
+    if (E != NULL)
+    {
+        ++E->calls;
+        E->ns += ns;
+    }
+    else
+    {
+        tms_profile_entry new_entry = {strdup(name), 1, ns};
+        tms_symtab_set(T, &new_entry);
+    }
+}
+
+/*
+Writes the frame name of subexpression i to dest (with a leading ';' if sep is true), returns its length.
+func_off is set to the offset of the function name, or 0 if there is none.
+*/
+static size_t _tms_profile_frame_name(char *dest, bool sep, int i, const char *func, int func_len, size_t *func_off)
+{
+    size_t len = sprintf(dest, sep ? ";S%d" : "S%d", i);
+    *func_off = 0;
+    if (func != NULL)
+    {
+        dest[len++] = ' ';
+        *func_off = len;
+        memcpy(dest + len, func, func_len);
+        len += func_len;
+    }
+    dest[len] = '\0';
+    return len;
+}
+
+static tms_expr_profile *_tms_new_profile(const char *name, int subexpr_count)
+{
+    tms_expr_profile *P = malloc(sizeof(tms_expr_profile));
+    if (P == NULL)
+        return NULL;
+    P->name = strdup(name);
+    // ';' separates the frames of folded stacks
+    for (char *c = P->name; *c != '\0'; ++c)
+        if (*c == ';')
+            *c = '_';
+    P->total = (tms_profile_entry){NULL, 0, 0};
+    P->subexpr_count = subexpr_count;
+    P->subexprs = calloc(subexpr_count, sizeof(tms_profile_entry));
+    P->functions = tms_symtab_new(sizeof(tms_profile_entry), 0, rand(), _tms_free_profile_entry);
+    P->stacks = tms_symtab_new(sizeof(tms_profile_entry), 0, rand(), _tms_free_profile_entry);
+    __atomic_fetch_add(&_tms_profile_count, 1, __ATOMIC_RELAXED);
+    return P;
+}
+
+// Names the subexpression entries of a new profile
+static void _tms_set_profile_subexpr(tms_expr_profile *P, int i, const char *func, int func_len)
+{
+    size_t func_off;
+    P->subexprs[i].name = malloc(func_len + 16);
+    _tms_profile_frame_name(P->subexprs[i].name, false, i, func, func_len, &func_off);
+}
+
+int tms_enable_profile(tms_math_expr *M, const char *name)
+{
+    if (M == NULL)
+        return -1;
+    if (M->profile != NULL)
+        return 0;
+
+    tms_expr_profile *P = _tms_new_profile(name != NULL ? name : M->expr, M->subexpr_count);
+    if (P == NULL)
+        return -1;
+    const char *func;
+    int func_len;
+    for (int i = 0; i < M->subexpr_count; ++i)
+    {
+        func = _tms_subexpr_func_name(M->expr, M->S[i].subexpr_start, M->S[i].func_type,
+                                      M->S[i].func_type == TMS_F_USER ? M->S[i].func.user : NULL, &func_len);
+        _tms_set_profile_subexpr(P, i, func, func_len);
+    }
+    M->profile = P;
+    return 0;
+}
+
+int tms_enable_int_profile(tms_int_expr *M, const char *name)
+{
+    if (M == NULL)
+        return -1;
+    if (M->profile != NULL)
+        return 0;
+
+    tms_expr_profile *P = _tms_new_profile(name != NULL ? name : M->expr, M->subexpr_count);
+    if (P == NULL)
+        return -1;
+    const char *func;
+    int func_len;
+    for (int i = 0; i < M->subexpr_count; ++i)
+    {
+        func = _tms_subexpr_func_name(M->expr, M->S[i].subexpr_start, M->S[i].func_type,
+                                      M->S[i].func_type == TMS_F_INT_USER ? M->S[i].func.user : NULL, &func_len);
+        _tms_set_profile_subexpr(P, i, func, func_len);
+    }
+    M->profile = P;
+    return 0;
+}
+
+void tms_disable_profile(tms_math_expr *M)
+{
+    tms_delete_profile(M->profile);
+    M->profile = NULL;
+}
+
+void tms_disable_int_profile(tms_int_expr *M)
+{
+    tms_delete_profile(M->profile);
+    M->profile = NULL;
+}
+
+void tms_reset_profile(tms_expr_profile *P)
+{
+    P->total.calls = P->total.ns = 0;
+    for (int i = 0; i < P->subexpr_count; ++i)
+        P->subexprs[i].calls = P->subexprs[i].ns = 0;
+    tms_symtab_clear(P->functions);
+    tms_symtab_clear(P->stacks);
+}
+
+void tms_delete_profile(tms_expr_profile *P)
+{
+    if (P == NULL)
+        return;
+    for (int i = 0; i < P->subexpr_count; ++i)
+        free(P->subexprs[i].name);
+    free(P->subexprs);
+    tms_symtab_clear(P->functions);
+    tms_symtab_free(P->functions);
+    tms_symtab_clear(P->stacks);
+    tms_symtab_free(P->stacks);
+    free(P->name);
+    free(P);
+    __atomic_fetch_sub(&_tms_profile_count, 1, __ATOMIC_RELAXED);
+}
+
+static int _tms_compare_profile_entries(const void *a, const void *b)
+{
+    const tms_profile_entry *x = a, *y = b;
+    if (x->ns != y->ns)
+        return x->ns < y->ns ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+tms_profile_entry *tms_get_profile_functions(tms_expr_profile *P, size_t *count)
+{
+    *count = 0;
+    tms_profile_entry *E = tms_symtab_to_array(P->functions, count, false);
+    if (E != NULL)
+        qsort(E, *count, sizeof(tms_profile_entry), _tms_compare_profile_entries);
+    return E;
+}
+
+void tms_print_profile(tms_expr_profile *P, FILE *out)
+{
+    size_t count, i;
+    tms_profile_entry *E;
+
+    fprintf(out, "Profile of %s: %" PRIu64 " evaluations, %" PRIu64 " ns\n", P->name, P->total.calls, P->total.ns);
+    fprintf(out, "%-24s %12s %14s %12s\n", "Subexpression", "Calls", "Total (ns)", "Avg (ns)");
+    for (int s = 0; s < P->subexpr_count; ++s)
+    {
+        E = P->subexprs + s;
+        fprintf(out, "%-24s %12" PRIu64 " %14" PRIu64 " %12" PRIu64 "\n", E->name, E->calls, E->ns,
+                E->calls != 0 ? E->ns / E->calls : 0);
+    }
+
+    E = tms_get_profile_functions(P, &count);
+    fprintf(out, "%-24s %12s %14s %12s\n", "Function", "Calls", "Total (ns)", "Avg (ns)");
+    for (i = 0; i < count; ++i)
+        fprintf(out, "%-24s %12" PRIu64 " %14" PRIu64 " %12" PRIu64 "\n", E[i].name, E[i].calls, E[i].ns,
+                E[i].ns / E[i].calls);
+    free(E);
+}
+
+int tms_write_folded_profile(tms_expr_profile *P, FILE *out)
+{
+    size_t count = 0;
+    // Sorted by stack, so that the output of identical profiles is identical
+    tms_profile_entry *E = tms_symtab_to_array(P->stacks, &count, true);
+    for (size_t i = 0; i < count; ++i)
+        fprintf(out, "%s %" PRIu64 "\n", E[i].name, E[i].ns);
+    free(E);
+    return ferror(out) ? -1 : 0;
+}
+
+int _tms_profile_begin(_tms_profile_ctx *C, tms_expr_profile *P)
+{
+    size_t len = strlen(P->name);
+    C->path_cap = len + 256;
+    C->path = malloc(C->path_cap);
+    if (C->path == NULL)
+        return -1;
+    memcpy(C->path, P->name, len + 1);
+    C->path_len = len;
+    C->P = P;
+    C->depth = 1;
+    C->dropped = 0;
+    C->frames[0] = (_tms_profile_frame){_tms_stats_now(), 0, 0, 0, -1};
+    _tms_profile = C;
+    return 0;
+}
+
+void _tms_profile_end(_tms_profile_ctx *C)
+{
+    _tms_profile_unwind(1);
+    uint64_t ns = _tms_stats_now() - C->frames[0].start;
+    // Time of the evaluator outside of the subexpressions
+    _tms_profile_record(C->P->stacks, C->path, ns - C->frames[0].child_ns);
+    ++C->P->total.calls;
+    C->P->total.ns += ns;
+    free(C->path);
+    _tms_profile = NULL;
+}
+
+void _tms_profile_enter(int i, const char *func, int func_len)
+{
+    _tms_profile_ctx *C = _tms_profile;
+    if (C->depth == TMS_PROFILE_MAX_DEPTH)
+    {
+        ++C->dropped;
+        return;
+    }
+
+    _tms_profile_frame *F = C->frames + C->depth;
+    // ';', 'S', the index, ' ' and the terminator
+    size_t needed = C->path_len + func_len + 16;
+    if (needed > C->path_cap)
+    {
+        C->path_cap = needed * 2;
+        C->path = realloc(C->path, C->path_cap);
+    }
+    F->path_len = C->path_len;
+    C->path_len += _tms_profile_frame_name(C->path + C->path_len, true, i, func, func_len, &F->func_off);
+    if (F->func_off != 0)
+        F->func_off += F->path_len;
+    // Only the subexpressions of the profiled expression have an entry
+    F->subexpr = (C->depth == 1 ? i : -1);
+    F->child_ns = 0;
+    ++C->depth;
+    F->start = _tms_stats_now();
+}
+
+void _tms_profile_leave()
+{
+    _tms_profile_ctx *C = _tms_profile;
+    uint64_t end = _tms_stats_now();
+    if (C->dropped != 0)
+    {
+        --C->dropped;
+        return;
+    }
+
+    _tms_profile_frame *F = C->frames + C->depth - 1;
+    uint64_t ns = end - F->start;
+    C->frames[C->depth - 2].child_ns += ns;
+    _tms_profile_record(C->P->stacks, C->path, ns - F->child_ns);
+    if (F->func_off != 0)
+        _tms_profile_record(C->P->functions, C->path + F->func_off, ns);
+    if (F->subexpr != -1)
+    {
+        ++C->P->subexprs[F->subexpr].calls;
+        C->P->subexprs[F->subexpr].ns += ns;
+    }
+    C->path_len = F->path_len;
+    C->path[C->path_len] = '\0';
+    --C->depth;
+}
+
+void _tms_profile_unwind(int level)
+{
+    while (_tms_profile_level() > level)
+        _tms_profile_leave();
+}
@@ -0,0 +1,102 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_PROFILE_COMMON_H
+#define _TMS_PROFILE_COMMON_H
+
+// Recording of the evaluation profiles, used by the evaluators
+
+#include "profile.h"
+#include "string_tools.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Frames deeper than this are not recorded, the evaluators nest at most 32 expressions
+#define TMS_PROFILE_MAX_DEPTH 64
+
+typedef struct _tms_profile_frame
+{
+    uint64_t start;
+    // Time of the frames called by this one
+    uint64_t child_ns;
+    // Length of the stack path without this frame
+    size_t path_len;
+    // Offset of the function name in the path, 0 if the subexpression has no function
+    size_t func_off;
+    // Index in the profiled expression, -1 for the root frame and the subexpressions of nested expressions
+    int subexpr;
+} _tms_profile_frame;
+
+// State of the profiled evaluation running in a thread, on the stack of its tms_evaluate() call
+typedef struct _tms_profile_ctx
+{
+    tms_expr_profile *P;
+    // Folded stack of the current frame
+    char *path;
+    size_t path_len, path_cap;
+    int depth;
+    // Frames not recorded beyond TMS_PROFILE_MAX_DEPTH
+    int dropped;
+    _tms_profile_frame frames[TMS_PROFILE_MAX_DEPTH];
+} _tms_profile_ctx;
+
+// NULL when no profiled evaluation is running in the current thread
+extern _Thread_local _tms_profile_ctx *_tms_profile;
+// Number of existing profiles, avoids reading the thread local variable when profiling is unused
+extern int _tms_profile_count;
+
+// Returns true if the evaluation of an expression with profile P (can be NULL) should be recorded
+static inline bool _tms_profiling(tms_expr_profile *P)
+{
+    return __atomic_load_n(&_tms_profile_count, __ATOMIC_RELAXED) != 0 && (P != NULL || _tms_profile != NULL);
+}
+
+/**
+ * Starts a profiled evaluation with P as the root frame, the nested evaluations of the thread are recorded in P until
+ * _tms_profile_end(). Returns -1 if memory allocation failed.
+ */
+int _tms_profile_begin(_tms_profile_ctx *C, tms_expr_profile *P);
+
+void _tms_profile_end(_tms_profile_ctx *C);
+
+// Pushes the frame of subexpression i, func is the function name (not null terminated)
+void _tms_profile_enter(int i, const char *func, int func_len);
+
+// Pops and records the current frame
+void _tms_profile_leave();
+
+// Returns the current level, to close the frames left by a failed evaluation with _tms_profile_unwind()
+static inline int _tms_profile_level()
+{
+    return _tms_profile->depth + _tms_profile->dropped;
+}
+
+void _tms_profile_unwind(int level);
+
+// Finds the function name of a subexpression, without allocation
+static inline const char *_tms_subexpr_func_name(const char *expr, int subexpr_start, uint8_t func_type,
+                                                 const char *user, int *len)
+{
+    int end;
+    switch (func_type)
+    {
+    case TMS_NOFUNC:
+        *len = 0;
+        return NULL;
+
+    case TMS_F_USER:
+    case TMS_F_INT_USER:
+        *len = strlen(user);
+        return user;
+
+    default:
+        end = tms_name_bounds(expr, subexpr_start, true);
+        *len = (end == -1 ? 0 : end - subexpr_start + 1);
+        return *len == 0 ? NULL : expr + subexpr_start;
+    }
+}
+
+#endif
@@ -222,6 +222,7 @@ double complex tms_solve(const char *expr)
                     // Conversion to complex failed
                     if (!M->enable_complex)
                     {
+                        tms_unlock_evaluator(TMS_EVALUATOR);
                         tms_delete_math_expr(M);
                         return NAN;
                     }
@@ -0,0 +1,733 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "serializer.h"
+#include "error_handler.h"
+#include "internals.h"
+#include "jit.h"
+#include "m_errors.h"
+#include "profile.h"
+#include "string_tools.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct tms_catalog
+{
+    char *base;
+    size_t size;
+    tms_catalog_header *header;
+    uint64_t *index;
+    // Names table and record indexes sorted by name, NULL for unnamed catalogs
+    uint64_t *names;
+    uint32_t *sorted;
+    // User functions structures, allocated on the first user function request
+    void *ufuncs;
+    // State of each record (tms_record_states), kept out of the file so it can't be forged
+    uint8_t *states;
+    // Private copy of each prepared record, the mapping itself is never written
+    char **records;
+    bool is_mapped;
+    pthread_mutex_t lock;
+};
+
+enum tms_record_states
+{
+    TMS_RECORD_RAW,
+    TMS_RECORD_READY,
+    TMS_RECORD_INVALID
+};
+
+// Growable buffer used to build a record
+typedef struct _tms_buffer
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+} _tms_buffer;
+
+// Maps the address range of a block in the expression to its offset in the record
+typedef struct _tms_ptr_range
+{
+    uintptr_t start, end;
+    size_t offset;
+} _tms_ptr_range;
+
+// Stores an offset in a pointer member, offset 0 is the record header so it is used for NULL
+#define _TMS_OFFSET(offset) ((void *)(uintptr_t)(offset))
+
+// Converts an offset stored in a pointer member back to a pointer, fails if the block is outside the record or misaligned
+// Records start at a 16 bytes boundary, so the alignment of the offset is the alignment of the pointer
+#define _TMS_FIXUP(ptr, len, alignment)                                                                                           \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ((ptr) != NULL)                                                                                             \
+        {                                                                                                              \
+            if ((uintptr_t)(ptr) >= size || (len) > size - (uintptr_t)(ptr) || (uintptr_t)(ptr) % (alignment) != 0)   \
+                return -1;                                                                                             \
+            (ptr) = (void *)(base + (uintptr_t)(ptr));                                                                 \
+        }                                                                                                              \
+    } while (0)
+
+static size_t _tms_buffer_reserve(_tms_buffer *B, size_t size, size_t alignment)
+{
+    size_t offset = (B->size + alignment - 1) & ~(alignment - 1);
+
+    if (offset + size > B->capacity)
+    {
+        while (offset + size > B->capacity)
+            B->capacity *= 2;
+        B->data = realloc(B->data, B->capacity);
+    }
+    // Zero the padding and the reserved block, keeps the file content deterministic
+    memset(B->data + B->size, 0, offset + size - B->size);
+    B->size = offset + size;
+    return offset;
+}
+
+static size_t _tms_buffer_add(_tms_buffer *B, const void *data, size_t size, size_t alignment)
+{
+    size_t offset = _tms_buffer_reserve(B, size, alignment);
+    memcpy(B->data + offset, data, size);
+    return offset;
+}
+
+static size_t _tms_serialize_arg_list(_tms_buffer *B, tms_arg_list *L)
+{
+    if (L == NULL)
+        return 0;
+
+    size_t l_off = _tms_buffer_reserve(B, sizeof(tms_arg_list), 16);
+    size_t a_off = _tms_buffer_reserve(B, L->count * sizeof(char *), 16);
+    size_t p_off = 0;
+
+    for (int i = 0; i < L->count; ++i)
+    {
+        size_t str_off = _tms_buffer_add(B, L->arguments[i], strlen(L->arguments[i]) + 1, 1);
+        ((char **)(B->data + a_off))[i] = _TMS_OFFSET(str_off);
+    }
+    if (L->payload != NULL && L->payload_size > 0)
+        p_off = _tms_buffer_add(B, L->payload, L->payload_size, 16);
+
+    tms_arg_list *NL = (tms_arg_list *)(B->data + l_off);
+    NL->count = L->count;
+    NL->arguments = _TMS_OFFSET(a_off);
+    NL->payload = _TMS_OFFSET(p_off);
+    NL->payload_size = (p_off == 0 ? 0 : L->payload_size);
+    return l_off;
+}
+
+static int _tms_fixup_arg_list(char *base, size_t size, tms_arg_list **L_ptr)
+{
+    _TMS_FIXUP(*L_ptr, sizeof(tms_arg_list), _Alignof(tms_arg_list));
+
+    tms_arg_list *L = *L_ptr;
+    if (L == NULL)
+        return 0;
+
+    // Read once, a corrupted record could overlap the count with the fixed pointers
+    int count = L->count;
+    if (count < 0)
+        return -1;
+    _TMS_FIXUP(L->arguments, count * sizeof(char *), _Alignof(char *));
+    _TMS_FIXUP(L->payload, L->payload_size, 1);
+    if (count > 0 && L->arguments == NULL)
+        return -1;
+    for (int i = 0; i < count; ++i)
+    {
+        _TMS_FIXUP(L->arguments[i], 1, 1);
+        if (L->arguments[i] == NULL || memchr(L->arguments[i], '\0', base + size - L->arguments[i]) == NULL)
+            return -1;
+    }
+    return 0;
+}
+
+static int _tms_compare_ranges(const void *a, const void *b)
+{
+    uintptr_t start_a = ((_tms_ptr_range *)a)->start, start_b = ((_tms_ptr_range *)b)->start;
+    if (start_a < start_b)
+        return -1;
+    else if (start_a > start_b)
+        return 1;
+    else
+        return 0;
+}
+
+// Translates a pointer to the expression memory into an offset in the record (stored in a pointer)
+static void *_tms_translate_ptr(_tms_ptr_range *ranges, int count, void *ptr, bool *failed)
+{
+    if (ptr == NULL)
+        return NULL;
+
+    uintptr_t p = (uintptr_t)ptr;
+    int low = 0, high = count - 1;
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        if (p < ranges[mid].start)
+            high = mid - 1;
+        else if (p >= ranges[mid].end)
+            low = mid + 1;
+        else
+            return _TMS_OFFSET(ranges[mid].offset + (p - ranges[mid].start));
+    }
+    // Points outside of the expression, should not happen
+    *failed = true;
+    return NULL;
+}
+
+// Used to sort the record indexes by name
+typedef struct _tms_named_index
+{
+    const char *name;
+    uint32_t index;
+} _tms_named_index;
+
+static int _tms_compare_named_index(const void *a, const void *b)
+{
+    return strcmp(((_tms_named_index *)a)->name, ((_tms_named_index *)b)->name);
+}
+
+// Writes the names table and the sorted indexes at the current file position, updates the header
+static bool _tms_write_names(FILE *file, tms_catalog_header *header, uint64_t position, char **names, int count)
+{
+    uint64_t *name_offsets = malloc(count * sizeof(uint64_t));
+    _tms_named_index *sorted = malloc(count * sizeof(_tms_named_index));
+    uint32_t *sorted_indexes = malloc(count * sizeof(uint32_t));
+    static const char padding[8] = {0};
+    bool failed = false;
+    int i;
+
+    for (i = 0; i < count && !failed; ++i)
+    {
+        size_t len = strlen(names[i]) + 1;
+        name_offsets[i] = position;
+        sorted[i] = (_tms_named_index){names[i], i};
+        failed = (fwrite(names[i], len, 1, file) != 1);
+        position += len;
+    }
+    qsort(sorted, count, sizeof(_tms_named_index), _tms_compare_named_index);
+    for (i = 0; i < count; ++i)
+        sorted_indexes[i] = sorted[i].index;
+
+    // Keep the tables aligned
+    size_t pad = (8 - position % 8) % 8;
+    header->names_offset = position + pad;
+    header->sorted_offset = header->names_offset + count * sizeof(uint64_t);
+    if (!failed)
+        failed = (fwrite(padding, 1, pad, file) != pad) ||
+                 (fwrite(name_offsets, sizeof(uint64_t), count, file) != (size_t)count) ||
+                 (fwrite(sorted_indexes, sizeof(uint32_t), count, file) != (size_t)count);
+
+    free(name_offsets);
+    free(sorted);
+    free(sorted_indexes);
+    return failed;
+}
+
+static int _tms_write_catalog(const char *path, int type, void **list, char **names, int count,
+                              int (*serializer)(_tms_buffer *, void *))
+{
+    if (count < 0 || (count > 0 && list == NULL))
+    {
+        tms_save_error(TMS_GENERAL, INTERNAL_ERROR, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_IO_ERROR, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    tms_catalog_header header = {.magic = {'T', 'M', 'S', 'C'},
+                                 .version = TMS_CATALOG_VERSION,
+                                 .type = type,
+                                 .byte_order = 0x01020304,
+                                 .ptr_size = sizeof(void *),
+                                 .arg_list_size = sizeof(tms_arg_list),
+                                 .labeled_operand_size = sizeof(tms_labeled_operand),
+                                 .count = count};
+    if (type == TMS_CATALOG_SCIENTIFIC)
+    {
+        header.expr_size = sizeof(tms_math_expr);
+        header.subexpr_size = sizeof(tms_math_subexpr);
+        header.node_size = sizeof(tms_op_node);
+    }
+    else
+    {
+        header.expr_size = sizeof(tms_int_expr);
+        header.subexpr_size = sizeof(tms_int_subexpr);
+        header.node_size = sizeof(tms_int_op_node);
+    }
+
+    uint64_t *index = malloc((count > 0 ? count : 1) * sizeof(uint64_t));
+    _tms_buffer B = {malloc(4096), 0, 4096};
+    // Records are aligned to 16 bytes in the file, the header is padded to that
+    uint64_t position = (sizeof(header) + 15) & ~15;
+    static const char padding[16] = {0};
+    bool failed = (fwrite(&header, sizeof(header), 1, file) != 1) ||
+                  (fwrite(padding, 1, position - sizeof(header), file) != position - sizeof(header));
+
+    for (int i = 0; i < count && !failed; ++i)
+    {
+        B.size = 0;
+        if (list[i] == NULL || serializer(&B, list[i]) != 0)
+        {
+            fclose(file);
+            remove(path);
+            free(index);
+            free(B.data);
+            if (list[i] == NULL)
+                tms_save_error(TMS_GENERAL, INTERNAL_ERROR, EH_FATAL, NULL, 0);
+            return -1;
+        }
+        // Pad the record to keep the next one aligned
+        size_t padded_size = (B.size + 15) & ~(size_t)15;
+        _tms_buffer_reserve(&B, padded_size - B.size, 1);
+
+        index[i] = position;
+        failed = (fwrite(B.data, B.size, 1, file) != 1);
+        position += B.size;
+    }
+
+    header.index_offset = position;
+    if (!failed && count > 0)
+        failed = (fwrite(index, sizeof(uint64_t), count, file) != (size_t)count);
+    position += count * sizeof(uint64_t);
+
+    if (!failed && names != NULL)
+        failed = _tms_write_names(file, &header, position, names, count);
+
+    // Rewrite the header with the index location
+    if (!failed)
+        failed = (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1);
+
+    failed = (fclose(file) != 0) || failed;
+    free(index);
+    free(B.data);
+
+    if (failed)
+    {
+        remove(path);
+        tms_save_error(TMS_GENERAL, CATALOG_IO_ERROR, EH_FATAL, NULL, 0);
+        return -1;
+    }
+    return 0;
+}
+
+tms_catalog *tms_open_catalog(const char *path)
+{
+    tms_catalog *C = malloc(sizeof(tms_catalog));
+    C->base = NULL;
+    C->size = 0;
+    C->index = NULL;
+    C->names = NULL;
+    C->sorted = NULL;
+    C->ufuncs = NULL;
+    C->states = NULL;
+    C->records = NULL;
+
+#ifndef _WIN32
+    // Read only shared mapping: the processes using the catalog share its pages in the page cache
+    int fd = open(path, O_RDONLY);
+    struct stat file_stat;
+    if (fd != -1 && fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        C->size = file_stat.st_size;
+        C->base = mmap(NULL, C->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (C->base == MAP_FAILED)
+            C->base = NULL;
+    }
+    if (fd != -1)
+        close(fd);
+    C->is_mapped = true;
+#else
+    // No mmap, read the whole file instead
+    FILE *file = fopen(path, "rb");
+    if (file != NULL && fseek(file, 0, SEEK_END) == 0)
+    {
+        long file_size = ftell(file);
+        if (file_size > 0 && fseek(file, 0, SEEK_SET) == 0)
+        {
+            C->size = file_size;
+            C->base = malloc(C->size);
+            if (fread(C->base, C->size, 1, file) != 1)
+            {
+                free(C->base);
+                C->base = NULL;
+            }
+        }
+    }
+    if (file != NULL)
+        fclose(file);
+    C->is_mapped = false;
+#endif
+
+    if (C->base == NULL)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_IO_ERROR, EH_FATAL, NULL, 0);
+        free(C);
+        return NULL;
+    }
+
+    tms_catalog_header *H = (tms_catalog_header *)C->base;
+    C->header = H;
+
+    if (C->size < sizeof(tms_catalog_header) || memcmp(H->magic, "TMSC", 4) != 0)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_INVALID, EH_FATAL, NULL, 0);
+        tms_close_catalog(C);
+        return NULL;
+    }
+
+    bool abi_match = (H->byte_order == 0x01020304 && H->ptr_size == sizeof(void *) &&
+                      H->arg_list_size == sizeof(tms_arg_list) &&
+                      H->labeled_operand_size == sizeof(tms_labeled_operand));
+    if (H->type == TMS_CATALOG_SCIENTIFIC)
+        abi_match = abi_match && H->expr_size == sizeof(tms_math_expr) &&
+                    H->subexpr_size == sizeof(tms_math_subexpr) && H->node_size == sizeof(tms_op_node);
+    else if (H->type == TMS_CATALOG_INT)
+        abi_match = abi_match && H->expr_size == sizeof(tms_int_expr) && H->subexpr_size == sizeof(tms_int_subexpr) &&
+                    H->node_size == sizeof(tms_int_op_node);
+    else
+        abi_match = false;
+
+    if (H->version != TMS_CATALOG_VERSION || !abi_match)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_INCOMPATIBLE, EH_FATAL, NULL, 0);
+        tms_close_catalog(C);
+        return NULL;
+    }
+
+    if (H->index_offset % sizeof(uint64_t) != 0 || H->index_offset > C->size ||
+        (C->size - H->index_offset) / sizeof(uint64_t) < H->count)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_INVALID, EH_FATAL, NULL, 0);
+        tms_close_catalog(C);
+        return NULL;
+    }
+    C->index = (uint64_t *)(C->base + H->index_offset);
+
+    if (H->names_offset != 0)
+    {
+        if (H->names_offset % sizeof(uint64_t) != 0 || H->names_offset > C->size ||
+            (C->size - H->names_offset) / sizeof(uint64_t) < H->count || H->sorted_offset % sizeof(uint32_t) != 0 ||
+            H->sorted_offset > C->size || (C->size - H->sorted_offset) / sizeof(uint32_t) < H->count)
+        {
+            tms_save_error(TMS_GENERAL, CATALOG_INVALID, EH_FATAL, NULL, 0);
+            C->index = NULL;
+            tms_close_catalog(C);
+            return NULL;
+        }
+        C->names = (uint64_t *)(C->base + H->names_offset);
+        C->sorted = (uint32_t *)(C->base + H->sorted_offset);
+    }
+    C->states = calloc(H->count > 0 ? H->count : 1, sizeof(uint8_t));
+    C->records = calloc(H->count > 0 ? H->count : 1, sizeof(char *));
+    if (C->states == NULL || C->records == NULL)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_NO_MEMORY, EH_FATAL, NULL, 0);
+        C->index = NULL;
+        tms_close_catalog(C);
+        return NULL;
+    }
+    pthread_mutex_init(&C->lock, NULL);
+    return C;
+}
+
+void tms_close_catalog(tms_catalog *C)
+{
+    if (C == NULL)
+        return;
+
+    // The lock is initialized only after the header checks
+    if (C->index != NULL)
+    {
+        pthread_mutex_destroy(&C->lock);
+
+        // Free the compiled code and profiles of expressions evaluated from the catalog, then their records
+        for (uint32_t i = 0; i < C->header->count; ++i)
+        {
+            if (C->states[i] == TMS_RECORD_READY)
+            {
+                tms_catalog_record *R = (tms_catalog_record *)C->records[i];
+                if (C->header->type == TMS_CATALOG_SCIENTIFIC)
+                {
+                    tms_jit_free(((tms_math_expr *)(R + 1))->jit);
+                    tms_delete_profile(((tms_math_expr *)(R + 1))->profile);
+                }
+                else
+                    tms_delete_profile(((tms_int_expr *)(R + 1))->profile);
+            }
+            free(C->records[i]);
+        }
+    }
+
+#ifndef _WIN32
+    munmap(C->base, C->size);
+#else
+    free(C->base);
+#endif
+    free(C->ufuncs);
+    free(C->states);
+    free(C->records);
+    free(C);
+}
+
+int tms_catalog_count(const tms_catalog *C)
+{
+    return C->header->count;
+}
+
+int tms_catalog_type(const tms_catalog *C)
+{
+    return C->header->type;
+}
+
+const char *tms_catalog_get_name(const tms_catalog *C, int index)
+{
+    if (C->names == NULL || index < 0 || (uint32_t)index >= C->header->count)
+        return NULL;
+
+    // Names are checked on access, opening the catalog doesn't touch them
+    uint64_t offset = C->names[index];
+    if (offset >= C->size || memchr(C->base + offset, '\0', C->size - offset) == NULL)
+        return NULL;
+    return C->base + offset;
+}
+
+int tms_catalog_find(const tms_catalog *C, const char *name)
+{
+    if (C->names == NULL)
+        return -1;
+
+    int low = 0, high = C->header->count - 1;
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        uint32_t index = C->sorted[mid];
+        const char *mid_name = tms_catalog_get_name(C, index);
+        if (mid_name == NULL)
+            return -1;
+
+        int cmp = strcmp(name, mid_name);
+        if (cmp < 0)
+            high = mid - 1;
+        else if (cmp > 0)
+            low = mid + 1;
+        else
+            return index;
+    }
+    return -1;
+}
+
+/*
+Returns the record at the specified index after converting it to a usable expression (once).
+The evaluation writes to the nodes, so the record is copied out of the read only mapping and converted in the copy.
+malloc() alignment is enough for the structures of the record, its offsets are checked against their alignment.
+*/
+static char *_tms_prepare_record(tms_catalog *C, int index, int type, int (*fixup)(char *, size_t))
+{
+    if (C->header->type != type)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_TYPE_MISMATCH, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    if (index < 0 || (uint32_t)index >= C->header->count)
+    {
+        tms_save_error(TMS_GENERAL, INDEX_OUT_OF_RANGE, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+
+    uint64_t offset = C->index[index], size;
+    if (offset % 16 != 0 || offset >= C->size || C->size - offset < sizeof(tms_catalog_record))
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_INVALID, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    // Read once, the copy is checked by the fixup and not the mapping
+    size = ((tms_catalog_record *)(C->base + offset))->size;
+    if (size < sizeof(tms_catalog_record) || size > C->size - offset)
+    {
+        tms_save_error(TMS_GENERAL, CATALOG_INVALID, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&C->lock);
+    if (C->states[index] == TMS_RECORD_RAW)
+    {
+        char *record = malloc(size);
+        if (record != NULL)
+        {
+            memcpy(record, C->base + offset, size);
+            if (fixup(record, size) == 0)
+            {
+                C->records[index] = record;
+                C->states[index] = TMS_RECORD_READY;
+            }
+            else
+            {
+                free(record);
+                C->states[index] = TMS_RECORD_INVALID;
+            }
+        }
+    }
+    uint8_t state = C->states[index];
+    char *record = C->records[index];
+    pthread_mutex_unlock(&C->lock);
+
+    if (state != TMS_RECORD_READY)
+    {
+        // A failed allocation leaves the record raw, it can be prepared by a later request
+        if (state == TMS_RECORD_RAW)
+            tms_save_error(TMS_GENERAL, CATALOG_NO_MEMORY, EH_FATAL, NULL, 0);
+        else
+            tms_save_error(TMS_GENERAL, CATALOG_INVALID, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    return record;
+}
+
+static int _tms_resolve_math_function(tms_math_expr *M, tms_math_subexpr *S)
+{
+    char *name = tms_get_name(M->expr, S->subexpr_start, true);
+    if (name == NULL)
+        return -1;
+
+    const tms_rc_func *rc_func;
+    const tms_extf *extf;
+    int status = 0;
+
+    switch (S->func_type)
+    {
+    case TMS_F_REAL:
+        rc_func = tms_get_rc_func_by_name(name);
+        if (rc_func == NULL || rc_func->real == NULL)
+            status = -1;
+        else
+            S->func.real = rc_func->real;
+        break;
+
+    case TMS_F_CMPLX:
+        rc_func = tms_get_rc_func_by_name(name);
+        if (rc_func == NULL || rc_func->cmplx == NULL)
+            status = -1;
+        else
+            S->func.cmplx = rc_func->cmplx;
+        break;
+
+    case TMS_F_EXTENDED:
+        extf = tms_get_extf_by_name(name);
+        if (extf == NULL)
+            status = -1;
+        else
+            S->func.extended = extf->ptr;
+        break;
+
+    default:
+        status = -1;
+    }
+    free(name);
+    return status;
+}
+
+static int _tms_resolve_int_function(tms_int_expr *M, tms_int_subexpr *S)
+{
+    char *name = tms_get_name(M->expr, S->subexpr_start, true);
+    if (name == NULL)
+        return -1;
+
+    const tms_int_func *func;
+    const tms_int_extf *extf;
+    int status = 0;
+
+    switch (S->func_type)
+    {
+    case TMS_F_INT64:
+        func = tms_get_int_func_by_name(name);
+        if (func == NULL)
+            status = -1;
+        else
+            S->func.simple = func->ptr;
+        break;
+
+    case TMS_F_INT_EXTENDED:
+        extf = tms_get_int_extf_by_name(name);
+        if (extf == NULL)
+            status = -1;
+        else
+            S->func.extended = extf->ptr;
+        break;
+
+    default:
+        status = -1;
+    }
+    free(name);
+    return status;
+}
+
+#define math_expr tms_math_expr
+#define math_subexpr tms_math_subexpr
+#define op_node tms_op_node
+#define operand_type cdouble
+#define F_USER TMS_F_USER
+#define CATALOG_TYPE TMS_CATALOG_SCIENTIFIC
+#define serialize_expr _tms_serialize_math_expr
+#define fixup_expr _tms_fixup_math_expr
+#define resolve_function _tms_resolve_math_function
+#define save_exprs tms_save_math_exprs
+#define catalog_get_expr tms_catalog_get_math_expr
+#define ufunc_type tms_ufunc
+#define get_all_ufunc tms_get_all_ufunc
+#define save_ufuncs tms_save_ufunctions
+#define catalog_get_ufunc tms_catalog_get_ufunc
+#define HAS_JIT_STATE
+
+#include "serializer_common.h"
+
+#undef math_expr
+#undef math_subexpr
+#undef op_node
+#undef operand_type
+#undef F_USER
+#undef CATALOG_TYPE
+#undef serialize_expr
+#undef fixup_expr
+#undef resolve_function
+#undef save_exprs
+#undef catalog_get_expr
+#undef ufunc_type
+#undef get_all_ufunc
+#undef save_ufuncs
+#undef catalog_get_ufunc
+#undef HAS_JIT_STATE
+
+#define math_expr tms_int_expr
+#define math_subexpr tms_int_subexpr
+#define op_node tms_int_op_node
+#define operand_type int64_t
+#define F_USER TMS_F_INT_USER
+#define CATALOG_TYPE TMS_CATALOG_INT
+#define serialize_expr _tms_serialize_int_expr
+#define fixup_expr _tms_fixup_int_expr
+#define resolve_function _tms_resolve_int_function
+#define save_exprs tms_save_int_exprs
+#define catalog_get_expr tms_catalog_get_int_expr
+#define ufunc_type tms_int_ufunc
+#define get_all_ufunc tms_get_all_int_ufunc
+#define save_ufuncs tms_save_int_ufunctions
+#define catalog_get_ufunc tms_catalog_get_int_ufunc
+
+#include "serializer_common.h"
@@ -0,0 +1,261 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+
+// Common code for serialization of scientific and integer expressions, included by serializer.c
+// The following macros must be defined before including this file:
+// math_expr, math_subexpr, op_node, operand_type, F_USER, CATALOG_TYPE, ufunc_type, get_all_ufunc,
+// serialize_expr, fixup_expr, resolve_function, save_exprs, save_ufuncs, catalog_get_expr, catalog_get_ufunc
+// HAS_JIT_STATE is defined if the expression structure has JIT state
+
+static int serialize_expr(_tms_buffer *B, void *expr)
+{
+    math_expr *M = expr;
+    math_subexpr *S = M->S;
+    int s, i, node_count, s_count = M->subexpr_count;
+
+    // Reserve the fixed size part of the record first, offsets are known before any data is written
+    size_t r_off = _tms_buffer_reserve(B, sizeof(tms_catalog_record), 16);
+    size_t m_off = _tms_buffer_reserve(B, sizeof(math_expr), 16);
+    size_t s_off = _tms_buffer_reserve(B, s_count * sizeof(math_subexpr), 16);
+    size_t lops_off = 0;
+    // Offset of the nodes of each subexpression, or its result cell if it is an extended/user function
+    size_t *n_off = malloc(s_count * sizeof(size_t));
+    size_t *args_off = malloc(s_count * sizeof(size_t));
+    size_t *name_off = malloc(s_count * sizeof(size_t));
+
+    // Address ranges used to translate pointers to offsets
+    _tms_ptr_range *ranges = malloc((s_count + 1) * sizeof(_tms_ptr_range));
+    int r_count = 0;
+
+    ranges[r_count++] = (_tms_ptr_range){(uintptr_t)M, (uintptr_t)(M + 1), m_off};
+
+    for (s = 0; s < s_count; ++s)
+    {
+        if (S[s].nodes != NULL)
+        {
+            node_count = (S[s].op_count > 0 ? S[s].op_count : 1);
+            n_off[s] = _tms_buffer_reserve(B, node_count * sizeof(op_node), 16);
+            ranges[r_count++] = (_tms_ptr_range){(uintptr_t)S[s].nodes, (uintptr_t)(S[s].nodes + node_count), n_off[s]};
+        }
+        else
+            n_off[s] = _tms_buffer_reserve(B, sizeof(operand_type *), 16);
+    }
+
+    if (M->labeled_operands_count > 0)
+        lops_off = _tms_buffer_reserve(B, M->labeled_operands_count * sizeof(tms_labeled_operand), 16);
+
+    // Variable size data (strings and argument lists)
+    size_t expr_off = _tms_buffer_add(B, M->expr, strlen(M->expr) + 1, 1);
+    size_t labels_off = _tms_serialize_arg_list(B, M->labels);
+    for (s = 0; s < s_count; ++s)
+    {
+        args_off[s] = _tms_serialize_arg_list(B, S[s].f_args);
+        if (S[s].func_type == F_USER)
+            name_off[s] = _tms_buffer_add(B, S[s].func.user, strlen(S[s].func.user) + 1, 1);
+        else
+            name_off[s] = 0;
+    }
+
+    // No reservations beyond this point, pointers to the buffer remain valid
+    qsort(ranges, r_count, sizeof(_tms_ptr_range), _tms_compare_ranges);
+    bool failed = false;
+
+    math_expr *NM = (math_expr *)(B->data + m_off);
+    *NM = *M;
+    NM->expr = _TMS_OFFSET(expr_off);
+    NM->S = _TMS_OFFSET(s_off);
+    NM->labels = _TMS_OFFSET(labels_off);
+    NM->all_labeled_ops = _TMS_OFFSET(lops_off);
+    NM->profile = NULL;
+#ifdef HAS_JIT_STATE
+    NM->eval_count = 0;
+    NM->jit = NULL;
+#endif
+
+    tms_labeled_operand *lops = (tms_labeled_operand *)(B->data + lops_off);
+    for (i = 0; i < M->labeled_operands_count; ++i)
+    {
+        lops[i] = M->all_labeled_ops[i];
+        lops[i].ptr = _tms_translate_ptr(ranges, r_count, M->all_labeled_ops[i].ptr, &failed);
+    }
+
+    math_subexpr *NS = (math_subexpr *)(B->data + s_off);
+    for (s = 0; s < s_count; ++s)
+    {
+        NS[s] = S[s];
+        NS[s].f_args = _TMS_OFFSET(args_off[s]);
+        // Function pointers are resolved by name when loading
+        memset(&NS[s].func, 0, sizeof(NS[s].func));
+        if (S[s].func_type == F_USER)
+            NS[s].func.user = _TMS_OFFSET(name_off[s]);
+
+        if (S[s].nodes != NULL)
+        {
+            op_node *N = S[s].nodes, *NN = (op_node *)(B->data + n_off[s]);
+            node_count = (S[s].op_count > 0 ? S[s].op_count : 1);
+
+            NS[s].nodes = _TMS_OFFSET(n_off[s]);
+            NS[s].result = _tms_translate_ptr(ranges, r_count, S[s].result, &failed);
+            for (i = 0; i < node_count; ++i)
+            {
+                NN[i] = N[i];
+                NN[i].result = _tms_translate_ptr(ranges, r_count, N[i].result, &failed);
+                NN[i].next = _tms_translate_ptr(ranges, r_count, N[i].next, &failed);
+            }
+        }
+        else
+        {
+            // The result cell holds a pointer to the operand receiving the function answer
+            NS[s].result = _TMS_OFFSET(n_off[s]);
+            *(void **)(B->data + n_off[s]) = _tms_translate_ptr(ranges, r_count, *(S[s].result), &failed);
+        }
+    }
+
+    ((tms_catalog_record *)(B->data + r_off))->size = B->size;
+
+    free(n_off);
+    free(args_off);
+    free(name_off);
+    free(ranges);
+
+    if (failed)
+    {
+        tms_save_error(TMS_GENERAL, INTERNAL_ERROR, EH_FATAL, NULL, 0);
+        return -1;
+    }
+    return 0;
+}
+
+static int fixup_expr(char *base, size_t size)
+{
+    math_expr *M = (math_expr *)(base + sizeof(tms_catalog_record));
+    int s, i, node_count, s_count, lops_count;
+
+    if (sizeof(tms_catalog_record) + sizeof(math_expr) > size)
+        return -1;
+
+    M->profile = NULL;
+#ifdef HAS_JIT_STATE
+    // Never use the JIT state from the file
+    M->eval_count = 0;
+    M->jit = NULL;
+#endif
+
+    _TMS_FIXUP(M->expr, 1, 1);
+    if (M->expr == NULL || memchr(M->expr, '\0', base + size - M->expr) == NULL)
+        return -1;
+
+    s_count = M->subexpr_count;
+    lops_count = M->labeled_operands_count;
+    if (s_count < 1 || lops_count < 0)
+        return -1;
+    _TMS_FIXUP(M->S, s_count * sizeof(math_subexpr), _Alignof(math_subexpr));
+    _TMS_FIXUP(M->all_labeled_ops, lops_count * sizeof(tms_labeled_operand), _Alignof(tms_labeled_operand));
+    if (M->S == NULL || (lops_count > 0 && M->all_labeled_ops == NULL))
+        return -1;
+
+    for (i = 0; i < lops_count; ++i)
+        _TMS_FIXUP(M->all_labeled_ops[i].ptr, sizeof(operand_type), _Alignof(operand_type));
+
+    if (_tms_fixup_arg_list(base, size, &M->labels) != 0)
+        return -1;
+
+    math_subexpr *S = M->S;
+    for (s = 0; s < s_count; ++s)
+    {
+        if (_tms_fixup_arg_list(base, size, &S[s].f_args) != 0)
+            return -1;
+
+        if (S[s].nodes != NULL)
+        {
+            if (S[s].op_count < 0)
+                return -1;
+            node_count = (S[s].op_count > 0 ? S[s].op_count : 1);
+            _TMS_FIXUP(S[s].nodes, node_count * sizeof(op_node), _Alignof(op_node));
+            _TMS_FIXUP(S[s].result, sizeof(operand_type *), _Alignof(operand_type *));
+            for (i = 0; i < node_count; ++i)
+            {
+                _TMS_FIXUP(S[s].nodes[i].result, sizeof(operand_type), _Alignof(operand_type));
+                _TMS_FIXUP(S[s].nodes[i].next, sizeof(op_node), _Alignof(op_node));
+            }
+        }
+        else
+        {
+            _TMS_FIXUP(S[s].result, sizeof(operand_type *), _Alignof(operand_type *));
+            if (S[s].result == NULL)
+                return -1;
+            _TMS_FIXUP(*(S[s].result), sizeof(operand_type), _Alignof(operand_type));
+        }
+
+        if (S[s].func_type == F_USER)
+        {
+            _TMS_FIXUP(S[s].func.user, 1, 1);
+            if (S[s].func.user == NULL || memchr(S[s].func.user, '\0', base + size - S[s].func.user) == NULL)
+                return -1;
+        }
+        else if (S[s].func_type != TMS_NOFUNC)
+        {
+            if (S[s].subexpr_start < 0 || S[s].subexpr_start >= (int)strlen(M->expr))
+                return -1;
+            if (resolve_function(M, S + s) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+int save_exprs(const char *path, math_expr **list, int count)
+{
+    return _tms_write_catalog(path, CATALOG_TYPE, (void **)list, NULL, count, serialize_expr);
+}
+
+int save_ufuncs(const char *path)
+{
+    size_t count, i;
+    ufunc_type *all = get_all_ufunc(&count, false);
+    math_expr **list = malloc((count > 0 ? count : 1) * sizeof(math_expr *));
+    char **names = malloc((count > 0 ? count : 1) * sizeof(char *));
+
+    for (i = 0; i < count; ++i)
+    {
+        list[i] = all[i].F;
+        names[i] = all[i].name;
+    }
+    int status = _tms_write_catalog(path, CATALOG_TYPE, (void **)list, names, count, serialize_expr);
+
+    free(all);
+    free(list);
+    free(names);
+    return status;
+}
+
+math_expr *catalog_get_expr(tms_catalog *C, int index)
+{
+    char *record = _tms_prepare_record(C, index, CATALOG_TYPE, fixup_expr);
+    if (record == NULL)
+        return NULL;
+    else
+        return (math_expr *)(record + sizeof(tms_catalog_record));
+}
+
+const ufunc_type *catalog_get_ufunc(tms_catalog *C, const char *name)
+{
+    int index = tms_catalog_find(C, name);
+    if (index == -1)
+        return NULL;
+
+    math_expr *F = catalog_get_expr(C, index);
+    if (F == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&C->lock);
+    if (C->ufuncs == NULL)
+        C->ufuncs = calloc(C->header->count, sizeof(ufunc_type));
+    ufunc_type *U = (ufunc_type *)C->ufuncs + index;
+    U->name = (char *)tms_catalog_get_name(C, index);
+    U->F = F;
+    pthread_mutex_unlock(&C->lock);
+    return U;
+}
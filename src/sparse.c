@@ -0,0 +1,390 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "sparse.h"
+#include "error_handler.h"
+#include "m_errors.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Member of a row while building a matrix
+typedef struct _tms_sparse_entry
+{
+    int col;
+    double value;
+} _tms_sparse_entry;
+
+static int _tms_sparse_entry_cmp(const void *a, const void *b)
+{
+    const _tms_sparse_entry *x = a, *y = b;
+    return (x->col > y->col) - (x->col < y->col);
+}
+
+// Sorts the members of a row by column, rows are usually short so insertion sort is used for them
+static void _tms_sparse_sort_row(_tms_sparse_entry *entries, int count)
+{
+    int i, j;
+    _tms_sparse_entry tmp;
+    if (count > 16)
+    {
+        qsort(entries, count, sizeof(_tms_sparse_entry), _tms_sparse_entry_cmp);
+        return;
+    }
+    for (i = 1; i < count; ++i)
+    {
+        tmp = entries[i];
+        for (j = i; j > 0 && entries[j - 1].col > tmp.col; --j)
+            entries[j] = entries[j - 1];
+        entries[j] = tmp;
+    }
+}
+
+tms_sparse_matrix *tms_sparse_from_triplets(int rows, int columns, int count, const int *row, const int *col,
+                                            const double *values)
+{
+    int i, j, k, nnz, *next;
+    _tms_sparse_entry *entries;
+    tms_sparse_matrix *A;
+
+    if (rows < 0 || columns < 0 || count < 0)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return NULL;
+    }
+    for (k = 0; k < count; ++k)
+        if (row[k] < 0 || row[k] >= rows || col[k] < 0 || col[k] >= columns)
+        {
+            tms_save_error(TMS_MATRIX, INDEX_OUT_OF_RANGE, EH_FATAL, NULL, 0);
+            return NULL;
+        }
+
+    A = malloc(sizeof(tms_sparse_matrix));
+    A->rows = rows;
+    A->columns = columns;
+    A->row_start = calloc(rows + 1, sizeof(int));
+
+    // Counting sort of the triplets by row
+    for (k = 0; k < count; ++k)
+        ++A->row_start[row[k] + 1];
+    for (i = 0; i < rows; ++i)
+        A->row_start[i + 1] += A->row_start[i];
+
+    entries = malloc(count * sizeof(_tms_sparse_entry));
+    next = malloc(rows * sizeof(int));
+    memcpy(next, A->row_start, rows * sizeof(int));
+    for (k = 0; k < count; ++k)
+        entries[next[row[k]]++] = (_tms_sparse_entry){col[k], values[k]};
+    free(next);
+
+    // Sort each row by column and add duplicates, rows are compacted in place
+    A->col_index = malloc(count * sizeof(int));
+    A->values = malloc(count * sizeof(double));
+    nnz = 0;
+    for (i = 0; i < rows; ++i)
+    {
+        int start = A->row_start[i], end = A->row_start[i + 1];
+        _tms_sparse_sort_row(entries + start, end - start);
+        A->row_start[i] = nnz;
+        for (j = start; j < end; ++j)
+        {
+            if (nnz > A->row_start[i] && A->col_index[nnz - 1] == entries[j].col)
+                A->values[nnz - 1] += entries[j].value;
+            else
+            {
+                A->col_index[nnz] = entries[j].col;
+                A->values[nnz] = entries[j].value;
+                ++nnz;
+            }
+        }
+    }
+    A->row_start[rows] = nnz;
+    A->nnz = nnz;
+    free(entries);
+
+    if (nnz < count)
+    {
+        A->col_index = realloc(A->col_index, (nnz > 0 ? nnz : 1) * sizeof(int));
+        A->values = realloc(A->values, (nnz > 0 ? nnz : 1) * sizeof(double));
+    }
+    return A;
+}
+
+tms_sparse_matrix *tms_sparse_from_dense(tms_matrix *M)
+{
+    int i, j, nnz = 0;
+    tms_sparse_matrix *A;
+    if (M == NULL)
+        return NULL;
+
+    for (i = 0; i < M->rows; ++i)
+        for (j = 0; j < M->columns; ++j)
+            if (TMS_MATRIX_ROW(M, i)[j] != 0)
+                ++nnz;
+
+    A = malloc(sizeof(tms_sparse_matrix));
+    A->rows = M->rows;
+    A->columns = M->columns;
+    A->nnz = nnz;
+    A->row_start = malloc((M->rows + 1) * sizeof(int));
+    A->col_index = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    A->values = malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+
+    nnz = 0;
+    for (i = 0; i < M->rows; ++i)
+    {
+        A->row_start[i] = nnz;
+        for (j = 0; j < M->columns; ++j)
+            if (TMS_MATRIX_ROW(M, i)[j] != 0)
+            {
+                A->col_index[nnz] = j;
+                A->values[nnz++] = TMS_MATRIX_ROW(M, i)[j];
+            }
+    }
+    A->row_start[M->rows] = nnz;
+    return A;
+}
+
+void tms_delete_sparse_matrix(tms_sparse_matrix *A)
+{
+    if (A == NULL)
+        return;
+    free(A->row_start);
+    free(A->col_index);
+    free(A->values);
+    free(A);
+}
+
+void tms_sparse_multiply_vector(tms_sparse_matrix *A, const double *x, double *y)
+{
+    int i, k;
+    double sum;
+    for (i = 0; i < A->rows; ++i)
+    {
+        sum = 0;
+        for (k = A->row_start[i]; k < A->row_start[i + 1]; ++k)
+            sum += A->values[k] * x[A->col_index[k]];
+        y[i] = sum;
+    }
+}
+
+// Returns the index of member (row, col) in col_index and values, -1 if it isn't stored
+static int _tms_sparse_find(tms_sparse_matrix *A, int row, int col)
+{
+    int low = A->row_start[row], high = A->row_start[row + 1] - 1, mid;
+    while (low <= high)
+    {
+        mid = low + (high - low) / 2;
+        if (A->col_index[mid] == col)
+            return mid;
+        else if (A->col_index[mid] < col)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return -1;
+}
+
+bool tms_sparse_is_symmetric(tms_sparse_matrix *A)
+{
+    int i, k, transposed;
+    if (A->rows != A->columns)
+        return false;
+
+    for (i = 0; i < A->rows; ++i)
+        for (k = A->row_start[i]; k < A->row_start[i + 1]; ++k)
+        {
+            transposed = _tms_sparse_find(A, A->col_index[k], i);
+            if (transposed == -1 || A->values[transposed] != A->values[k])
+                return false;
+        }
+    return true;
+}
+
+static double _tms_dot(const double *x, const double *y, int n)
+{
+    double sum = 0;
+    for (int i = 0; i < n; ++i)
+        sum += x[i] * y[i];
+    return sum;
+}
+
+// Jacobi preconditioner: inverse of the diagonal, rows without a usable diagonal member are left unscaled
+static double *_tms_jacobi(tms_sparse_matrix *A)
+{
+    int i, k;
+    double *inv_diagonal = malloc(A->rows * sizeof(double));
+    for (i = 0; i < A->rows; ++i)
+    {
+        k = _tms_sparse_find(A, i, i);
+        inv_diagonal[i] = (k == -1 || A->values[k] == 0 ? 1 : 1 / A->values[k]);
+    }
+    return inv_diagonal;
+}
+
+// Preconditioned conjugate gradient
+static int _tms_sparse_cg(tms_sparse_matrix *A, const double *b, double *x, double stop, int max_iterations)
+{
+    int i, iteration, n = A->rows;
+    double *inv_diagonal = _tms_jacobi(A), *r = malloc(n * sizeof(double)), *z = malloc(n * sizeof(double));
+    double *p = malloc(n * sizeof(double)), *Ap = malloc(n * sizeof(double));
+    double rz, rz_new, pAp, alpha, beta;
+
+    tms_sparse_multiply_vector(A, x, Ap);
+    for (i = 0; i < n; ++i)
+    {
+        r[i] = b[i] - Ap[i];
+        p[i] = z[i] = inv_diagonal[i] * r[i];
+    }
+    rz = _tms_dot(r, z, n);
+
+    // Written to stop on NaN residuals as a failure, not as convergence
+    for (iteration = 0; !(sqrt(_tms_dot(r, r, n)) <= stop); ++iteration)
+    {
+        tms_sparse_multiply_vector(A, p, Ap);
+        pAp = _tms_dot(p, Ap, n);
+        // Not positive definite, or max iterations reached
+        if (!(pAp > 0) || iteration == max_iterations)
+        {
+            iteration = -1;
+            break;
+        }
+        alpha = rz / pAp;
+        for (i = 0; i < n; ++i)
+        {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            z[i] = inv_diagonal[i] * r[i];
+        }
+        rz_new = _tms_dot(r, z, n);
+        beta = rz_new / rz;
+        rz = rz_new;
+        for (i = 0; i < n; ++i)
+            p[i] = z[i] + beta * p[i];
+    }
+
+    free(inv_diagonal);
+    free(r);
+    free(z);
+    free(p);
+    free(Ap);
+    return iteration;
+}
+
+// Right preconditioned BiCGSTAB
+static int _tms_sparse_bicgstab(tms_sparse_matrix *A, const double *b, double *x, double stop, int max_iterations)
+{
+    int i, iteration, n = A->rows;
+    double *inv_diagonal = _tms_jacobi(A), *work = malloc(7 * n * sizeof(double));
+    double *r = work, *r_hat = work + n, *p = work + 2 * n, *v = work + 3 * n, *y = work + 4 * n, *s = work + 5 * n,
+           *t = work + 6 * n;
+    double rho = 1, rho_new, alpha = 1, omega = 1, beta, tt, rv;
+
+    tms_sparse_multiply_vector(A, x, v);
+    for (i = 0; i < n; ++i)
+    {
+        r[i] = r_hat[i] = b[i] - v[i];
+        p[i] = v[i] = 0;
+    }
+
+    // Breakdowns (rho, r_hat.v or omega equal to 0) fail, NaN residuals don't stop the loop as converged
+    for (iteration = 0; !(sqrt(_tms_dot(r, r, n)) <= stop); ++iteration)
+    {
+        rho_new = _tms_dot(r_hat, r, n);
+        if (rho_new == 0 || iteration == max_iterations)
+        {
+            iteration = -1;
+            break;
+        }
+        beta = (rho_new / rho) * (alpha / omega);
+        rho = rho_new;
+        for (i = 0; i < n; ++i)
+        {
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+            y[i] = inv_diagonal[i] * p[i];
+        }
+        tms_sparse_multiply_vector(A, y, v);
+        rv = _tms_dot(r_hat, v, n);
+        if (rv == 0)
+        {
+            iteration = -1;
+            break;
+        }
+        alpha = rho / rv;
+        for (i = 0; i < n; ++i)
+            s[i] = r[i] - alpha * v[i];
+
+        if (sqrt(_tms_dot(s, s, n)) <= stop)
+        {
+            for (i = 0; i < n; ++i)
+                x[i] += alpha * y[i];
+            ++iteration;
+            break;
+        }
+
+        // y is reused for the preconditioned s
+        for (i = 0; i < n; ++i)
+        {
+            x[i] += alpha * y[i];
+            y[i] = inv_diagonal[i] * s[i];
+        }
+        tms_sparse_multiply_vector(A, y, t);
+        tt = _tms_dot(t, t, n);
+        omega = (tt == 0 ? 0 : _tms_dot(t, s, n) / tt);
+        if (omega == 0)
+        {
+            iteration = -1;
+            break;
+        }
+        for (i = 0; i < n; ++i)
+        {
+            x[i] += omega * y[i];
+            r[i] = s[i] - omega * t[i];
+        }
+    }
+
+    free(inv_diagonal);
+    free(work);
+    return iteration;
+}
+
+int tms_sparse_solve(tms_sparse_matrix *A, const double *b, double *x, int method, double tolerance,
+                     int max_iterations)
+{
+    int i, iterations;
+    bool positive_diagonal = true;
+
+    if (A == NULL || A->rows != A->columns)
+    {
+        tms_save_error(TMS_MATRIX, INVALID_MATRIX, EH_FATAL, NULL, 0);
+        return -1;
+    }
+    if (max_iterations <= 0)
+        max_iterations = (2 * A->rows > 100 ? 2 * A->rows : 100);
+
+    if (method == TMS_SPARSE_AUTO)
+    {
+        for (i = 0; i < A->rows && positive_diagonal; ++i)
+        {
+            int k = _tms_sparse_find(A, i, i);
+            positive_diagonal = (k != -1 && A->values[k] > 0);
+        }
+        method = (positive_diagonal && tms_sparse_is_symmetric(A) ? TMS_SPARSE_CG : TMS_SPARSE_BICGSTAB);
+    }
+
+    double stop = tolerance * sqrt(_tms_dot(b, b, A->rows));
+    if (method == TMS_SPARSE_CG)
+        iterations = _tms_sparse_cg(A, b, x, stop, max_iterations);
+    else if (method == TMS_SPARSE_BICGSTAB)
+        iterations = _tms_sparse_bicgstab(A, b, x, stop, max_iterations);
+    else
+    {
+        tms_save_error(TMS_MATRIX, INTERNAL_ERROR, EH_FATAL, NULL, 0);
+        return -1;
+    }
+
+    if (iterations == -1)
+        tms_save_error(TMS_MATRIX, NO_CONVERGENCE, EH_FATAL, NULL, 0);
+    return iterations;
+}
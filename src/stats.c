@@ -0,0 +1,55 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "stats.h"
+#include "internals.h"
+#include "stats_common.h"
+
+bool _tms_stats_on = false;
+uint64_t _tms_stats_count[TMS_STAT_COUNT], _tms_stats_ns[TMS_STAT_COUNT];
+_Thread_local int _tms_stats_depth[TMS_STAT_COUNT];
+
+// Same order as enum tms_stat_phases
+static const char *_tms_stat_names[] = {"parse",      "int_parse",    "expand_macros", "evaluate",
+                                        "int_evaluate", "extf",      "ufunc_lookup",  "save_error",
+                                        "parser_lock_wait", "evaluator_lock_wait"};
+
+_Static_assert(array_length(_tms_stat_names) == TMS_STAT_COUNT, "A phase has no name");
+
+void tms_set_stats(bool enable)
+{
+    __atomic_store_n(&_tms_stats_on, enable, __ATOMIC_RELAXED);
+}
+
+bool tms_stats_enabled()
+{
+    return __atomic_load_n(&_tms_stats_on, __ATOMIC_RELAXED);
+}
+
+tms_stats tms_get_stats()
+{
+    tms_stats S;
+    for (int i = 0; i < TMS_STAT_COUNT; ++i)
+    {
+        S.count[i] = __atomic_load_n(_tms_stats_count + i, __ATOMIC_RELAXED);
+        S.ns[i] = __atomic_load_n(_tms_stats_ns + i, __ATOMIC_RELAXED);
+    }
+    return S;
+}
+
+void tms_reset_stats()
+{
+    for (int i = 0; i < TMS_STAT_COUNT; ++i)
+    {
+        __atomic_store_n(_tms_stats_count + i, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(_tms_stats_ns + i, 0, __ATOMIC_RELAXED);
+    }
+}
+
+const char *tms_stat_name(int phase)
+{
+    if (phase < 0 || phase >= TMS_STAT_COUNT)
+        return NULL;
+    return _tms_stat_names[phase];
+}
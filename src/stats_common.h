@@ -0,0 +1,83 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#ifndef _TMS_STATS_COMMON_H
+#define _TMS_STATS_COMMON_H
+
+// Recording of the profiling counters, used by the instrumented functions
+
+#include "stats.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Returned by _tms_stats_begin() when the counters are disabled
+#define TMS_STATS_OFF UINT64_MAX
+
+extern bool _tms_stats_on;
+extern uint64_t _tms_stats_count[TMS_STAT_COUNT], _tms_stats_ns[TMS_STAT_COUNT];
+// Nesting depth of each phase in the current thread, only the outermost call is timed
+extern _Thread_local int _tms_stats_depth[TMS_STAT_COUNT];
+
+static inline uint64_t _tms_stats_now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+// Starts a phase, the returned value is passed to _tms_stats_end()
+static inline uint64_t _tms_stats_begin(int phase)
+{
+    if (!__atomic_load_n(&_tms_stats_on, __ATOMIC_RELAXED))
+        return TMS_STATS_OFF;
+    // 0 for nested calls, the monotonic clock is never 0
+    return _tms_stats_depth[phase]++ == 0 ? _tms_stats_now() : 0;
+}
+
+static inline void _tms_stats_end(int phase, uint64_t start)
+{
+    if (start == TMS_STATS_OFF)
+        return;
+    --_tms_stats_depth[phase];
+    __atomic_fetch_add(_tms_stats_count + phase, 1, __ATOMIC_RELAXED);
+    if (start != 0)
+        __atomic_fetch_add(_tms_stats_ns + phase, _tms_stats_now() - start, __ATOMIC_RELAXED);
+}
+
+// Locks the mutex, the time spent waiting for another thread to release it is recorded in phase
+static inline void _tms_stats_lock(pthread_mutex_t *lock, int phase)
+{
+    if (!__atomic_load_n(&_tms_stats_on, __ATOMIC_RELAXED) || pthread_mutex_trylock(lock) != 0)
+    {
+        uint64_t start = _tms_stats_begin(phase);
+        pthread_mutex_lock(lock);
+        _tms_stats_end(phase, start);
+    }
+}
+
+// Read locks the rwlock, the wait is recorded like _tms_stats_lock()
+static inline void _tms_stats_rdlock(pthread_rwlock_t *lock, int phase)
+{
+    if (!__atomic_load_n(&_tms_stats_on, __ATOMIC_RELAXED) || pthread_rwlock_tryrdlock(lock) != 0)
+    {
+        uint64_t start = _tms_stats_begin(phase);
+        pthread_rwlock_rdlock(lock);
+        _tms_stats_end(phase, start);
+    }
+}
+
+// Write locks the rwlock, the wait is recorded like _tms_stats_lock()
+static inline void _tms_stats_wrlock(pthread_rwlock_t *lock, int phase)
+{
+    if (!__atomic_load_n(&_tms_stats_on, __ATOMIC_RELAXED) || pthread_rwlock_trywrlock(lock) != 0)
+    {
+        uint64_t start = _tms_stats_begin(phase);
+        pthread_rwlock_wrlock(lock);
+        _tms_stats_end(phase, start);
+    }
+}
+
+#endif
@@ -556,51 +556,38 @@ Returns true on success and false in case of invalid indexes a and b.
 */
 void _tms_combine_add_sub(char *expr)
 {
-    int subcount, i, j, length = strlen(expr);
+    int i = 0, j = 0, subcount;
 
-    i = tms_find_add_subtract(expr, 0);
-    while (i != -1 && i < length)
+    // Compact the string in a single pass, "i" reads and "j" writes
+    while (expr[i] != '\0')
     {
-        j = i;
-        subcount = 0;
-        if (expr[j] == '-')
-            ++subcount;
-        while (1)
-        {
-            if (expr[j + 1] == '-')
-                ++subcount;
-            else if (expr[j + 1] != '+')
-                break;
-            ++j;
-        }
-        if (subcount >= 1)
+        if (expr[i] == '+' || expr[i] == '-')
         {
-            if (subcount % 2 == 1)
-                expr[i] = '-';
-            else
-                expr[i] = '+';
+            subcount = 0;
+            while (expr[i] == '+' || expr[i] == '-')
+            {
+                if (expr[i] == '-')
+                    ++subcount;
+                ++i;
+            }
+            expr[j++] = (subcount % 2 == 1 ? '-' : '+');
         }
-        if (i < j)
-            tms_resize_zone(expr, j, i);
-        i = tms_find_add_subtract(expr, i + 1);
+        else
+            expr[j++] = expr[i++];
     }
+    expr[j] = '\0';
 }
 
 void tms_remove_whitespace(char *str)
 {
-    int start, end, length;
-    length = strlen(str);
-    for (start = 0; start < length; ++start)
+    int i, j = 0;
+    // Single pass compaction, avoids shifting the remaining string for each whitespace run
+    for (i = 0; str[i] != '\0'; ++i)
     {
-        if (isspace(str[start]))
-        {
-            end = start;
-            while (isspace(str[end]))
-                ++end;
-            memmove(str + start, str + end, length - end + 1);
-            length -= end - start;
-        }
+        if (!isspace(str[i]))
+            str[j++] = str[i];
     }
+    str[j] = '\0';
 }
 
 void tms_resize_zone(char *str, int old_end, int new_end)
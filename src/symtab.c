@@ -0,0 +1,277 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "symtab.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Keeps at least half of the slots empty: probing always ends on an empty slot, and misses stay short
+#define TMS_SYMTAB_MAX_LOAD(cap) ((cap) / 2)
+
+typedef struct _tms_symtab_slot
+{
+    // 0 for empty slots, the hash is never 0 otherwise
+    uint32_t hash;
+    // First bytes of the name, zero padded
+    uint64_t key[TMS_SYMTAB_KEY_SIZE / 8];
+} _tms_symtab_slot;
+
+struct tms_symtab
+{
+    size_t elsize;
+    size_t capacity;
+    size_t mask;
+    size_t count;
+    uint64_t seed;
+    void (*elfree)(void *item);
+    _tms_symtab_slot *slots;
+    // Items are in a separate array, the slot i holds the key of item i
+    char *items;
+    // Stores the replaced or deleted item returned to the caller
+    char *spare;
+};
+
+static inline void *_tms_symtab_item(tms_symtab *T, size_t i)
+{
+    return T->items + i * T->elsize;
+}
+
+static inline const char *_tms_symtab_item_name(const void *item)
+{
+    return *(char *const *)item;
+}
+
+static inline uint64_t _tms_symtab_mix(uint64_t h, uint64_t value)
+{
+    h = (h ^ value) * 0x9E3779B97F4A7C15;
+    return h ^ (h >> 32);
+}
+
+// Hashes the name and copies its first bytes to key
+static inline uint32_t _tms_symtab_hash(tms_symtab *T, const char *name, uint64_t key[TMS_SYMTAB_KEY_SIZE / 8],
+                                        size_t *len)
+{
+    size_t n = _tms_symtab_key(name, key), i;
+    uint64_t chunk, h;
+
+    h = _tms_symtab_mix(T->seed, key[0]);
+    h = _tms_symtab_mix(h, key[1]);
+    for (i = TMS_SYMTAB_KEY_SIZE; i < n; i += 8)
+    {
+        chunk = 0;
+        memcpy(&chunk, name + i, n - i < 8 ? n - i : 8);
+        h = _tms_symtab_mix(h, chunk);
+    }
+    h *= 0xD6E8FEB86659FD93;
+    h ^= h >> 29;
+
+    *len = n;
+    // 0 marks empty slots
+    return (uint32_t)h != 0 ? (uint32_t)h : 1;
+}
+
+// Returns the slot holding name, or the empty slot where it should be inserted
+static inline size_t _tms_symtab_find(tms_symtab *T, const char *name, uint32_t hash, const uint64_t *key, size_t len)
+{
+    size_t i = hash & T->mask;
+    _tms_symtab_slot *slot;
+    while (true)
+    {
+        slot = T->slots + i;
+        if (slot->hash == 0)
+            return i;
+        if (slot->hash == hash && slot->key[0] == key[0] && slot->key[1] == key[1])
+        {
+            // Names shorter than the key are fully compared already
+            if (len < TMS_SYMTAB_KEY_SIZE ||
+                strcmp(_tms_symtab_item_name(_tms_symtab_item(T, i)) + TMS_SYMTAB_KEY_SIZE,
+                       name + TMS_SYMTAB_KEY_SIZE) == 0)
+                return i;
+        }
+        i = (i + 1) & T->mask;
+    }
+}
+
+static void _tms_symtab_alloc(tms_symtab *T, size_t capacity)
+{
+    T->capacity = capacity;
+    T->mask = capacity - 1;
+    T->slots = calloc(capacity, sizeof(_tms_symtab_slot));
+    T->items = malloc(capacity * T->elsize);
+}
+
+static void _tms_symtab_grow(tms_symtab *T)
+{
+    _tms_symtab_slot *old_slots = T->slots;
+    char *old_items = T->items;
+    size_t old_capacity = T->capacity, i, j;
+
+    _tms_symtab_alloc(T, old_capacity * 2);
+    for (i = 0; i < old_capacity; ++i)
+    {
+        if (old_slots[i].hash == 0)
+            continue;
+        j = old_slots[i].hash & T->mask;
+        while (T->slots[j].hash != 0)
+            j = (j + 1) & T->mask;
+        T->slots[j] = old_slots[i];
+        memcpy(_tms_symtab_item(T, j), old_items + i * T->elsize, T->elsize);
+    }
+    free(old_slots);
+    free(old_items);
+}
+
+tms_symtab *tms_symtab_new(size_t elsize, size_t cap, uint64_t seed, void (*elfree)(void *item))
+{
+    size_t capacity = 16;
+    tms_symtab *T = malloc(sizeof(tms_symtab));
+    while (TMS_SYMTAB_MAX_LOAD(capacity) < cap)
+        capacity *= 2;
+
+    T->elsize = elsize;
+    T->count = 0;
+    T->seed = seed;
+    T->elfree = elfree;
+    T->spare = malloc(elsize);
+    _tms_symtab_alloc(T, capacity);
+    return T;
+}
+
+void tms_symtab_free(tms_symtab *T)
+{
+    if (T == NULL)
+        return;
+    free(T->slots);
+    free(T->items);
+    free(T->spare);
+    free(T);
+}
+
+void tms_symtab_clear(tms_symtab *T)
+{
+    for (size_t i = 0; i < T->capacity; ++i)
+    {
+        if (T->slots[i].hash != 0 && T->elfree != NULL)
+            T->elfree(_tms_symtab_item(T, i));
+        T->slots[i].hash = 0;
+    }
+    T->count = 0;
+}
+
+size_t tms_symtab_count(tms_symtab *T)
+{
+    return T->count;
+}
+
+const void *tms_symtab_get(tms_symtab *T, const char *name)
+{
+    uint64_t key[TMS_SYMTAB_KEY_SIZE / 8];
+    size_t len;
+    uint32_t hash = _tms_symtab_hash(T, name, key, &len);
+    size_t i = _tms_symtab_find(T, name, hash, key, len);
+    return T->slots[i].hash != 0 ? _tms_symtab_item(T, i) : NULL;
+}
+
+const void *tms_symtab_set(tms_symtab *T, const void *item)
+{
+    uint64_t key[TMS_SYMTAB_KEY_SIZE / 8];
+    size_t len, i;
+    const char *name = _tms_symtab_item_name(item);
+    uint32_t hash = _tms_symtab_hash(T, name, key, &len);
+
+    i = _tms_symtab_find(T, name, hash, key, len);
+    if (T->slots[i].hash != 0)
+    {
+        memcpy(T->spare, _tms_symtab_item(T, i), T->elsize);
+        memcpy(_tms_symtab_item(T, i), item, T->elsize);
+        return T->spare;
+    }
+
+    if (T->count + 1 > TMS_SYMTAB_MAX_LOAD(T->capacity))
+    {
+        _tms_symtab_grow(T);
+        i = _tms_symtab_find(T, name, hash, key, len);
+    }
+    T->slots[i].hash = hash;
+    T->slots[i].key[0] = key[0];
+    T->slots[i].key[1] = key[1];
+    memcpy(_tms_symtab_item(T, i), item, T->elsize);
+    ++T->count;
+    return NULL;
+}
+
+const void *tms_symtab_delete(tms_symtab *T, const char *name)
+{
+    uint64_t key[TMS_SYMTAB_KEY_SIZE / 8];
+    size_t len, i, j, home;
+    uint32_t hash = _tms_symtab_hash(T, name, key, &len);
+
+    i = _tms_symtab_find(T, name, hash, key, len);
+    if (T->slots[i].hash == 0)
+        return NULL;
+    memcpy(T->spare, _tms_symtab_item(T, i), T->elsize);
+
+    // Backward shift: move back the following items of the probe sequence that can use the free slot (no tombstones)
+    j = i;
+    while (true)
+    {
+        j = (j + 1) & T->mask;
+        if (T->slots[j].hash == 0)
+            break;
+        home = T->slots[j].hash & T->mask;
+        // The item at j can move to i if i is between its home slot and j
+        if (((j - home) & T->mask) >= ((j - i) & T->mask))
+        {
+            T->slots[i] = T->slots[j];
+            memcpy(_tms_symtab_item(T, i), _tms_symtab_item(T, j), T->elsize);
+            i = j;
+        }
+    }
+    T->slots[i].hash = 0;
+    --T->count;
+    return T->spare;
+}
+
+int tms_symtab_delete_and_free(tms_symtab *T, const char *name)
+{
+    void *item = (void *)tms_symtab_delete(T, name);
+    if (item == NULL)
+        return -1;
+    if (T->elfree != NULL)
+        T->elfree(item);
+    return 0;
+}
+
+bool tms_symtab_iter(tms_symtab *T, size_t *i, void **item)
+{
+    for (; *i < T->capacity; ++*i)
+        if (T->slots[*i].hash != 0)
+        {
+            *item = _tms_symtab_item(T, (*i)++);
+            return true;
+        }
+    return false;
+}
+
+static int _tms_symtab_compare(const void *a, const void *b)
+{
+    return strcmp(_tms_symtab_item_name(a), _tms_symtab_item_name(b));
+}
+
+void *tms_symtab_to_array(tms_symtab *T, size_t *len, bool sort)
+{
+    size_t i, count = 0;
+    char *array;
+    if (T == NULL || T->count == 0 || len == NULL)
+        return NULL;
+
+    array = malloc(T->count * T->elsize);
+    for (i = 0; i < T->capacity; ++i)
+        if (T->slots[i].hash != 0)
+            memcpy(array + count++ * T->elsize, _tms_symtab_item(T, i), T->elsize);
+    if (sort)
+        qsort(array, count, T->elsize, _tms_symtab_compare);
+    *len = count;
+    return array;
+}
@@ -0,0 +1,420 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+#include "thread_pool.h"
+#include "internals.h"
+#include "profile_common.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Chunks [first, last) of a job owned by a thread, the others steal its upper half when they run out
+typedef struct _tms_pool_slot
+{
+    pthread_mutex_t lock;
+    size_t first, last;
+} _tms_pool_slot;
+
+typedef struct _tms_pool_job
+{
+    tms_range_func func;
+    void *arg;
+    size_t n, grain;
+    // One slot per thread that can join, slot 0 belongs to the thread that started the job
+    _tms_pool_slot *slots;
+    int slot_count;
+    // Slots taken, protected by the pool lock
+    int joined;
+    // Pool threads running the job, protected by lock
+    int running;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    struct _tms_pool_job *next;
+} _tms_pool_job;
+
+// Task queued with _tms_pool_submit()
+typedef struct _tms_pool_task
+{
+    void (*func)(void *);
+    void *arg;
+    struct _tms_pool_task *next;
+} _tms_pool_task;
+
+static pthread_mutex_t _tms_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+// Serializes the resizing and stopping of the pool
+static pthread_mutex_t _tms_pool_resize_lock = PTHREAD_MUTEX_INITIALIZER;
+// Signaled when a job or task is queued, and when the pool stops
+static pthread_cond_t _tms_pool_wake = PTHREAD_COND_INITIALIZER;
+// Signaled when the last running job or task finishes
+static pthread_cond_t _tms_pool_idle = PTHREAD_COND_INITIALIZER;
+
+// Number of threads of the pool including the caller, 0 for the number of CPUs
+static int _tms_pool_size = 0;
+static pthread_t *_tms_pool_threads = NULL;
+static int _tms_pool_started = 0;
+static bool _tms_pool_stopping = false;
+// Jobs with free slots, oldest first
+static _tms_pool_job *_tms_pool_queue = NULL;
+// Jobs started and not finished
+static int _tms_pool_jobs = 0;
+// Tasks waiting for a thread, oldest first, and their last link
+static _tms_pool_task *_tms_task_queue = NULL, **_tms_task_tail = &_tms_task_queue;
+// Tasks queued or running
+static int _tms_pool_tasks = 0;
+
+static tms_executor _tms_executor;
+static bool _tms_has_executor = false;
+
+// Nonzero while the thread runs a range of a job
+static _Thread_local int _tms_pool_depth = 0;
+
+// Number of threads of the pool, with 0 resolved to the number of CPUs
+static int _tms_pool_threads_count()
+{
+    if (_tms_pool_size != 0)
+        return _tms_pool_size;
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpus < 1 ? 1 : (int)cpus);
+#else
+    return 1;
+#endif
+}
+
+static void _tms_pool_run_range(tms_range_func func, void *arg, size_t begin, size_t end)
+{
+    ++_tms_pool_depth;
+    func(arg, begin, end);
+    --_tms_pool_depth;
+}
+
+// Takes the first chunk of a slot, returns false if it is empty
+static bool _tms_pool_take(_tms_pool_slot *S, size_t *chunk)
+{
+    bool found = false;
+    pthread_mutex_lock(&S->lock);
+    if (S->first < S->last)
+    {
+        *chunk = S->first++;
+        found = true;
+    }
+    pthread_mutex_unlock(&S->lock);
+    return found;
+}
+
+// Moves the upper half of the chunks of another slot to the (empty) slot "self", returns false if all slots are empty
+static bool _tms_pool_steal(_tms_pool_job *J, int self)
+{
+    size_t first, last;
+    for (int k = 1; k < J->slot_count; ++k)
+    {
+        _tms_pool_slot *victim = J->slots + (self + k) % J->slot_count;
+        pthread_mutex_lock(&victim->lock);
+        last = victim->last;
+        first = last - (last - victim->first + 1) / 2;
+        victim->last = first;
+        pthread_mutex_unlock(&victim->lock);
+        if (first < last)
+        {
+            pthread_mutex_lock(&J->slots[self].lock);
+            J->slots[self].first = first;
+            J->slots[self].last = last;
+            pthread_mutex_unlock(&J->slots[self].lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runs the chunks of slot "self", then the chunks stolen from the other slots until none is left
+static void _tms_pool_participate(_tms_pool_job *J, int self)
+{
+    size_t chunk, end;
+    do
+    {
+        while (_tms_pool_take(J->slots + self, &chunk))
+        {
+            end = (chunk + 1) * J->grain;
+            _tms_pool_run_range(J->func, J->arg, chunk * J->grain, end < J->n ? end : J->n);
+        }
+    } while (_tms_pool_steal(J, self));
+}
+
+// Removes a job from the queue if it is still there, called with the pool lock held
+static void _tms_pool_dequeue(_tms_pool_job *J)
+{
+    _tms_pool_job **link = &_tms_pool_queue;
+    while (*link != NULL && *link != J)
+        link = &(*link)->next;
+    if (*link != NULL)
+        *link = J->next;
+}
+
+static void *_tms_pool_worker(void *unused)
+{
+    (void)unused;
+    _tms_pool_job *J;
+    _tms_pool_task *T;
+    int slot;
+
+    pthread_mutex_lock(&_tms_pool_lock);
+    while (true)
+    {
+        while (!_tms_pool_stopping && _tms_pool_queue == NULL && _tms_task_queue == NULL)
+            pthread_cond_wait(&_tms_pool_wake, &_tms_pool_lock);
+        if (_tms_pool_stopping)
+            break;
+
+        // Jobs first, their threads are waiting for them
+        if (_tms_pool_queue == NULL)
+        {
+            T = _tms_task_queue;
+            _tms_task_queue = T->next;
+            if (_tms_task_queue == NULL)
+                _tms_task_tail = &_tms_task_queue;
+            pthread_mutex_unlock(&_tms_pool_lock);
+
+            T->func(T->arg);
+            free(T);
+
+            pthread_mutex_lock(&_tms_pool_lock);
+            if (--_tms_pool_tasks == 0 && _tms_pool_jobs == 0)
+                pthread_cond_broadcast(&_tms_pool_idle);
+            continue;
+        }
+
+        J = _tms_pool_queue;
+        slot = J->joined++;
+        if (J->joined == J->slot_count)
+            _tms_pool_queue = J->next;
+        pthread_mutex_lock(&J->lock);
+        ++J->running;
+        pthread_mutex_unlock(&J->lock);
+        pthread_mutex_unlock(&_tms_pool_lock);
+
+        _tms_pool_participate(J, slot);
+
+        // The job may be freed by its thread as soon as the lock is released
+        pthread_mutex_lock(&J->lock);
+        if (--J->running == 0)
+            pthread_cond_signal(&J->finished);
+        pthread_mutex_unlock(&J->lock);
+
+        pthread_mutex_lock(&_tms_pool_lock);
+    }
+    pthread_mutex_unlock(&_tms_pool_lock);
+    return NULL;
+}
+
+// Starts the pool threads if needed (at least "minimum"), called with the pool lock held
+static void _tms_pool_start(int minimum)
+{
+    int count = _tms_pool_threads_count() - 1;
+    if (count < minimum)
+        count = minimum;
+    if (_tms_pool_started != 0 || _tms_pool_stopping || count < 1)
+        return;
+
+    _tms_pool_threads = malloc(count * sizeof(pthread_t));
+    if (_tms_pool_threads == NULL)
+        return;
+    // The job still completes if some threads couldn't be started
+    while (_tms_pool_started < count &&
+           pthread_create(_tms_pool_threads + _tms_pool_started, NULL, _tms_pool_worker, NULL) == 0)
+        ++_tms_pool_started;
+}
+
+// Waits for the running jobs and tasks, then stops the pool threads
+static void _tms_pool_stop()
+{
+    pthread_mutex_lock(&_tms_pool_lock);
+    while (_tms_pool_jobs != 0 || _tms_pool_tasks != 0)
+        pthread_cond_wait(&_tms_pool_idle, &_tms_pool_lock);
+    _tms_pool_stopping = true;
+    pthread_cond_broadcast(&_tms_pool_wake);
+    pthread_mutex_unlock(&_tms_pool_lock);
+
+    for (int i = 0; i < _tms_pool_started; ++i)
+        pthread_join(_tms_pool_threads[i], NULL);
+
+    pthread_mutex_lock(&_tms_pool_lock);
+    free(_tms_pool_threads);
+    _tms_pool_threads = NULL;
+    _tms_pool_started = 0;
+    _tms_pool_stopping = false;
+    // Tasks submitted while the threads were stopping
+    if (_tms_task_queue != NULL)
+        _tms_pool_start(1);
+    pthread_mutex_unlock(&_tms_pool_lock);
+}
+
+void tms_set_thread_pool_size(int count)
+{
+    pthread_mutex_lock(&_tms_pool_resize_lock);
+    _tms_pool_stop();
+    pthread_mutex_lock(&_tms_pool_lock);
+    _tms_pool_size = (count < 0 ? 0 : count);
+    pthread_mutex_unlock(&_tms_pool_lock);
+    pthread_mutex_unlock(&_tms_pool_resize_lock);
+}
+
+int tms_get_thread_pool_size()
+{
+    pthread_mutex_lock(&_tms_pool_lock);
+    int count = _tms_pool_threads_count();
+    pthread_mutex_unlock(&_tms_pool_lock);
+    return count;
+}
+
+void tms_stop_thread_pool()
+{
+    pthread_mutex_lock(&_tms_pool_resize_lock);
+    _tms_pool_stop();
+    pthread_mutex_unlock(&_tms_pool_resize_lock);
+}
+
+void tms_set_executor(const tms_executor *E)
+{
+    pthread_mutex_lock(&_tms_pool_lock);
+    _tms_has_executor = (E != NULL);
+    if (E != NULL)
+        _tms_executor = *E;
+    pthread_mutex_unlock(&_tms_pool_lock);
+}
+
+int tms_get_thread_count()
+{
+    pthread_mutex_lock(&_tms_pool_lock);
+    bool has_executor = _tms_has_executor;
+    tms_executor E = _tms_executor;
+    int count = _tms_pool_threads_count();
+    pthread_mutex_unlock(&_tms_pool_lock);
+
+    if (has_executor)
+        count = E.thread_count(E.context);
+    return (count < 1 ? 1 : count);
+}
+
+bool _tms_parallel_enabled()
+{
+    return _tms_pool_depth == 0 && !_tms_debug && !_tms_profiling(NULL) && tms_get_thread_count() > 1;
+}
+
+// Function and argument of a job run by a host executor
+typedef struct _tms_executor_job
+{
+    tms_range_func func;
+    void *arg;
+} _tms_executor_job;
+
+static void _tms_executor_range(void *arg, size_t begin, size_t end)
+{
+    _tms_executor_job *J = arg;
+    _tms_pool_run_range(J->func, J->arg, begin, end);
+}
+
+void tms_parallel_for(size_t n, size_t grain, tms_range_func func, void *arg)
+{
+    if (n == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+    size_t chunks = (n + grain - 1) / grain;
+    if (chunks == 1 || !_tms_parallel_enabled())
+    {
+        _tms_pool_run_range(func, arg, 0, n);
+        return;
+    }
+
+    pthread_mutex_lock(&_tms_pool_lock);
+    if (_tms_has_executor)
+    {
+        tms_executor E = _tms_executor;
+        pthread_mutex_unlock(&_tms_pool_lock);
+        _tms_executor_job EJ = {func, arg};
+        E.parallel_for(E.context, n, grain, _tms_executor_range, &EJ);
+        return;
+    }
+
+    int i, slot_count = _tms_pool_threads_count();
+    if ((size_t)slot_count > chunks)
+        slot_count = chunks;
+    _tms_pool_job J = {.func = func,
+                       .arg = arg,
+                       .n = n,
+                       .grain = grain,
+                       .slots = malloc(slot_count * sizeof(_tms_pool_slot)),
+                       .slot_count = slot_count,
+                       .joined = 1};
+    if (J.slots == NULL)
+    {
+        pthread_mutex_unlock(&_tms_pool_lock);
+        _tms_pool_run_range(func, arg, 0, n);
+        return;
+    }
+    for (i = 0; i < slot_count; ++i)
+    {
+        pthread_mutex_init(&J.slots[i].lock, NULL);
+        J.slots[i].first = chunks * i / slot_count;
+        J.slots[i].last = chunks * (i + 1) / slot_count;
+    }
+    pthread_mutex_init(&J.lock, NULL);
+    pthread_cond_init(&J.finished, NULL);
+
+    _tms_pool_start(0);
+    ++_tms_pool_jobs;
+    // Queue the job, the slots without a thread are stolen by the others
+    _tms_pool_job **link = &_tms_pool_queue;
+    while (*link != NULL)
+        link = &(*link)->next;
+    *link = &J;
+    pthread_cond_broadcast(&_tms_pool_wake);
+    pthread_mutex_unlock(&_tms_pool_lock);
+
+    _tms_pool_participate(&J, 0);
+
+    // All the chunks are taken, wait for the pool threads still running theirs
+    pthread_mutex_lock(&_tms_pool_lock);
+    _tms_pool_dequeue(&J);
+    pthread_mutex_unlock(&_tms_pool_lock);
+    pthread_mutex_lock(&J.lock);
+    while (J.running != 0)
+        pthread_cond_wait(&J.finished, &J.lock);
+    pthread_mutex_unlock(&J.lock);
+
+    pthread_mutex_lock(&_tms_pool_lock);
+    if (--_tms_pool_jobs == 0 && _tms_pool_tasks == 0)
+        pthread_cond_broadcast(&_tms_pool_idle);
+    pthread_mutex_unlock(&_tms_pool_lock);
+
+    for (i = 0; i < slot_count; ++i)
+        pthread_mutex_destroy(&J.slots[i].lock);
+    free(J.slots);
+    pthread_mutex_destroy(&J.lock);
+    pthread_cond_destroy(&J.finished);
+}
+
+int _tms_pool_submit(void (*func)(void *), void *arg)
+{
+    _tms_pool_task *T = malloc(sizeof(_tms_pool_task));
+    if (T == NULL)
+        return -1;
+    *T = (_tms_pool_task){func, arg, NULL};
+
+    pthread_mutex_lock(&_tms_pool_lock);
+    // Tasks need a pool thread even if the pool size is 1
+    _tms_pool_start(1);
+    if (_tms_pool_started == 0 && !_tms_pool_stopping)
+    {
+        pthread_mutex_unlock(&_tms_pool_lock);
+        free(T);
+        return -1;
+    }
+    *_tms_task_tail = T;
+    _tms_task_tail = &T->next;
+    ++_tms_pool_tasks;
+    pthread_cond_signal(&_tms_pool_wake);
+    pthread_mutex_unlock(&_tms_pool_lock);
+    return 0;
+}
@@ -0,0 +1,882 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+
+#include "error_handler.h"
+#include "evaluator.h"
+#include "hashmap.h"
+#include "int_parser.h"
+#include "internals.h"
+#include "jit.h"
+#include "matrix.h"
+#include "parser.h"
+#include "scientific.h"
+#include "serializer.h"
+#include "sparse.h"
+#include "string_tools.h"
+#include "symtab.h"
+#include "tms_math_strs.h"
+#include "version.h"
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Allocations counter: glibc allows replacing malloc, the replacements count the calls and use the glibc allocator
+#if defined(__GLIBC__)
+#define BENCH_COUNTS_ALLOCS 1
+static size_t bench_allocs = 0;
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr == NULL ? ENOMEM : 0;
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+static size_t allocs_count()
+{
+    return __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+}
+#else
+#define BENCH_COUNTS_ALLOCS 0
+static size_t allocs_count()
+{
+    return 0;
+}
+#endif
+
+static double now_ns()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Generates a flat expression of about "size" bytes: 12.5+3*4-7/2^2+...
+char *gen_flat_expr(size_t size)
+{
+    const char *pattern = "12.5+3*4-7/2^2+1e-3*5+";
+    size_t p_len = strlen(pattern), i;
+    char *expr = malloc(size + p_len + 2);
+
+    for (i = 0; i + p_len <= size; i += p_len)
+        memcpy(expr + i, pattern, p_len);
+    expr[i] = '1';
+    expr[i + 1] = '\0';
+    return expr;
+}
+
+// Generates a deeply nested expression of about "size" bytes: ((((1)+1)*2)+1)*2...
+char *gen_nested_expr(size_t size)
+{
+    const char *closing = ")*2+1";
+    size_t c_len = strlen(closing), depth = size / (c_len + 1), i, j = 0;
+    char *expr = malloc(depth * (c_len + 1) + 2);
+
+    for (i = 0; i < depth; ++i)
+        expr[j++] = '(';
+    expr[j++] = '1';
+    for (i = 0; i < depth; ++i, j += c_len)
+        memcpy(expr + j, closing, c_len);
+    expr[j] = '\0';
+    return expr;
+}
+
+// Generates an expression with "count" subexpressions side by side: sin(1)+(2*3)-sin(1)+(2*3)-...
+char *gen_wide_subexprs(size_t count)
+{
+    const char *pattern = "sin(1)+(2*3)-";
+    size_t p_len = strlen(pattern), i, j = 0;
+    char *expr = malloc((count / 2 + 1) * p_len + 2);
+
+    for (i = 0; i < count / 2; ++i, j += p_len)
+        memcpy(expr + j, pattern, p_len);
+    expr[j++] = '1';
+    expr[j] = '\0';
+    return expr;
+}
+
+// Generates an expression with "count" nested subexpressions: cos((cos((1)*2)*2)*2)...
+char *gen_nested_subexprs(size_t count)
+{
+    const char *opening = "cos((", *closing = ")*2)";
+    size_t o_len = strlen(opening), c_len = strlen(closing), i, j = 0;
+    char *expr = malloc((count / 2 + 1) * (o_len + c_len) + 2);
+
+    for (i = 0; i < count / 2; ++i, j += o_len)
+        memcpy(expr + j, opening, o_len);
+    expr[j++] = '1';
+    for (i = 0; i < count / 2; ++i, j += c_len)
+        memcpy(expr + j, closing, c_len);
+    expr[j] = '\0';
+    return expr;
+}
+
+// Measures the parse time of generated expressions, "n" is the size argument passed to the generator
+void bench_parse(const char *name, const char *unit, char *(*generator)(size_t), size_t min_n, size_t max_n)
+{
+    puts(name);
+    printf("%10s %9s %10s\n", unit, "ms", "ns/unit");
+    for (size_t n = min_n; n <= max_n; n *= 2)
+    {
+        char *expr = generator(n);
+        double start = now_ns();
+        tms_math_expr *M = tms_parse_expr(expr, 0, NULL);
+        double elapsed = now_ns() - start;
+
+        if (M == NULL)
+        {
+            tms_print_errors(TMS_PARSER);
+            exit(1);
+        }
+        printf("%10zu %9.3f %10.2f\n", n, elapsed / 1e6, elapsed / n);
+        tms_delete_math_expr(M);
+        free(expr);
+    }
+}
+
+// Compares parsing "count" formulas with loading them from a catalog file
+void bench_catalog(int count)
+{
+    const char *path = "tms_bench_catalog.bin";
+    char expr[64];
+    tms_math_expr **list = malloc(count * sizeof(tms_math_expr *));
+    int i;
+
+    puts("Catalog:");
+    double start = now_ns();
+    for (i = 0; i < count; ++i)
+    {
+        sprintf(expr, "sin(%d*x)+cos(x/%d)^2-sqrt(%d+x)", i, i + 1, i);
+        list[i] = tms_parse_expr(expr, 0, tms_get_args("x"));
+        if (list[i] == NULL)
+        {
+            tms_print_errors(TMS_PARSER);
+            exit(1);
+        }
+    }
+    printf("%-18s %9.3f ms\n", "parse", (now_ns() - start) / 1e6);
+
+    start = now_ns();
+    if (tms_save_math_exprs(path, list, count) != 0)
+    {
+        tms_print_errors(TMS_GENERAL);
+        exit(1);
+    }
+    printf("%-18s %9.3f ms\n", "save", (now_ns() - start) / 1e6);
+
+    start = now_ns();
+    tms_catalog *C = tms_open_catalog(path);
+    if (C == NULL)
+    {
+        tms_print_errors(TMS_GENERAL);
+        exit(1);
+    }
+    printf("%-18s %9.3f ms\n", "open", (now_ns() - start) / 1e6);
+
+    start = now_ns();
+    for (i = 0; i < count; ++i)
+    {
+        if (tms_catalog_get_math_expr(C, i) == NULL)
+        {
+            tms_print_errors(TMS_GENERAL);
+            exit(1);
+        }
+    }
+    printf("%-18s %9.3f ms\n", "load (first get)", (now_ns() - start) / 1e6);
+
+    tms_close_catalog(C);
+    remove(path);
+    for (i = 0; i < count; ++i)
+        tms_delete_math_expr(list[i]);
+    free(list);
+}
+
+// Compares the evaluator and the JIT on repeated evaluations of an expression with a label
+void bench_eval(const char *expr, int options, int count)
+{
+    tms_math_expr *M = tms_parse_expr(expr, options, tms_get_args("x"));
+    double complex x, sum;
+    int i, pass;
+
+    if (M == NULL)
+    {
+        tms_print_errors(TMS_PARSER);
+        exit(1);
+    }
+    printf("Evaluate %s:\n", expr);
+    for (pass = 0; pass < 2; ++pass)
+    {
+        // The expression is compiled at its first evaluation of the second pass
+        tms_set_jit_threshold(pass);
+        sum = 0;
+        double start = now_ns();
+        for (i = 0; i < count; ++i)
+        {
+            x = i * 1e-3;
+            tms_set_labels_values(M, &x);
+            sum += tms_evaluate(M, 0);
+        }
+        printf("%-18s %9.2f ns/eval (sum: %g)\n", (pass == 0 ? "evaluator" : "jit"), (now_ns() - start) / count,
+               creal(sum));
+    }
+    tms_set_jit_threshold(0);
+    tms_delete_math_expr(M);
+}
+
+// Times the LU factorization, determinant, inverse, a solve with an existing factorization
+// and tms_matrix_solve() with 16 right hand sides for n*n matrices
+void bench_matrix(int max_n)
+{
+    puts("Matrix (LU):");
+    printf("%6s %12s %12s %12s %12s %12s\n", "n", "lu ms", "det ms", "inv ms", "solve ms", "16 rhs ms");
+    srand(1);
+    for (int n = 2; n <= max_n; n *= 2)
+    {
+        tms_matrix *M = tms_new_matrix(n, n), *B = tms_new_matrix(n, 16);
+        double *b = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+        for (int i = 0; i < n; ++i)
+        {
+            b[i] = rand() / (double)RAND_MAX;
+            for (int j = 0; j < n; ++j)
+                TMS_MATRIX_ROW(M, i)[j] = rand() / (double)RAND_MAX - 0.5;
+            for (int j = 0; j < 16; ++j)
+                TMS_MATRIX_ROW(B, i)[j] = rand() / (double)RAND_MAX;
+        }
+
+        double start = now_ns();
+        tms_lu *F = tms_matrix_lu(M);
+        double lu_time = now_ns() - start;
+
+        start = now_ns();
+        double det = tms_matrix_det(M);
+        double det_time = now_ns() - start;
+
+        start = now_ns();
+        tms_matrix *inverse = tms_matrix_inv(M);
+        double inv_time = now_ns() - start;
+
+        start = now_ns();
+        int status = tms_lu_solve(F, b, x);
+        double solve_time = now_ns() - start;
+
+        start = now_ns();
+        tms_matrix *X = tms_matrix_solve(M, B);
+        double system_time = now_ns() - start;
+
+        if (F == NULL || inverse == NULL || status != 0 || isnan(det) || X == NULL)
+        {
+            tms_print_errors(TMS_MATRIX);
+            exit(1);
+        }
+        printf("%6d %12.4f %12.4f %12.4f %12.4f %12.4f\n", n, lu_time / 1e6, det_time / 1e6, inv_time / 1e6,
+               solve_time / 1e6, system_time / 1e6);
+        tms_delete_lu(F);
+        tms_delete_matrix(X);
+        tms_delete_matrix(B);
+        tms_delete_matrix(inverse);
+        tms_delete_matrix(M);
+        free(b);
+        free(x);
+    }
+}
+
+// Measures the GFLOP/s of tms_matrix_multiply() with one thread and all threads, then tms_cmatrix_multiply()
+// (a complex multiply-add is 8 flops), for n*n matrices
+void bench_gemm(int max_n)
+{
+    printf("Matrix multiply (GFLOP/s, %d threads available):\n", tms_get_matrix_threads());
+    printf("%6s %12s %12s %12s\n", "n", "1 thread", "all threads", "complex");
+    srand(1);
+    for (int n = 64; n <= max_n; n *= 2)
+    {
+        tms_matrix *A = tms_new_matrix(n, n), *B = tms_new_matrix(n, n), *C;
+        tms_cmatrix *ZA = tms_new_cmatrix(n, n), *ZB = tms_new_cmatrix(n, n), *ZC;
+        double gflops[3];
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+            {
+                TMS_MATRIX_ROW(A, i)[j] = rand() / (double)RAND_MAX;
+                TMS_MATRIX_ROW(B, i)[j] = rand() / (double)RAND_MAX;
+                TMS_CMATRIX_ROW(ZA, i)[j] = TMS_MATRIX_ROW(A, i)[j] + I * TMS_MATRIX_ROW(B, i)[j];
+                TMS_CMATRIX_ROW(ZB, i)[j] = TMS_MATRIX_ROW(B, i)[j] - I * TMS_MATRIX_ROW(A, i)[j];
+            }
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            tms_set_matrix_threads(pass == 0 ? 1 : 0);
+            double start = now_ns();
+            C = tms_matrix_multiply(A, B);
+            gflops[pass] = 2.0 * n * n * n / (now_ns() - start);
+            tms_delete_matrix(C);
+        }
+        double start = now_ns();
+        ZC = tms_cmatrix_multiply(ZA, ZB);
+        gflops[2] = 8.0 * n * n * n / (now_ns() - start);
+        tms_delete_cmatrix(ZC);
+
+        printf("%6d %12.2f %12.2f %12.2f\n", n, gflops[0], gflops[1], gflops[2]);
+        tms_delete_matrix(A);
+        tms_delete_matrix(B);
+        tms_delete_cmatrix(ZA);
+        tms_delete_cmatrix(ZB);
+    }
+    tms_set_matrix_threads(0);
+}
+
+// 2D Poisson problem (5 point stencil) on a grid*grid mesh: builds the sparse matrix, then times products and CG
+void bench_sparse(int grid)
+{
+    int n = grid * grid, count = 0, i, j, k;
+    int *row = malloc(5 * n * sizeof(int)), *col = malloc(5 * n * sizeof(int));
+    double *values = malloc(5 * n * sizeof(double)), *x = calloc(n, sizeof(double)), *b = malloc(n * sizeof(double));
+
+    printf("Sparse (2D Poisson, %d unknowns):\n", n);
+    for (i = 0; i < grid; ++i)
+        for (j = 0; j < grid; ++j)
+        {
+            k = i * grid + j;
+            row[count] = k, col[count] = k, values[count++] = 4;
+            if (i > 0)
+                row[count] = k, col[count] = k - grid, values[count++] = -1;
+            if (i + 1 < grid)
+                row[count] = k, col[count] = k + grid, values[count++] = -1;
+            if (j > 0)
+                row[count] = k, col[count] = k - 1, values[count++] = -1;
+            if (j + 1 < grid)
+                row[count] = k, col[count] = k + 1, values[count++] = -1;
+            b[k] = 1;
+        }
+
+    double start = now_ns();
+    tms_sparse_matrix *A = tms_sparse_from_triplets(n, n, count, row, col, values);
+    printf("%-18s %10.3f ms (%d nonzeros, %.1f MB)\n", "build", (now_ns() - start) / 1e6, A->nnz,
+           (A->nnz * (sizeof(int) + sizeof(double)) + (n + 1) * sizeof(int)) / 1e6);
+
+    start = now_ns();
+    for (i = 0; i < 100; ++i)
+        tms_sparse_multiply_vector(A, b, x);
+    printf("%-18s %10.3f ms\n", "multiply vector", (now_ns() - start) / 1e8);
+
+    memset(x, 0, n * sizeof(double));
+    start = now_ns();
+    int iterations = tms_sparse_solve(A, b, x, TMS_SPARSE_AUTO, 1e-8, 0);
+    printf("%-18s %10.3f ms (%d iterations)\n", "solve (CG)", (now_ns() - start) / 1e6, iterations);
+
+    memset(x, 0, n * sizeof(double));
+    start = now_ns();
+    iterations = tms_sparse_solve(A, b, x, TMS_SPARSE_BICGSTAB, 1e-8, 0);
+    printf("%-18s %10.3f ms (%d iterations)\n", "solve (BiCGSTAB)", (now_ns() - start) / 1e6, iterations);
+
+    tms_delete_sparse_matrix(A);
+    free(row);
+    free(col);
+    free(values);
+    free(x);
+    free(b);
+}
+
+typedef struct bench_symbol
+{
+    char *name;
+    double value;
+} bench_symbol;
+
+static int bench_symbol_compare(const void *a, const void *b, void *udata)
+{
+    const bench_symbol *sa = a, *sb = b;
+    return strcmp(sa->name, sb->name);
+}
+
+static uint64_t bench_symbol_hash(const void *item, uint64_t seed0, uint64_t seed1)
+{
+    const bench_symbol *s = item;
+    return hashmap_xxhash3(s->name, strlen(s->name), seed0, seed1);
+}
+
+// Compares the symbol table to the generic hashmap with the callbacks previously used for variables and functions
+void bench_symtab(int max_count)
+{
+    const int lookups = 1 << 22;
+    int count, i, found;
+    double start, t_set, t_hit, t_miss, t_delete;
+
+    puts("Symbol tables (ns/op):");
+    printf("%8s %10s %12s %12s %12s %12s\n", "symbols", "table", "set", "get (hit)", "get (miss)", "delete");
+    for (count = 32; count <= max_count; count *= 8)
+    {
+        // Identifier-like names, some longer than the inline key
+        bench_symbol *symbols = malloc(count * sizeof(bench_symbol));
+        char **misses = malloc(count * sizeof(char *)), buffer[64];
+        for (i = 0; i < count; ++i)
+        {
+            snprintf(buffer, sizeof(buffer), i % 4 == 3 ? "a_long_variable_name_%d" : "x%d", i);
+            symbols[i].name = strdup(buffer);
+            symbols[i].value = i;
+            snprintf(buffer, sizeof(buffer), i % 4 == 3 ? "a_long_variable_name_%d_" : "y%d", i);
+            misses[i] = strdup(buffer);
+        }
+
+        hashmap *map = hashmap_new(sizeof(bench_symbol), 0, 1, 2, bench_symbol_hash, bench_symbol_compare, NULL, NULL);
+        start = now_ns();
+        for (i = 0; i < count; ++i)
+            hashmap_set(map, symbols + i);
+        t_set = (now_ns() - start) / count;
+        found = 0;
+        start = now_ns();
+        for (i = 0; i < lookups; ++i)
+            found += hashmap_get(map, symbols + (i & (count - 1))) != NULL;
+        t_hit = (now_ns() - start) / lookups;
+        start = now_ns();
+        for (i = 0; i < lookups; ++i)
+        {
+            bench_symbol key = {.name = misses[i & (count - 1)]};
+            found += hashmap_get(map, &key) != NULL;
+        }
+        t_miss = (now_ns() - start) / lookups;
+        start = now_ns();
+        for (i = 0; i < count; ++i)
+            hashmap_delete(map, symbols + i);
+        t_delete = (now_ns() - start) / count;
+        hashmap_free(map);
+        printf("%8d %10s %12.2f %12.2f %12.2f %12.2f\n", count, "hashmap", t_set, t_hit, t_miss, t_delete);
+
+        tms_symtab *T = tms_symtab_new(sizeof(bench_symbol), 0, 1, NULL);
+        start = now_ns();
+        for (i = 0; i < count; ++i)
+            tms_symtab_set(T, symbols + i);
+        t_set = (now_ns() - start) / count;
+        start = now_ns();
+        for (i = 0; i < lookups; ++i)
+            found += tms_symtab_get(T, symbols[i & (count - 1)].name) != NULL;
+        t_hit = (now_ns() - start) / lookups;
+        start = now_ns();
+        for (i = 0; i < lookups; ++i)
+            found += tms_symtab_get(T, misses[i & (count - 1)]) != NULL;
+        t_miss = (now_ns() - start) / lookups;
+        start = now_ns();
+        for (i = 0; i < count; ++i)
+            tms_symtab_delete(T, symbols[i].name);
+        t_delete = (now_ns() - start) / count;
+        tms_symtab_free(T);
+        printf("%8d %10s %12.2f %12.2f %12.2f %12.2f\n", count, "symtab", t_set, t_hit, t_miss, t_delete);
+
+        if (found != 2 * lookups)
+            puts("Symbol table lookup mismatch!");
+        for (i = 0; i < count; ++i)
+        {
+            free(symbols[i].name);
+            free(misses[i]);
+        }
+        free(symbols);
+        free(misses);
+    }
+}
+
+// Lookup of built-in function names: perfect hash against a symbol table holding the same functions
+void bench_builtins()
+{
+    const int lookups = 1 << 22;
+    const char *misses[] = {"x", "y1", "fx", "speed", "cos2", "a_long_variable_name", "t", "theta"};
+    // Names looked up, a power of 2 to avoid a division in the loop
+    const char *hits[64];
+    size_t count, i;
+    int found = 0;
+    double start, t_hit, t_miss;
+    tms_rc_func *F = tms_get_all_rc_func(&count, false);
+    tms_symtab *T = tms_symtab_new(sizeof(tms_rc_func), 0, 1, NULL);
+    for (i = 0; i < count; ++i)
+        tms_symtab_set(T, F + i);
+    for (i = 0; i < array_length(hits); ++i)
+        hits[i] = F[i % count].name;
+
+    puts("Built-in functions lookup (ns/op):");
+    printf("%14s %12s %12s\n", "table", "get (hit)", "get (miss)");
+    start = now_ns();
+    for (i = 0; i < lookups; ++i)
+        found += tms_symtab_get(T, hits[i & (array_length(hits) - 1)]) != NULL;
+    t_hit = (now_ns() - start) / lookups;
+    start = now_ns();
+    for (i = 0; i < lookups; ++i)
+        found += tms_symtab_get(T, misses[i & (array_length(misses) - 1)]) != NULL;
+    t_miss = (now_ns() - start) / lookups;
+    printf("%14s %12.2f %12.2f\n", "symtab", t_hit, t_miss);
+
+    start = now_ns();
+    for (i = 0; i < lookups; ++i)
+        found += tms_get_rc_func_by_name(hits[i & (array_length(hits) - 1)]) != NULL;
+    t_hit = (now_ns() - start) / lookups;
+    start = now_ns();
+    for (i = 0; i < lookups; ++i)
+        found += tms_get_rc_func_by_name(misses[i & (array_length(misses) - 1)]) != NULL;
+    t_miss = (now_ns() - start) / lookups;
+    printf("%14s %12.2f %12.2f\n", "perfect hash", t_hit, t_miss);
+
+    if (found != 2 * lookups)
+        puts("Built-in lookup mismatch!");
+    tms_symtab_free(T);
+    free(F);
+}
+
+/*
+Benchmark suite: repeats each operation for at least SUITE_MIN_NS and reports ns/op and allocations/op.
+Uses the expressions of the accuracy test file and generated large expressions, the results are written as JSON.
+*/
+
+#define SUITE_MIN_NS 2e8
+#define SUITE_MAX_EXPRS 1000
+#define SUITE_OPTIONS (ENABLE_CMPLX | EXPAND_UOPS)
+
+typedef struct suite_data
+{
+    char *exprs[SUITE_MAX_EXPRS], *int_exprs[SUITE_MAX_EXPRS];
+    int count, int_count;
+    tms_math_expr *parsed[SUITE_MAX_EXPRS];
+    tms_int_expr *int_parsed[SUITE_MAX_EXPRS];
+    // Single expression used by the generated expressions and user functions benchmarks
+    char *expr;
+    tms_math_expr *M;
+    // Keeps the results alive so the calls aren't optimized away
+    double complex sink;
+    int64_t int_sink;
+} suite_data;
+
+// Human readable results, stderr when the JSON is written to stdout
+static FILE *suite_log;
+
+typedef struct suite_result
+{
+    const char *name;
+    size_t ops;
+    double ns_per_op;
+    double allocs_per_op;
+} suite_result;
+
+// Runs one batch of operations, returns the number of operations done
+typedef size_t (*suite_batch)(suite_data *D);
+
+static size_t batch_parse(suite_data *D)
+{
+    for (int i = 0; i < D->count; ++i)
+        tms_delete_math_expr(tms_parse_expr(D->exprs[i], SUITE_OPTIONS, NULL));
+    return D->count;
+}
+
+static size_t batch_evaluate(suite_data *D)
+{
+    for (int i = 0; i < D->count; ++i)
+        D->sink += tms_evaluate(D->parsed[i], 0);
+    return D->count;
+}
+
+static size_t batch_solve(suite_data *D)
+{
+    for (int i = 0; i < D->count; ++i)
+        D->sink += tms_solve(D->exprs[i]);
+    return D->count;
+}
+
+static size_t batch_solve_e(suite_data *D)
+{
+    for (int i = 0; i < D->count; ++i)
+        D->sink += tms_solve_e(D->exprs[i], SUITE_OPTIONS, NULL);
+    return D->count;
+}
+
+static size_t batch_int_parse(suite_data *D)
+{
+    for (int i = 0; i < D->int_count; ++i)
+        tms_delete_int_expr(tms_parse_int_expr(D->int_exprs[i], EXPAND_UOPS, NULL));
+    return D->int_count;
+}
+
+static size_t batch_int_evaluate(suite_data *D)
+{
+    int64_t result;
+    for (int i = 0; i < D->int_count; ++i)
+    {
+        tms_int_evaluate(D->int_parsed[i], &result, 0);
+        D->int_sink += result;
+    }
+    return D->int_count;
+}
+
+static size_t batch_int_solve_e(suite_data *D)
+{
+    int64_t result;
+    for (int i = 0; i < D->int_count; ++i)
+    {
+        tms_int_solve_e(D->int_exprs[i], &result, EXPAND_UOPS, NULL);
+        D->int_sink += result;
+    }
+    return D->int_count;
+}
+
+static size_t batch_parse_single(suite_data *D)
+{
+    tms_delete_math_expr(tms_parse_expr(D->expr, SUITE_OPTIONS, NULL));
+    return 1;
+}
+
+static size_t batch_evaluate_single(suite_data *D)
+{
+    D->sink += tms_evaluate(D->M, 0);
+    return 1;
+}
+
+static size_t batch_solve_single(suite_data *D)
+{
+    D->sink += tms_solve(D->expr);
+    return 1;
+}
+
+// Repeats the batch until SUITE_MIN_NS is reached, after a warm up batch
+static suite_result suite_run(const char *name, suite_batch batch, suite_data *D)
+{
+    suite_result R = {.name = name};
+    size_t allocs;
+    double start, elapsed = 0;
+
+    batch(D);
+    tms_clear_errors(TMS_ALL_FACILITIES);
+    allocs = allocs_count();
+    start = now_ns();
+    while (elapsed < SUITE_MIN_NS)
+    {
+        R.ops += batch(D);
+        elapsed = now_ns() - start;
+    }
+    R.ns_per_op = elapsed / R.ops;
+    R.allocs_per_op = (double)(allocs_count() - allocs) / R.ops;
+    if (tms_get_error_count(TMS_ALL_FACILITIES, EH_ALL_ERRORS) != 0)
+        fprintf(stderr, "Warning: errors in benchmark %s\n", name);
+    tms_clear_errors(TMS_ALL_FACILITIES);
+    fprintf(suite_log, "%-28s %12.1f ns/op %10.2f allocs/op\n", name, R.ns_per_op, R.allocs_per_op);
+    return R;
+}
+
+// Loads the scientific (S) and integer (I) expressions of the accuracy test file
+static int suite_load(suite_data *D, const char *path)
+{
+    char buffer[1000], *separator;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    while (fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        tms_remove_whitespace(buffer);
+        separator = strchr(buffer, ';');
+        if (separator == NULL || buffer[1] != ':')
+            continue;
+        *separator = '\0';
+        if (buffer[0] == 'S' && D->count < SUITE_MAX_EXPRS)
+            D->exprs[D->count++] = strdup(buffer + 2);
+        else if (buffer[0] == 'I' && D->int_count < SUITE_MAX_EXPRS)
+            D->int_exprs[D->int_count++] = strdup(buffer + 2);
+    }
+    fclose(file);
+
+    // User functions used by the test file, defined as in tms_test
+    tms_set_ufunction("f", "x,y,z", "(x^y)%z");
+    tms_set_ufunction("g", "p", "f(p,2*p,10)+max(10,p)");
+    tms_set_int_ufunction("f", "x,y,z", "(x^y)&z");
+    tms_set_int_ufunction("g", "n", "f(n,2*n,1+3*n)+18/7");
+
+    for (int i = 0; i < D->count; ++i)
+        if ((D->parsed[i] = tms_parse_expr(D->exprs[i], SUITE_OPTIONS, NULL)) == NULL)
+        {
+            fprintf(stderr, "Failed to parse %s\n", D->exprs[i]);
+            return -1;
+        }
+    for (int i = 0; i < D->int_count; ++i)
+        if ((D->int_parsed[i] = tms_parse_int_expr(D->int_exprs[i], EXPAND_UOPS, NULL)) == NULL)
+        {
+            fprintf(stderr, "Failed to parse %s\n", D->int_exprs[i]);
+            return -1;
+        }
+    return 0;
+}
+
+static void suite_write_json(FILE *out, suite_result *results, int count)
+{
+    fprintf(out, "{\n  \"library\": \"libtmsolve\",\n  \"version\": \"%s\",\n", tms_lib_version);
+    fprintf(out, "  \"allocations_counted\": %s,\n  \"results\": [\n", BENCH_COUNTS_ALLOCS ? "true" : "false");
+    for (int i = 0; i < count; ++i)
+        fprintf(out, "    {\"name\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f}%s\n",
+                results[i].name, results[i].ops, results[i].ns_per_op, results[i].allocs_per_op,
+                i + 1 < count ? "," : "");
+    fputs("  ]\n}\n", out);
+}
+
+// Runs the benchmark suite, writes the JSON results to json_path (stdout if NULL)
+int bench_suite(const char *test_path, const char *json_path)
+{
+    suite_data *D = calloc(1, sizeof(suite_data));
+    suite_result results[32];
+    int n = 0, i;
+    struct
+    {
+        const char *name;
+        char *(*generator)(size_t);
+        size_t size;
+    } generated[] = {{"flat_64k", gen_flat_expr, 1 << 16},
+                     // Larger nested expressions overflow
+                     {"nested_4k", gen_nested_expr, 1 << 12},
+                     {"wide_subexprs_4k", gen_wide_subexprs, 1 << 12},
+                     {"nested_subexprs_4k", gen_nested_subexprs, 1 << 12}};
+    static char names[8][64];
+
+    suite_log = json_path == NULL ? stderr : stdout;
+    if (suite_load(D, test_path) != 0)
+        return 1;
+    fprintf(suite_log, "Benchmark suite (%d scientific and %d integer expressions):\n", D->count, D->int_count);
+
+    results[n++] = suite_run("parse", batch_parse, D);
+    results[n++] = suite_run("evaluate", batch_evaluate, D);
+    results[n++] = suite_run("solve", batch_solve, D);
+    results[n++] = suite_run("solve_e", batch_solve_e, D);
+    results[n++] = suite_run("int_parse", batch_int_parse, D);
+    results[n++] = suite_run("int_evaluate", batch_int_evaluate, D);
+    results[n++] = suite_run("int_solve_e", batch_int_solve_e, D);
+
+    // User functions calls, g() calls f()
+    D->expr = "g(1.5)+f(1.2,2,3)";
+    D->M = tms_parse_expr(D->expr, SUITE_OPTIONS, NULL);
+    results[n++] = suite_run("ufunc_parse", batch_parse_single, D);
+    results[n++] = suite_run("ufunc_evaluate", batch_evaluate_single, D);
+    tms_delete_math_expr(D->M);
+
+    D->expr = "integrate(0,3,x*sin(x)^2)";
+    results[n++] = suite_run("integrate", batch_solve_single, D);
+    D->expr = "derivative(x^3*sin(x)+exp(x/2),1.5)";
+    results[n++] = suite_run("derivative", batch_solve_single, D);
+
+    for (i = 0; i < array_length(generated); ++i)
+    {
+        D->expr = generated[i].generator(generated[i].size);
+        D->M = tms_parse_expr(D->expr, SUITE_OPTIONS, NULL);
+        snprintf(names[2 * i], sizeof(names[0]), "parse_%s", generated[i].name);
+        snprintf(names[2 * i + 1], sizeof(names[0]), "evaluate_%s", generated[i].name);
+        results[n++] = suite_run(names[2 * i], batch_parse_single, D);
+        results[n++] = suite_run(names[2 * i + 1], batch_evaluate_single, D);
+        tms_delete_math_expr(D->M);
+        free(D->expr);
+    }
+
+    if (json_path == NULL)
+        suite_write_json(stdout, results, n);
+    else
+    {
+        FILE *out = fopen(json_path, "w");
+        if (out == NULL)
+        {
+            perror(json_path);
+            return 1;
+        }
+        suite_write_json(out, results, n);
+        fclose(out);
+    }
+
+    tmsolve_reset();
+    for (i = 0; i < D->count; ++i)
+    {
+        tms_delete_math_expr(D->parsed[i]);
+        free(D->exprs[i]);
+    }
+    for (i = 0; i < D->int_count; ++i)
+    {
+        tms_delete_int_expr(D->int_parsed[i]);
+        free(D->int_exprs[i]);
+    }
+    free(D);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_size = 1 << 20, max_subexprs = 1 << 20;
+    int catalog_count = 100000, max_matrix = 512, max_gemm = 2048, sparse_grid = 224, max_symbols = 16384;
+
+    // Benchmark suite with JSON output: tms_bench suite <accuracy_test.txt> [results.json]
+    if (argc > 1 && strcmp(argv[1], "suite") == 0)
+    {
+        if (argc < 3)
+        {
+            fputs("Usage: tms_bench suite <accuracy test file> [JSON output file]\n", stderr);
+            return 1;
+        }
+        return bench_suite(argv[2], argc > 3 ? argv[3] : NULL);
+    }
+
+    if (argc > 1)
+        max_size = strtoul(argv[1], NULL, 10);
+    if (argc > 2)
+        max_subexprs = strtoul(argv[2], NULL, 10);
+    if (argc > 3)
+        catalog_count = atoi(argv[3]);
+    if (argc > 4)
+        max_matrix = atoi(argv[4]);
+    if (argc > 5)
+        max_gemm = atoi(argv[5]);
+    if (argc > 6)
+        sparse_grid = atoi(argv[6]);
+    if (argc > 7)
+        max_symbols = atoi(argv[7]);
+
+    bench_parse("Parse (flat):", "bytes", gen_flat_expr, 1024, max_size);
+    bench_parse("Parse (nested):", "bytes", gen_nested_expr, 1024, max_size);
+    bench_parse("Parse (side by side subexpressions):", "subexprs", gen_wide_subexprs, 1024, max_subexprs);
+    bench_parse("Parse (nested subexpressions):", "subexprs", gen_nested_subexprs, 1024, max_subexprs);
+    bench_catalog(catalog_count);
+    bench_eval("x*x+3*x-2/(x+1)*x+(x-1)*(x+2)*(x-3)*(x+4)-x/7+x*x*x*0.5-(x+1)*(x-2)+x*1.5", 0, 1000000);
+    bench_eval("sin(x)^2+cos(x/3)*(x-1)/(x+2)-sqrt(x)", ENABLE_CMPLX, 1000000);
+    bench_matrix(max_matrix);
+    bench_gemm(max_gemm);
+    bench_sparse(sparse_grid);
+    bench_symtab(max_symbols);
+    bench_builtins();
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+
+// Compares the answers of compile time expressions (static_expression.h) with the runtime parser and evaluator
+
+#include "static_expression.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+extern "C"
+{
+#include "error_handler.h"
+#include "evaluator.h"
+#include "internals.h"
+#include "parser.h"
+#include "scientific.h"
+#include "string_tools.h"
+}
+
+using tmsolve::StaticExpression;
+using tmsolve::static_detail::fixed_string;
+
+int failures = 0;
+
+// Labels list with its values, owned by the expression parsed with it
+tms_arg_list *make_labels(const std::string &names, const cdouble *values, size_t size)
+{
+    if (names.empty())
+        return NULL;
+    tms_arg_list *L = tms_get_args(names.c_str());
+    L->payload = malloc(size);
+    L->payload_size = size;
+    memcpy(L->payload, values, size);
+    return L;
+}
+
+std::complex<double> runtime_solve(const char *expr, int options, tms_arg_list *labels)
+{
+    tms_math_expr *M = tms_parse_expr(expr, options, labels);
+    if (M == NULL)
+        return NAN;
+    cdouble result = tms_evaluate(M, options);
+    tms_delete_math_expr(M);
+    return std::complex<double>(result.r, result.c);
+}
+
+// Real evaluation first, then complex if it fails, like StaticExpression::evaluate()
+std::complex<double> runtime_answer(const char *expr, const std::string &names, const cdouble *values, size_t size)
+{
+    std::complex<double> result = runtime_solve(expr, EXPAND_UOPS, make_labels(names, values, size));
+    if (std::isnan(result.real()))
+    {
+        tms_clear_errors(TMS_PARSER | TMS_EVALUATOR);
+        result = runtime_solve(expr, ENABLE_CMPLX | EXPAND_UOPS, make_labels(names, values, size));
+        tms_clear_errors(TMS_PARSER | TMS_EVALUATOR);
+    }
+    return result;
+}
+
+// The compiler can fold the math functions of constant arguments (correctly rounded), allow a few ulp of difference
+bool same(std::complex<double> a, std::complex<double> b)
+{
+    if (std::isnan(a.real()) || std::isnan(b.real()))
+        return std::isnan(a.real()) && std::isnan(b.real());
+    return std::abs(a - b) <= 1e-14 * std::max(std::abs(a), std::abs(b));
+}
+
+template <fixed_string Expr, fixed_string... Labels, typename... V> void check(V... values)
+{
+    std::complex<double> expected, actual = StaticExpression<Expr, Labels...>::evaluate(values...);
+
+    std::string names;
+    for (std::string_view name : {std::string_view(), Labels.view()...})
+        if (!name.empty())
+            names += (names.empty() ? "" : ",") + std::string(name);
+    const cdouble values_c[] = {cdouble{}, tmsolve::static_detail::to_c(std::complex<double>(values))...};
+    expected = runtime_answer(Expr.str, names, values_c + 1, sizeof(values_c) - sizeof(cdouble));
+
+    printf("%s = %.17g%+.17gi\n", Expr.str, actual.real(), actual.imag());
+    if (!same(actual, expected))
+    {
+        printf("Mismatch, the runtime answer is %.17g%+.17gi\n", expected.real(), expected.imag());
+        ++failures;
+    }
+}
+
+void check_builtins()
+{
+    using namespace tmsolve::static_detail;
+    for (std::string_view name : rc_funcs)
+        if (tms_get_rc_func_by_name(std::string(name).c_str()) == NULL)
+        {
+            printf("%s is not a runtime function\n", name.data());
+            ++failures;
+        }
+    for (std::string_view name : extfs)
+        if (tms_get_extf_by_name(std::string(name).c_str()) == NULL)
+        {
+            printf("%s is not a runtime extended function\n", name.data());
+            ++failures;
+        }
+    for (const auto &var : builtin_vars)
+    {
+        const tms_var *v = tms_get_var_by_name(std::string(var.name).c_str());
+        if (v == NULL || v->value.r != var.real || v->value.c != var.imag)
+        {
+            printf("%s doesn't match the runtime constant\n", var.name.data());
+            ++failures;
+        }
+    }
+}
+
+int main()
+{
+    check_builtins();
+
+    // Expressions of accuracy_test.txt that don't need the runtime (no integrate, derivative, hex... or user functions)
+    check<"5+8+9*8/7.545+57.87^0.56+(5+562/95+7*7^3+(59^2.211)/7)+5*4">();
+    check<"5+8+9*8/7.545+57.87^0.56+(5+562/95+7*7^3+(59^2.211)/(7*(pi/3-2))+5*4)">();
+    check<"avg(1,3,-6,-234,674)+min(9,-4)+max(10,-5)+arg(3)">();
+    check<"arg(1+i)">();
+    check<"sin(0.7)^2+cos(0.7)^2">();
+    check<"5*sign(-5)+4+sign(345)">();
+    check<"4*fact(5)">();
+    check<"round(234.1)+round(99.5)">();
+    check<"abs(-12.3234)+abs(0)+abs(10)">();
+    check<"(-2)^0.5">();
+    check<"(((cos(pi/3))))+0.546545+i">();
+    check<"tan(pi/8)">();
+    check<"tan(pi/8)-2i">();
+    check<"cos(0.8282+4i)+sin(pi/3)/tan(pi/6+i)">();
+    check<"5e-3+exp(i*pi/3)">();
+    check<"e+1e3">();
+    check<"(1e5*pi)/pi">();
+    check<"sqrt(1/(8.8541878128e-12*(4e-7*pi)))">();
+    check<"-5^2">();
+    check<"cbrt(sqrt(-1))">();
+    check<"ceil(5.1232)+floor(-5.71816-7.826727i)">();
+    check<"ln(exp(2))+log10(10^3+20i)">();
+    check<"log2(10+3i)">();
+    check<"log2(9823497)">();
+    check<"0xff+0o726">();
+    check<"cos(-0b11.0011)+0xffi">();
+    check<"0xa5/0b100">();
+    check<"int(6.872-17.828498i)">();
+    check<"8.1^(logn(193,8.1))">();
+    check<"2^(logn(-6.6727,2))">();
+    check<"cos(acos(-0.7))">();
+    check<"sin(asin(0.21342345))">();
+    check<"tan(atan(23))">();
+    check<"cosh(acosh(-0.7))">();
+    check<"sinh(asinh(0.21342345))">();
+    check<"tanh(atanh(23))">();
+    check<"fact(5)-5!">();
+    check<"2+-2">();
+    check<"21//6">();
+    check<"(21-13i)//6">();
+    check<"-7//2+(-7)//2">();
+    check<"16**0.5+2**-1">();
+    check<"2!!!!+avg(1,3)!">();
+
+    // Priorities, signs and number formats
+    check<"2^3^2 + 2*-3^2 - -2^2">();
+    check<" 8 / 2 / 2 + 5 % 3 * 2 - 7.5 % 2 ">();
+    check<"3!^2+2^3!+2!^-1">();
+    check<".5+5.+1.5e-3+1e+2+2.5e30+1e-30+1e2.5">();
+    check<"2i^2+1.2e3i-pi*i">();
+    check<"sqrt(-4)+ln(-1)+(-3)^(1/3)">();
+    check<"avg(1,i)+avg(i,-i)">();
+    check<"1/0">();
+    check<"5%0">();
+    check<"fact(-1)+1">();
+    check<"min(1,i)">();
+
+    // Labels, "c" is the built-in constant
+    check<"x^2+sin(y)*-x", "x", "y">(2.0, 0.5);
+    check<"-x!+avg(x,y)//2", "x", "y">(4.0, 7.0);
+    check<"sqrt(x)+c", "x", "c">(-9.0, 1.0);
+    check<"x*y-logn(x,2)", "x", "y">(std::complex<double>(1, 2), 3.0);
+
+    if (failures != 0)
+    {
+        printf("%d static expressions don't match the runtime.\n", failures);
+        return 1;
+    }
+    puts("Passed");
+    return 0;
+}
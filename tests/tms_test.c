@@ -3,16 +3,34 @@ Copyright (C) 2023-2026 Ahmad Ismail
 SPDX-License-Identifier: LGPL-2.1-only
 */
 
+#include "async.h"
 #include "error_handler.h"
+#include "evaluator.h"
+#include "int_parser.h"
 #include "internals.h"
+#include "jit.h"
+#include "m_errors.h"
+#include "matrix.h"
+#include "matrix_expr.h"
+#include "parser.h"
+#include "profile.h"
 #include "scientific.h"
+#include "serializer.h"
+#include "sparse.h"
+#include "stats.h"
 #include "string_tools.h"
+#include "symtab.h"
+#include "thread_pool.h"
 #include "tms_math_strs.h"
+#include <inttypes.h>
 #include <math.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 void test_scientific(char *buffer)
 {
@@ -118,13 +136,1500 @@ void test_integer(char *buffer)
     }
 }
 
+// Parsed expressions saved to a catalog and loaded back should give identical answers
+// Saves user functions to a catalog and uses them after a reset
+void test_ufunc_catalog()
+{
+    double complex expected, loaded;
+    int64_t int_expected, int_loaded;
+
+    puts("User functions catalog:");
+    if (tms_set_ufunction("f", "x", "x^2+1") != 0 || tms_set_ufunction("g", "x,y", "f(x)*y") != 0 ||
+        tms_set_int_ufunction("h", "a,b", "a*b+1") != 0)
+    {
+        tms_print_errors(TMS_ALL_FACILITIES);
+        exit(1);
+    }
+    expected = tms_solve("g(3,2)+f(1)");
+    tms_int_solve("h(5,3)", &int_expected);
+
+    if (tms_save_ufunctions("tms_test_ufuncs.bin") != 0 || tms_save_int_ufunctions("tms_test_int_ufuncs.bin") != 0)
+    {
+        tms_print_errors(TMS_ALL_FACILITIES);
+        exit(1);
+    }
+    tmsolve_reset();
+
+    if (tms_load_ufunc_catalog("tms_test_ufuncs.bin") != 0 || tms_load_int_ufunc_catalog("tms_test_int_ufuncs.bin") != 0)
+    {
+        tms_print_errors(TMS_ALL_FACILITIES);
+        exit(1);
+    }
+    loaded = tms_solve("g(3,2)+f(1)");
+    if (expected != loaded || tms_int_solve("h(5,3)", &int_loaded) != 0 || int_expected != int_loaded)
+    {
+        puts("Functions from the catalog produced a different answer.");
+        tms_print_errors(TMS_ALL_FACILITIES);
+        exit(1);
+    }
+
+    // A runtime function shadows the catalog function with the same name
+    tms_set_ufunction("f", "x", "x");
+    if (tms_solve("g(3,2)") != 6)
+    {
+        puts("Runtime function didn't shadow the catalog function.");
+        exit(1);
+    }
+
+    tmsolve_reset();
+    remove("tms_test_ufuncs.bin");
+    remove("tms_test_int_ufuncs.bin");
+    puts("Passed\n--------------------\n");
+}
+
+// Evaluates an expression with the evaluator then with the JIT, the answers should be identical
+int compare_jit(const char *expr, int options)
+{
+    double complex expected, compiled;
+    int expected_errors, compiled_errors, compiled_count;
+
+    tms_math_expr *M = tms_parse_expr(expr, options, NULL);
+    if (M == NULL)
+    {
+        tms_clear_errors(TMS_PARSER);
+        return 0;
+    }
+
+    tms_set_jit_threshold(0);
+    expected = tms_evaluate(M, 0);
+    expected_errors = tms_get_error_count(TMS_EVALUATOR, EH_ALL_ERRORS);
+    tms_clear_errors(TMS_EVALUATOR);
+
+    compiled_count = (tms_jit_compile(M) == 0);
+    tms_set_jit_threshold(1);
+    compiled = tms_evaluate(M, 0);
+    compiled_errors = tms_get_error_count(TMS_EVALUATOR, EH_ALL_ERRORS);
+    tms_clear_errors(TMS_EVALUATOR);
+    tms_set_jit_threshold(0);
+    tms_delete_math_expr(M);
+
+    // Errors are reported by the evaluator after the compiled code fails, so the count should match too
+    if (memcmp(&expected, &compiled, sizeof(expected)) != 0 || expected_errors != compiled_errors)
+    {
+        printf("JIT answer doesn't match the evaluator for %s\n", expr);
+        exit(1);
+    }
+    return compiled_count;
+}
+
+void test_jit(FILE *test_file)
+{
+    char buffer[1000];
+    int total = 0, compiled = 0;
+
+    while (fgets(buffer, 1000, test_file) != NULL)
+    {
+        tms_remove_whitespace(buffer);
+        int field_separator = tms_f_search(buffer, ";", 0, false);
+        if (field_separator == -1 || buffer[0] != 'S')
+            continue;
+        buffer[field_separator] = '\0';
+
+        puts(buffer + 2);
+        compiled += compare_jit(buffer + 2, EXPAND_UOPS);
+        compiled += compare_jit(buffer + 2, ENABLE_CMPLX | EXPAND_UOPS);
+        total += 2;
+        puts("Passed\n--------------------\n");
+    }
+    printf("Compiled %d of %d expressions.\n", compiled, total);
+    if (compiled == 0)
+    {
+        puts("The JIT compiled no expression, is a C compiler available?");
+        exit(1);
+    }
+}
+
+void test_catalog(FILE *test_file)
+{
+    char buffer[1000];
+    int count = 0, int_count = 0, i;
+    tms_math_expr *list[1000];
+    tms_int_expr *int_list[1000];
+
+    while (fgets(buffer, 1000, test_file) != NULL && count < 1000 && int_count < 1000)
+    {
+        tms_remove_whitespace(buffer);
+        int field_separator = tms_f_search(buffer, ";", 0, false);
+        if (field_separator == -1)
+            continue;
+        buffer[field_separator] = '\0';
+
+        if (buffer[0] == 'S')
+            list[count++] = tms_parse_expr(buffer + 2, ENABLE_CMPLX | EXPAND_UOPS, NULL);
+        else if (buffer[0] == 'I')
+            int_list[int_count++] = tms_parse_int_expr(buffer + 2, EXPAND_UOPS, NULL);
+        else
+            continue;
+
+        if ((buffer[0] == 'S' && list[count - 1] == NULL) || (buffer[0] == 'I' && int_list[int_count - 1] == NULL))
+        {
+            printf("Failed to parse %s\n", buffer + 2);
+            tms_print_errors(TMS_ALL_FACILITIES);
+            exit(1);
+        }
+    }
+
+    // Save before evaluating, evaluation changes the state of extended functions
+    if (tms_save_math_exprs("tms_test_catalog.bin", list, count) != 0 ||
+        tms_save_int_exprs("tms_test_int_catalog.bin", int_list, int_count) != 0)
+    {
+        tms_print_errors(TMS_ALL_FACILITIES);
+        exit(1);
+    }
+
+    tms_catalog *C = tms_open_catalog("tms_test_catalog.bin");
+    tms_catalog *IC = tms_open_catalog("tms_test_int_catalog.bin");
+    if (C == NULL || IC == NULL || tms_catalog_count(C) != count || tms_catalog_count(IC) != int_count)
+    {
+        puts("Failed to load the catalogs.");
+        tms_print_errors(TMS_ALL_FACILITIES);
+        exit(1);
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        tms_math_expr *L = tms_catalog_get_math_expr(C, i);
+        if (L == NULL)
+        {
+            tms_print_errors(TMS_ALL_FACILITIES);
+            exit(1);
+        }
+        puts(L->expr);
+        tms_math_expr *D = tms_dup_mexpr(L);
+        double complex expected = tms_evaluate(list[i], 0), loaded = tms_evaluate(L, 0), duplicated = tms_evaluate(D, 0);
+        tms_delete_math_expr(D);
+        tms_delete_math_expr(list[i]);
+        if (memcmp(&expected, &loaded, sizeof(expected)) != 0 || memcmp(&expected, &duplicated, sizeof(expected)) != 0)
+        {
+            puts("Loaded expression answer doesn't match the original.");
+            exit(1);
+        }
+        puts("Passed\n--------------------\n");
+    }
+
+    for (i = 0; i < int_count; ++i)
+    {
+        tms_int_expr *L = tms_catalog_get_int_expr(IC, i);
+        int64_t expected, loaded;
+        if (L == NULL)
+        {
+            tms_print_errors(TMS_ALL_FACILITIES);
+            exit(1);
+        }
+        puts(L->expr);
+        if (tms_int_evaluate(int_list[i], &expected, 0) != 0 || tms_int_evaluate(L, &loaded, 0) != 0 ||
+            expected != loaded)
+        {
+            puts("Loaded expression answer doesn't match the original.");
+            tms_print_errors(TMS_ALL_FACILITIES);
+            exit(1);
+        }
+        tms_delete_int_expr(int_list[i]);
+        puts("Passed\n--------------------\n");
+    }
+
+    tms_close_catalog(C);
+    tms_close_catalog(IC);
+    remove("tms_test_catalog.bin");
+    remove("tms_test_int_catalog.bin");
+    test_ufunc_catalog();
+}
+
+tms_matrix *make_matrix(int n, const double *values)
+{
+    tms_matrix *M = tms_new_matrix(n, n);
+    for (int i = 0; i < n; ++i)
+        memcpy(TMS_MATRIX_ROW(M, i), values + i * n, n * sizeof(double));
+    return M;
+}
+
+tms_matrix *random_matrix(int rows, int columns)
+{
+    tms_matrix *M = tms_new_matrix(rows, columns);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < columns; ++j)
+            TMS_MATRIX_ROW(M, i)[j] = rand() / (double)RAND_MAX - 0.5;
+    return M;
+}
+
+// Compares tms_matrix_multiply() to the naive product, and the single thread product to the multithreaded one
+int test_multiply(int m, int k, int n)
+{
+    tms_matrix *A = random_matrix(m, k), *B = random_matrix(k, n), *C, *C_mt;
+    int i, j, p, failed = 0;
+
+    tms_set_matrix_threads(1);
+    C = tms_matrix_multiply(A, B);
+    tms_set_matrix_threads(4);
+    C_mt = tms_matrix_multiply(A, B);
+    tms_set_matrix_threads(0);
+
+    for (i = 0; i < m; ++i)
+    {
+        if (memcmp(TMS_MATRIX_ROW(C, i), TMS_MATRIX_ROW(C_mt, i), n * sizeof(double)) != 0)
+            failed = 1;
+        for (j = 0; j < n; ++j)
+        {
+            double expected = 0;
+            for (p = 0; p < k; ++p)
+                expected += TMS_MATRIX_ROW(A, i)[p] * TMS_MATRIX_ROW(B, p)[j];
+            if (fabs(TMS_MATRIX_ROW(C, i)[j] - expected) > 1e-12 * k)
+                failed = 1;
+        }
+    }
+    tms_delete_matrix(A);
+    tms_delete_matrix(B);
+    tms_delete_matrix(C);
+    tms_delete_matrix(C_mt);
+    return failed;
+}
+
+tms_cmatrix *random_cmatrix(int rows, int columns)
+{
+    tms_cmatrix *M = tms_new_cmatrix(rows, columns);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < columns; ++j)
+            TMS_CMATRIX_ROW(M, i)[j] = (rand() / (double)RAND_MAX - 0.5) + I * (rand() / (double)RAND_MAX - 0.5);
+    return M;
+}
+
+// Checks the complex product against the naive one, and the complex inverse: A*inv(A) should be the identity
+int test_cmatrix(int m, int k, int n)
+{
+    tms_cmatrix *A = random_cmatrix(m, k), *B = random_cmatrix(k, n), *C, *C_mt, *inverse, *identity;
+    int i, j, p, failed = 0;
+
+    tms_set_matrix_threads(1);
+    C = tms_cmatrix_multiply(A, B);
+    tms_set_matrix_threads(4);
+    C_mt = tms_cmatrix_multiply(A, B);
+    tms_set_matrix_threads(0);
+
+    for (i = 0; i < m; ++i)
+    {
+        if (memcmp(TMS_CMATRIX_ROW(C, i), TMS_CMATRIX_ROW(C_mt, i), n * sizeof(double complex)) != 0)
+            failed = 1;
+        for (j = 0; j < n; ++j)
+        {
+            double complex expected = 0;
+            for (p = 0; p < k; ++p)
+                expected += TMS_CMATRIX_ROW(A, i)[p] * TMS_CMATRIX_ROW(B, p)[j];
+            if (cabs(TMS_CMATRIX_ROW(C, i)[j] - expected) > 1e-12 * k)
+                failed = 1;
+        }
+    }
+    tms_delete_cmatrix(B);
+    tms_delete_cmatrix(C);
+    tms_delete_cmatrix(C_mt);
+
+    if (m == k)
+    {
+        inverse = tms_cmatrix_inv(A);
+        if (inverse == NULL)
+            failed = 1;
+        else
+        {
+            identity = tms_cmatrix_multiply(A, inverse);
+            for (i = 0; i < m; ++i)
+                for (j = 0; j < m; ++j)
+                    if (cabs(TMS_CMATRIX_ROW(identity, i)[j] - (i == j)) > 1e-10)
+                        failed = 1;
+            tms_delete_cmatrix(identity);
+            tms_delete_cmatrix(inverse);
+        }
+    }
+    tms_delete_cmatrix(A);
+    return failed;
+}
+
+// Solves A*X = B and compares X to the expected values, returns 1 on failure
+int test_solve(int rows, int columns, const double *a, int rhs, const double *b, const double *expected)
+{
+    tms_matrix *A = tms_new_matrix(rows, columns), *B = tms_new_matrix(rows, rhs), *X;
+    int i, j, failed = 0;
+    for (i = 0; i < rows; ++i)
+    {
+        memcpy(TMS_MATRIX_ROW(A, i), a + i * columns, columns * sizeof(double));
+        memcpy(TMS_MATRIX_ROW(B, i), b + i * rhs, rhs * sizeof(double));
+    }
+
+    X = tms_matrix_solve(A, B);
+    if (X == NULL || X->rows != columns || X->columns != rhs)
+        failed = 1;
+    else
+        for (i = 0; i < columns; ++i)
+            for (j = 0; j < rhs; ++j)
+                if (fabs(TMS_MATRIX_ROW(X, i)[j] - expected[i * rhs + j]) > 1e-12)
+                    failed = 1;
+
+    if (X != NULL)
+        tms_delete_matrix(X);
+    tms_delete_matrix(A);
+    tms_delete_matrix(B);
+    return failed;
+}
+
+// Builds a tridiagonal n*n sparse matrix, solves A*x = b with b computed from a known x and checks the answer
+int test_sparse_solve(int n, double lower, double diagonal, double upper, int method)
+{
+    int *row = malloc(3 * n * sizeof(int)), *col = malloc(3 * n * sizeof(int)), i, count = 0, failed = 0;
+    double *values = malloc(3 * n * sizeof(double)), *x = calloc(n, sizeof(double)), *b = malloc(n * sizeof(double)),
+           *expected = malloc(n * sizeof(double));
+
+    // Triplets in reverse order to check the sorting
+    for (i = n - 1; i >= 0; --i)
+    {
+        if (i + 1 < n)
+            row[count] = i, col[count] = i + 1, values[count++] = upper;
+        row[count] = i, col[count] = i, values[count++] = diagonal;
+        if (i > 0)
+            row[count] = i, col[count] = i - 1, values[count++] = lower;
+        expected[i] = sin(i);
+    }
+    tms_sparse_matrix *A = tms_sparse_from_triplets(n, n, count, row, col, values);
+    if (A == NULL || A->nnz != 3 * n - 2)
+        failed = 1;
+    else
+    {
+        tms_sparse_multiply_vector(A, expected, b);
+        if (tms_sparse_solve(A, b, x, method, 1e-12, 0) < 0)
+            failed = 1;
+        for (i = 0; i < n; ++i)
+            if (fabs(x[i] - expected[i]) > 1e-8)
+                failed = 1;
+    }
+    tms_delete_sparse_matrix(A);
+    free(row);
+    free(col);
+    free(values);
+    free(x);
+    free(b);
+    free(expected);
+    return failed;
+}
+
+// Checks the determinant, inverse and LU solve against known answers
+void test_matrix()
+{
+    const double singular[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    const double tridiagonal[] = {2, -1, 0, -1, 2, -1, 0, -1, 2};
+    const double tridiagonal_inv[] = {0.75, 0.5, 0.25, 0.5, 1, 0.5, 0.25, 0.5, 0.75};
+    // Needs pivoting, the first pivot is 0
+    const double permuted[] = {0, 2, 1, 0, 1, 0, 0, 3, 0, 1, 4, 0, 2, 0, 0, 5};
+    const double b[] = {1, 2, 3, 4}, expected_x[] = {2, 1.0 / 7, 5.0 / 7, 0};
+    // Badly scaled rows, not singular: det = 1
+    const double scaled[] = {1e10, 0, 0, 0, 1e-10, 0, 0, 0, 1};
+    double x[4];
+    int i, j, failed = 0;
+
+    tms_matrix *A = make_matrix(3, singular), *B = make_matrix(3, tridiagonal), *C = make_matrix(4, permuted), *inverse;
+    tms_lu *F;
+    srand(1);
+
+    puts("Testing matrix determinant:");
+    // The determinant of the singular matrix is only rounding noise, it isn't rounded to 0
+    if (fabs(tms_matrix_det(A)) > 1e-14 || fabs(tms_matrix_det(B) - 4) > 1e-12 || fabs(tms_matrix_det(C) - 7) > 1e-12)
+        failed = 1;
+    {
+        tms_matrix *S = make_matrix(3, scaled);
+        F = tms_matrix_lu(S);
+        if (tms_matrix_det(S) != 1 || F->singular || tms_lu_solve(F, b, x) != 0 || x[1] != 2e10)
+            failed = 1;
+        inverse = tms_lu_inv(F);
+        if (inverse == NULL || TMS_MATRIX_ROW(inverse, 0)[0] != 1e-10)
+            failed = 1;
+        tms_delete_matrix(inverse);
+        tms_delete_lu(F);
+        tms_delete_matrix(S);
+    }
+
+    puts("Testing matrix inverse:");
+    inverse = tms_matrix_inv(B);
+    if (inverse == NULL)
+        failed = 1;
+    else
+    {
+        for (i = 0; i < 3; ++i)
+            for (j = 0; j < 3; ++j)
+                if (fabs(TMS_MATRIX_ROW(inverse, i)[j] - tridiagonal_inv[i * 3 + j]) > 1e-12)
+                    failed = 1;
+        tms_delete_matrix(inverse);
+    }
+    // Needs row swaps, C * inverse should be the identity
+    inverse = tms_matrix_inv(C);
+    if (inverse == NULL)
+        failed = 1;
+    else
+    {
+        tms_matrix *product = tms_matrix_multiply(C, inverse);
+        for (i = 0; i < 4; ++i)
+            for (j = 0; j < 4; ++j)
+                if (fabs(TMS_MATRIX_ROW(product, i)[j] - (i == j)) > 1e-12)
+                    failed = 1;
+        tms_delete_matrix(product);
+        tms_delete_matrix(inverse);
+    }
+    if (tms_matrix_inv(A) != NULL || tms_get_error_count(TMS_MATRIX, EH_FATAL) != 1)
+        failed = 1;
+    tms_clear_errors(TMS_MATRIX);
+
+    puts("Testing comatrix:");
+    {
+        // Singular matrix (computed from the minors)
+        const double singular_comatrix[] = {-3, 6, -3, 6, -12, 6, -3, 6, -3};
+        tms_matrix *comatrix = tms_comatrix(A);
+        for (i = 0; i < 3; ++i)
+            for (j = 0; j < 3; ++j)
+                if (fabs(TMS_MATRIX_ROW(comatrix, i)[j] - singular_comatrix[i * 3 + j]) > 1e-12)
+                    failed = 1;
+        tms_delete_matrix(comatrix);
+
+        // C * transpose(comatrix) = det(C) * identity
+        tms_matrix *transpose, *product;
+        comatrix = tms_comatrix(C);
+        transpose = tms_matrix_tr(comatrix);
+        product = tms_matrix_multiply(C, transpose);
+        for (i = 0; i < 4; ++i)
+            for (j = 0; j < 4; ++j)
+                if (fabs(TMS_MATRIX_ROW(product, i)[j] - 7 * (i == j)) > 1e-12)
+                    failed = 1;
+        tms_delete_matrix(comatrix);
+        tms_delete_matrix(transpose);
+        tms_delete_matrix(product);
+    }
+
+    puts("Testing LU solve:");
+    F = tms_matrix_lu(C);
+    if (F == NULL || F->singular || tms_lu_solve(F, b, x) != 0)
+        failed = 1;
+    else
+        for (i = 0; i < 4; ++i)
+            if (fabs(x[i] - expected_x[i]) > 1e-12)
+                failed = 1;
+    tms_delete_lu(F);
+
+    puts("Testing wrapped strided matrix:");
+    // The tridiagonal matrix with a padding column
+    double buffer[] = {2, -1, 0, 99, -1, 2, -1, 99, 0, -1, 2, 99};
+    tms_matrix *W = tms_wrap_matrix(buffer, 3, 3, 4), *copy = tms_matrix_dup(W);
+    if (fabs(tms_matrix_det(W) - 4) > 1e-12 || copy->stride != 3 || TMS_MATRIX_ROW(copy, 2)[0] != 0)
+        failed = 1;
+    tms_delete_matrix(W);
+    tms_delete_matrix(copy);
+
+    puts("Testing matrix multiplication:");
+    // Sizes that aren't multiples of the kernel tiles and cache blocks
+    failed |= test_multiply(1, 1, 1) | test_multiply(7, 3, 9) | test_multiply(37, 300, 29) | test_multiply(200, 150, 170);
+
+    puts("Testing linear system solver:");
+    {
+        // Symmetric positive definite (Cholesky), then symmetric indefinite (falls back to LU)
+        const double spd_b[] = {1, 0, 0, 1, 0, 0}, spd_x[] = {0.75, 0.5, 0.5, 1, 0.25, 0.5};
+        const double indefinite[] = {1, 2, 2, 1}, indefinite_b[] = {3, 3}, indefinite_x[] = {1, 1};
+        // Needs pivoting, two right hand sides
+        const double permuted_b[] = {1, 3, 2, 4, 3, 5, 4, 7}, permuted_x[] = {2, 1, 1.0 / 7, 1, 5.0 / 7, 1, 0, 1};
+        // Least squares fit of y = 2 + 3x on exact points
+        const double fit[] = {1, 0, 1, 1, 1, 2, 1, 3, 1, 4}, fit_y[] = {2, 5, 8, 11, 14}, fit_x[] = {2, 3};
+        // Badly scaled but not singular, for LU (indefinite) and QR
+        const double scaled_lu[] = {1e10, 0, 0, 0, -1e-10, 0, 0, 0, 1}, scaled_lu_b[] = {1e10, -1e-10, 1};
+        const double scaled_qr[] = {1e10, 0, 0, 1e-10, 0, 0}, scaled_qr_b[] = {1e10, 1e-10, 0}, ones[] = {1, 1, 1};
+        // The elimination gives an exactly zero pivot
+        const double zero_pivot[] = {1, 2, 3, 2, 4, 6, 1, 0, 1};
+
+        failed |= test_solve(3, 3, tridiagonal, 2, spd_b, spd_x);
+        failed |= test_solve(2, 2, indefinite, 1, indefinite_b, indefinite_x);
+        failed |= test_solve(4, 4, permuted, 2, permuted_b, permuted_x);
+        failed |= test_solve(5, 2, fit, 1, fit_y, fit_x);
+        failed |= test_solve(3, 3, scaled_lu, 1, scaled_lu_b, ones);
+        failed |= test_solve(3, 2, scaled_qr, 1, scaled_qr_b, ones);
+        // Singular matrix should fail
+        failed |= !test_solve(3, 3, zero_pivot, 1, b, b);
+        tms_clear_errors(TMS_MATRIX);
+    }
+
+    puts("Testing complex matrices:");
+    {
+        double complex values[] = {1 + I, 2, 3, 4 - I};
+        tms_cmatrix *Z = tms_wrap_cmatrix(values, 2, 2, 2);
+        if (cabs(tms_cmatrix_det(Z) - (-1 + 3 * I)) > 1e-12)
+            failed = 1;
+        // Same error as the real product
+        tms_cmatrix *R = tms_new_cmatrix(3, 1);
+        if (tms_cmatrix_multiply(Z, R) != NULL || tms_find_error(TMS_MATRIX, MATRIX_DIMENSIONS_MISMATCH) == -1)
+            failed = 1;
+        tms_clear_errors(TMS_MATRIX);
+        tms_delete_cmatrix(R);
+        tms_delete_cmatrix(Z);
+        failed |= test_cmatrix(1, 1, 1) | test_cmatrix(5, 5, 3) | test_cmatrix(37, 37, 29) | test_cmatrix(130, 140, 150);
+    }
+
+    puts("Testing sparse matrices:");
+    {
+        // Duplicates are added, the dense conversion should give the same matrix
+        const int row[] = {2, 0, 1, 2, 0}, col[] = {0, 1, 1, 0, 1};
+        const double values[] = {1, 2, 3, 4, 5}, x_dense[] = {1, 2, 3};
+        double y[3];
+        tms_sparse_matrix *S = tms_sparse_from_triplets(3, 3, 5, row, col, values), *S_dense;
+        tms_matrix *D = tms_new_matrix(3, 3);
+        memset(D->data, 0, 9 * sizeof(double));
+        TMS_MATRIX_ROW(D, 0)[1] = 7;
+        TMS_MATRIX_ROW(D, 1)[1] = 3;
+        TMS_MATRIX_ROW(D, 2)[0] = 5;
+        S_dense = tms_sparse_from_dense(D);
+        if (S->nnz != 3 || S_dense->nnz != 3 || memcmp(S->row_start, S_dense->row_start, 4 * sizeof(int)) != 0 ||
+            memcmp(S->col_index, S_dense->col_index, 3 * sizeof(int)) != 0 ||
+            memcmp(S->values, S_dense->values, 3 * sizeof(double)) != 0)
+            failed = 1;
+        tms_sparse_multiply_vector(S, x_dense, y);
+        if (y[0] != 14 || y[1] != 6 || y[2] != 5)
+            failed = 1;
+        tms_delete_sparse_matrix(S);
+        tms_delete_sparse_matrix(S_dense);
+        tms_delete_matrix(D);
+
+        // Symmetric positive definite (CG) and nonsymmetric (BiCGSTAB) systems
+        failed |= test_sparse_solve(1000, -1, 2.5, -1, TMS_SPARSE_AUTO) | test_sparse_solve(1000, -1, 2.5, -1, TMS_SPARSE_CG);
+        failed |= test_sparse_solve(1000, -1.5, 3, -0.5, TMS_SPARSE_AUTO);
+        failed |= test_sparse_solve(1000, -1.5, 3, -0.5, TMS_SPARSE_BICGSTAB);
+
+        // BiCGSTAB breaks down (r_hat.v = 0), this is a failure and not a NaN solution
+        const int swap_row[] = {0, 1}, swap_col[] = {1, 0};
+        const double ones[] = {1, 1}, swap_b[] = {1, 0};
+        double swap_x[2] = {0, 0};
+        S = tms_sparse_from_triplets(2, 2, 2, swap_row, swap_col, ones);
+        if (tms_sparse_solve(S, swap_b, swap_x, TMS_SPARSE_AUTO, 1e-12, 0) != -1 ||
+            tms_find_error(TMS_MATRIX, NO_CONVERGENCE) == -1)
+            failed = 1;
+        tms_clear_errors(TMS_MATRIX);
+        tms_delete_sparse_matrix(S);
+    }
+
+    puts("Testing matrix expressions:");
+    {
+        tms_matrix *X = random_matrix(4, 3), *solved = tms_matrix_solve(C, X), *R;
+        tms_set_matrix_var("B", B);
+        tms_set_matrix_var("C", C);
+        tms_set_matrix_var("X", X);
+
+        // Evaluated as a solve, should match tms_matrix_solve()
+        R = tms_matrix_eval("inv(C)*X");
+        if (R == NULL || R->rows != 4 || R->columns != 3)
+            failed = 1;
+        else
+            for (i = 0; i < 4; ++i)
+                for (j = 0; j < 3; ++j)
+                    if (fabs(TMS_MATRIX_ROW(R, i)[j] - TMS_MATRIX_ROW(solved, i)[j]) > 1e-12)
+                        failed = 1;
+        tms_delete_matrix(R);
+
+        R = tms_matrix_eval("tr(X)*inv(C)*C - tr(X)");
+        if (R == NULL || R->rows != 3 || R->columns != 4)
+            failed = 1;
+        else
+            for (i = 0; i < 3; ++i)
+                for (j = 0; j < 4; ++j)
+                    if (fabs(TMS_MATRIX_ROW(R, i)[j]) > 1e-12)
+                        failed = 1;
+        tms_delete_matrix(R);
+
+        // Scalar functions in scientific expressions
+        cdouble first = tms_solve("det(B)+trace(B*B)"), second = tms_solve("det(inv(C))");
+        if (cabs(first - 20) > 1e-12 || isnan(creal(first)) || cabs(second - 1.0 / 7) > 1e-12 || isnan(creal(second)))
+            failed = 1;
+
+        // Incompatible dimensions
+        if (tms_matrix_eval("B+X") != NULL || !isnan(creal(tms_solve("det(X)"))))
+            failed = 1;
+        tms_clear_errors(TMS_ALL_FACILITIES);
+
+        // Labels of the scientific expression are scalars: det(2*B) = 2^3*det(B)
+        tms_arg_list *labels = tms_get_args("x");
+        double complex x_value = 2;
+        labels->payload = malloc(sizeof(x_value));
+        labels->payload_size = sizeof(x_value);
+        memcpy(labels->payload, &x_value, sizeof(x_value));
+        first = tms_solve_e("det(x*B)", 0, labels);
+        if (cabs(first - 32) > 1e-12 || isnan(creal(first)))
+            failed = 1;
+        tms_free_arg_list(labels);
+
+        // Too deep for the recursive parser: nested parenthesis, a run of signs and a long sum
+        size_t length = 3 * TMS_MATRIX_EXPR_MAX_DEPTH;
+        char *deep = malloc(2 * length + 2);
+        memset(deep, '(', length);
+        deep[length] = 'B';
+        memset(deep + length + 1, ')', length);
+        deep[2 * length + 1] = '\0';
+        if (tms_matrix_eval(deep) != NULL || tms_find_error(TMS_MATRIX, STACK_DEPTH_EXCEEDED) == -1)
+            failed = 1;
+        tms_clear_errors(TMS_MATRIX);
+        memset(deep, '-', length);
+        deep[length] = 'B';
+        deep[length + 1] = '\0';
+        if (tms_matrix_eval(deep) != NULL || tms_find_error(TMS_MATRIX, STACK_DEPTH_EXCEEDED) == -1)
+            failed = 1;
+        tms_clear_errors(TMS_MATRIX);
+        for (i = 0; i < (int)length; ++i)
+            memcpy(deep + 2 * i, "B+", 2);
+        deep[2 * length - 1] = '\0';
+        if (tms_matrix_eval(deep) != NULL || tms_find_error(TMS_MATRIX, STACK_DEPTH_EXCEEDED) == -1)
+            failed = 1;
+        tms_clear_errors(TMS_MATRIX);
+        // Nesting below the limit is accepted
+        R = tms_matrix_eval("((((-(-B))))-B)");
+        if (R == NULL || TMS_MATRIX_ROW(R, 0)[0] != 0)
+            failed = 1;
+        if (R != NULL)
+            tms_delete_matrix(R);
+        free(deep);
+
+        tms_clear_matrix_vars();
+        tms_delete_matrix(X);
+        tms_delete_matrix(solved);
+    }
+
+    puts("Testing singular matrix detection:");
+    {
+        // The elimination gives an exactly zero pivot
+        const double zero_pivot[] = {1, 2, 3, 2, 4, 6, 1, 0, 1};
+        tms_matrix *Z = make_matrix(3, zero_pivot);
+        F = tms_matrix_lu(Z);
+        if (F == NULL || !F->singular || tms_lu_inv(F) != NULL || tms_lu_det(F) != 0)
+            failed = 1;
+        tms_delete_lu(F);
+        tms_delete_matrix(Z);
+        tms_clear_errors(TMS_MATRIX);
+    }
+
+    tms_delete_matrix(A);
+    tms_delete_matrix(B);
+    tms_delete_matrix(C);
+    if (failed)
+    {
+        puts("Matrix test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+// Random inserts, replacements and deletions checked against a plain array of the expected items
+void test_symtab()
+{
+    typedef struct
+    {
+        char *name;
+        int value;
+    } item;
+    const int name_count = 500;
+    char *names[500], buffer[64];
+    int values[500], i, j, k, failed = 0;
+    size_t count = 0, len, iter = 0;
+    tms_symtab *T = tms_symtab_new(sizeof(item), 0, 1, NULL);
+    item *it;
+    srand(1);
+
+    puts("Testing symbol table:");
+    // Short names, names of exactly 16 bytes, and long names sharing their first 16 bytes
+    for (i = 0; i < name_count; ++i)
+    {
+        if (i % 3 == 0)
+            snprintf(buffer, sizeof(buffer), "v%d", i);
+        else if (i % 3 == 1)
+            snprintf(buffer, sizeof(buffer), "sixteen_bytes%03d", i);
+        else
+            snprintf(buffer, sizeof(buffer), "sixteen_bytes000_long_%d", i);
+        names[i] = strdup(buffer);
+        values[i] = -1;
+    }
+
+    for (k = 0; k < 200000 && !failed; ++k)
+    {
+        i = rand() % name_count;
+        item new_item = {.name = names[i], .value = k};
+        switch (rand() % 3)
+        {
+        case 0:
+            if ((tms_symtab_set(T, &new_item) != NULL) != (values[i] != -1))
+                failed = 1;
+            count += values[i] == -1;
+            values[i] = k;
+            break;
+        case 1:
+            it = (item *)tms_symtab_delete(T, names[i]);
+            if ((it != NULL) != (values[i] != -1) || (it != NULL && it->value != values[i]))
+                failed = 1;
+            count -= values[i] != -1;
+            values[i] = -1;
+            break;
+        default:
+            it = (item *)tms_symtab_get(T, names[i]);
+            if ((it != NULL) != (values[i] != -1) || (it != NULL && it->value != values[i]))
+                failed = 1;
+        }
+        if (tms_symtab_count(T) != count)
+            failed = 1;
+    }
+
+    // Every item should be found by iteration and in the sorted array
+    for (i = 0; tms_symtab_iter(T, &iter, (void **)&it); ++i)
+        for (j = 0; j < name_count; ++j)
+            if (strcmp(it->name, names[j]) == 0 && it->value != values[j])
+                failed = 1;
+    it = tms_symtab_to_array(T, &len, true);
+    if (i != count || len != count)
+        failed = 1;
+    for (i = 1; i < len; ++i)
+        if (strcmp(it[i - 1].name, it[i].name) >= 0)
+            failed = 1;
+    free(it);
+
+    tms_symtab_free(T);
+    for (i = 0; i < name_count; ++i)
+        free(names[i]);
+    if (failed)
+    {
+        puts("Symbol table test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+// Every built-in name should be found by the perfect hash, other names should not
+void test_builtins()
+{
+    const char *misses[] = {"", "x", "fac", "facts", "Sin", "sin ", "not", "gcd", "mask_bit2", "pi_", "ans"};
+    size_t count, i, j;
+    int failed = 0;
+
+    puts("Testing built-in names:");
+    tms_rc_func *rc_funcs = tms_get_all_rc_func(&count, true);
+    for (i = 0; i < count; ++i)
+    {
+        const tms_rc_func *F = tms_get_rc_func_by_name(rc_funcs[i].name);
+        if (F == NULL || F->real != rc_funcs[i].real || (i > 0 && strcmp(rc_funcs[i - 1].name, rc_funcs[i].name) >= 0))
+            failed = 1;
+    }
+    free(rc_funcs);
+
+    tms_extf *extfs = tms_get_all_extf(&count, false);
+    for (i = 0; i < count; ++i)
+        if (tms_get_extf_by_name(extfs[i].name) == NULL || tms_get_extf_by_name(extfs[i].name)->ptr != extfs[i].ptr)
+            failed = 1;
+    free(extfs);
+
+    tms_int_func *int_funcs = tms_get_all_int_func(&count, false);
+    for (i = 0; i < count; ++i)
+        if (tms_get_int_func_by_name(int_funcs[i].name) == NULL ||
+            tms_get_int_func_by_name(int_funcs[i].name)->ptr != int_funcs[i].ptr)
+            failed = 1;
+    free(int_funcs);
+
+    tms_int_extf *int_extfs = tms_get_all_int_extf(&count, false);
+    for (i = 0; i < count; ++i)
+        if (tms_get_int_extf_by_name(int_extfs[i].name) == NULL ||
+            tms_get_int_extf_by_name(int_extfs[i].name)->ptr != int_extfs[i].ptr)
+            failed = 1;
+    free(int_extfs);
+
+    for (i = 0; i < array_length(misses); ++i)
+        if (tms_get_rc_func_by_name(misses[i]) != NULL || tms_get_extf_by_name(misses[i]) != NULL ||
+            tms_get_var_by_name(misses[i]) != NULL)
+            failed = 1;
+    if (tms_get_int_func_by_name("sin") != NULL || tms_get_int_extf_by_name("avg") != NULL)
+        failed = 1;
+
+    // Constants are built-in, user variables are listed with them
+    if (tms_get_var_by_name("pi") == NULL || tms_get_var_by_name("pi")->value != M_PI || tms_remove_var("pi") != 1 ||
+        tms_set_var("pi", 3, false) != -1)
+        failed = 1;
+    tms_clear_errors(TMS_PARSER);
+    tms_set_var("pi2", 6, false);
+    tms_var *vars = tms_get_all_vars(&count, true);
+    for (i = 0, j = 0; i < count; ++i)
+        j += strcmp(vars[i].name, "pi2") == 0 || strcmp(vars[i].name, "pi") == 0;
+    if (j != 2 || count != 5)
+        failed = 1;
+    free(vars);
+    if (tms_remove_var("pi2") != 0)
+        failed = 1;
+
+    if (failed)
+    {
+        puts("Built-in names test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+// The profiling counters should only change while enabled, and count the phases that ran
+void test_stats()
+{
+    int64_t int_result;
+    int failed = 0, i;
+    tms_stats S;
+
+    puts("Testing profiling counters:");
+    tms_reset_stats();
+    tms_solve_e("sin(2)+1", 0, NULL);
+    S = tms_get_stats();
+    if (tms_stats_enabled() || S.count[TMS_STAT_PARSE] != 0 || S.ns[TMS_STAT_EVALUATE] != 0)
+        failed = 1;
+
+    tms_set_stats(true);
+    tms_set_ufunction("h", "x", "x^2+avg(x,1)");
+    tms_solve_e("h(3)!+avg(1,3)", EXPAND_UOPS, NULL);
+    tms_int_solve_e("~5+rr(1,2)", &int_result, EXPAND_UOPS, NULL);
+    tms_solve_e("5+", 0, NULL);
+    tms_clear_errors(TMS_ALL_FACILITIES);
+    S = tms_get_stats();
+    // Extended functions parse and evaluate their arguments too
+    if (S.count[TMS_STAT_PARSE] < 3 || S.count[TMS_STAT_EVALUATE] < 2 || S.count[TMS_STAT_INT_PARSE] < 1 ||
+        S.count[TMS_STAT_INT_EVALUATE] < 1 || S.count[TMS_STAT_EXTF] < 2 || S.count[TMS_STAT_UFUNC_LOOKUP] != 1 ||
+        S.count[TMS_STAT_EXPAND_MACROS] < 2 || S.count[TMS_STAT_SAVE_ERROR] < 1 || S.ns[TMS_STAT_PARSE] == 0 ||
+        S.ns[TMS_STAT_EVALUATE] < S.ns[TMS_STAT_EXTF])
+        failed = 1;
+    for (i = 0; i < TMS_STAT_COUNT; ++i)
+        printf("%-20s %6" PRIu64 " calls %10" PRIu64 " ns\n", tms_stat_name(i), S.count[i], S.ns[i]);
+    if (tms_stat_name(TMS_STAT_COUNT) != NULL)
+        failed = 1;
+
+    tms_set_stats(false);
+    tms_reset_stats();
+    tms_solve("1+1");
+    S = tms_get_stats();
+    for (i = 0; i < TMS_STAT_COUNT; ++i)
+        if (S.count[i] != 0 || S.ns[i] != 0)
+            failed = 1;
+    tms_remove_ufunc("h");
+
+    if (failed)
+    {
+        puts("Profiling counters test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+void test_evaluate_batch()
+{
+    int failed = 0;
+    double x[] = {0, 1, 2, 3, 4}, y[] = {1, 0, 2, 0, 5}, k = 10, results[5];
+    // Row 1 and 3 divide by zero, y is read backwards and k is repeated
+    const double *columns[] = {x, y + 4, &k};
+    int64_t strides[] = {1, -1, 0};
+    double expected[] = {0 / 5.0 + 10, 1 / 0.0, 2 / 2.0 + 10, 1 / 0.0, 4 / 1.0 + 10};
+
+    puts("Testing batch evaluation:");
+    tms_math_expr *M = tms_parse_expr("x/y+k", 0, tms_get_args("x,y,k"));
+    if (M == NULL || tms_evaluate_batch(M, columns, strides, 5, results, 0) != 2)
+        failed = 1;
+    for (int i = 0; i < 5 && !failed; ++i)
+        if (isinf(expected[i]) ? !isnan(results[i]) : results[i] != expected[i])
+            failed = 1;
+    // Errors of failed rows are cleared
+    if (tms_get_error_count(TMS_ALL_FACILITIES, EH_ALL_ERRORS) != 0)
+        failed = 1;
+    tms_delete_math_expr(M);
+
+    // Contiguous columns, complex answers are NaN
+    M = tms_parse_expr("sqrt(x-2)", ENABLE_CMPLX, tms_get_args("x"));
+    columns[0] = x;
+    if (M == NULL || tms_evaluate_batch(M, columns, NULL, 5, results, 0) != 2 || !isnan(results[1]) ||
+        results[3] != 1)
+        failed = 1;
+    tms_delete_math_expr(M);
+
+    if (failed)
+    {
+        puts("Batch evaluation test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+#define SHARED_THREADS 4
+
+// Evaluates its own expressions with SHARED_LOCK, returns NULL if all answers and errors were as expected
+void *shared_evaluation_worker(void *arg)
+{
+    int id = *(int *)arg;
+    double complex values[2];
+    double expected;
+    tms_math_expr *M = tms_parse_expr("x*2+g(x,y)+f(y)", 0, tms_get_args("x,y"));
+    tms_math_expr *F = tms_parse_expr("1/(x-x)", 0, tms_get_args("x"));
+    void *status = NULL;
+    if (M == NULL || F == NULL)
+        status = arg;
+
+    for (int i = 0; i < 2000 && status == NULL; ++i)
+    {
+        values[0] = id;
+        values[1] = i;
+        tms_set_labels_values(M, values);
+        expected = id * 2 + (id + i) / 2.0 + i * i + 1;
+        if (fabs(creal(tms_evaluate(M, SHARED_LOCK)) - expected) > 1e-12 * expected)
+            status = arg;
+
+        // The error of the failed evaluation is only in the database of this thread
+        tms_set_labels_values(F, values);
+        if (!isnan(creal(tms_evaluate(F, SHARED_LOCK))) || tms_get_error_count(TMS_ALL_FACILITIES, EH_ALL_ERRORS) != 1)
+            status = arg;
+        tms_clear_errors(TMS_ALL_FACILITIES);
+    }
+    tms_delete_math_expr(M);
+    tms_delete_math_expr(F);
+    return status;
+}
+
+void test_shared_evaluation()
+{
+    pthread_t threads[SHARED_THREADS];
+    int ids[SHARED_THREADS], failed = 0, i;
+    void *status;
+
+    puts("Testing concurrent evaluations:");
+    // g calls an extended function, which parses its arguments during the evaluation
+    tms_set_ufunction("f", "x", "x^2+1");
+    tms_set_ufunction("g", "a,b", "avg(a,b)");
+    for (i = 0; i < SHARED_THREADS; ++i)
+    {
+        ids[i] = i;
+        pthread_create(threads + i, NULL, shared_evaluation_worker, ids + i);
+    }
+    for (i = 0; i < SHARED_THREADS; ++i)
+    {
+        pthread_join(threads[i], &status);
+        if (status != NULL)
+            failed = 1;
+    }
+    // The errors of the threads didn't reach this one
+    if (tms_get_error_count(TMS_ALL_FACILITIES, EH_ALL_ERRORS) != 0)
+        failed = 1;
+    tms_remove_ufunc("f");
+    tms_remove_ufunc("g");
+
+    if (failed)
+    {
+        puts("Concurrent evaluations test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+// Counts the calls of each item, and the ranges started from a range (they run in the same thread)
+typedef struct pool_test_job
+{
+    int *calls;
+    int nested;
+} pool_test_job;
+
+void pool_test_range(void *arg, size_t begin, size_t end)
+{
+    pool_test_job *J = arg;
+    for (size_t i = begin; i < end; ++i)
+        __atomic_fetch_add(J->calls + i, 1, __ATOMIC_RELAXED);
+}
+
+void pool_test_nested_range(void *arg, size_t begin, size_t end)
+{
+    pool_test_job *J = arg;
+    pool_test_range(arg, begin, end);
+    if (!_tms_parallel_enabled())
+        __atomic_fetch_add(&J->nested, 1, __ATOMIC_RELAXED);
+}
+
+// Host executor running the ranges in order, counts its calls
+int test_executor_calls = 0;
+
+int test_executor_threads(void *context)
+{
+    return *(int *)context;
+}
+
+void test_executor_for(void *context, size_t n, size_t grain, tms_range_func func, void *arg)
+{
+    (void)context;
+    ++test_executor_calls;
+    for (size_t i = 0; i < n; i += grain)
+        func(arg, i, i + grain < n ? i + grain : n);
+}
+
+// Returns true if each of the n items was run once
+bool pool_test_once(int *calls, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (calls[i] != 1)
+            return false;
+    return true;
+}
+
+void test_thread_pool()
+{
+    int failed = 0, calls[10000], executor_threads = 3;
+    size_t sizes[] = {1, 7, 64, 1000, 10000};
+    pool_test_job J = {calls, 0};
+    tms_executor E = {&executor_threads, test_executor_threads, test_executor_for};
+    double x[4096], results[4096], serial[4096];
+    const double *columns[] = {x};
+    double complex integral, serial_integral;
+
+    puts("Testing the thread pool:");
+    tms_set_thread_pool_size(4);
+    if (tms_get_thread_pool_size() != 4 || tms_get_thread_count() != 4)
+        failed = 1;
+    for (int s = 0; s < 5; ++s)
+        for (size_t grain = 1; grain <= 16; grain *= 4)
+        {
+            memset(calls, 0, sizeof(calls));
+            tms_parallel_for(sizes[s], grain, pool_test_range, &J);
+            if (!pool_test_once(calls, sizes[s]))
+                failed = 1;
+        }
+
+    // Ranges started by a range run in its thread
+    memset(calls, 0, sizeof(calls));
+    tms_parallel_for(100, 1, pool_test_nested_range, &J);
+    if (!pool_test_once(calls, 100) || J.nested == 0)
+        failed = 1;
+
+    // Batches and integrals have the same answers in parallel and in one thread
+    for (int i = 0; i < 4096; ++i)
+        x[i] = i / 64.0 - 32;
+    tms_math_expr *M = tms_parse_expr("sin(t)/t+integrate(0,1,x^2)", 0, tms_get_args("t"));
+    if (M == NULL || tms_evaluate_batch(M, columns, NULL, 4096, results, 0) != 1 || !isnan(results[2048]))
+        failed = 1;
+    integral = tms_solve("integrate(-3,5.5,sin(x)*x^2)");
+    tms_set_thread_pool_size(1);
+    if (M == NULL || tms_evaluate_batch(M, columns, NULL, 4096, serial, 0) != 1)
+        failed = 1;
+    for (int i = 0; i < 4096 && !failed; ++i)
+        if (i != 2048 && results[i] != serial[i])
+            failed = 1;
+    serial_integral = tms_solve("integrate(-3,5.5,sin(x)*x^2)");
+    if (integral != serial_integral || isnan(creal(integral)))
+        failed = 1;
+    // A failed point is reported by this thread
+    if (!isnan(creal(tms_solve_e("integrate(0,2,1/(x-1))", 0, NULL))) ||
+        tms_get_error_count(TMS_EVALUATOR, EH_FATAL) == 0)
+        failed = 1;
+    tms_clear_errors(TMS_ALL_FACILITIES);
+
+    // Host executor
+    tms_set_executor(&E);
+    memset(calls, 0, sizeof(calls));
+    tms_parallel_for(1000, 10, pool_test_range, &J);
+    if (tms_get_thread_count() != 3 || test_executor_calls != 1 || !pool_test_once(calls, 1000))
+        failed = 1;
+    tms_set_executor(NULL);
+    tms_set_thread_pool_size(0);
+    tms_stop_thread_pool();
+    tms_delete_math_expr(M);
+
+    if (failed)
+    {
+        puts("Thread pool test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+void test_solve_list_parallel()
+{
+    int failed = 0, status[1000], i;
+    char buffer[16000], *end = buffer;
+    double complex values[] = {3, -2}, *answers;
+    int64_t int_values[] = {6}, *int_answers;
+    tms_arg_list *labels = tms_get_args("x,y"), *int_labels = tms_get_args("n");
+    labels->payload = malloc(sizeof(values));
+    labels->payload_size = sizeof(values);
+    memcpy(labels->payload, values, sizeof(values));
+    int_labels->payload = malloc(sizeof(int_values));
+    int_labels->payload_size = sizeof(int_values);
+    memcpy(int_labels->payload, int_values, sizeof(int_values));
+
+    puts("Testing parallel list solving:");
+    // Failed expressions keep the answers of the others
+    tms_arg_list *L = tms_get_args("x*y+1,2*,sqrt(y),avg(x,y)^2,z");
+    answers = tms_solve_list_parallel(L, 0, labels, status);
+    if (answers == NULL || answers[0] != -5 || !isnan(creal(answers[1])) || !isnan(creal(answers[2])) ||
+        answers[3] != 0.25 || status[0] != 0 || status[1] != -1 || status[2] != -1 || status[3] != 0 || status[4] != -1)
+        failed = 1;
+    free(answers);
+    answers = tms_solve_list_parallel(L, ENABLE_CMPLX, labels, NULL);
+    if (answers == NULL || cabs(answers[2] - sqrt(2) * I) > 1e-15)
+        failed = 1;
+    free(answers);
+    tms_free_arg_list(L);
+
+    // Large lists are split between threads, the order is kept
+    tms_set_thread_pool_size(4);
+    for (i = 0; i < 1000; ++i)
+        end += sprintf(end, i == 0 ? "%d*x" : ",%d*x", i);
+    L = tms_get_args(buffer);
+    answers = tms_solve_list_parallel(L, 0, labels, status);
+    for (i = 0; i < 1000 && answers != NULL; ++i)
+        if (answers[i] != 3 * i || status[i] != 0)
+            failed = 1;
+    free(answers);
+    tms_free_arg_list(L);
+    tms_set_thread_pool_size(0);
+
+    L = tms_get_args("n<<2,5&,n/0,rr(n,1)");
+    int_answers = tms_int_solve_list_parallel(L, 0, int_labels, status);
+    if (int_answers == NULL || int_answers[0] != 24 || int_answers[1] != 0 || int_answers[2] != 0 || int_answers[3] != 3 ||
+        status[0] != 0 || status[1] != -1 || status[2] != -1 || status[3] != 0)
+        failed = 1;
+    free(int_answers);
+    tms_free_arg_list(L);
+
+    // The labels are not modified, the errors are cleared
+    if (labels->count != 2 || memcmp(labels->payload, values, sizeof(values)) != 0 ||
+        tms_get_error_count(TMS_ALL_FACILITIES, EH_ALL_ERRORS) != 0)
+        failed = 1;
+    tms_free_arg_list(labels);
+    tms_free_arg_list(int_labels);
+
+    if (failed)
+    {
+        puts("Parallel list solving test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+// Returns the sum of the times in folded stacks, or -1 if a line doesn't contain find
+int64_t sum_folded_profile(tms_expr_profile *P, const char *find, bool *found)
+{
+    char line[512];
+    int64_t sum = 0;
+    char *space;
+    FILE *tmp = tmpfile();
+    if (tmp == NULL || tms_write_folded_profile(P, tmp) != 0)
+        return -1;
+    rewind(tmp);
+    while (fgets(line, sizeof(line), tmp) != NULL)
+    {
+        space = strrchr(line, ' ');
+        if (space == NULL)
+            return -1;
+        sum += strtoll(space + 1, NULL, 10);
+        if (strstr(line, find) != NULL)
+            *found = true;
+    }
+    fclose(tmp);
+    return sum;
+}
+
+const tms_profile_entry *find_profile_function(tms_profile_entry *E, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; ++i)
+        if (strcmp(E[i].name, name) == 0)
+            return E + i;
+    return NULL;
+}
+
+void test_profile()
+{
+    int failed = 0, i;
+    int64_t int_result;
+    size_t count;
+    bool found = false;
+    const tms_profile_entry *sin_entry, *pf_entry, *avg_entry;
+    tms_profile_entry *E;
+
+    puts("Testing evaluation profiles:");
+    tms_set_ufunction("pf", "x", "sin(x)+x^2");
+    tms_set_ufunction("pz", "x", "1/(x-1)");
+    tms_math_expr *M = tms_parse_expr("pf(2)+avg(1,3)*sin(1)", 0, NULL);
+    if (M == NULL || M->profile != NULL || tms_enable_profile(M, "test") != 0)
+    {
+        puts("Profiling test failed.");
+        exit(1);
+    }
+
+    for (i = 0; i < 3; ++i)
+        tms_evaluate(M, 0);
+    tms_print_profile(M->profile, stdout);
+    E = tms_get_profile_functions(M->profile, &count);
+    sin_entry = find_profile_function(E, count, "sin");
+    pf_entry = find_profile_function(E, count, "pf");
+    avg_entry = find_profile_function(E, count, "avg");
+    // sin() is called by the expression and by pf()
+    if (M->profile->total.calls != 3 || sin_entry == NULL || sin_entry->calls != 6 || pf_entry == NULL ||
+        pf_entry->calls != 3 || avg_entry == NULL || avg_entry->calls != 3 || M->profile->subexprs[0].calls != 3)
+        failed = 1;
+    // The time of each frame is in one stack only, the frames of pf() are nested in its subexpression
+    if (sum_folded_profile(M->profile, " pf;S0 sin", &found) != (int64_t)M->profile->total.ns || !found)
+        failed = 1;
+    free(E);
+
+    // Copies don't share the profile
+    tms_math_expr *copy = tms_dup_mexpr(M);
+    if (copy->profile != NULL)
+        failed = 1;
+    tms_delete_math_expr(copy);
+    tms_disable_profile(M);
+    if (M->profile != NULL)
+        failed = 1;
+    tms_delete_math_expr(M);
+
+    // The frames of a failed evaluation are closed when it returns
+    M = tms_parse_expr("pz(1)+pf(1)", 0, NULL);
+    tms_enable_profile(M, NULL);
+    tms_evaluate(M, 0);
+    tms_clear_errors(TMS_ALL_FACILITIES);
+    tms_reset_profile(M->profile);
+    tms_evaluate(M, 0);
+    tms_clear_errors(TMS_ALL_FACILITIES);
+    found = false;
+    if (M->profile->total.calls != 1 || strcmp(M->profile->name, M->expr) != 0 ||
+        sum_folded_profile(M->profile, "pz", &found) != (int64_t)M->profile->total.ns || !found)
+        failed = 1;
+    tms_delete_math_expr(M);
+
+    tms_int_expr *IM = tms_parse_int_expr("rr(1,2)+not(5)", 0, NULL);
+    tms_enable_int_profile(IM, "int_test");
+    tms_int_evaluate(IM, &int_result, 0);
+    E = tms_get_profile_functions(IM->profile, &count);
+    if (count != 2 || find_profile_function(E, count, "rr") == NULL || find_profile_function(E, count, "not") == NULL)
+        failed = 1;
+    free(E);
+    tms_delete_int_expr(IM);
+    tms_remove_ufunc("pf");
+    tms_remove_ufunc("pz");
+
+    if (failed)
+    {
+        puts("Profiling test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
+// Completions reported to test_async_callback()
+pthread_mutex_t test_async_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t test_async_cond = PTHREAD_COND_INITIALIZER;
+int test_async_calls = 0;
+
+void test_async_callback(tms_async_job *job, void *data)
+{
+    cdouble *result = data;
+    if (tms_async_result(job, result) != 0)
+        *result = NAN;
+    pthread_mutex_lock(&test_async_lock);
+    ++test_async_calls;
+    pthread_cond_broadcast(&test_async_cond);
+    pthread_mutex_unlock(&test_async_lock);
+}
+
+void test_async_wait_calls(int calls)
+{
+    pthread_mutex_lock(&test_async_lock);
+    while (test_async_calls < calls)
+        pthread_cond_wait(&test_async_cond, &test_async_lock);
+    pthread_mutex_unlock(&test_async_lock);
+}
+
+// Signals its start then returns after a delay, tms_async_free() must wait for it
+void test_async_slow_callback(tms_async_job *job, void *data)
+{
+    int *step = data;
+    struct timespec delay = {0, 50000000};
+    (void)job;
+    pthread_mutex_lock(&test_async_lock);
+    *step = 1;
+    pthread_cond_broadcast(&test_async_cond);
+    pthread_mutex_unlock(&test_async_lock);
+    nanosleep(&delay, NULL);
+    pthread_mutex_lock(&test_async_lock);
+    *step = 2;
+    pthread_mutex_unlock(&test_async_lock);
+}
+
+// Frees its own job
+void test_async_free_callback(tms_async_job *job, void *data)
+{
+    test_async_callback(job, data);
+    tms_async_free(job);
+}
+
+// Waits until a job is taken by a pool thread
+void test_async_wait_running(tms_async_job *job)
+{
+    struct timespec delay = {0, 1000000};
+    while (tms_async_state(job) == TMS_ASYNC_QUEUED)
+        nanosleep(&delay, NULL);
+}
+
+void test_async_evaluation()
+{
+    int failed = 0;
+    size_t count = 0, n;
+    cdouble result, callback_result;
+    double complex values[] = {3};
+    tms_async_job *jobs[3], *done[3], *A, *B;
+    tms_arg_list *labels = tms_get_args("y");
+    labels->payload = malloc(sizeof(values));
+    labels->payload_size = sizeof(values);
+    memcpy(labels->payload, values, sizeof(values));
+
+    puts("Testing asynchronous evaluation:");
+    // Callback, the labels are copied
+    A = tms_evaluate_async("y^2+integrate(0,1,x)", SHARED_LOCK, labels, test_async_callback, &callback_result);
+    tms_free_arg_list(labels);
+    test_async_wait_calls(1);
+    // Same answer as a synchronous evaluation
+    if (A == NULL || tms_async_wait(A) != TMS_ASYNC_DONE || callback_result != tms_solve_e("9+integrate(0,1,x)", 0, NULL) ||
+        tms_async_data(A) != &callback_result || tms_async_error(A) != NULL)
+        failed = 1;
+    tms_async_free(A);
+
+    // Completion descriptor, failed jobs keep their error message
+    int fd = tms_async_eventfd();
+    jobs[0] = tms_evaluate_async("1+1", 0, NULL, NULL, NULL);
+    jobs[1] = tms_evaluate_async("2*", 0, NULL, NULL, NULL);
+    jobs[2] = tms_evaluate_async("sqrt(-4)", ENABLE_CMPLX | SHARED_LOCK, NULL, NULL, NULL);
+    struct pollfd P = {fd, POLLIN, 0};
+    while (fd != -1 && count < 3 && poll(&P, 1, 10000) == 1)
+        count += tms_async_completed(done + count, 3 - count);
+    for (n = 0; n < count; ++n)
+    {
+        if (done[n] == jobs[0] && (tms_async_result(done[n], &result) != 0 || result != 2))
+            failed = 1;
+        if (done[n] == jobs[1] && (tms_async_state(done[n]) != TMS_ASYNC_FAILED || tms_async_error(done[n]) == NULL))
+            failed = 1;
+        if (done[n] == jobs[2] && (tms_async_result(done[n], &result) != 0 || cabs(result - 2 * I) > 1e-15))
+            failed = 1;
+    }
+    // Nothing left to report
+    if (count != 3 || poll(&P, 1, 0) != 0 || tms_async_completed(done, 3) != 0)
+        failed = 1;
+    for (n = 0; n < 3; ++n)
+        tms_async_free(jobs[n]);
+
+    // A single pool thread: A runs while B is queued
+    tms_set_thread_pool_size(2);
+    A = tms_evaluate_async("integrate(0,1000,sin(x))", SHARED_LOCK, NULL, NULL, NULL);
+    B = tms_evaluate_async("integrate(0,1,x)", SHARED_LOCK, NULL, test_async_callback, &callback_result);
+    test_async_wait_running(A);
+    // The queued job completes in this thread
+    tms_async_cancel(B);
+    if (tms_async_state(B) != TMS_ASYNC_CANCELLED || test_async_calls != 2 || !isnan(creal(callback_result)))
+        failed = 1;
+    // The running integration stops
+    tms_async_cancel(A);
+    if (tms_async_wait(A) != TMS_ASYNC_CANCELLED || tms_async_result(A, &result) != -1 ||
+        strcmp(tms_async_error(A), EVALUATION_CANCELLED) != 0)
+        failed = 1;
+    tms_async_free(A);
+    tms_async_free(B);
+
+    // Freeing a running job cancels it
+    A = tms_evaluate_async("derivative(x^2,1)+integrate(0,1000,cos(x))", 0, NULL, NULL, NULL);
+    test_async_wait_running(A);
+    tms_async_free(A);
+
+    // A callback running in a pool thread returns before the job is freed
+    int step = 0;
+    A = tms_evaluate_async("1+1", 0, NULL, test_async_slow_callback, &step);
+    pthread_mutex_lock(&test_async_lock);
+    while (step == 0)
+        pthread_cond_wait(&test_async_cond, &test_async_lock);
+    pthread_mutex_unlock(&test_async_lock);
+    tms_async_free(A);
+    pthread_mutex_lock(&test_async_lock);
+    if (step != 2)
+        failed = 1;
+    pthread_mutex_unlock(&test_async_lock);
+
+    // The callback frees its own job
+    tms_evaluate_async("2+2", 0, NULL, test_async_free_callback, &callback_result);
+    test_async_wait_calls(3);
+    if (callback_result != 4)
+        failed = 1;
+    tms_stop_thread_pool();
+    tms_set_thread_pool_size(0);
+
+    if (failed || tms_get_error_count(TMS_ALL_FACILITIES, EH_ALL_ERRORS) != 0)
+    {
+        puts("Asynchronous evaluation test failed.");
+        exit(1);
+    }
+    puts("Passed\n--------------------\n");
+}
+
 int main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        puts("Missing argument\nUsage: tms_test a|r test_file");
+        puts("Missing argument\nUsage: tms_test a|r|c|j test_file\n       tms_test m|s|t|p|b|e|w|l|q");
         exit(1);
     }
+    // Matrix test: Doesn't use a test file
+    if (argv[1][0] == 'm')
+    {
+        test_matrix();
+        return 0;
+    }
+    // Symbol table test: Doesn't use a test file
+    if (argv[1][0] == 's')
+    {
+        test_symtab();
+        test_builtins();
+        return 0;
+    }
+    // Profiling counters test: Doesn't use a test file
+    if (argv[1][0] == 't')
+    {
+        test_stats();
+        return 0;
+    }
+    // Evaluation profiles test: Doesn't use a test file
+    if (argv[1][0] == 'p')
+    {
+        test_profile();
+        return 0;
+    }
+    // Batch evaluation test: Doesn't use a test file
+    if (argv[1][0] == 'b')
+    {
+        test_evaluate_batch();
+        return 0;
+    }
+    // Concurrent evaluations test: Doesn't use a test file
+    if (argv[1][0] == 'e')
+    {
+        test_shared_evaluation();
+        return 0;
+    }
+    // Thread pool test: Doesn't use a test file
+    if (argv[1][0] == 'w')
+    {
+        test_thread_pool();
+        return 0;
+    }
+    // Parallel list solving test: Doesn't use a test file
+    if (argv[1][0] == 'l')
+    {
+        test_solve_list_parallel();
+        return 0;
+    }
+    // Asynchronous evaluation test: Doesn't use a test file
+    if (argv[1][0] == 'q')
+    {
+        test_async_evaluation();
+        return 0;
+    }
     // Load the test file, should have the following format:
     // Mode_char:expression1;expected_answer1
     // Mode_char is either S or B
@@ -210,5 +1715,11 @@ int main(int argc, char **argv)
         }
         puts("All test cases produced errors as expected.");
     }
+    // Catalog test: Expressions loaded from a catalog file should match the parsed ones
+    else if (argv[1][0] == 'c')
+        test_catalog(test_file);
+    // JIT test: Compiled expressions should produce the same answers as the evaluator
+    else if (argv[1][0] == 'j')
+        test_jit(test_file);
     return 0;
 }
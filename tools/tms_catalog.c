@@ -0,0 +1,144 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+
+// Builds a catalog of user functions from a definitions file, to be loaded with tms_load_ufunc_catalog()
+
+#include "error_handler.h"
+#include "internals.h"
+#include "serializer.h"
+#include "string_tools.h"
+#include "tms_math_strs.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void print_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  %s [-i] <definitions> <catalog>  Build a catalog (-i for int functions)\n"
+            "  %s -l <catalog>                  List the functions of a catalog\n\n"
+            "The definitions file has one function per line: name(arg1,arg2,...)=expression\n"
+            "Empty lines and lines starting with # are ignored, a function must be defined before its use.\n",
+            program, program);
+}
+
+// Defines the function in "line", returns 0 on success
+int define_function(char *line, bool int_mode)
+{
+    char *lparenthesis = strchr(line, '('), *equal = strchr(line, '=');
+    if (lparenthesis == NULL || equal == NULL || lparenthesis > equal)
+        return -1;
+
+    int rparenthesis = tms_find_closing_parenthesis(line, lparenthesis - line);
+    if (rparenthesis == -1 || line + rparenthesis > equal)
+        return -1;
+
+    *lparenthesis = '\0';
+    line[rparenthesis] = '\0';
+    *equal = '\0';
+
+    if (int_mode)
+        return tms_set_int_ufunction(line, lparenthesis + 1, equal + 1);
+    else
+        return tms_set_ufunction(line, lparenthesis + 1, equal + 1);
+}
+
+int build_catalog(const char *definitions, const char *catalog, bool int_mode)
+{
+    FILE *file = fopen(definitions, "r");
+    if (file == NULL)
+    {
+        perror(definitions);
+        return 1;
+    }
+
+    char buffer[10000];
+    int line_number = 0, count = 0;
+    while (fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        ++line_number;
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        tms_remove_whitespace(buffer);
+        if (buffer[0] == '\0' || buffer[0] == '#')
+            continue;
+
+        if (define_function(buffer, int_mode) != 0)
+        {
+            fprintf(stderr, "%s:%d: invalid function definition\n", definitions, line_number);
+            tms_print_errors(TMS_PARSER);
+            fclose(file);
+            return 1;
+        }
+        ++count;
+    }
+    fclose(file);
+
+    int status = (int_mode ? tms_save_int_ufunctions(catalog) : tms_save_ufunctions(catalog));
+    if (status != 0)
+    {
+        tms_print_errors(TMS_GENERAL);
+        return 1;
+    }
+    printf("Saved %d functions to %s\n", count, catalog);
+    return 0;
+}
+
+int list_catalog(const char *path)
+{
+    tms_catalog *C = tms_open_catalog(path);
+    if (C == NULL)
+    {
+        tms_print_errors(TMS_GENERAL);
+        return 1;
+    }
+
+    int count = tms_catalog_count(C);
+    bool int_mode = (tms_catalog_type(C) == TMS_CATALOG_INT);
+    for (int i = 0; i < count; ++i)
+    {
+        const char *name = tms_catalog_get_name(C, i), *expr;
+        tms_arg_list *labels;
+        if (int_mode)
+        {
+            tms_int_expr *M = tms_catalog_get_int_expr(C, i);
+            expr = (M == NULL ? NULL : M->expr);
+            labels = (M == NULL ? NULL : M->labels);
+        }
+        else
+        {
+            tms_math_expr *M = tms_catalog_get_math_expr(C, i);
+            expr = (M == NULL ? NULL : M->expr);
+            labels = (M == NULL ? NULL : M->labels);
+        }
+
+        if (expr == NULL)
+        {
+            tms_print_errors(TMS_GENERAL);
+            tms_close_catalog(C);
+            return 1;
+        }
+
+        char *args = (labels == NULL ? NULL : tms_args_to_string(labels));
+        printf("%s(%s)=%s\n", (name == NULL ? "?" : name), (args == NULL ? "" : args), expr);
+        free(args);
+    }
+    tms_close_catalog(C);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "-l") == 0)
+        return list_catalog(argv[2]);
+    else if (argc == 3)
+        return build_catalog(argv[1], argv[2], false);
+    else if (argc == 4 && strcmp(argv[1], "-i") == 0)
+        return build_catalog(argv[2], argv[3], true);
+
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,192 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: LGPL-2.1-only
+*/
+
+// Generates the minimal perfect hash tables of the built-in functions and constants listed in src/builtins.h
+
+#include "builtins.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Displacements tried for a bucket before giving up
+#define MAX_DISPLACEMENT (1u << 24)
+
+#define NAME_ONLY(name, ...) name,
+
+const char *vars[] = {TMS_BUILTIN_VARS(NAME_ONLY)};
+const char *rc_funcs[] = {TMS_BUILTIN_RC_FUNCS(NAME_ONLY)};
+const char *extfs[] = {TMS_BUILTIN_EXTFS(NAME_ONLY)};
+const char *int_funcs[] = {TMS_BUILTIN_INT_FUNCS(NAME_ONLY)};
+const char *int_extfs[] = {TMS_BUILTIN_INT_EXTFS(NAME_ONLY)};
+
+#define array_length(z) (sizeof(z) / sizeof(*z))
+
+typedef struct bucket
+{
+    uint32_t id;
+    uint32_t size;
+    // Indexes of the names in the bucket
+    uint32_t *names;
+} bucket;
+
+// Largest buckets first, they are the hardest to place
+int compare_buckets(const void *a, const void *b)
+{
+    const bucket *x = a, *y = b;
+    if (x->size != y->size)
+        return x->size < y->size ? 1 : -1;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+// Finds the displacements for the names and writes the tables to out, returns 0 on success
+int generate(FILE *out, const char *prefix, const char **names, uint32_t count)
+{
+    if (count > UINT8_MAX)
+    {
+        fprintf(stderr, "%s: too many names (%u), the index is 8 bits\n", prefix, count);
+        return -1;
+    }
+
+    uint32_t buckets = count / 2 + 1, i, j, k, d;
+    uint64_t *hashes = malloc(count * sizeof(uint64_t));
+    uint64_t(*keys)[TMS_SYMTAB_KEY_SIZE / 8] = malloc(count * sizeof(*keys));
+    size_t len;
+    uint32_t *displacement = calloc(buckets, sizeof(uint32_t)), *slots = malloc(count * sizeof(uint32_t));
+    uint8_t *index = malloc(count);
+    bool *used = calloc(count, sizeof(bool)), placed;
+    bucket *B = calloc(buckets, sizeof(bucket));
+    int status = 0;
+
+    for (i = 0; i < buckets; ++i)
+    {
+        B[i].id = i;
+        B[i].names = malloc(count * sizeof(uint32_t));
+    }
+    for (i = 0; i < count; ++i)
+    {
+        for (j = 0; j < i; ++j)
+            if (strcmp(names[i], names[j]) == 0)
+            {
+                fprintf(stderr, "%s: duplicate name \"%s\"\n", prefix, names[i]);
+                status = -1;
+                goto cleanup;
+            }
+        len = _tms_symtab_key(names[i], keys[i]);
+        hashes[i] = _tms_phf_hash(names[i], keys[i], len);
+        k = _tms_phf_bucket(hashes[i], buckets);
+        B[k].names[B[k].size++] = i;
+    }
+    qsort(B, buckets, sizeof(bucket), compare_buckets);
+
+    for (i = 0; i < buckets && B[i].size != 0; ++i)
+    {
+        placed = false;
+        for (d = 0; d < MAX_DISPLACEMENT && !placed; ++d)
+        {
+            placed = true;
+            for (j = 0; j < B[i].size && placed; ++j)
+            {
+                slots[j] = _tms_phf_slot(hashes[B[i].names[j]], d, count);
+                if (used[slots[j]])
+                    placed = false;
+                // Names of the same bucket must not collide either
+                for (k = 0; k < j && placed; ++k)
+                    if (slots[k] == slots[j])
+                        placed = false;
+            }
+            if (placed)
+            {
+                displacement[B[i].id] = d;
+                for (j = 0; j < B[i].size; ++j)
+                {
+                    used[slots[j]] = true;
+                    index[slots[j]] = B[i].names[j];
+                }
+            }
+        }
+        if (!placed)
+        {
+            fprintf(stderr, "%s: no displacement found for bucket %u\n", prefix, B[i].id);
+            status = -1;
+            goto cleanup;
+        }
+    }
+
+    fprintf(out, "static const uint32_t _tms_%s_displacement[] = {", prefix);
+    for (i = 0; i < buckets; ++i)
+        fprintf(out, i == 0 ? "%u" : ", %u", displacement[i]);
+    fprintf(out, "};\n");
+    fprintf(out, "static const uint64_t _tms_%s_keys[][%d] = {\n", prefix, TMS_SYMTAB_KEY_SIZE / 8);
+    for (i = 0; i < count; ++i)
+        fprintf(out, "    {0x%" PRIX64 ", 0x%" PRIX64 "}, // %s\n", keys[index[i]][0], keys[index[i]][1], names[index[i]]);
+    fprintf(out, "};\n");
+    fprintf(out, "static const uint8_t _tms_%s_index[] = {", prefix);
+    for (i = 0; i < count; ++i)
+        fprintf(out, i == 0 ? "%u" : ", %u", index[i]);
+    fprintf(out, "};\n");
+    fprintf(out, "static const _tms_phf _tms_%s_phf = {\n    %u, %u, _tms_%s_displacement, _tms_%s_keys, _tms_%s_index};\n\n",
+            prefix, count, buckets, prefix, prefix, prefix);
+
+cleanup:
+    for (i = 0; i < buckets; ++i)
+        free(B[i].names);
+    free(B);
+    free(hashes);
+    free(keys);
+    free(displacement);
+    free(slots);
+    free(index);
+    free(used);
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *out = stdout;
+    int status = 0;
+    if (argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [output]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2)
+    {
+        out = fopen(argv[1], "w");
+        if (out == NULL)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    fputs("/*\n"
+          "Copyright (C) 2026 Ahmad Ismail\n"
+          "SPDX-License-Identifier: LGPL-2.1-only\n"
+          "*/\n"
+          "// Generated by tools/tms_gen_builtins.c from builtins.h, do not edit\n"
+          "#ifndef _TMS_BUILTINS_PHF_H\n"
+          "#define _TMS_BUILTINS_PHF_H\n\n"
+          "#include \"builtins.h\"\n\n",
+          out);
+    status |= generate(out, "builtin_vars", vars, array_length(vars));
+    status |= generate(out, "rc_func", rc_funcs, array_length(rc_funcs));
+    status |= generate(out, "extf", extfs, array_length(extfs));
+    status |= generate(out, "int_func", int_funcs, array_length(int_funcs));
+    status |= generate(out, "int_extf", int_extfs, array_length(int_extfs));
+    fputs("#endif\n", out);
+
+    if (out != stdout)
+        fclose(out);
+    if (status != 0)
+    {
+        // Don't leave an incomplete header that looks up to date
+        if (out != stdout)
+            remove(argv[1]);
+        return 1;
+    }
+    return 0;
+}